@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Compares the way send_message_async dispatches requests: a new thread per
+// call through std::async, against the shared request pool. Short tasks show
+// the per-call dispatch cost; tasks that sleep stand in for requests blocked
+// in curl and show how many threads a fan-out keeps alive at once.
+//
+// Usage: async_dispatch_bench [calls]
+
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct result {
+    double ms;
+    int peak_threads;
+};
+
+template <typename Dispatch>
+result fan_out(size_t calls, std::chrono::microseconds blocked, Dispatch dispatch) {
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    auto task = [&] {
+        const int now = running.fetch_add(1) + 1;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+        if (blocked.count() > 0) {
+            std::this_thread::sleep_for(blocked);
+        }
+        running.fetch_sub(1);
+        return 0;
+    };
+
+    const auto start = clock_type::now();
+    std::vector<std::future<int>> futures;
+    futures.reserve(calls);
+    for (size_t i = 0; i < calls; ++i) {
+        futures.push_back(dispatch(task));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    return {std::chrono::duration<double, std::milli>(clock_type::now() - start).count(),
+            peak.load()};
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    auto& pool = thread_pool::shared_io();
+    auto by_async = [](auto& task) { return std::async(std::launch::async, task); };
+    auto by_pool = [&pool](auto& task) { return pool.submit(task); };
+
+    std::printf("%zu calls, request pool of %zu threads\n", calls, pool.size());
+    std::printf("%10s  %24s  %24s\n", "blocked", "std::async", "shared_io");
+    for (auto blocked : {std::chrono::microseconds(0), std::chrono::microseconds(1000),
+                         std::chrono::microseconds(10000)}) {
+        const auto before = fan_out(calls, blocked, by_async);
+        const auto after = fan_out(calls, blocked, by_pool);
+        std::printf("%8lldus  %9.1f ms %5d threads  %9.1f ms %5d threads\n",
+                    static_cast<long long>(blocked.count()), before.ms, before.peak_threads,
+                    after.ms, after.peak_threads);
+    }
+    std::printf("steals: %zu\n", pool.steals());
+    return 0;
+}
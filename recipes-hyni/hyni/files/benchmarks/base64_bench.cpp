@@ -0,0 +1,121 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Compares the base64 kernels with the previous byte-at-a-time implementations
+// of response_utils::base64_encode and general_context::is_base64_encoded.
+//
+// Usage: base64_bench [size_in_mb]
+
+#include "base64.h"
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace hyni;
+
+namespace {
+
+std::string legacy_encode(const unsigned char* data, size_t len) {
+    static constexpr char encoding_table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz"
+        "0123456789+/";
+
+    std::string ret;
+    ret.reserve(4 * ((len + 2) / 3));
+
+    for (size_t i = 0; i < len;) {
+        size_t bytes_left = len - i;
+
+        uint32_t octet_a = data[i++];
+        uint32_t octet_b = (bytes_left > 1) ? data[i++] : 0;
+        uint32_t octet_c = (bytes_left > 2) ? data[i++] : 0;
+
+        uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
+
+        ret += encoding_table[(triple >> 18) & 0x3F];
+        ret += encoding_table[(triple >> 12) & 0x3F];
+        ret += (bytes_left > 1) ? encoding_table[(triple >> 6) & 0x3F] : '=';
+        ret += (bytes_left > 2) ? encoding_table[triple & 0x3F] : '=';
+    }
+
+    return ret;
+}
+
+bool legacy_validate(const std::string& data) {
+    constexpr std::string_view base64_chars =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+
+    size_t padding = 0;
+    size_t data_len = 0;
+    for (char c : data) {
+        if (std::isspace(c)) continue;
+        if (base64_chars.find(c) == std::string_view::npos) return false;
+        if (c == '=') {
+            if (++padding > 2) return false;
+        }
+        data_len++;
+    }
+    return (data_len % 4 == 0) && (padding != 1);
+}
+
+template <typename F>
+void measure(const char* operation, const char* kernel, size_t bytes, F&& f) {
+    f(); // Warm up
+    constexpr int iterations = 5;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    const double mb = static_cast<double>(bytes) * iterations / (1024.0 * 1024.0);
+    std::printf("%-8s %-8s %10.1f MB/s\n", operation, kernel, mb / elapsed.count());
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const size_t size = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8) * 1024 * 1024;
+
+    std::mt19937 rng(1);
+    std::string input(size, '\0');
+    for (auto& c : input) c = static_cast<char>(rng() & 0xFF);
+    const auto* data = reinterpret_cast<const unsigned char*>(input.data());
+    const std::string encoded = base64::encode(input, base64::kernel::scalar);
+
+    std::printf("input: %zu bytes, active kernel: %s\n\n", size,
+                base64::kernel_name(base64::active_kernel()));
+
+    volatile size_t sink = 0;
+    measure("encode", "legacy", size, [&] { sink = legacy_encode(data, size).size(); });
+    measure("validate", "legacy", encoded.size(), [&] { sink = legacy_validate(encoded); });
+
+    std::string out(base64::encoded_size(size), '\0');
+    std::string decoded(size, '\0');
+    for (auto k : base64::supported_kernels()) {
+        const char* name = base64::kernel_name(k);
+        measure("encode", name, size, [&] { sink = base64::encode_to(data, size, out.data(), k); });
+        measure("decode", name, encoded.size(), [&] {
+            sink = *base64::decode_to(encoded, reinterpret_cast<unsigned char*>(decoded.data()), k);
+        });
+        measure("validate", name, encoded.size(), [&] { sink = base64::is_valid(encoded, k); });
+        if (out != encoded || decoded != input) {
+            std::printf("MISMATCH in %s kernel\n", name);
+            return 1;
+        }
+    }
+    (void)sink;
+    return 0;
+}
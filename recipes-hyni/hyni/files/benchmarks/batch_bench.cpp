@@ -0,0 +1,117 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Measures batch file throughput against plain file I/O of the same bytes:
+// writing a request file with batch_builder, and reading a result file back
+// with batch_result_reader.
+//
+// Usage: batch_bench [schema_path] [requests]
+
+#include "batch_builder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+double mb_per_s(size_t bytes, double seconds) {
+    return bytes / seconds / (1024.0 * 1024.0);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const std::string schema = argc > 1 ? argv[1] : "../schemas/openai.json";
+    const size_t requests = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    const auto dir = std::filesystem::temp_directory_path() /
+                     ("hyni_batch_bench_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir);
+
+    general_context context(schema);
+    context.set_system_message("Classify the sentiment of the review.");
+
+    // About 1 KB of prompt per request
+    std::string filler;
+    for (int i = 0; filler.size() < 1000; ++i) {
+        filler += "word" + std::to_string(i) + " ";
+    }
+
+    const auto request_path = dir / "requests.jsonl";
+    auto start = clock_type::now();
+    size_t request_bytes = 0;
+    {
+        batch_builder builder(context, request_path);
+        for (size_t i = 0; i < requests; ++i) {
+            builder.add("review-" + std::to_string(i), "Review " + std::to_string(i) + ": " + filler);
+        }
+        builder.finish();
+        request_bytes = builder.bytes();
+    }
+    const double build_s = seconds_since(start);
+
+    // The same bytes written as-is, for comparison
+    std::string contents(request_bytes, '\0');
+    std::ifstream(request_path, std::ios::binary).read(contents.data(), contents.size());
+    start = clock_type::now();
+    {
+        std::ofstream out(dir / "copy.jsonl", std::ios::binary);
+        for (size_t pos = 0; pos < contents.size(); pos += 1024 * 1024) {
+            out.write(contents.data() + pos, std::min<size_t>(1024 * 1024, contents.size() - pos));
+        }
+    }
+    const double copy_s = seconds_since(start);
+
+    local_batch_uploader uploader([&](const nlohmann::json&) {
+        return nlohmann::json{{"choices", {{{"message", {{"content", "positive " + filler.substr(0, 200)}}}}}}};
+    });
+    const auto result_path = *uploader.results(uploader.submit(request_path));
+    const size_t result_bytes = std::filesystem::file_size(result_path);
+
+    start = clock_type::now();
+    size_t text_bytes = 0;
+    batch_result_reader reader(context, result_path);
+    const size_t outcomes = reader.for_each([&](const batch_outcome& outcome) {
+        text_bytes += outcome.text.size();
+    });
+    const double read_s = seconds_since(start);
+
+    start = clock_type::now();
+    size_t lines = 0;
+    {
+        std::ifstream in(result_path, std::ios::binary);
+        std::string line;
+        while (std::getline(in, line)) ++lines;
+    }
+    const double scan_s = seconds_since(start);
+
+    std::printf("requests        %zu, %.1f MB\n", requests, request_bytes / 1048576.0);
+    std::printf("batch_builder   %8.1f MB/s  (%.0f requests/s)\n", mb_per_s(request_bytes, build_s),
+                requests / build_s);
+    std::printf("plain write     %8.1f MB/s\n", mb_per_s(request_bytes, copy_s));
+    std::printf("results         %zu, %.1f MB\n", outcomes, result_bytes / 1048576.0);
+    std::printf("result reader   %8.1f MB/s  (%.0f outcomes/s, %zu text bytes)\n",
+                mb_per_s(result_bytes, read_s), outcomes / read_s, text_bytes);
+    std::printf("line scan       %8.1f MB/s  (%zu lines)\n", mb_per_s(result_bytes, scan_s), lines);
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
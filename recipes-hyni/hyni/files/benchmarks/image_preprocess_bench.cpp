@@ -0,0 +1,175 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Measures what image preprocessing saves: encoded bytes, and the end-to-end
+// time of preparing plus uploading an image at a given uplink bandwidth.
+//
+// Usage: image_preprocess_bench [image_path] [uplink_mbit]
+// Without a path, a 4032x3024 camera-sized JPEG is synthesised first.
+
+#include "image_processor.h"
+#include "base64.h"
+#include "media_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double ms_since(clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// Textured RGB pixels: smooth gradients plus sensor-like noise
+std::string synthesize_camera_jpeg(uint32_t width, uint32_t height) {
+    // Minimal stored-deflate PNG as the lossless source
+    auto be32 = [](std::string& out, uint32_t v) {
+        for (int s = 24; s >= 0; s -= 8) out.push_back(char(v >> s));
+    };
+    auto crc = [](const std::string& data) {
+        uint32_t c = 0xFFFFFFFFu;
+        for (unsigned char b : data) {
+            c ^= b;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        return c ^ 0xFFFFFFFFu;
+    };
+    auto chunk = [&](std::string& out, const char* type, const std::string& body) {
+        be32(out, static_cast<uint32_t>(body.size()));
+        out += type + body;
+        be32(out, crc(type + body));
+    };
+
+    std::mt19937 rng(7);
+    std::string raw;
+    raw.reserve(size_t(height) * (width * 3 + 1));
+    for (uint32_t y = 0; y < height; ++y) {
+        raw.push_back('\0');
+        for (uint32_t x = 0; x < width; ++x) {
+            const double shade = 128 + 100 * std::sin(x / 150.0) * std::cos(y / 90.0);
+            for (int c = 0; c < 3; ++c) {
+                raw.push_back(char(std::clamp<int>(int(shade) + c * 20 + int(rng() % 24), 0, 255)));
+            }
+        }
+    }
+
+    std::string zlib = "\x78\x01";
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t pos = 0; pos < raw.size(); pos += 65535) {
+        const size_t len = std::min<size_t>(65535, raw.size() - pos);
+        zlib.push_back(pos + len >= raw.size() ? '\x01' : '\x00');
+        zlib.push_back(char(len & 0xFF));
+        zlib.push_back(char(len >> 8));
+        zlib.push_back(char(~len & 0xFF));
+        zlib.push_back(char((~len >> 8) & 0xFF));
+        zlib.append(raw, pos, len);
+    }
+    be32(zlib, (b << 16) | a);
+
+    std::string png = "\x89PNG\r\n\x1A\n", ihdr;
+    be32(ihdr, width);
+    be32(ihdr, height);
+    ihdr += std::string("\x08\x02\0\0\0", 5);
+    chunk(png, "IHDR", ihdr);
+    chunk(png, "IDAT", zlib);
+    chunk(png, "IEND", "");
+
+    // Transcode at full size and high quality, as a phone camera would store it
+    image_options options;
+    options.enabled = true;
+    options.max_dimension = std::max(width, height);
+    options.jpeg_quality = 95;
+    return image_processor(options, 0, {"image/jpeg"}).process(png)->data;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (!image_processor::codecs_available()) {
+        std::printf("hyni was built without image codecs; nothing to measure\n");
+        return 0;
+    }
+
+    const double uplink_mbit = argc > 2 ? std::atof(argv[2]) : 10.0;
+    std::string original;
+    if (argc > 1) {
+        auto file = media_file::open(argv[1], 64 * 1024 * 1024);
+        original = std::string(file.contents());
+    } else {
+        original = synthesize_camera_jpeg(4032, 3024);
+    }
+    const auto info = image_processor::probe(original);
+    if (!info) {
+        std::printf("unrecognised image\n");
+        return 1;
+    }
+
+    image_options options;
+    options.enabled = true;
+    image_processor processor(options, 5 * 1024 * 1024);
+
+    const auto start = clock_type::now();
+    const auto processed = processor.process(original);
+    const double process_ms = ms_since(start);
+    const std::string& sent = processed ? processed->data : original;
+
+    const size_t before = base64::encoded_size(original.size());
+    const size_t after = base64::encoded_size(sent.size());
+    const double bytes_per_ms = uplink_mbit * 1e6 / 8 / 1000;
+    const double upload_before = before / bytes_per_ms;
+    const double upload_after = after / bytes_per_ms;
+
+    std::printf("input     %ux%u, %zu bytes\n", info->width, info->height, original.size());
+    if (processed) {
+        std::printf("output    %ux%u %s, %zu bytes\n", processed->width, processed->height,
+                    processed->media_type.c_str(), processed->data.size());
+    }
+    std::printf("base64    %zu -> %zu bytes (%.1f%% saved)\n", before, after,
+                100.0 * (1.0 - double(after) / before));
+    std::printf("uplink    %.1f Mbit/s\n", uplink_mbit);
+    std::printf("as-is     %8.1f ms upload\n", upload_before);
+    std::printf("processed %8.1f ms process + %.1f ms upload = %.1f ms\n", process_ms,
+                upload_after, process_ms + upload_after);
+
+    // Several images prepared on the shared pool versus one after another
+    constexpr int images = 4;
+    auto serial_start = clock_type::now();
+    for (int i = 0; i < images; ++i) {
+        (void)processor.process(original);
+    }
+    const double serial_ms = ms_since(serial_start);
+
+    auto pool_start = clock_type::now();
+    std::vector<std::future<std::optional<image_processor::result>>> pending;
+    for (int i = 0; i < images; ++i) {
+        pending.push_back(processor.process_async(original));
+    }
+    for (auto& f : pending) {
+        (void)f.get();
+    }
+    const double pool_ms = ms_since(pool_start);
+    std::printf("%d images serial %.1f ms, on %zu-thread pool %.1f ms\n", images, serial_ms,
+                thread_pool::shared().size(), pool_ms);
+    return 0;
+}
@@ -0,0 +1,122 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Compares loading and encoding an image with media_file against the previous
+// ifstream-based path, in time and in peak heap memory.
+//
+// Usage: media_load_bench [image_path]
+// Without a path, a 10 MB file of random bytes is created in the temp directory.
+
+#include "media_file.h"
+#include "base64.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+std::atomic<size_t> g_current{0};
+std::atomic<size_t> g_peak{0};
+
+void track_alloc(size_t size) {
+    const size_t now = g_current.fetch_add(size) + size;
+    size_t peak = g_peak.load();
+    while (now > peak && !g_peak.compare_exchange_weak(peak, now)) {}
+}
+
+} // anonymous namespace
+
+// Every allocation carries its size in a header so that peak usage can be tracked
+void* operator new(size_t size) {
+    auto* p = static_cast<size_t*>(std::malloc(size + 16));
+    if (!p) throw std::bad_alloc();
+    *p = size;
+    track_alloc(size);
+    return reinterpret_cast<char*>(p) + 16;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    auto* p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - 16);
+    g_current.fetch_sub(*p);
+    std::free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+namespace {
+
+std::string legacy_load(const std::string& image_path) {
+    std::ifstream file(image_path, std::ios::binary);
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+    return base64::encode(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size());
+}
+
+std::string mapped_load(const std::string& image_path) {
+    return media_file::open(image_path, 64 * 1024 * 1024).encode_base64();
+}
+
+template <typename F>
+void measure(const char* name, const std::string& path, F&& load) {
+    (void)load(path); // Warm the page cache
+
+    const size_t baseline = g_current.load();
+    g_peak.store(baseline);
+    constexpr int iterations = 10;
+    size_t encoded = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        encoded = load(path).size();
+    }
+    const auto elapsed = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start);
+
+    std::printf("%-8s %8.2f ms/load  peak heap %6.1f MB  (encoded %zu bytes)\n", name,
+                elapsed.count() / iterations,
+                static_cast<double>(g_peak.load() - baseline) / (1024.0 * 1024.0), encoded);
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    std::string path;
+    bool temporary = false;
+    if (argc > 1) {
+        path = argv[1];
+    } else {
+        path = (std::filesystem::temp_directory_path() / "hyni_media_load_bench.bin").string();
+        std::mt19937 rng(1);
+        std::string data(10 * 1024 * 1024, '\0');
+        for (auto& c : data) c = static_cast<char>(rng());
+        std::ofstream(path, std::ios::binary) << data;
+        temporary = true;
+    }
+
+    std::printf("file: %s (%ju bytes)\n", path.c_str(),
+                static_cast<uintmax_t>(std::filesystem::file_size(path)));
+    measure("ifstream", path, legacy_load);
+    measure("mmap", path, mapped_load);
+
+    if (temporary) {
+        std::filesystem::remove(path);
+    }
+    return 0;
+}
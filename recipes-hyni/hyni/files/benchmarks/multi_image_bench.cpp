@@ -0,0 +1,85 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Compares preparing a message with ten image attachments against preparing
+// one with only the largest of them. With parallel encoding the two should be
+// close once the shared pool has as many workers as there are images.
+//
+// Usage: multi_image_bench [schema_path]
+
+#include "general_context.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+template <typename F>
+double best_of(int runs, F&& body) {
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const std::string schema = argc > 1 ? argv[1] : "../schemas/claude.json";
+    const auto dir = std::filesystem::temp_directory_path() / "hyni_multi_image_bench";
+    std::filesystem::create_directories(dir);
+
+    // Ten images between 1 and 4 MB
+    std::mt19937 rng(3);
+    std::vector<media_attachment> media;
+    size_t largest = 0;
+    for (int i = 0; i < 10; ++i) {
+        std::string data((1 + i % 4) * 1024 * 1024, '\0');
+        for (auto& c : data) c = static_cast<char>(rng());
+        const auto path = (dir / ("image" + std::to_string(i) + ".bin")).string();
+        std::ofstream(path, std::ios::binary) << data;
+        if (media.empty() || data.size() > std::filesystem::file_size(media[largest].data)) {
+            largest = media.size();
+        }
+        media.push_back({"image/jpeg", path});
+    }
+
+    context_config config;
+    config.enable_media_cache = false; // Measure encoding, not cache hits
+    general_context context(schema, config);
+
+    constexpr int runs = 5;
+    const double single = best_of(runs, [&] {
+        context.clear_user_messages();
+        context.add_user_message("one", media[largest].media_type, media[largest].data);
+    });
+    const double all = best_of(runs, [&] {
+        context.clear_user_messages();
+        context.add_user_message("ten", media);
+    });
+
+    std::printf("pool threads       %zu\n", thread_pool::shared().size());
+    std::printf("largest image only %8.2f ms\n", single);
+    std::printf("all 10 images      %8.2f ms  (%.2fx the largest)\n", all, all / single);
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
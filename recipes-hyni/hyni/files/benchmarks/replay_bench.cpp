@@ -0,0 +1,142 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Replays recorded provider traffic through chat_api::send_message_stream(),
+// measuring time to first delta and the gaps between deltas at the recorded
+// speed, and the delta throughput of the SSE decoder and stream parser with
+// the delays removed. Without a trace, a synthetic one is used: a 300 token
+// answer streamed one token per chunk, 20 ms apart after 400 ms.
+//
+// Record a trace with chat_api::set_traffic_recorder().
+//
+// Usage: replay_bench [trace] [schema_path] [speed]
+
+#include "chat_api.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+std::vector<recorded_exchange> synthetic_trace() {
+    recorded_exchange exchange;
+    exchange.url = "https://api.openai.com/v1/chat/completions";
+    exchange.streamed = true;
+    exchange.status_code = 200;
+    std::chrono::microseconds at(400000);
+    for (int i = 0; i < 300; ++i) {
+        nlohmann::json chunk = {{"choices", {{{"index", 0},
+                                              {"delta", {{"content", " token" + std::to_string(i)}}}}}}};
+        exchange.chunks.push_back({at, "data: " + chunk.dump() + "\n\n"});
+        at += std::chrono::microseconds(20000);
+    }
+    exchange.chunks.push_back({at, "data: [DONE]\n\n"});
+    exchange.duration = at;
+    return {exchange};
+}
+
+struct stream_timing {
+    double total_ms = 0;
+    double first_delta_ms = 0;
+    double mean_gap_ms = 0;
+    size_t deltas = 0;
+};
+
+stream_timing time_stream(chat_api& api) {
+    stream_timing timing;
+    std::vector<clock_type::time_point> arrivals;
+    std::promise<void> done;
+    const auto start = clock_type::now();
+    api.send_message_stream("Tell me a story",
+                            [&](std::string) { arrivals.push_back(clock_type::now()); },
+                            [&](const http_response&) { done.set_value(); });
+    done.get_future().wait();
+
+    const auto ms = [](clock_type::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    timing.total_ms = ms(clock_type::now() - start);
+    timing.deltas = arrivals.size();
+    if (!arrivals.empty()) {
+        timing.first_delta_ms = ms(arrivals.front() - start);
+    }
+    if (arrivals.size() > 1) {
+        timing.mean_gap_ms = ms(arrivals.back() - arrivals.front()) / static_cast<double>(arrivals.size() - 1);
+    }
+    return timing;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const std::string trace_path = argc > 1 ? argv[1] : "";
+    const std::string schema_path = argc > 2 ? argv[2] : "../schemas/openai.json";
+    const double speed = argc > 3 ? std::strtod(argv[3], nullptr) : 1.0;
+
+    std::ifstream file(schema_path);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "Cannot open %s\n", schema_path.c_str());
+        return 1;
+    }
+    nlohmann::json schema;
+    file >> schema;
+
+    const std::vector<recorded_exchange> trace = trace_path.empty() ? synthetic_trace()
+                                                                    : traffic_replay::load(trace_path);
+    size_t streams = 0;
+    for (const auto& exchange : trace) {
+        streams += exchange.streamed;
+    }
+    if (streams == 0) {
+        std::fprintf(stderr, "The trace has no streamed responses\n");
+        return 1;
+    }
+
+    auto context = std::make_unique<general_context>(schema);
+    context->set_api_key("bench-key");
+    chat_api api(std::move(context));
+
+    // Requests differ from the recorded ones, so exchanges are served in order
+    replay_options options;
+    options.match_requests = false;
+    options.speed = speed;
+    std::vector<recorded_exchange> streamed;
+    for (const auto& exchange : trace) {
+        if (exchange.streamed) streamed.push_back(exchange);
+    }
+    api.set_traffic_replay(std::make_shared<traffic_replay>(streamed, options));
+
+    std::printf("%zu streamed exchange(s), replayed at %.2fx\n", streamed.size(), speed);
+    for (size_t i = 0; i < streamed.size(); ++i) {
+        const auto timing = time_stream(api);
+        std::printf("stream %zu: %4zu deltas, first after %8.2f ms, gap %6.2f ms, total %8.2f ms\n",
+                    i, timing.deltas, timing.first_delta_ms, timing.mean_gap_ms, timing.total_ms);
+    }
+
+    // Parser throughput: the same streams without any delay
+    options.speed = 0;
+    api.set_traffic_replay(std::make_shared<traffic_replay>(streamed, options));
+    const size_t rounds = 200;
+    size_t deltas = 0;
+    const auto start = clock_type::now();
+    for (size_t i = 0; i < rounds; ++i) {
+        deltas += time_stream(api).deltas;
+    }
+    const double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+    std::printf("without delays: %8.2f us per stream, %8.2f M deltas/s\n",
+                elapsed / rounds * 1e6, deltas / elapsed / 1e6);
+    return 0;
+}
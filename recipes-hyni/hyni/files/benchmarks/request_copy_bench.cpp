@@ -0,0 +1,116 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Counts the bytes allocated between handing a large prompt to the context and
+// holding the serialized request body, once the way callers used to (copying
+// the prompt in, building a request object, dumping it) and once by moving the
+// prompt in and serializing straight from the history.
+//
+// Usage: request_copy_bench [schema_path] [prompt_kib]
+
+#include "general_context.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<size_t> g_allocated{0};
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) {
+    g_allocated.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace hyni;
+
+namespace {
+
+struct sample {
+    size_t bytes;
+    double ms;
+    size_t body_size;
+};
+
+// The caller's prompt is allocated before counting starts
+template <typename F>
+sample measure(int runs, size_t prompt_size, F&& request) {
+    sample best{SIZE_MAX, 1e30, 0};
+    for (int i = 0; i < runs; ++i) {
+        std::string prompt(prompt_size, 'p');
+        const size_t before = g_allocated.load();
+        const auto start = std::chrono::steady_clock::now();
+        best.body_size = request(std::move(prompt));
+        best.ms = std::min(best.ms, std::chrono::duration<double, std::milli>(
+                                        std::chrono::steady_clock::now() - start).count());
+        best.bytes = std::min(best.bytes, g_allocated.load() - before);
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const std::string schema = argc > 1 ? argv[1] : "../schemas/claude.json";
+    const size_t prompt_size = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200) * 1024;
+
+    general_context context(schema);
+    constexpr int runs = 20;
+
+    // Before: the prompt is copied into the message and the request object,
+    // then the object is dumped into the body
+    const auto legacy = measure(runs, prompt_size, [&](const std::string& prompt) {
+        context.clear_user_messages();
+        context.add_user_message(prompt);
+        auto body = std::make_shared<const std::string>(context.build_request().dump());
+        return body->size();
+    });
+
+    // After: the prompt is moved in and serialized once, into a shared body
+    const auto moved = measure(runs, prompt_size, [&](std::string prompt) {
+        context.clear_user_messages();
+        context.add_user_message(std::move(prompt));
+        auto body = std::make_shared<const std::string>(context.build_request_body());
+        return body->size();
+    });
+
+    // Prompt caching sends the marked message as an edited copy; without it the
+    // body is the only copy of the prompt
+    context_config no_caching;
+    no_caching.enable_prompt_caching = false;
+    general_context plain(schema, no_caching);
+    const auto uncached = measure(runs, prompt_size, [&](std::string prompt) {
+        plain.clear_user_messages();
+        plain.add_user_message(std::move(prompt));
+        auto body = std::make_shared<const std::string>(plain.build_request_body());
+        return body->size();
+    });
+
+    std::printf("prompt            %zu bytes\n", prompt_size);
+    std::printf("body              %zu bytes\n", moved.body_size);
+    std::printf("copy + dump       %10zu bytes allocated (%.2fx prompt)  %.3f ms\n", legacy.bytes,
+                double(legacy.bytes) / prompt_size, legacy.ms);
+    std::printf("move + serialize  %10zu bytes allocated (%.2fx prompt)  %.3f ms\n", moved.bytes,
+                double(moved.bytes) / prompt_size, moved.ms);
+    std::printf("  without caching %10zu bytes allocated (%.2fx prompt)  %.3f ms\n", uncached.bytes,
+                double(uncached.bytes) / prompt_size, uncached.ms);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Measures the latency of a repeated deterministic send_message answered by
+// the response cache, from building the request to extracting the text, and
+// the lookup throughput of the sharded cache from several threads.
+//
+// Usage: response_cache_bench [schema_path] [iterations]
+
+#include "chat_api.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const std::string schema_path = argc > 1 ? argv[1] : "../schemas/openai.json";
+    const size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+
+    std::ifstream file(schema_path);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "Cannot open %s\n", schema_path.c_str());
+        return 1;
+    }
+    nlohmann::json schema;
+    file >> schema;
+
+    // A conversation of a few turns, answered once and then from the cache
+    auto context = std::make_unique<general_context>(schema);
+    context->set_api_key("bench-key");
+    context->set_parameter("temperature", 0.0);
+    context->set_system_message("You are a concise assistant.");
+    for (int i = 0; i < 8; ++i) {
+        context->add_user_message("Question " + std::to_string(i) + std::string(200, 'q'));
+        context->add_assistant_message("Answer " + std::to_string(i) + std::string(400, 'a'));
+    }
+    chat_api api(std::move(context));
+    response_cache cache;
+    api.set_response_cache(cache);
+
+    // The request send_message() builds, answered in advance
+    api.get_context().clear_user_messages();
+    api.get_context().add_user_message("What is the capital of France?");
+    const std::string key = response_cache::make_key(api.get_context().get_endpoint(),
+                                                     api.get_context().build_request_body());
+    cache.insert(key, nlohmann::json{{"choices", {{{"message", {{"role", "assistant"},
+                                      {"content", "Paris."}}}}}}}.dump());
+
+    auto start = clock_type::now();
+    size_t answered = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        answered += api.send_message("What is the capital of France?").size();
+    }
+    const double per_send = seconds_since(start) / iterations * 1e6;
+    std::printf("cached send_message:   %8.2f us per call (%zu bytes of request key, %zu of text)\n",
+                per_send, key.size(), answered);
+
+    // Lookups of 1000 distinct keys from an increasing number of threads
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(key + std::to_string(i));
+        cache.insert(keys.back(), "response");
+    }
+    for (size_t threads : {1, 2, 4, 8}) {
+        std::vector<std::thread> workers;
+        start = clock_type::now();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (size_t i = 0; i < iterations; ++i) {
+                    (void)cache.find(keys[(i + t * 7) % keys.size()]);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const double elapsed = seconds_since(start);
+        std::printf("find, %zu thread(s):   %8.2f M lookups/s\n", threads,
+                    threads * iterations / elapsed / 1e6);
+    }
+
+    const auto stats = cache.get_cache_stats();
+    std::printf("hit rate %.3f, %zu entries, %zu bytes\n", stats.hit_rate(), stats.entries,
+                stats.bytes);
+    return 0;
+}
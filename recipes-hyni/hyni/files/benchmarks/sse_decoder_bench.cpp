@@ -0,0 +1,101 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Decodes a synthetic chat completion stream cut into chunks of various sizes,
+// once with the line splitting chat_api used to do on each chunk in isolation
+// (istringstream + getline) and once with sse_decoder. Reports throughput and
+// how many events each approach recovers intact.
+//
+// Usage: sse_decoder_bench [events]
+
+#include "sse_decoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct result {
+    double mb_per_s;
+    size_t intact;
+};
+
+bool intact(std::string_view data) {
+    return data.size() > 2 && data.front() == '{' && data.back() == '}';
+}
+
+// The previous approach: each chunk is split on its own
+result legacy(const std::vector<std::string>& chunks, size_t bytes) {
+    size_t count = 0;
+    const auto start = clock_type::now();
+    for (const auto& chunk : chunks) {
+        std::istringstream stream(chunk);
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.compare(0, 6, "data: ") == 0) {
+                count += intact(std::string_view(line).substr(6));
+            }
+        }
+    }
+    const double s = std::chrono::duration<double>(clock_type::now() - start).count();
+    return {bytes / s / 1048576.0, count};
+}
+
+result decoder(const std::vector<std::string>& chunks, size_t bytes) {
+    size_t count = 0;
+    sse_decoder decoder;
+    const sse_decoder::event_callback on_event = [&](const sse_event& e) { count += intact(e.data); };
+    const auto start = clock_type::now();
+    for (const auto& chunk : chunks) {
+        decoder.feed(chunk, on_event);
+    }
+    decoder.finish(on_event);
+    const double s = std::chrono::duration<double>(clock_type::now() - start).count();
+    return {bytes / s / 1048576.0, count};
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    const size_t events = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    std::mt19937 rng(1);
+    std::string stream;
+    for (size_t i = 0; i < events; ++i) {
+        stream += "data: {\"id\":\"chatcmpl-1\",\"object\":\"chat.completion.chunk\",\"choices\":"
+                  "[{\"index\":0,\"delta\":{\"content\":\"tok" + std::to_string(rng() % 100000) +
+                  "\"},\"finish_reason\":null}]}\n\n";
+    }
+
+    std::printf("%zu events, %.1f MB\n", events, stream.size() / 1048576.0);
+    std::printf("%8s  %22s  %22s\n", "chunk", "istringstream", "sse_decoder");
+    for (size_t chunk_size : {16, 100, 1024, 16384}) {
+        std::vector<std::string> chunks;
+        for (size_t pos = 0; pos < stream.size(); pos += chunk_size) {
+            chunks.push_back(stream.substr(pos, chunk_size));
+        }
+        const auto before = legacy(chunks, stream.size());
+        const auto after = decoder(chunks, stream.size());
+        std::printf("%8zu  %7.1f MB/s %6.1f%% ok  %7.1f MB/s %6.1f%% ok\n", chunk_size,
+                    before.mb_per_s, 100.0 * before.intact / events, after.mb_per_s,
+                    100.0 * after.intact / events);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+// Measures token_estimator throughput and, given captured traffic, its error
+// against the usage numbers reported by the providers.
+//
+// Usage: token_estimator_bench [samples.jsonl]
+//
+// Each line of the samples file is a JSON object with the sent request and the
+// provider's response:
+//   {"provider": "claude", "request": {...}, "response": {...}}
+// The response must contain a usage block with input_tokens or prompt_tokens.
+
+#include "token_estimator.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace hyni;
+
+namespace {
+
+std::string make_corpus(size_t size) {
+    static const char* const fragments[] = {
+        "The quick brown fox jumps over the lazy dog. ",
+        "int main(int argc, char** argv) {\n    return 0;\n}\n",
+        "{\"id\": 12345, \"name\": \"example\", \"values\": [1, 2, 3]}\n",
+        "Internationalization and localization are often abbreviated. ",
+        "Größenordnung, café, naïve, 東京都, こんにちは世界. ",
+        "    - item one\n    - item two\n\n",
+    };
+    std::string corpus;
+    corpus.reserve(size);
+    for (size_t i = 0; corpus.size() < size; ++i) {
+        corpus += fragments[i % (sizeof(fragments) / sizeof(fragments[0]))];
+    }
+    corpus.resize(size);
+    return corpus;
+}
+
+void run_throughput() {
+    const std::string corpus = make_corpus(64 * 1024 * 1024);
+    const auto estimator = token_estimator::for_provider("openai");
+
+    // Warm up caches
+    volatile size_t sink = estimator.count(corpus);
+
+    constexpr int iterations = 5;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink = estimator.count(corpus);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    const double mb = static_cast<double>(corpus.size()) * iterations / (1024.0 * 1024.0);
+
+    std::printf("throughput: %.1f MB/s (%zu tokens per %zu bytes)\n",
+                mb / elapsed.count(), static_cast<size_t>(sink), corpus.size());
+}
+
+size_t estimate_request(const token_estimator& estimator, const nlohmann::json& request) {
+    size_t tokens = 0;
+    if (request.contains("system") && request["system"].is_string()) {
+        tokens += estimator.count(request["system"].get<std::string>());
+    }
+    if (request.contains("messages")) {
+        for (const auto& message : request["messages"]) {
+            tokens += estimator.count_message(message);
+        }
+    }
+    return tokens;
+}
+
+void run_accuracy(const std::string& samples_path) {
+    std::ifstream file(samples_path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open samples file: " << samples_path << std::endl;
+        return;
+    }
+
+    struct error_stats {
+        size_t samples = 0;
+        double sum_abs_pct = 0;
+        double sum_pct = 0;
+        double max_abs_pct = 0;
+    };
+    std::map<std::string, error_stats> by_provider;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        try {
+            auto sample = nlohmann::json::parse(line);
+            const auto provider = sample.at("provider").get<std::string>();
+            const auto& usage = sample.at("response").at("usage");
+            const double actual = usage.contains("input_tokens")
+                                      ? usage["input_tokens"].get<double>()
+                                      : usage.at("prompt_tokens").get<double>();
+            if (actual <= 0) continue;
+
+            const auto estimator = token_estimator::for_provider(provider);
+            const double estimate = static_cast<double>(
+                estimate_request(estimator, sample.at("request")));
+            const double pct = (estimate - actual) / actual * 100.0;
+
+            auto& stats = by_provider[provider];
+            ++stats.samples;
+            stats.sum_pct += pct;
+            stats.sum_abs_pct += std::fabs(pct);
+            stats.max_abs_pct = std::max(stats.max_abs_pct, std::fabs(pct));
+        } catch (const std::exception& e) {
+            std::cerr << "Skipping sample: " << e.what() << std::endl;
+        }
+    }
+
+    for (const auto& [provider, stats] : by_provider) {
+        std::printf("%-10s samples=%zu mean_abs_error=%.1f%% bias=%+.1f%% max_abs_error=%.1f%%\n",
+                    provider.c_str(), stats.samples,
+                    stats.sum_abs_pct / stats.samples,
+                    stats.sum_pct / stats.samples,
+                    stats.max_abs_pct);
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv) {
+    run_throughput();
+    if (argc > 1) {
+        run_accuracy(argv[1]);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "chat_api.h"
+#include <boost/asio.hpp>
+#include <exception>
+#include <string>
+
+namespace hyni {
+
+/**
+ * @brief Resumes coroutines on a Boost.Asio io_context
+ * @param io_context Context whose run() threads resume the coroutines; must outlive them
+ *
+ * Lets hyni tasks share the threads of an application that already runs
+ * an io_context, such as one using hyni_websocket_client.
+ */
+inline resume_executor asio_executor(boost::asio::io_context& io_context) {
+    return [&io_context](std::coroutine_handle<> handle) {
+        boost::asio::post(io_context, [handle] { handle.resume(); });
+    };
+}
+
+namespace detail {
+
+template <typename Handler>
+task<void> complete_on_asio(task<std::string> request, Handler handler) {
+    auto executor = boost::asio::get_associated_executor(handler);
+    auto work = boost::asio::make_work_guard(executor);
+
+    std::exception_ptr error;
+    std::string text;
+    try {
+        text = co_await std::move(request);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    boost::asio::post(executor, [handler = std::move(handler), error, text = std::move(text)]() mutable {
+        std::move(handler)(error, std::move(text));
+    });
+}
+
+} // detail
+
+/**
+ * @brief Sends a message as a Boost.Asio asynchronous operation
+ *
+ * Works with any completion token, for example a callback or
+ * boost::asio::use_awaitable inside an asio coroutine:
+ *
+ * @code
+ * std::string answer = co_await hyni::async_send_message(api, "Hello", boost::asio::use_awaitable);
+ * @endcode
+ *
+ * The request runs on the chat_api's async_transport; the completion handler
+ * is invoked through its associated executor with the signature
+ * void(std::exception_ptr, std::string).
+ *
+ * @param api The chat API; must outlive the operation
+ * @param message The message to send
+ * @param token Completion token
+ */
+template <typename CompletionToken>
+auto async_send_message(chat_api& api, std::string message, CompletionToken&& token) {
+    return boost::asio::async_initiate<CompletionToken, void(std::exception_ptr, std::string)>(
+        [&api](auto handler, std::string message) {
+            spawn(detail::complete_on_asio(api.co_send_message(std::move(message)),
+                                           std::move(handler)));
+        },
+        token, std::move(message));
+}
+
+} // hyni
@@ -0,0 +1,408 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "async_transport.h"
+#include "logger.h"
+#include <algorithm>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+thread_local const hyni::async_transport* t_current_transport = nullptr;
+
+// Longest wait in curl_multi_poll; submit() and cancel() wake the loop earlier
+constexpr int MAX_POLL_MS = 1000;
+
+std::string trim(std::string_view text) {
+    const size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return std::string(text.substr(first, last - first + 1));
+}
+
+// Identifies a request for single-flight sharing: the URL, the headers in
+// sorted order and the body with JSON whitespace and key order normalized
+std::string request_key(const hyni::transport_request& request) {
+    std::vector<std::pair<std::string, std::string>> headers(request.headers.begin(),
+                                                             request.headers.end());
+    std::sort(headers.begin(), headers.end());
+
+    std::string key = request.url;
+    key += '\n';
+    for (const auto& [name, value] : headers) {
+        key += name;
+        key += ": ";
+        key += value;
+        key += '\n';
+    }
+    key += request.on_chunk ? "stream\n" : "\n";
+    const auto body = nlohmann::json::parse(*request.body, nullptr, false);
+    key += body.is_discarded() ? *request.body : body.dump();
+    return key;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+struct async_transport::transfer {
+    transfer_id id = 0;
+    transport_request request;
+    completion on_complete;
+    http_response response;
+    CURL* easy = nullptr;
+    curl_slist* headers = nullptr;
+    bool upstream = false; ///< Internal transfer of a flight; not counted in in_flight()
+
+    ~transfer() {
+        if (headers) {
+            curl_slist_free_all(headers);
+        }
+        if (easy) {
+            curl_easy_cleanup(easy);
+        }
+    }
+
+    static size_t write_body(char* data, size_t size, size_t count, void* user) {
+        auto* self = static_cast<transfer*>(user);
+        self->response.body.append(data, size * count);
+        return size * count;
+    }
+
+    static size_t write_stream(char* data, size_t size, size_t count, void* user) {
+        auto* self = static_cast<transfer*>(user);
+        self->request.on_chunk(std::string_view(data, size * count));
+        return size * count;
+    }
+
+    static size_t write_header(char* data, size_t size, size_t count, void* user) {
+        auto* self = static_cast<transfer*>(user);
+        if (self->response.headers_received == std::chrono::steady_clock::time_point{}) {
+            self->response.headers_received = std::chrono::steady_clock::now();
+        }
+        const std::string_view line(data, size * count);
+        if (const size_t colon = line.find(':'); colon != std::string_view::npos) {
+            self->response.headers[trim(line.substr(0, colon))] = trim(line.substr(colon + 1));
+        }
+        return size * count;
+    }
+
+    static int progress(void* user, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        auto* self = static_cast<transfer*>(user);
+        return self->request.cancel_check() ? 1 : 0;
+    }
+};
+
+/**
+ * @brief Requests sharing one upstream transfer
+ */
+struct async_transport::flight {
+    transfer_id upstream = 0;
+    std::vector<std::unique_ptr<transfer>> members; ///< Completed with the upstream response
+    std::string streamed;                           ///< Chunks so far, replayed to late joiners
+};
+
+async_transport::async_transport(size_t max_host_connections) {
+    // http_client owns the global curl initialization
+    m_multi = curl_multi_init();
+    if (!m_multi) {
+        throw std::runtime_error("Failed to initialize CURL multi handle");
+    }
+    if (max_host_connections > 0) {
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          static_cast<long>(max_host_connections));
+    }
+    m_thread = std::thread([this] { run(); });
+}
+
+async_transport::~async_transport() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    curl_multi_wakeup(m_multi);
+    m_thread.join();
+    curl_multi_cleanup(m_multi);
+}
+
+async_transport& async_transport::shared() {
+    static async_transport transport;
+    return transport;
+}
+
+async_transport::transfer_id async_transport::submit(transport_request request,
+                                                     completion on_complete) {
+    auto item = std::make_unique<transfer>();
+    item->id = m_next_id.fetch_add(1, std::memory_order_relaxed);
+    item->request = std::move(request);
+    item->on_complete = std::move(on_complete);
+    const transfer_id id = item->id;
+
+    m_in_flight.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_incoming.push_back(std::move(item));
+    }
+    curl_multi_wakeup(m_multi);
+    return id;
+}
+
+void async_transport::cancel(transfer_id id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled.push_back(id);
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+bool async_transport::in_event_loop() const noexcept {
+    return t_current_transport == this;
+}
+
+void async_transport::run() {
+    t_current_transport = this;
+    for (;;) {
+        std::vector<std::unique_ptr<transfer>> incoming;
+        std::vector<transfer_id> cancelled;
+        bool stopping = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            incoming.swap(m_incoming);
+            cancelled.swap(m_cancelled);
+            stopping = m_stopping;
+        }
+
+        if (stopping) {
+            for (auto& item : incoming) {
+                item->response.error_message = "Transport shut down";
+                complete(std::move(item));
+            }
+            while (!m_active.empty()) {
+                abort(m_active.begin()->second->id, "Transport shut down");
+            }
+            return;
+        }
+
+        for (auto& item : incoming) {
+            if (item->request.single_flight && item->request.body) {
+                start_shared(std::move(item));
+            } else {
+                start(std::move(item));
+            }
+        }
+        for (transfer_id id : cancelled) {
+            if (!leave_flight(id, "Request cancelled")) {
+                abort(id, "Request cancelled");
+            }
+        }
+
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg == CURLMSG_DONE) {
+                finish(message->easy_handle, message->data.result);
+            }
+        }
+
+        curl_multi_poll(m_multi, nullptr, 0, MAX_POLL_MS, nullptr);
+    }
+}
+
+void async_transport::start(std::unique_ptr<transfer> item) {
+    const transport_request& request = item->request;
+    if (!request.body) {
+        item->response.error_message = "Request body is null";
+        complete(std::move(item));
+        return;
+    }
+
+    item->easy = curl_easy_init();
+    if (!item->easy) {
+        item->response.error_message = "Failed to initialize CURL";
+        complete(std::move(item));
+        return;
+    }
+
+    for (const auto& [key, value] : request.headers) {
+        const std::string header = key + ": " + value;
+        item->headers = curl_slist_append(item->headers, header.c_str());
+    }
+
+    CURL* easy = item->easy;
+    curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, request.timeout_ms);
+    curl_easy_setopt(easy, CURLOPT_POST, 1L);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body->c_str());
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body->size()));
+    curl_easy_setopt(easy, CURLOPT_HTTPHEADER, item->headers);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION,
+                     request.on_chunk ? &transfer::write_stream : &transfer::write_body);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, item.get());
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, &transfer::write_header);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, item.get());
+    if (request.cancel_check) {
+        curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, &transfer::progress);
+        curl_easy_setopt(easy, CURLOPT_XFERINFODATA, item.get());
+        curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    if (CURLMcode result = curl_multi_add_handle(m_multi, easy); result != CURLM_OK) {
+        item->response.error_message = curl_multi_strerror(result);
+        complete(std::move(item));
+        return;
+    }
+    m_active.emplace(easy, std::move(item));
+}
+
+void async_transport::start_shared(std::unique_ptr<transfer> item) {
+    std::string key = request_key(item->request);
+    if (auto it = m_flights.find(key); it != m_flights.end()) {
+        flight& joined = *it->second;
+        if (item->request.on_chunk && !joined.streamed.empty()) {
+            item->request.on_chunk(joined.streamed);
+        }
+        joined.members.push_back(std::move(item));
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto shared = std::make_unique<flight>();
+    flight* members = shared.get();
+
+    auto upstream = std::make_unique<transfer>();
+    upstream->id = m_next_id.fetch_add(1, std::memory_order_relaxed);
+    upstream->upstream = true;
+    upstream->request.url = item->request.url;
+    upstream->request.body = item->request.body;
+    upstream->request.headers = item->request.headers;
+    upstream->request.timeout_ms = item->request.timeout_ms;
+    if (item->request.on_chunk) {
+        upstream->request.on_chunk = [members](std::string_view chunk) {
+            members->streamed.append(chunk);
+            for (const auto& member : members->members) {
+                member->request.on_chunk(chunk);
+            }
+        };
+    }
+    // Members cancelled through their own check leave; once none is left the
+    // transfer is aborted by returning true, as it cannot be removed from here
+    upstream->request.cancel_check = [this, members] {
+        auto& list = members->members;
+        for (auto it = list.begin(); it != list.end();) {
+            if ((*it)->request.cancel_check && (*it)->request.cancel_check()) {
+                auto item = std::move(*it);
+                it = list.erase(it);
+                item->response.error_message = "Request cancelled";
+                complete(std::move(item));
+            } else {
+                ++it;
+            }
+        }
+        return list.empty();
+    };
+    upstream->on_complete = [this, key](http_response response) {
+        auto it = m_flights.find(key);
+        if (it == m_flights.end()) {
+            return;
+        }
+        auto finished = std::move(it->second);
+        m_flights.erase(it);
+        for (auto& member : finished->members) {
+            member->response = response;
+            complete(std::move(member));
+        }
+    };
+
+    members->upstream = upstream->id;
+    members->members.push_back(std::move(item));
+    m_flights.emplace(std::move(key), std::move(shared));
+    start(std::move(upstream));
+}
+
+bool async_transport::leave_flight(transfer_id id, const std::string& reason) {
+    for (auto& [key, shared] : m_flights) {
+        auto& members = shared->members;
+        auto it = std::find_if(members.begin(), members.end(),
+                               [id](const auto& member) { return member->id == id; });
+        if (it == members.end()) {
+            continue;
+        }
+        auto item = std::move(*it);
+        members.erase(it);
+        item->response.error_message = reason;
+        const transfer_id upstream = shared->upstream;
+        const bool abandoned = members.empty();
+        complete(std::move(item));
+        if (abandoned) {
+            abort(upstream, reason);
+        }
+        return true;
+    }
+    return false;
+}
+
+void async_transport::finish(CURL* easy, CURLcode result) {
+    auto it = m_active.find(easy);
+    if (it == m_active.end()) {
+        return;
+    }
+    auto item = std::move(it->second);
+    m_active.erase(it);
+    curl_multi_remove_handle(m_multi, easy);
+
+    if (result != CURLE_OK) {
+        item->response.error_message = result == CURLE_ABORTED_BY_CALLBACK
+            ? std::string("Request cancelled")
+            : std::string("cURL error: ") + curl_easy_strerror(result);
+    } else {
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &item->response.status_code);
+        item->response.success =
+            item->response.status_code >= 200 && item->response.status_code < 300;
+    }
+    complete(std::move(item));
+}
+
+void async_transport::abort(transfer_id id, const std::string& reason) {
+    for (auto it = m_active.begin(); it != m_active.end(); ++it) {
+        if (it->second->id == id) {
+            auto item = std::move(it->second);
+            m_active.erase(it);
+            curl_multi_remove_handle(m_multi, item->easy);
+            item->response.error_message = reason;
+            complete(std::move(item));
+            return;
+        }
+    }
+}
+
+void async_transport::complete(std::unique_ptr<transfer> item) {
+    if (!item->upstream) {
+        m_in_flight.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (!item->on_complete) {
+        return;
+    }
+    try {
+        item->on_complete(std::move(item->response));
+    } catch (const std::exception& e) {
+        LOG_ERROR("Transfer completion callback failed: " + std::string(e.what()));
+    }
+}
+
+} // hyni
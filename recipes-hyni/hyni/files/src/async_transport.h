@@ -0,0 +1,149 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "http_client.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief One HTTP POST for the async_transport
+ */
+struct transport_request {
+    std::string url;
+    request_body body;
+    std::unordered_map<std::string, std::string> headers;
+    stream_view_callback on_chunk;  ///< If set, the response body is delivered here instead of collected
+    progress_callback cancel_check; ///< Optional; return true to abort the transfer
+    long timeout_ms = 60000;
+    bool single_flight = false;     ///< Share one transfer with identical requests already in flight
+};
+
+/**
+ * @class async_transport
+ * @brief Non-blocking HTTP transport driving every transfer from one thread
+ *
+ * Requests are handed to a curl multi handle that a single event loop thread
+ * drives with curl_multi_poll, so any number of requests can be in flight
+ * without a thread each. Transfers to the same host reuse the multi handle's
+ * connection pool.
+ *
+ * Completion and chunk callbacks run on the event loop thread. They must not
+ * block; they typically resume a coroutine on an executor or hand the result
+ * to a queue.
+ *
+ * Requests marked single_flight are deduplicated: a request identical to one
+ * already in flight, compared by URL, headers and canonical JSON body, joins
+ * that upstream transfer instead of starting its own. Every joined request
+ * receives the full response; a stream joined late first receives the chunks
+ * that already arrived. The upstream transfer is aborted only when every
+ * request sharing it has been cancelled, and it keeps the timeout of the
+ * request that started it.
+ *
+ * @note Thread-safe.
+ */
+class async_transport {
+public:
+    /**
+     * @brief Receives the outcome of a transfer; the response body is empty for streams
+     */
+    using completion = std::function<void(http_response response)>;
+
+    using transfer_id = uint64_t;
+
+    /**
+     * @brief Starts the event loop
+     * @param max_host_connections Connections kept open per host; 0 leaves it unlimited.
+     *        Transfers beyond the limit wait for a free connection.
+     */
+    explicit async_transport(size_t max_host_connections = 0);
+
+    /**
+     * @brief Stops the event loop; transfers still running complete with an error
+     */
+    ~async_transport();
+
+    async_transport(const async_transport&) = delete;
+    async_transport& operator=(const async_transport&) = delete;
+
+    /**
+     * @brief Gets the process-wide transport
+     */
+    static async_transport& shared();
+
+    /**
+     * @brief Starts a transfer
+     * @param request Request to send
+     * @param on_complete Called once on the event loop thread when the transfer ends
+     * @return Identifier for cancel()
+     */
+    transfer_id submit(transport_request request, completion on_complete);
+
+    /**
+     * @brief Aborts a transfer
+     *
+     * Its completion reports "Request cancelled". Unknown or finished transfers
+     * are ignored.
+     */
+    void cancel(transfer_id id);
+
+    /**
+     * @brief Gets the number of transfers submitted and not yet completed
+     */
+    [[nodiscard]] size_t in_flight() const noexcept { return m_in_flight.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets the number of single_flight requests served by another request's transfer
+     */
+    [[nodiscard]] size_t coalesced() const noexcept { return m_coalesced.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Checks whether the calling thread is this transport's event loop
+     */
+    [[nodiscard]] bool in_event_loop() const noexcept;
+
+private:
+    struct transfer;
+    struct flight;
+
+    void run();
+    void start(std::unique_ptr<transfer> item);
+    void start_shared(std::unique_ptr<transfer> item);
+    bool leave_flight(transfer_id id, const std::string& reason);
+    void finish(CURL* easy, CURLcode result);
+    void abort(transfer_id id, const std::string& reason);
+    void complete(std::unique_ptr<transfer> item);
+
+    CURLM* m_multi = nullptr;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<transfer>> m_incoming;
+    std::vector<transfer_id> m_cancelled;
+    bool m_stopping = false;
+
+    std::unordered_map<CURL*, std::unique_ptr<transfer>> m_active; ///< Event loop thread only
+    std::unordered_map<std::string, std::unique_ptr<flight>> m_flights; ///< By request key; event loop thread only
+    std::atomic<transfer_id> m_next_id{1};
+    std::atomic<size_t> m_in_flight{0};
+    std::atomic<size_t> m_coalesced{0};
+    std::thread m_thread;
+};
+
+} // hyni
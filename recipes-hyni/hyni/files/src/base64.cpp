@@ -0,0 +1,728 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "base64.h"
+#include <array>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HYNI_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HYNI_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr char ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+constexpr uint8_t INVALID = 0x80;
+
+// Character to 6-bit value, INVALID for everything outside the alphabet
+constexpr std::array<uint8_t, 256> make_decode_table() {
+    std::array<uint8_t, 256> table{};
+    for (auto& value : table) value = INVALID;
+    for (uint8_t i = 0; i < 64; ++i) table[static_cast<uint8_t>(ALPHABET[i])] = i;
+    return table;
+}
+
+constexpr auto DECODE_TABLE = make_decode_table();
+
+enum char_class : uint8_t {
+    CLASS_INVALID = 0,
+    CLASS_SYMBOL = 1,
+    CLASS_PAD = 2,
+    CLASS_SPACE = 4
+};
+
+// Same whitespace set as std::isspace in the "C" locale
+constexpr std::array<uint8_t, 256> make_class_table() {
+    std::array<uint8_t, 256> table{};
+    for (uint8_t i = 0; i < 64; ++i) table[static_cast<uint8_t>(ALPHABET[i])] = CLASS_SYMBOL;
+    table['='] = CLASS_PAD;
+    for (uint8_t c : {' ', '\t', '\n', '\v', '\f', '\r'}) table[c] = CLASS_SPACE;
+    return table;
+}
+
+constexpr auto CLASS_TABLE = make_class_table();
+
+/**
+ * Running state of is_valid(), so that SIMD blocks and the scalar tail can
+ * share the work on one text.
+ */
+struct validation_state {
+    size_t symbols = 0;   ///< Alphabet and padding characters seen
+    size_t padding = 0;   ///< Padding characters seen
+    bool failed = false;
+};
+
+// ---------------------------------------------------------------------------
+// Scalar
+// ---------------------------------------------------------------------------
+
+inline void encode_triple(const uint8_t* src, char* dst) noexcept {
+    const uint32_t triple = (uint32_t(src[0]) << 16) | (uint32_t(src[1]) << 8) | src[2];
+    dst[0] = ALPHABET[(triple >> 18) & 0x3F];
+    dst[1] = ALPHABET[(triple >> 12) & 0x3F];
+    dst[2] = ALPHABET[(triple >> 6) & 0x3F];
+    dst[3] = ALPHABET[triple & 0x3F];
+}
+
+size_t encode_scalar(const uint8_t* src, size_t len, char* dst) noexcept {
+    const size_t full = len - len % 3;
+    for (size_t i = 0; i < full; i += 3, dst += 4) {
+        encode_triple(src + i, dst);
+    }
+    return full;
+}
+
+void encode_tail(const uint8_t* src, size_t len, char* dst) noexcept {
+    if (len == 0) return;
+    const uint32_t a = src[0];
+    const uint32_t b = len > 1 ? src[1] : 0;
+    const uint32_t triple = (a << 16) | (b << 8);
+    dst[0] = ALPHABET[(triple >> 18) & 0x3F];
+    dst[1] = ALPHABET[(triple >> 12) & 0x3F];
+    dst[2] = len > 1 ? ALPHABET[(triple >> 6) & 0x3F] : '=';
+    dst[3] = '=';
+}
+
+// Decodes complete quartets without padding; returns false on an invalid character
+bool decode_scalar(const char* src, size_t len, uint8_t* dst) noexcept {
+    const auto* in = reinterpret_cast<const uint8_t*>(src);
+    uint8_t error = 0;
+    for (size_t i = 0; i < len; i += 4, dst += 3) {
+        const uint8_t a = DECODE_TABLE[in[i]];
+        const uint8_t b = DECODE_TABLE[in[i + 1]];
+        const uint8_t c = DECODE_TABLE[in[i + 2]];
+        const uint8_t d = DECODE_TABLE[in[i + 3]];
+        error |= a | b | c | d;
+        const uint32_t triple = (uint32_t(a) << 18) | (uint32_t(b) << 12) |
+                                (uint32_t(c) << 6) | d;
+        dst[0] = static_cast<uint8_t>(triple >> 16);
+        dst[1] = static_cast<uint8_t>(triple >> 8);
+        dst[2] = static_cast<uint8_t>(triple);
+    }
+    return (error & INVALID) == 0;
+}
+
+void validate_scalar(const char* src, size_t len, validation_state& state) noexcept {
+    const auto* in = reinterpret_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < len; ++i) {
+        const uint8_t cls = CLASS_TABLE[in[i]];
+        if (cls == CLASS_INVALID || (cls == CLASS_SYMBOL && state.padding > 0)) {
+            state.failed = true;
+            return;
+        }
+        state.symbols += cls != CLASS_SPACE;
+        state.padding += cls == CLASS_PAD;
+    }
+}
+
+// Checks one block given bit masks of symbol and padding positions
+inline bool validate_masks(uint64_t symbols, uint64_t pads, validation_state& state) noexcept {
+    // No symbol may follow the first padding character
+    if (state.padding > 0) {
+        if (symbols) return false;
+    } else if (pads && (symbols >> __builtin_ctzll(pads))) {
+        return false;
+    }
+    state.symbols += __builtin_popcountll(symbols | pads);
+    state.padding += __builtin_popcountll(pads);
+    return true;
+}
+
+#ifdef HYNI_BASE64_X86
+
+// ---------------------------------------------------------------------------
+// SSE4.1: 12 bytes to 16 characters per step
+// ---------------------------------------------------------------------------
+
+#define HYNI_TARGET_SSE41 __attribute__((target("ssse3,sse4.1")))
+
+HYNI_TARGET_SSE41 inline __m128i sse_indices(__m128i in) {
+    // Spread the 24-bit groups to one per 32-bit lane as [b1 b0 b2 b1], then move
+    // each 6-bit field into its own byte with two multiplies.
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+HYNI_TARGET_SSE41 inline __m128i sse_lookup(__m128i indices) {
+    // Map each 6-bit value to the offset of its alphabet range
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+HYNI_TARGET_SSE41 size_t encode_sse41(const uint8_t* src, size_t len, char* dst) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 12, dst += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), sse_lookup(sse_indices(in)));
+    }
+    return i;
+}
+
+// Translates characters to 6-bit values; returns a non-zero mask byte for invalid ones
+HYNI_TARGET_SSE41 inline __m128i sse_translate(__m128i in, __m128i& values) {
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    const __m128i lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i is_slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(is_slash, hi_nibbles));
+    values = _mm_add_epi8(in, roll);
+    return _mm_and_si128(lo, hi);
+}
+
+HYNI_TARGET_SSE41 inline __m128i sse_pack(__m128i values) {
+    const __m128i ab_bc = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i abcd = _mm_madd_epi16(ab_bc, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(abcd, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                -1, -1, -1, -1));
+}
+
+// Writes 16 bytes per 12 decoded; the caller keeps 20 characters of slack
+HYNI_TARGET_SSE41 size_t decode_sse41(const char* src, size_t len, uint8_t* dst, bool& ok) {
+    size_t i = 0;
+    for (; i + 20 <= len; i += 16, dst += 12) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i values;
+        if (!_mm_testz_si128(sse_translate(in, values), _mm_set1_epi8(-1))) {
+            ok = false;
+            return i;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), sse_pack(values));
+    }
+    return i;
+}
+
+HYNI_TARGET_SSE41 size_t validate_sse41(const char* src, size_t len, validation_state& state) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i values;
+        const __m128i invalid = sse_translate(in, values);
+        const __m128i symbol = _mm_cmpeq_epi8(invalid, _mm_setzero_si128());
+        const __m128i pad = _mm_cmpeq_epi8(in, _mm_set1_epi8('='));
+        const __m128i shifted = _mm_sub_epi8(in, _mm_set1_epi8('\t'));
+        const __m128i space = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted),
+            _mm_cmpeq_epi8(in, _mm_set1_epi8(' ')));
+
+        const uint64_t symbols = static_cast<uint32_t>(_mm_movemask_epi8(symbol));
+        const uint64_t pads = static_cast<uint32_t>(_mm_movemask_epi8(pad));
+        const uint64_t spaces = static_cast<uint32_t>(_mm_movemask_epi8(space));
+        if ((symbols | pads | spaces) != 0xFFFF || !validate_masks(symbols, pads, state)) {
+            state.failed = true;
+            return i;
+        }
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 24 bytes to 32 characters per step, the SSE4.1 algorithm on two lanes
+// ---------------------------------------------------------------------------
+
+#define HYNI_TARGET_AVX2 __attribute__((target("avx2")))
+
+HYNI_TARGET_AVX2 size_t encode_avx2(const uint8_t* src, size_t len, char* dst) {
+    const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                             1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; i + 28 <= len; i += 24, dst += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        const __m256i out = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+    }
+    return i;
+}
+
+HYNI_TARGET_AVX2 inline __m256i avx2_translate(__m256i in, __m256i& values) {
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+    const __m256i lo_nibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i is_slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+    const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(is_slash, hi_nibbles));
+    values = _mm256_add_epi8(in, roll);
+    return _mm256_and_si256(lo, hi);
+}
+
+// Writes 32 bytes per 24 decoded; the caller keeps 44 characters of slack
+HYNI_TARGET_AVX2 size_t decode_avx2(const char* src, size_t len, uint8_t* dst, bool& ok) {
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    size_t i = 0;
+    for (; i + 44 <= len; i += 32, dst += 24) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i values;
+        const __m256i invalid = avx2_translate(in, values);
+        if (!_mm256_testz_si256(invalid, invalid)) {
+            ok = false;
+            return i;
+        }
+        const __m256i ab_bc = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i abcd = _mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000));
+        const __m256i out = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(abcd, pack), lanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+    }
+    return i;
+}
+
+HYNI_TARGET_AVX2 size_t validate_avx2(const char* src, size_t len, validation_state& state) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i values;
+        const __m256i invalid = avx2_translate(in, values);
+        const __m256i symbol = _mm256_cmpeq_epi8(invalid, _mm256_setzero_si256());
+        const __m256i pad = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('='));
+        const __m256i shifted = _mm256_sub_epi8(in, _mm256_set1_epi8('\t'));
+        const __m256i space = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted),
+            _mm256_cmpeq_epi8(in, _mm256_set1_epi8(' ')));
+
+        const uint64_t symbols = static_cast<uint32_t>(_mm256_movemask_epi8(symbol));
+        const uint64_t pads = static_cast<uint32_t>(_mm256_movemask_epi8(pad));
+        const uint64_t spaces = static_cast<uint32_t>(_mm256_movemask_epi8(space));
+        if ((symbols | pads | spaces) != 0xFFFFFFFFull || !validate_masks(symbols, pads, state)) {
+            state.failed = true;
+            return i;
+        }
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 VBMI: 48 bytes to 64 characters per step with byte permutes
+// ---------------------------------------------------------------------------
+
+#define HYNI_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+// GCC 12 reports the intentionally undefined pass-through operand of the
+// unmasked VBMI intrinsics as uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+HYNI_TARGET_AVX512 size_t encode_avx512(const uint8_t* src, size_t len, char* dst) {
+    // Bytes [b1 b0 b2 b1] per 32-bit lane, then multishift extracts the four
+    // 6-bit fields of each group and a 64-entry permute maps them to characters.
+    const __m512i spread = _mm512_setr_epi32(
+        0x01020001, 0x04050304, 0x07080607, 0x0a0b090a, 0x0d0e0c0d, 0x10110f10,
+        0x13141213, 0x16171516, 0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122,
+        0x25262425, 0x28292728, 0x2b2c2a2b, 0x2e2f2d2e);
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040a);
+    const __m512i alphabet = _mm512_loadu_si512(ALPHABET);
+
+    size_t i = 0;
+    for (; i + 48 <= len; i += 48, dst += 64) {
+        const __m512i in = _mm512_maskz_loadu_epi8(0x0000FFFFFFFFFFFFull, src + i);
+        const __m512i groups = _mm512_permutexvar_epi8(spread, in);
+        const __m512i indices = _mm512_multishift_epi64_epi8(shifts, groups);
+        _mm512_storeu_si512(dst, _mm512_permutexvar_epi8(indices, alphabet));
+    }
+    return i;
+}
+
+HYNI_TARGET_AVX512 inline __m512i avx512_translate(__m512i in, __mmask64& invalid) {
+    // 128-entry lookup across two registers; bit 7 marks invalid characters
+    const __m512i lookup_0 = _mm512_loadu_si512(DECODE_TABLE.data());
+    const __m512i lookup_1 = _mm512_loadu_si512(DECODE_TABLE.data() + 64);
+    const __m512i values = _mm512_permutex2var_epi8(lookup_0, in, lookup_1);
+    invalid = _mm512_movepi8_mask(_mm512_or_si512(values, in));
+    return values;
+}
+
+HYNI_TARGET_AVX512 size_t decode_avx512(const char* src, size_t len, uint8_t* dst, bool& ok) {
+    const __m512i pack = _mm512_setr_epi32(
+        0x06000102, 0x090a0405, 0x0c0d0e08, 0x16101112, 0x191a1415, 0x1c1d1e18,
+        0x26202122, 0x292a2425, 0x2c2d2e28, 0x36303132, 0x393a3435, 0x3c3d3e38,
+        0, 0, 0, 0);
+
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64, dst += 48) {
+        const __m512i in = _mm512_loadu_si512(src + i);
+        __mmask64 invalid;
+        const __m512i values = avx512_translate(in, invalid);
+        if (invalid) {
+            ok = false;
+            return i;
+        }
+        const __m512i ab_bc = _mm512_maddubs_epi16(values, _mm512_set1_epi32(0x01400140));
+        const __m512i abcd = _mm512_madd_epi16(ab_bc, _mm512_set1_epi32(0x00011000));
+        _mm512_mask_storeu_epi8(dst, 0x0000FFFFFFFFFFFFull, _mm512_permutexvar_epi8(pack, abcd));
+    }
+    return i;
+}
+
+HYNI_TARGET_AVX512 size_t validate_avx512(const char* src, size_t len, validation_state& state) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        const __m512i in = _mm512_loadu_si512(src + i);
+        __mmask64 invalid;
+        (void)avx512_translate(in, invalid);
+        const uint64_t symbols = ~invalid;
+        const uint64_t pads = _mm512_cmpeq_epi8_mask(in, _mm512_set1_epi8('='));
+        const uint64_t spaces =
+            _mm512_cmple_epu8_mask(_mm512_sub_epi8(in, _mm512_set1_epi8('\t')), _mm512_set1_epi8(4)) |
+            _mm512_cmpeq_epi8_mask(in, _mm512_set1_epi8(' '));
+        if ((symbols | pads | spaces) != ~0ull || !validate_masks(symbols, pads, state)) {
+            state.failed = true;
+            return i;
+        }
+    }
+    return i;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // HYNI_BASE64_X86
+
+#ifdef HYNI_BASE64_NEON
+
+// ---------------------------------------------------------------------------
+// NEON (AArch64): 48 bytes to 64 characters per step with (de)interleaving loads
+// ---------------------------------------------------------------------------
+
+inline uint8x16x4_t neon_load_table(const uint8_t* table) {
+    uint8x16x4_t result;
+    result.val[0] = vld1q_u8(table);
+    result.val[1] = vld1q_u8(table + 16);
+    result.val[2] = vld1q_u8(table + 32);
+    result.val[3] = vld1q_u8(table + 48);
+    return result;
+}
+
+size_t encode_neon(const uint8_t* src, size_t len, char* dst) {
+    const uint8x16x4_t alphabet = neon_load_table(reinterpret_cast<const uint8_t*>(ALPHABET));
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+
+    size_t i = 0;
+    for (; i + 48 <= len; i += 48, dst += 64) {
+        const uint8x16x3_t in = vld3q_u8(src + i);
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+        for (auto& v : out.val) {
+            v = vqtbl4q_u8(alphabet, v);
+        }
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst), out);
+    }
+    return i;
+}
+
+// Characters 0..63 come from the first table, 64..127 from the second; bytes
+// with bit 7 set in either the input or the result are invalid.
+inline uint8x16_t neon_translate(uint8x16_t in, const uint8x16x4_t& lo, const uint8x16x4_t& hi,
+                                 uint8x16_t& error) {
+    uint8x16_t values = vqtbl4q_u8(lo, in);
+    values = vqtbx4q_u8(values, hi, vsubq_u8(in, vdupq_n_u8(64)));
+    error = vorrq_u8(error, vorrq_u8(values, in));
+    return values;
+}
+
+size_t decode_neon(const char* src, size_t len, uint8_t* dst, bool& ok) {
+    const uint8x16x4_t lo = neon_load_table(DECODE_TABLE.data());
+    const uint8x16x4_t hi = neon_load_table(DECODE_TABLE.data() + 64);
+
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64, dst += 48) {
+        const uint8x16x4_t in = vld4q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        uint8x16_t error = vdupq_n_u8(0);
+        const uint8x16_t a = neon_translate(in.val[0], lo, hi, error);
+        const uint8x16_t b = neon_translate(in.val[1], lo, hi, error);
+        const uint8x16_t c = neon_translate(in.val[2], lo, hi, error);
+        const uint8x16_t d = neon_translate(in.val[3], lo, hi, error);
+        if (vmaxvq_u8(error) & INVALID) {
+            ok = false;
+            return i;
+        }
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(dst, out);
+    }
+    return i;
+}
+
+// Collapses a byte mask (0x00/0xFF per lane) to one bit per lane
+inline uint64_t neon_movemask(uint8x16_t mask) {
+    const uint8x16_t bits = vandq_u8(mask, vreinterpretq_u8_u64(vdupq_n_u64(0x8040201008040201ull)));
+    const uint8x8_t lo = vget_low_u8(bits);
+    const uint8x8_t hi = vget_high_u8(bits);
+    return vaddv_u8(lo) | (static_cast<uint64_t>(vaddv_u8(hi)) << 8);
+}
+
+size_t validate_neon(const char* src, size_t len, validation_state& state) {
+    const uint8x16x4_t lo = neon_load_table(DECODE_TABLE.data());
+    const uint8x16x4_t hi = neon_load_table(DECODE_TABLE.data() + 64);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const uint8x16_t in = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        uint8x16_t error = vdupq_n_u8(0);
+        (void)neon_translate(in, lo, hi, error);
+        const uint8x16_t symbol = vcltq_u8(error, vdupq_n_u8(INVALID));
+        const uint8x16_t pad = vceqq_u8(in, vdupq_n_u8('='));
+        const uint8x16_t space = vorrq_u8(vcleq_u8(vsubq_u8(in, vdupq_n_u8('\t')), vdupq_n_u8(4)),
+                                          vceqq_u8(in, vdupq_n_u8(' ')));
+        const uint64_t symbols = neon_movemask(symbol);
+        const uint64_t pads = neon_movemask(pad);
+        const uint64_t spaces = neon_movemask(space);
+        if ((symbols | pads | spaces) != 0xFFFF || !validate_masks(symbols, pads, state)) {
+            state.failed = true;
+            return i;
+        }
+    }
+    return i;
+}
+
+#endif // HYNI_BASE64_NEON
+
+hyni::base64::kernel detect_kernel() noexcept {
+    using kernel = hyni::base64::kernel;
+#ifdef HYNI_BASE64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vbmi")) {
+        return kernel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) return kernel::avx2;
+    if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) return kernel::sse41;
+#endif
+#ifdef HYNI_BASE64_NEON
+    return kernel::neon;
+#endif
+    return kernel::scalar;
+}
+
+// Kernels are ordered by preference, so a kernel is usable up to the detected one
+hyni::base64::kernel usable(hyni::base64::kernel k) noexcept {
+    return hyni::base64::is_supported(k) ? k : hyni::base64::kernel::scalar;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+base64::kernel base64::active_kernel() noexcept {
+    static const kernel detected = detect_kernel();
+    return detected;
+}
+
+bool base64::is_supported(kernel k) noexcept {
+    const kernel best = active_kernel();
+    switch (k) {
+    case kernel::scalar:
+        return true;
+    case kernel::sse41:
+    case kernel::avx2:
+    case kernel::avx512:
+        return best != kernel::neon && best != kernel::scalar && k <= best;
+    case kernel::neon:
+        return best == kernel::neon;
+    }
+    return false;
+}
+
+std::vector<base64::kernel> base64::supported_kernels() {
+    std::vector<kernel> result;
+    for (kernel k : {kernel::scalar, kernel::sse41, kernel::avx2, kernel::avx512, kernel::neon}) {
+        if (is_supported(k)) result.push_back(k);
+    }
+    return result;
+}
+
+const char* base64::kernel_name(kernel k) noexcept {
+    switch (k) {
+    case kernel::scalar: return "scalar";
+    case kernel::sse41:  return "sse4.1";
+    case kernel::avx2:   return "avx2";
+    case kernel::avx512: return "avx512";
+    case kernel::neon:   return "neon";
+    }
+    return "unknown";
+}
+
+size_t base64::decoded_size(std::string_view text) noexcept {
+    const size_t len = text.size() - text.size() % 4;
+    size_t padding = 0;
+    if (len >= 4 && text[len - 1] == '=') padding = text[len - 2] == '=' ? 2 : 1;
+    return len / 4 * 3 - padding;
+}
+
+size_t base64::encode_to(const unsigned char* data, size_t len, char* out, kernel k) noexcept {
+    size_t done = 0;
+    switch (usable(k)) {
+#ifdef HYNI_BASE64_X86
+    case kernel::sse41:  done = encode_sse41(data, len, out); break;
+    case kernel::avx2:   done = encode_avx2(data, len, out); break;
+    case kernel::avx512: done = encode_avx512(data, len, out); break;
+#endif
+#ifdef HYNI_BASE64_NEON
+    case kernel::neon:   done = encode_neon(data, len, out); break;
+#endif
+    default: break;
+    }
+
+    char* dst = out + done / 3 * 4;
+    const size_t scalar = encode_scalar(data + done, len - done, dst);
+    encode_tail(data + done + scalar, len - done - scalar, dst + scalar / 3 * 4);
+    return encoded_size(len);
+}
+
+std::string base64::encode(const unsigned char* data, size_t len, kernel k) {
+    std::string result(encoded_size(len), '\0');
+    encode_to(data, len, result.data(), k);
+    return result;
+}
+
+std::optional<size_t> base64::decode_to(std::string_view text, unsigned char* out,
+                                        kernel k) noexcept {
+    const size_t len = text.size();
+    if (len % 4 != 0) {
+        return std::nullopt;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    // Everything but the last quartet is padding-free; SIMD kernels work on that body
+    const char* src = text.data();
+    const size_t body = len - 4;
+    bool ok = true;
+    size_t done = 0;
+    switch (usable(k)) {
+#ifdef HYNI_BASE64_X86
+    case kernel::sse41:  done = decode_sse41(src, body, out, ok); break;
+    case kernel::avx2:   done = decode_avx2(src, body, out, ok); break;
+    case kernel::avx512: done = decode_avx512(src, body, out, ok); break;
+#endif
+#ifdef HYNI_BASE64_NEON
+    case kernel::neon:   done = decode_neon(src, body, out, ok); break;
+#endif
+    default: break;
+    }
+    if (!ok || !decode_scalar(src + done, body - done, out + done / 4 * 3)) {
+        return std::nullopt;
+    }
+
+    // Last quartet, possibly padded
+    const char* last = src + body;
+    const size_t padding = last[3] == '=' ? (last[2] == '=' ? 2 : 1) : 0;
+    uint8_t quartet[4];
+    for (size_t j = 0; j < 4; ++j) {
+        quartet[j] = j < 4 - padding ? DECODE_TABLE[static_cast<uint8_t>(last[j])] : 0;
+        if (quartet[j] & INVALID) {
+            return std::nullopt;
+        }
+    }
+    const uint32_t triple = (uint32_t(quartet[0]) << 18) | (uint32_t(quartet[1]) << 12) |
+                            (uint32_t(quartet[2]) << 6) | quartet[3];
+    unsigned char* dst = out + body / 4 * 3;
+    dst[0] = static_cast<unsigned char>(triple >> 16);
+    if (padding < 2) dst[1] = static_cast<unsigned char>(triple >> 8);
+    if (padding < 1) dst[2] = static_cast<unsigned char>(triple);
+    return body / 4 * 3 + 3 - padding;
+}
+
+std::optional<std::string> base64::decode(std::string_view text, kernel k) {
+    if (text.size() % 4 != 0) {
+        return std::nullopt;
+    }
+    std::string result(decoded_size(text), '\0');
+    auto written = decode_to(text, reinterpret_cast<unsigned char*>(result.data()), k);
+    if (!written) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+bool base64::is_valid(std::string_view text, kernel k) noexcept {
+    validation_state state;
+    size_t done = 0;
+    switch (usable(k)) {
+#ifdef HYNI_BASE64_X86
+    case kernel::sse41:  done = validate_sse41(text.data(), text.size(), state); break;
+    case kernel::avx2:   done = validate_avx2(text.data(), text.size(), state); break;
+    case kernel::avx512: done = validate_avx512(text.data(), text.size(), state); break;
+#endif
+#ifdef HYNI_BASE64_NEON
+    case kernel::neon:   done = validate_neon(text.data(), text.size(), state); break;
+#endif
+    default: break;
+    }
+    if (!state.failed) {
+        validate_scalar(text.data() + done, text.size() - done, state);
+    }
+    return !state.failed && state.symbols > 0 && state.symbols % 4 == 0 && state.padding <= 2;
+}
+
+} // hyni
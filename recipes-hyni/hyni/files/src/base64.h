@@ -0,0 +1,135 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @class base64
+ * @brief Vectorized base64 (RFC 4648, standard alphabet) encoding, decoding and validation
+ *
+ * Every operation has a scalar implementation and SIMD kernels for SSE4.1, AVX2,
+ * AVX-512 (VBMI) and NEON (AArch64). The fastest kernel supported by the running CPU
+ * is selected once at first use; all kernels produce bit-identical results.
+ *
+ * @note Thread-safe. All functions are stateless.
+ */
+class base64 final {
+public:
+    /**
+     * @brief Instruction set used by an operation
+     */
+    enum class kernel {
+        scalar,
+        sse41,
+        avx2,
+        avx512,
+        neon
+    };
+
+    base64() = delete;
+
+    /**
+     * @brief Gets the fastest kernel supported by the running CPU
+     */
+    [[nodiscard]] static kernel active_kernel() noexcept;
+
+    /**
+     * @brief Gets all kernels supported by the running CPU, scalar first
+     */
+    [[nodiscard]] static std::vector<kernel> supported_kernels();
+
+    /**
+     * @brief Checks whether the running CPU supports a kernel
+     */
+    [[nodiscard]] static bool is_supported(kernel k) noexcept;
+
+    /**
+     * @brief Gets the name of a kernel, e.g. "avx2"
+     */
+    [[nodiscard]] static const char* kernel_name(kernel k) noexcept;
+
+    /**
+     * @brief Gets the length of the padded encoding of a number of bytes
+     */
+    [[nodiscard]] static constexpr size_t encoded_size(size_t len) noexcept {
+        return 4 * ((len + 2) / 3);
+    }
+
+    /**
+     * @brief Gets the number of bytes a padded encoding decodes to
+     * @return The decoded size, assuming the text is valid
+     */
+    [[nodiscard]] static size_t decoded_size(std::string_view text) noexcept;
+
+    /**
+     * @brief Encodes bytes into a caller-provided buffer
+     * @param data Bytes to encode
+     * @param len Number of bytes
+     * @param out Destination, must hold at least encoded_size(len) characters
+     * @param k Kernel to use; unsupported kernels fall back to scalar
+     * @return Number of characters written
+     */
+    static size_t encode_to(const unsigned char* data, size_t len, char* out,
+                            kernel k = active_kernel()) noexcept;
+
+    /**
+     * @brief Encodes bytes with padding
+     */
+    [[nodiscard]] static std::string encode(const unsigned char* data, size_t len,
+                                            kernel k = active_kernel());
+
+    /**
+     * @brief Encodes the bytes of a string with padding
+     */
+    [[nodiscard]] static std::string encode(std::string_view input, kernel k = active_kernel()) {
+        return encode(reinterpret_cast<const unsigned char*>(input.data()), input.size(), k);
+    }
+
+    /**
+     * @brief Decodes padded base64 into a caller-provided buffer
+     *
+     * The text must be a multiple of 4 characters long, with at most two '='
+     * padding characters at the end and no whitespace.
+     *
+     * @param text Text to decode
+     * @param out Destination, must hold at least decoded_size(text) bytes
+     * @param k Kernel to use; unsupported kernels fall back to scalar
+     * @return Number of bytes written, or std::nullopt if the text is not valid base64
+     */
+    static std::optional<size_t> decode_to(std::string_view text, unsigned char* out,
+                                           kernel k = active_kernel()) noexcept;
+
+    /**
+     * @brief Decodes padded base64
+     * @return The decoded bytes, or std::nullopt if the text is not valid base64
+     */
+    [[nodiscard]] static std::optional<std::string> decode(std::string_view text,
+                                                           kernel k = active_kernel());
+
+    /**
+     * @brief Checks whether a text is base64, ignoring whitespace
+     *
+     * Accepts line-wrapped encodings (MIME, PEM): whitespace anywhere is skipped,
+     * the remaining characters must be a non-empty, padded encoding.
+     */
+    [[nodiscard]] static bool is_valid(std::string_view text, kernel k = active_kernel()) noexcept;
+};
+
+} // hyni
@@ -0,0 +1,387 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "batch_builder.h"
+#include <initializer_list>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+// "https://api.openai.com/v1/chat/completions" -> "/v1/chat/completions"
+std::string endpoint_path(const std::string& endpoint) {
+    const size_t scheme = endpoint.find("://");
+    const size_t path = endpoint.find('/', scheme == std::string::npos ? 0 : scheme + 3);
+    return path == std::string::npos ? "/" : endpoint.substr(path);
+}
+
+std::string json_string(const std::string& value) {
+    return nlohmann::json(value).dump();
+}
+
+// Picks the few fields an outcome needs out of a result line without
+// building a DOM; everything else is tokenized and dropped.
+class result_line_handler : public nlohmann::json_sax<nlohmann::json> {
+public:
+    result_line_handler(const std::vector<std::string>& text_path,
+                        const std::vector<std::string>& error_path)
+        : m_text_path(text_path)
+        , m_error_path(error_path) {
+    }
+
+    void reset(hyni::batch_outcome& outcome) {
+        m_outcome = &outcome;
+        m_depth = 0;
+        m_has_text = false;
+        m_has_body_error = false;
+        m_request_failed = false;
+        m_body_error.clear();
+    }
+
+    [[nodiscard]] bool has_text() const noexcept { return m_has_text; }
+    [[nodiscard]] bool request_failed() const noexcept { return m_request_failed; }
+    [[nodiscard]] bool has_body_error() const noexcept { return m_has_body_error; }
+    [[nodiscard]] std::string& body_error() noexcept { return m_body_error; }
+
+    bool null() override { return scalar(); }
+    bool boolean(bool) override { return scalar(); }
+    bool number_integer(number_integer_t value) override { return number(value); }
+    bool number_unsigned(number_unsigned_t value) override {
+        return number(static_cast<number_integer_t>(value));
+    }
+    bool number_float(number_float_t, const string_t&) override { return scalar(); }
+    bool binary(binary_t&) override { return scalar(); }
+
+    bool string(string_t& value) override {
+        if (at({"custom_id"})) {
+            m_outcome->custom_id.swap(value);
+        } else if (at({"error", "message"})) {
+            m_outcome->error.swap(value);
+        } else if (in_body(m_text_path)) {
+            m_outcome->text.swap(value);
+            m_has_text = true;
+        } else if (!m_error_path.empty() && in_body(m_error_path)) {
+            m_body_error.swap(value);
+            m_has_body_error = true;
+        }
+        return scalar();
+    }
+
+    bool start_object(std::size_t) override {
+        if (at({"error"})) {
+            m_request_failed = true;
+        }
+        return push(false);
+    }
+    bool end_object() override { return pop(); }
+    bool start_array(std::size_t) override { return push(true); }
+    bool end_array() override { return pop(); }
+
+    bool key(string_t& value) override {
+        m_frames[m_depth - 1].key.swap(value);
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        return false;
+    }
+
+private:
+    struct frame {
+        bool is_array = false;
+        size_t index = 0;
+        std::string key;
+    };
+
+    bool push(bool is_array) {
+        if (m_depth == m_frames.size()) {
+            m_frames.emplace_back();
+        }
+        auto& f = m_frames[m_depth++];
+        f.is_array = is_array;
+        f.index = 0;
+        return true;
+    }
+
+    bool pop() {
+        --m_depth;
+        return scalar(); // The closed container was a value of its parent
+    }
+
+    // Advances the enclosing array past the value just read
+    bool scalar() {
+        if (m_depth > 0 && m_frames[m_depth - 1].is_array) {
+            ++m_frames[m_depth - 1].index;
+        }
+        return true;
+    }
+
+    bool number(number_integer_t value) {
+        if (at({"response", "status_code"})) {
+            m_outcome->status_code = static_cast<int>(value);
+        }
+        return scalar();
+    }
+
+    // Whether the value being read sits at the given path below the root object
+    template <typename Path>
+    bool matches(size_t offset, const Path& path) const {
+        if (m_depth != offset + path.size()) return false;
+        size_t level = offset;
+        for (const auto& element : path) {
+            const auto& f = m_frames[level++];
+            if (f.is_array ? element != std::to_string(f.index) : element != f.key) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool at(std::initializer_list<std::string_view> path) const {
+        return m_depth >= 1 && !m_frames[0].is_array && matches(0, path);
+    }
+
+    bool in_body(const std::vector<std::string>& path) const {
+        return m_depth >= 3 && !m_frames[0].is_array && m_frames[0].key == "response" &&
+               !m_frames[1].is_array && m_frames[1].key == "body" && matches(2, path);
+    }
+
+    const std::vector<std::string>& m_text_path;
+    const std::vector<std::string>& m_error_path;
+    hyni::batch_outcome* m_outcome = nullptr;
+    std::vector<frame> m_frames;
+    size_t m_depth = 0;
+    bool m_has_text = false;
+    bool m_has_body_error = false;
+    bool m_request_failed = false;
+    std::string m_body_error;
+};
+
+} // anonymous namespace
+
+namespace hyni {
+
+batch_builder::batch_builder(general_context& context, const std::filesystem::path& path,
+                             batch_options options)
+    : m_context(context)
+    , m_base(context.snapshot())
+    , m_path(path)
+    , m_options(std::move(options))
+    , m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file) {
+        throw std::runtime_error("Failed to create batch file: " + path.string());
+    }
+    if (m_options.url.empty()) {
+        m_options.url = endpoint_path(context.get_endpoint());
+    }
+    m_line_suffix = ",\"method\":\"POST\",\"url\":" + json_string(m_options.url) + ",\"body\":";
+    m_buffer.reserve(m_options.buffer_size);
+}
+
+batch_builder::~batch_builder() {
+    try {
+        finish();
+    } catch (...) {
+        // Destructors must not throw; call finish() to see write errors
+    }
+}
+
+bool batch_builder::add(std::string custom_id, std::string prompt) {
+    if (m_finished) {
+        throw std::logic_error("batch_builder::add() called after finish()");
+    }
+    if (custom_id.empty()) {
+        throw validation_exception("Batch custom_id cannot be empty");
+    }
+    if (m_ids.count(custom_id)) {
+        throw validation_exception("Duplicate batch custom_id: " + custom_id);
+    }
+    if (m_count >= m_options.max_requests) {
+        return false;
+    }
+
+    // Each request starts from the conversation the builder was created with
+    m_context.restore(m_base);
+    m_context.add_user_message(std::move(prompt));
+    const std::string body = m_context.build_request_body();
+
+    const std::string id = json_string(custom_id);
+    const size_t line_size = 13 + id.size() + m_line_suffix.size() + body.size() + 2;
+    if (m_bytes + m_buffer.size() + line_size > m_options.max_file_bytes) {
+        return false;
+    }
+
+    if (m_buffer.size() + line_size > m_options.buffer_size) {
+        flush();
+    }
+    m_buffer.append("{\"custom_id\":").append(id).append(m_line_suffix).append(body).append("}\n");
+
+    m_ids.insert(std::move(custom_id));
+    ++m_count;
+    return true;
+}
+
+void batch_builder::finish() {
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_context.restore(m_base);
+    flush();
+    m_file.close();
+    if (!m_file) {
+        throw std::runtime_error("Failed to write batch file: " + m_path.string());
+    }
+}
+
+void batch_builder::flush() {
+    if (m_buffer.empty()) {
+        return;
+    }
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    if (!m_file) {
+        throw std::runtime_error("Failed to write batch file: " + m_path.string());
+    }
+    m_bytes += m_buffer.size();
+    m_buffer.clear();
+}
+
+local_batch_uploader::local_batch_uploader(responder respond, std::filesystem::path directory)
+    : m_respond(std::move(respond))
+    , m_directory(std::move(directory)) {
+}
+
+std::string local_batch_uploader::submit(const std::filesystem::path& requests) {
+    std::ifstream in(requests, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open batch file: " + requests.string());
+    }
+
+    const std::string batch_id = "batch_local_" + std::to_string(m_results.size());
+    const auto directory = m_directory.empty() ? requests.parent_path() : m_directory;
+    const auto output_path = directory / (requests.stem().string() + "_" + batch_id + "_output.jsonl");
+    std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Failed to create batch result file: " + output_path.string());
+    }
+
+    std::string line;
+    size_t index = 0;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        auto request = nlohmann::json::parse(line);
+
+        nlohmann::json result = {
+            {"id", "batch_req_" + std::to_string(index++)},
+            {"custom_id", request["custom_id"]},
+        };
+        try {
+            result["response"] = {
+                {"status_code", 200},
+                {"body", m_respond(request["body"])},
+            };
+            result["error"] = nullptr;
+        } catch (const std::exception& e) {
+            result["response"] = nullptr;
+            result["error"] = {{"code", "local_error"}, {"message", e.what()}};
+        }
+        out << result.dump() << '\n';
+    }
+
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write batch result file: " + output_path.string());
+    }
+    m_results.push_back(output_path);
+    return batch_id;
+}
+
+std::optional<std::filesystem::path> local_batch_uploader::results(const std::string& batch_id) {
+    static const std::string PREFIX = "batch_local_";
+    if (batch_id.compare(0, PREFIX.size(), PREFIX) == 0) {
+        const auto number = batch_id.substr(PREFIX.size());
+        if (!number.empty() && number.find_first_not_of("0123456789") == std::string::npos) {
+            const size_t index = std::stoul(number);
+            if (index < m_results.size()) {
+                return m_results[index];
+            }
+        }
+    }
+    throw std::runtime_error("Unknown batch: " + batch_id);
+}
+
+batch_result_reader::batch_result_reader(const general_context& context,
+                                         const std::filesystem::path& path)
+    : m_text_path(context.get_text_path())
+    , m_error_path(context.get_error_path())
+    , m_read_buffer(1024 * 1024) {
+    // The stream buffer must be installed before the file is opened
+    m_file.rdbuf()->pubsetbuf(m_read_buffer.data(), static_cast<std::streamsize>(m_read_buffer.size()));
+    m_file.open(path, std::ios::binary);
+    if (!m_file) {
+        throw std::runtime_error("Failed to open batch result file: " + path.string());
+    }
+}
+
+bool batch_result_reader::next(batch_outcome& outcome) {
+    do {
+        if (!std::getline(m_file, m_line)) {
+            return false;
+        }
+    } while (m_line.empty());
+
+    outcome.custom_id.clear();
+    outcome.success = false;
+    outcome.status_code = 0;
+    outcome.text.clear();
+    outcome.error.clear();
+
+    result_line_handler handler(m_text_path, m_error_path);
+    handler.reset(outcome);
+    if (!nlohmann::json::sax_parse(m_line, &handler)) {
+        outcome.custom_id.clear();
+        outcome.error = "Invalid batch result line";
+        return true;
+    }
+
+    if (handler.request_failed()) {
+        if (outcome.error.empty()) outcome.error = "Request failed";
+        outcome.text.clear();
+        return true;
+    }
+
+    if (outcome.status_code >= 200 && outcome.status_code < 300) {
+        if (handler.has_text()) {
+            outcome.success = true;
+        } else {
+            outcome.error = "Failed to extract text response";
+        }
+    } else if (outcome.status_code == 0) {
+        outcome.error = "Batch result has no response";
+    } else {
+        outcome.text.clear();
+        outcome.error = handler.has_body_error() ? std::move(handler.body_error())
+                                                 : "Request failed with status " +
+                                                   std::to_string(outcome.status_code);
+    }
+    return true;
+}
+
+size_t batch_result_reader::for_each(const std::function<void(const batch_outcome&)>& on_outcome) {
+    batch_outcome outcome;
+    size_t count = 0;
+    while (next(outcome)) {
+        on_outcome(outcome);
+        ++count;
+    }
+    return count;
+}
+
+} // hyni
@@ -0,0 +1,242 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "general_context.h"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Limits and layout of a batch request file
+ *
+ * The defaults are the limits of OpenAI's batch API.
+ */
+struct batch_options {
+    std::string url;                               ///< Endpoint path on each line; empty uses the context's endpoint path
+    size_t max_requests = 50000;                   ///< Most requests accepted in one file
+    size_t max_file_bytes = 200 * 1024 * 1024;     ///< Largest file accepted, in bytes
+    size_t buffer_size = 1024 * 1024;              ///< Bytes collected before each write to disk
+};
+
+/**
+ * @class batch_builder
+ * @brief Writes requests for a provider batch endpoint as a JSONL file
+ *
+ * Each line has the OpenAI batch layout:
+ * {"custom_id":...,"method":"POST","url":...,"body":{...}}, where the body is
+ * exactly what chat_api would send for the prompt. Requests are built by the
+ * given context on top of its state at construction (system message,
+ * parameters and any earlier turns), and serialized straight into a write
+ * buffer, so memory stays bounded by the buffer size regardless of the number
+ * of requests.
+ *
+ * The context is restored to its original conversation once the builder is
+ * finished or destroyed.
+ *
+ * @note Not thread-safe; the context must not be used elsewhere while the
+ *       builder is alive.
+ */
+class batch_builder {
+public:
+    /**
+     * @brief Creates the request file
+     * @param context Context whose request construction is used
+     * @param path File to write; an existing file is replaced
+     * @param options Limits and layout of the file
+     * @throws std::runtime_error If the file cannot be created
+     */
+    batch_builder(general_context& context, const std::filesystem::path& path,
+                  batch_options options = {});
+
+    /**
+     * @brief Finishes the file if finish() has not been called
+     */
+    ~batch_builder();
+
+    batch_builder(const batch_builder&) = delete;
+    batch_builder& operator=(const batch_builder&) = delete;
+
+    /**
+     * @brief Appends a request for one prompt
+     * @param custom_id Identifier that the result for this request carries
+     * @param prompt The user message
+     * @return False if the file has reached options().max_requests or the
+     *         request would exceed options().max_file_bytes; nothing is written then
+     * @throws validation_exception If custom_id is empty or was used before, or
+     *         the message is invalid
+     * @throws std::logic_error If the builder is finished
+     */
+    bool add(std::string custom_id, std::string prompt);
+
+    /**
+     * @brief Writes any buffered requests, closes the file and restores the context
+     * @throws std::runtime_error If writing fails
+     */
+    void finish();
+
+    /**
+     * @brief Gets the number of requests added
+     */
+    [[nodiscard]] size_t size() const noexcept { return m_count; }
+
+    /**
+     * @brief Gets the size of the file once finished, in bytes
+     */
+    [[nodiscard]] size_t bytes() const noexcept { return m_bytes; }
+
+    /**
+     * @brief Gets the path of the request file
+     */
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return m_path; }
+
+    /**
+     * @brief Gets the options the file is written with
+     */
+    [[nodiscard]] const batch_options& options() const noexcept { return m_options; }
+
+private:
+    void flush();
+
+    general_context& m_context;
+    context_snapshot m_base;
+    std::filesystem::path m_path;
+    batch_options m_options;
+    std::ofstream m_file;
+    std::string m_buffer;
+    std::string m_line_suffix;                 ///< Escaped method and url, shared by all lines
+    std::unordered_set<std::string> m_ids;
+    size_t m_count = 0;
+    size_t m_bytes = 0;
+    bool m_finished = false;
+};
+
+/**
+ * @class batch_uploader
+ * @brief Submits a request file to a batch endpoint and retrieves its results
+ *
+ * Implementations wrap a provider's file and batch APIs; local_batch_uploader
+ * stands in for them in tests and offline runs.
+ */
+class batch_uploader {
+public:
+    virtual ~batch_uploader() = default;
+
+    /**
+     * @brief Submits a request file written by batch_builder
+     * @param requests Path of the request file
+     * @return Identifier of the batch
+     * @throws std::runtime_error If the submission fails
+     */
+    virtual std::string submit(const std::filesystem::path& requests) = 0;
+
+    /**
+     * @brief Gets the results of a batch
+     * @param batch_id Identifier returned by submit()
+     * @return Path of the downloaded result file, or std::nullopt while the batch is running
+     * @throws std::runtime_error If the batch failed or is unknown
+     */
+    virtual std::optional<std::filesystem::path> results(const std::string& batch_id) = 0;
+};
+
+/**
+ * @class local_batch_uploader
+ * @brief Runs a batch in-process by answering each request with a callback
+ *
+ * submit() reads the request file line by line, passes each request body to the
+ * responder and writes a result file in the OpenAI batch output layout. A
+ * responder that throws produces an error result for that request only.
+ */
+class local_batch_uploader : public batch_uploader {
+public:
+    /**
+     * @brief Produces the provider response body for a request body
+     */
+    using responder = std::function<nlohmann::json(const nlohmann::json& body)>;
+
+    /**
+     * @param respond Callback answering each request
+     * @param directory Where result files are written; empty uses the request file's directory
+     */
+    explicit local_batch_uploader(responder respond, std::filesystem::path directory = {});
+
+    std::string submit(const std::filesystem::path& requests) override;
+    std::optional<std::filesystem::path> results(const std::string& batch_id) override;
+
+private:
+    responder m_respond;
+    std::filesystem::path m_directory;
+    std::vector<std::filesystem::path> m_results; ///< Result file per batch, indexed by batch number
+};
+
+/**
+ * @brief Outcome of one request in a batch result file
+ */
+struct batch_outcome {
+    std::string custom_id;  ///< Identifier given to batch_builder::add()
+    bool success = false;   ///< Whether the request returned a 2xx response
+    int status_code = 0;    ///< HTTP status of the request; 0 if it was not sent
+    std::string text;       ///< Response text, if successful
+    std::string error;      ///< Error message, if not
+};
+
+/**
+ * @class batch_result_reader
+ * @brief Reads a batch result file one outcome at a time
+ *
+ * Lines are read one by one and scanned with a SAX parser that keeps only the
+ * custom_id, status, error message and the response text at the schema's
+ * text path, so no DOM is built and memory stays bounded by the longest line.
+ */
+class batch_result_reader {
+public:
+    /**
+     * @param context Context whose schema describes the response bodies
+     * @param path Result file to read
+     * @throws std::runtime_error If the file cannot be opened
+     */
+    batch_result_reader(const general_context& context, const std::filesystem::path& path);
+
+    /**
+     * @brief Reads the next outcome
+     * @param outcome Receives the outcome; its buffers are reused
+     * @return False at the end of the file
+     *
+     * A line that is not a valid result yields an unsuccessful outcome rather
+     * than an exception, so one damaged line does not lose the rest of the batch.
+     */
+    bool next(batch_outcome& outcome);
+
+    /**
+     * @brief Reads all remaining outcomes
+     * @param on_outcome Called for each outcome, in file order
+     * @return Number of outcomes read
+     */
+    size_t for_each(const std::function<void(const batch_outcome&)>& on_outcome);
+
+private:
+    std::vector<std::string> m_text_path;
+    std::vector<std::string> m_error_path;
+    std::ifstream m_file;
+    std::vector<char> m_read_buffer;
+    std::string m_line;
+};
+
+} // hyni
@@ -13,25 +13,81 @@
 #include "http_client.h"
 #include "http_client_factory.h"
 #include "logger.h"
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <strings.h>
+#include <unordered_map>
 
 namespace hyni {
 
+namespace {
+
+// Retry delays stop doubling here, so large max_retries cannot overflow the shift
+constexpr size_t MAX_BACKOFF_DOUBLINGS = 16;
+
+// Adapts a text callback to typed events; everything but text is ignored
+stream_event_callback text_deltas(stream_callback on_chunk) {
+    return [on_chunk = std::move(on_chunk)](const stream_event& event) {
+        if (event.type == stream_event_type::text_delta && on_chunk) {
+            on_chunk(std::string(event.text));
+        }
+        return true;
+    };
+}
+
+// Response served from a response_cache or disk_cache
+http_response cached_response(std::string body) {
+    http_response response;
+    response.status_code = 200;
+    response.success = true;
+    response.body = std::move(body);
+    response.from_cache = true;
+    return response;
+}
+
+// Whether a failed batch request is worth sending again
+bool is_retryable(const http_response& response) {
+    if (response.status_code == 0) {
+        return response.error_message != "Request cancelled";
+    }
+    return response.status_code == 429 || response.status_code >= 500;
+}
+
+// Delay requested by a Retry-After header given in seconds
+std::optional<std::chrono::milliseconds> retry_after(const http_response& response) {
+    for (const auto& [name, value] : response.headers) {
+        if (strcasecmp(name.c_str(), "retry-after") != 0) {
+            continue;
+        }
+        double seconds = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+        if (error == std::errc() && end != value.data() && seconds >= 0) {
+            return std::chrono::milliseconds(static_cast<long long>(seconds * 1000));
+        }
+    }
+    return std::nullopt;
+}
+
+} // anonymous namespace
+
 chat_api::chat_api(std::unique_ptr<general_context> context)
     : m_context(std::move(context)) {
-    ensure_http_client();
 }
 
-std::string chat_api::send_message(const std::string& message, progress_callback cancel_check) {
+std::string chat_api::send_message(std::string message, progress_callback cancel_check) {
     LOG_INFO("chat_api::send_message()");
 
     ensure_http_client();
 
     m_context->clear_user_messages();
-    m_context->add_user_message(message);
+    m_context->add_user_message(std::move(message));
 
-    auto request = m_context->build_request();
-    m_http_client->set_headers(m_context->get_headers());
-    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check);
+    std::string cache_key;
+    auto response = post_message(std::move(cancel_check), &cache_key);
 
     if (!response.success) {
         LOG_ERROR("API request failed: " + response.error_message);
@@ -40,17 +96,31 @@ std::string chat_api::send_message(const std::string& message, progress_callback
 
     try {
         auto json_response = nlohmann::json::parse(response.body);
-        return m_context->extract_text_response(json_response);
+        std::string text = m_context->extract_text_response(json_response);
+        account_usage(response, json_response);
+        // Only answers that parse are worth replaying
+        if (!cache_key.empty() && !response.from_cache) {
+            store_cached(cache_key, std::move(response.body));
+        }
+        return text;
     } catch (const std::exception& e) {
         LOG_ERROR("Extract response failed: " + *e.what());
         throw failed_api_response(std::string(e.what()));
     }
 }
 
-void chat_api::send_message_stream(const std::string& message,
+void chat_api::send_message_stream(std::string message,
                                  stream_callback on_chunk,
                                  completion_callback on_complete,
                                  progress_callback cancel_check) {
+    send_message_stream(std::move(message), text_deltas(std::move(on_chunk)),
+                        std::move(on_complete), std::move(cancel_check));
+}
+
+void chat_api::send_message_stream(std::string message,
+                                   stream_event_callback on_event,
+                                   completion_callback on_complete,
+                                   progress_callback cancel_check) {
     ensure_http_client();
 
     if (!m_context->supports_streaming()) {
@@ -58,66 +128,125 @@ void chat_api::send_message_stream(const std::string& message,
     }
 
     m_context->clear_user_messages();
-    m_context->add_user_message(message);
+    m_context->add_user_message(std::move(message));
 
     // Enable streaming in the request
-    auto request = m_context->build_request();
-    request["stream"] = true;
-
-    m_http_client->set_headers(m_context->get_headers());
-    m_http_client->post_stream(
-        m_context->get_endpoint(),
-        request,
-        [on_chunk, this](const std::string& chunk) {
-            parse_stream_chunk(chunk, on_chunk);
-        },
-        on_complete,
-        cancel_check
-    );
+    auto body = std::make_shared<const std::string>(m_context->build_request_body(true));
+    post_stream_request(std::move(body), std::move(on_event), std::move(on_complete),
+                        std::move(cancel_check));
 }
 
-void chat_api::parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk) {
-    try {
-        std::istringstream stream(chunk);
-        std::string line;
-
-        while (std::getline(stream, line)) {
-            // Remove potential carriage return
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
+void chat_api::post_stream_request(request_body body, stream_event_callback on_event,
+                                   completion_callback on_complete,
+                                   progress_callback cancel_check) {
+    // Shared by the transfer callbacks, which run on the client's thread
+    struct stream_state {
+        sse_decoder decoder;
+        stream_event_parser parser;
+        stream_event_callback on_event; ///< The caller's callback, timing text deltas
+        std::atomic<bool> stopped{false};
+        std::atomic<bool> failed{false}; ///< An error event or parse failure; such streams are not cached
+        std::vector<std::string> chunks; ///< Recorded for the disk cache
+        stream_timing timing;
+        std::optional<token_usage> usage;
+    };
+    auto state = std::make_shared<stream_state>();
+    state->parser = m_context->get_stream_parser();
+    state->timing.start = stream_timing::clock::now();
+    state->on_event = [state = state.get(), on_event = std::move(on_event)](const stream_event& event) {
+        if (event.type == stream_event_type::text_delta) {
+            state->timing.add_delta(stream_timing::clock::now());
+        } else if (event.type == stream_event_type::usage && event.usage) {
+            (state->usage ? *state->usage : state->usage.emplace()).update(token_usage::from_json(*event.usage));
+        } else if (event.type == stream_event_type::error) {
+            state->failed.store(true, std::memory_order_relaxed);
+        }
+        return !on_event || on_event(event);
+    };
+
+    // Completes the timing, records it and the usage unless replayed, and hands it to on_complete
+    const auto finish = [state, provider = m_context->get_provider_name(), model = m_context->get_model(),
+                         api_key = m_context->get_api_key(), tag = m_usage_tag, ledger = m_usage_ledger](
+                            const http_response& response, const completion_callback& on_complete, bool replayed) {
+        state->timing.end = stream_timing::clock::now();
+        state->timing.headers_received = response.headers_received;
+        if (!replayed) {
+            stream_metrics::instance().record(provider, model, state->timing,
+                response.success || state->stopped.load(std::memory_order_relaxed));
+            if (state->usage) {
+                ledger->record(provider, model, api_key, tag, *state->usage);
             }
+        }
+        if (on_complete) {
+            http_response timed = response;
+            timed.timing = std::make_shared<const stream_timing>(state->timing);
+            on_complete(timed);
+        }
+    };
 
-            if (line.empty()) continue;
-
-            static const std::string DATA_PREFIX = "data: ";
-            if (line.compare(0, DATA_PREFIX.length(), DATA_PREFIX) == 0) {
-                std::string json_str = line.substr(DATA_PREFIX.length());
-
-                if (json_str == "[DONE]") {
-                    return;
-                }
+    std::string key;
+    if (m_disk_cache && m_context->allows_response_caching()) {
+        key = response_cache::make_key(m_context->get_endpoint(), *body);
+    }
 
-                try {
-                    auto json_chunk = nlohmann::json::parse(json_str);
-                    std::string content = m_context->extract_text_response(json_chunk);
-                    if (!content.empty()) {
-                        on_chunk(content);
-                    }
-                } catch (const nlohmann::json::exception& e) {
-                    // Log parsing error but don't throw
-                    // Consider adding a logger
-                }
+    sse_decoder::event_callback on_sse = [state](const sse_event& event) {
+        if (state->stopped.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            if (!state->parser.parse(event, state->on_event)) {
+                state->stopped.store(true, std::memory_order_relaxed);
             }
+        } catch (const std::exception& e) {
+            state->failed.store(true, std::memory_order_relaxed);
+            LOG_ERROR("Stream event callback failed: " + std::string(e.what()));
+        }
+    };
+
+    if (!key.empty()) {
+        // Replay a recorded stream chunk by chunk, on the calling thread
+        if (auto entry = m_disk_cache->find(key); entry && entry->is_stream()) {
+            for (std::string_view chunk : entry->chunks()) {
+                state->timing.bytes += chunk.size();
+                state->decoder.feed(chunk, on_sse);
+            }
+            state->decoder.finish(on_sse);
+            finish(cached_response(std::move(entry->data)), on_complete, true);
+            return;
         }
-    } catch (const std::exception& e) {
-        // Log error but don't throw in callback
     }
-}
 
+    const bool recording = !key.empty();
+    m_http_client->set_headers(m_context->get_headers());
+    m_http_client->post_stream(
+        m_context->get_endpoint(),
+        std::move(body),
+        [state, on_sse, recording](std::string_view chunk) {
+            if (recording) {
+                state->chunks.emplace_back(chunk);
+            }
+            state->timing.bytes += chunk.size();
+            state->decoder.feed(chunk, on_sse);
+        },
+        [state, on_sse, finish, on_complete = std::move(on_complete), cache = m_disk_cache,
+         key = std::move(key)](const http_response& response) {
+            state->decoder.finish(on_sse);
+            if (!key.empty() && response.success && !state->stopped.load(std::memory_order_relaxed) &&
+                !state->failed.load(std::memory_order_relaxed)) {
+                cache->store_stream(key, state->chunks);
+            }
+            finish(response, on_complete, false);
+        },
+        [state, cancel_check = std::move(cancel_check)]() {
+            return state->stopped.load(std::memory_order_relaxed) ||
+                   (cancel_check && cancel_check());
+        }
+    );
+}
 
-std::future<std::string> chat_api::send_message_async(const std::string& message) {
-    return std::async(std::launch::async, [self = shared_from_this(), message]() {
-        return self->send_message(message);
+std::future<std::string> chat_api::send_message_async(std::string message) {
+    return m_executor->submit([self = shared_from_this(), message = std::move(message)]() mutable {
+        return self->send_message(std::move(message));
     });
 }
 
@@ -137,9 +266,8 @@ std::string chat_api::send_message(progress_callback cancel_check) {
         throw no_user_message_error();
     }
 
-    auto request = m_context->build_request();
-    m_http_client->set_headers(m_context->get_headers());
-    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check);
+    std::string cache_key;
+    auto response = post_message(std::move(cancel_check), &cache_key);
 
     if (!response.success) {
         throw failed_api_response(response.error_message);
@@ -147,7 +275,12 @@ std::string chat_api::send_message(progress_callback cancel_check) {
 
     try {
         auto json_response = nlohmann::json::parse(response.body);
-        return m_context->extract_text_response(json_response);
+        std::string text = m_context->extract_text_response(json_response);
+        account_usage(response, json_response);
+        if (!cache_key.empty() && !response.from_cache) {
+            store_cached(cache_key, std::move(response.body));
+        }
+        return text;
     } catch (const std::exception& e) {
         throw failed_api_response("Failed to parse API response: " + std::string(e.what()));
     }
@@ -156,6 +289,13 @@ std::string chat_api::send_message(progress_callback cancel_check) {
 void chat_api::send_message_stream(stream_callback on_chunk,
                                    completion_callback on_complete,
                                    progress_callback cancel_check) {
+    send_message_stream(text_deltas(std::move(on_chunk)), std::move(on_complete),
+                        std::move(cancel_check));
+}
+
+void chat_api::send_message_stream(stream_event_callback on_event,
+                                   completion_callback on_complete,
+                                   progress_callback cancel_check) {
     ensure_http_client();
 
     if (!m_context->supports_streaming()) {
@@ -176,26 +316,415 @@ void chat_api::send_message_stream(stream_callback on_chunk,
     }
 
     // Build request with streaming enabled
-    auto request = m_context->build_request(true);
-    m_http_client->set_headers(m_context->get_headers());
-
-    m_http_client->post_stream(
-        m_context->get_endpoint(),
-        request,
-        [on_chunk, this](const std::string& chunk) {
-            parse_stream_chunk(chunk, on_chunk);
-        },
-        on_complete,
-        cancel_check
-        );
+    auto body = std::make_shared<const std::string>(m_context->build_request_body(true));
+    post_stream_request(std::move(body), std::move(on_event), std::move(on_complete),
+                        std::move(cancel_check));
 }
 
 std::future<std::string> chat_api::send_message_async() {
-    return std::async(std::launch::async, [self = shared_from_this()]() {
+    return m_executor->submit([self = shared_from_this()]() {
         return self->send_message();
     });
 }
 
+task<std::string> chat_api::co_send_message(std::string message, resume_executor executor) {
+    m_context->clear_user_messages();
+    m_context->add_user_message(std::move(message));
+    co_return co_await co_send_message(std::move(executor));
+}
+
+task<std::string> chat_api::co_send_message(resume_executor executor) {
+    transport_request request = make_transport_request(false);
+    const std::string key = response_cache_key(request);
+    if (!key.empty()) {
+        if (auto body = find_cached(key)) {
+            co_return parse_text_response(cached_response(*body));
+        }
+    }
+
+    http_response response = co_await transfer_awaiter(*m_transport, std::move(request),
+                                                       std::move(executor));
+    std::string text = parse_text_response(response);
+    if (!key.empty()) {
+        store_cached(key, std::move(response.body));
+    }
+    co_return text;
+}
+
+delta_stream chat_api::co_send_message_stream(std::string message, resume_executor executor) {
+    if (!m_context->supports_streaming()) {
+        throw streaming_not_supported_error();
+    }
+
+    m_context->clear_user_messages();
+    m_context->add_user_message(std::move(message));
+    return co_send_message_stream(std::move(executor));
+}
+
+delta_stream chat_api::co_send_message_stream(resume_executor executor) {
+    if (!m_context->supports_streaming()) {
+        throw streaming_not_supported_error();
+    }
+
+    auto shared = std::make_shared<delta_stream::state>();
+    shared->executor = std::move(executor);
+    shared->transport = m_transport;
+
+    // Decoding state, used only on the transport thread
+    struct decoding {
+        sse_decoder decoder;
+        stream_event_parser parser;
+        std::string error;
+        sse_decoder::event_callback on_sse;
+        std::vector<std::string> chunks; ///< Recorded for the disk cache
+        stream_timing timing;
+        std::optional<token_usage> usage;
+    };
+    auto decode = std::make_shared<decoding>();
+    decode->parser = m_context->get_stream_parser();
+    decode->on_sse = [shared, state = decode.get()](const sse_event& event) {
+        state->parser.parse(event, [&](const stream_event& typed) {
+            if (typed.type == stream_event_type::text_delta) {
+                state->timing.add_delta(stream_timing::clock::now());
+                shared->push(std::string(typed.text));
+            } else if (typed.type == stream_event_type::usage && typed.usage) {
+                (state->usage ? *state->usage : state->usage.emplace()).update(token_usage::from_json(*typed.usage));
+            } else if (typed.type == stream_event_type::error) {
+                state->error = std::string(typed.text);
+            }
+            return true;
+        });
+    };
+
+    transport_request request = make_transport_request(true);
+    std::string key = m_disk_cache ? response_cache_key(request) : std::string();
+    if (!key.empty()) {
+        // A recorded stream is decoded up front; the consumer still awaits each delta
+        if (auto entry = m_disk_cache->find(key); entry && entry->is_stream()) {
+            for (std::string_view chunk : entry->chunks()) {
+                decode->decoder.feed(chunk, decode->on_sse);
+            }
+            decode->decoder.finish(decode->on_sse);
+            shared->finish(std::move(decode->error));
+            return delta_stream(std::move(shared));
+        }
+    }
+
+    request.on_chunk = [decode, recording = !key.empty()](std::string_view chunk) {
+        if (recording) {
+            decode->chunks.emplace_back(chunk);
+        }
+        decode->timing.bytes += chunk.size();
+        decode->decoder.feed(chunk, decode->on_sse);
+    };
+    request.cancel_check = [shared] { return shared->abandoned.load(); };
+
+    decode->timing.start = stream_timing::clock::now();
+    shared->id = m_transport->submit(std::move(request), [shared, decode, cache = m_disk_cache,
+                                                          key = std::move(key),
+                                                          provider = m_context->get_provider_name(),
+                                                          model = m_context->get_model(),
+                                                          api_key = m_context->get_api_key(), tag = m_usage_tag,
+                                                          ledger = m_usage_ledger](http_response response) {
+        decode->decoder.finish(decode->on_sse);
+        decode->timing.end = stream_timing::clock::now();
+        decode->timing.headers_received = response.headers_received;
+        std::string error = std::move(decode->error);
+        if (error.empty() && !response.success) {
+            error = "API request failed: " + failure_message(response);
+        }
+        if (!key.empty() && error.empty()) {
+            cache->store_stream(key, decode->chunks);
+        }
+        stream_metrics::instance().record(provider, model, decode->timing,
+                                          error.empty() || shared->abandoned.load());
+        if (decode->usage) {
+            ledger->record(provider, model, api_key, tag, *decode->usage);
+        }
+        shared->finish(std::move(error));
+    });
+    return delta_stream(std::move(shared));
+}
+
+std::vector<batch_response> chat_api::send_batch(std::span<const std::string> prompts,
+                                                 const send_batch_options& options,
+                                                 batch_response_callback on_response) {
+    using clock = rate_limiter::clock;
+    if (options.max_concurrency == 0) {
+        throw std::invalid_argument("send_batch: max_concurrency must be at least 1");
+    }
+
+    // Completions arrive on the transport thread and are handled here. The
+    // state is shared so that transfers still running when this call unwinds
+    // complete harmlessly.
+    struct completed {
+        size_t index;
+        http_response response;
+    };
+    struct shared_state {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<completed> done;
+    };
+    auto shared = std::make_shared<shared_state>();
+
+    struct pending_retry {
+        size_t index;
+        clock::time_point at;
+    };
+
+    const context_snapshot base = m_context->snapshot();
+    const size_t base_tokens = m_context->get_estimated_history_tokens();
+    const token_estimator& estimator = m_context->get_token_estimator();
+    rate_limiter limiter(options.requests_per_minute, options.tokens_per_minute);
+
+    std::vector<batch_response> results(prompts.size());
+    struct prepared {
+        transport_request request;
+        std::string cache_key;
+        size_t estimated_tokens; ///< Taken from the limiter for each attempt
+    };
+    std::unordered_map<size_t, prepared> requests; // Kept until final, for retries
+    std::unordered_map<size_t, async_transport::transfer_id> in_flight;
+    std::deque<pending_retry> retries;
+    size_t next = 0;
+    size_t finished = 0;
+
+    struct cleanup {
+        chat_api& api;
+        const context_snapshot& base;
+        std::unordered_map<size_t, async_transport::transfer_id>& in_flight;
+        ~cleanup() {
+            for (const auto& [index, id] : in_flight) {
+                api.m_transport->cancel(id);
+            }
+            api.m_context->restore(base);
+        }
+    } guard{*this, base, in_flight};
+
+    auto settle = [&](size_t index, const http_response& response) {
+        batch_response& result = results[index];
+        result.index = index;
+        result.status_code = response.status_code;
+        try {
+            token_usage usage;
+            result.text = parse_text_response(response, &usage);
+            result.success = true;
+            // The provider's count replaces the estimate taken from the token budget
+            if (usage.input_tokens > 0) {
+                limiter.correct_tokens(requests[index].estimated_tokens, usage.input_tokens);
+            }
+            if (const auto& key = requests[index].cache_key; !key.empty() && result.attempts > 0) {
+                store_cached(key, response.body);
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+        requests.erase(index);
+        ++finished;
+        if (on_response) {
+            on_response(result);
+        }
+    };
+
+    while (finished < prompts.size()) {
+        // Start requests while a slot and the rate limits allow
+        std::optional<clock::time_point> wake_at;
+        while (in_flight.size() < options.max_concurrency) {
+            const clock::time_point now = clock::now();
+            size_t index;
+            if (!retries.empty() && retries.front().at <= now) {
+                index = retries.front().index;
+            } else if (next < prompts.size()) {
+                index = next;
+            } else {
+                if (!retries.empty()) wake_at = retries.front().at;
+                break;
+            }
+
+            auto request = requests.find(index);
+            if (request == requests.end()) {
+                m_context->restore(base);
+                m_context->add_user_message(prompts[index]);
+                transport_request built = make_transport_request(false);
+                std::string key = response_cache_key(built);
+                request = requests.emplace(index, prepared{std::move(built), std::move(key),
+                                                           base_tokens + estimator.count(prompts[index])}).first;
+
+                // Cached answers need neither a slot nor rate limit budget
+                if (!request->second.cache_key.empty()) {
+                    if (auto body = find_cached(request->second.cache_key)) {
+                        ++next;
+                        settle(index, cached_response(*body));
+                        continue;
+                    }
+                }
+            }
+
+            const auto wait = limiter.try_acquire(request->second.estimated_tokens, now);
+            if (wait > clock::duration::zero()) {
+                wake_at = now + wait;
+                break;
+            }
+            if (index == next) {
+                ++next;
+            } else {
+                retries.pop_front();
+            }
+
+            ++results[index].attempts;
+            in_flight[index] = m_transport->submit(request->second.request,
+                [shared, index](http_response response) {
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    shared->done.push_back({index, std::move(response)});
+                    shared->ready.notify_one();
+                });
+        }
+
+        if (finished == prompts.size()) {
+            break; // The last prompts were answered from the cache
+        }
+
+        std::deque<completed> done;
+        {
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            const auto has_work = [&] { return !shared->done.empty(); };
+            if (wake_at) {
+                shared->ready.wait_until(lock, *wake_at, has_work);
+            } else {
+                shared->ready.wait(lock, has_work);
+            }
+            done.swap(shared->done);
+        }
+
+        for (auto& [index, response] : done) {
+            in_flight.erase(index);
+            batch_response& result = results[index];
+            if (!response.success && is_retryable(response) && result.attempts <= options.max_retries) {
+                result.status_code = response.status_code;
+                const size_t doublings = std::min<size_t>(result.attempts - 1, MAX_BACKOFF_DOUBLINGS);
+                auto delay = retry_after(response).value_or(options.retry_delay * (int64_t{1} << doublings));
+                const auto at = clock::now() + delay;
+                if (response.status_code == 429) {
+                    limiter.pause_until(at);
+                }
+                // Retries are kept in order of their due time
+                auto position = std::find_if(retries.begin(), retries.end(),
+                                             [&](const pending_retry& r) { return r.at > at; });
+                retries.insert(position, pending_retry{index, at});
+                continue;
+            }
+            settle(index, response);
+        }
+    }
+    return results;
+}
+
+http_response chat_api::post_message(progress_callback cancel_check, std::string* cache_key) {
+    transport_request request = make_transport_request(false);
+    *cache_key = response_cache_key(request);
+    if (!cache_key->empty()) {
+        if (auto body = find_cached(*cache_key)) {
+            return cached_response(*body);
+        }
+    }
+
+    http_response response;
+    // Waiting on the transport from its own event loop, as a coroutine
+    // continuation or transport callback would, could never be answered
+    if (m_single_flight && !m_transport->in_event_loop()) {
+        // Identical requests in flight can only be shared on the transport
+        request.cancel_check = std::move(cancel_check);
+        std::promise<http_response> done;
+        auto result = done.get_future();
+        m_transport->submit(std::move(request), [&done](http_response completed) {
+            done.set_value(std::move(completed));
+        });
+        response = result.get();
+    } else {
+        m_http_client->set_headers(request.headers);
+        response = m_http_client->post(request.url, std::move(request.body), cancel_check);
+    }
+    return response;
+}
+
+response_cache::payload chat_api::find_cached(const std::string& key) {
+    if (auto body = m_response_cache->find(key)) {
+        return body;
+    }
+    if (!m_disk_cache) {
+        return nullptr;
+    }
+    auto entry = m_disk_cache->find(key);
+    if (!entry || entry->is_stream()) {
+        return nullptr;
+    }
+    // Promote to memory for the next lookup
+    m_response_cache->insert(key, entry->data);
+    return std::make_shared<const std::string>(std::move(entry->data));
+}
+
+void chat_api::store_cached(const std::string& key, std::string body) {
+    if (m_disk_cache) {
+        m_disk_cache->store(key, body);
+    }
+    m_response_cache->insert(key, std::move(body));
+}
+
+std::string chat_api::response_cache_key(const transport_request& request) const {
+    if (!m_context->allows_response_caching()) {
+        return {};
+    }
+    return response_cache::make_key(request.url, *request.body);
+}
+
+transport_request chat_api::make_transport_request(bool streaming) {
+    transport_request request;
+    request.url = m_context->get_endpoint();
+    request.body = std::make_shared<const std::string>(m_context->build_request_body(streaming));
+    request.headers = m_context->get_headers();
+    request.single_flight = m_single_flight;
+    return request;
+}
+
+std::optional<token_usage> chat_api::account_usage(const http_response& response, const nlohmann::json& body) {
+    if (response.from_cache) {
+        return std::nullopt;
+    }
+    auto usage = m_context->extract_usage(body);
+    if (usage) {
+        m_usage_ledger->record(m_context->get_provider_name(), m_context->get_model(),
+                               m_context->get_api_key(), m_usage_tag, *usage);
+    }
+    return usage;
+}
+
+std::string chat_api::parse_text_response(const http_response& response, token_usage* usage) {
+    if (!response.success) {
+        std::string error = response.error_message;
+        if (error.empty()) {
+            error = "HTTP " + std::to_string(response.status_code);
+            auto body = nlohmann::json::parse(response.body, nullptr, false);
+            if (!body.is_discarded()) {
+                error += ": " + m_context->extract_error(body);
+            }
+        }
+        LOG_ERROR("API request failed: " + error);
+        throw std::runtime_error("API request failed: " + error);
+    }
+
+    try {
+        auto json_response = nlohmann::json::parse(response.body);
+        std::string text = m_context->extract_text_response(json_response);
+        if (auto reported = account_usage(response, json_response); reported && usage) {
+            *usage = *reported;
+        }
+        return text;
+    } catch (const std::exception& e) {
+        throw failed_api_response(std::string(e.what()));
+    }
+}
+
 void chat_api::ensure_http_client() {
     if (!m_http_client) {
         m_http_client = http_client_factory::create_http_client(*m_context);
@@ -11,10 +11,22 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <optional>
+#include <span>
 #include "http_client.h"
 #include "general_context.h"
+#include "sse_decoder.h"
+#include "stream_events.h"
+#include "thread_pool.h"
+#include "coro.h"
+#include "rate_limiter.h"
+#include "disk_cache.h"
+#include "response_cache.h"
+#include "stream_metrics.h"
+#include "traffic_recording.h"
+#include "usage_accounting.h"
 
 namespace hyni
 {
@@ -41,6 +53,34 @@ public:
         : chat_api_error("Failed to parse API response: " + message) {}
 };
 
+/**
+ * @brief Options for chat_api::send_batch
+ */
+struct send_batch_options {
+    size_t max_concurrency = 8;      ///< Requests in flight at once
+    size_t requests_per_minute = 0;  ///< Provider request limit; 0 is unlimited
+    size_t tokens_per_minute = 0;    ///< Provider token limit, applied to estimated prompt tokens; 0 is unlimited
+    size_t max_retries = 3;          ///< Retries after a 429, a 5xx or a transport failure
+    std::chrono::milliseconds retry_delay{1000}; ///< First retry delay without Retry-After; doubles per retry, up to 65536 times
+};
+
+/**
+ * @brief Result of one prompt of chat_api::send_batch
+ */
+struct batch_response {
+    size_t index = 0;      ///< Position of the prompt in the batch
+    bool success = false;
+    long status_code = 0;  ///< HTTP status of the last attempt; 0 if none was received
+    std::string text;      ///< Response text on success
+    std::string error;     ///< Error message on failure
+    size_t attempts = 0;   ///< Requests sent for this prompt
+};
+
+/**
+ * @brief Receives each batch_response as soon as it is final
+ */
+using batch_response_callback = std::function<void(const batch_response& response)>;
+
 /**
  * @brief Main class for interacting with LLM chat APIs
  *
@@ -49,7 +89,12 @@ public:
  *
  * Thread Safety: This class is NOT thread-safe. Concurrent calls to any
  * methods may result in undefined behavior. For concurrent usage, create
- * separate instances or use external synchronization.
+ * separate instances, use external synchronization, or use chat_client,
+ * whose session handles may be used from any thread.
+ *
+ * The HTTP client of the blocking API is created on first use, so an
+ * instance that only uses the coroutine and batch APIs holds no connection
+ * of its own.
  */
 class chat_api : public std::enable_shared_from_this<chat_api> {
 public:
@@ -72,32 +117,64 @@ public:
 
     /**
      * @brief Sends a message and waits for a response
+     *
+     * A message passed as an rvalue is moved into the request; the only copy
+     * made is its serialization into the request body.
+     *
      * @param message The message to send
      * @param cancel_check Optional callback to check if the operation should be cancelled
      * @return The response text
      * @throws std::runtime_error If the request fails or the response cannot be parsed
      */
-    [[nodiscard]] std::string send_message(const std::string& message, progress_callback cancel_check = nullptr);
+    [[nodiscard]] std::string send_message(std::string message, progress_callback cancel_check = nullptr);
 
     /**
      * @brief Sends a message and streams the response
+     *
+     * The response passed to on_complete carries the stream's timing in
+     * http_response::timing: time to headers, to the first text delta, the
+     * gaps between deltas, and delta and byte counts. The same timing is added
+     * to stream_metrics::instance() for the provider and model.
+     *
      * @param message The message to send
      * @param on_chunk Callback function to handle each chunk of the response
      * @param on_complete Optional callback function to handle completion
      * @param cancel_check Optional callback to check if the operation should be cancelled
      * @throws std::runtime_error If streaming is not supported or the request fails
      */
-    void send_message_stream(const std::string& message,
+    void send_message_stream(std::string message,
                              stream_callback on_chunk,
                              completion_callback on_complete = nullptr,
                              progress_callback cancel_check = nullptr);
 
+    /**
+     * @brief Sends a message and streams the response as typed events
+     *
+     * Text deltas, usage updates, the finish reason, pings and in-stream errors
+     * are reported separately, using the paths of the provider schema. Returning
+     * false from on_event cancels the transfer.
+     *
+     * @param message The message to send
+     * @param on_event Callback function to handle each event
+     * @param on_complete Optional callback function to handle completion, with the stream's timing
+     * @param cancel_check Optional callback to check if the operation should be cancelled
+     * @throws std::runtime_error If streaming is not supported or the request fails
+     */
+    void send_message_stream(std::string message,
+                             stream_event_callback on_event,
+                             completion_callback on_complete = nullptr,
+                             progress_callback cancel_check = nullptr);
+
     /**
      * @brief Sends a message asynchronously
+     *
+     * The request runs on the executor set with set_executor(), by default
+     * thread_pool::shared_io(); no thread is started per call.
+     *
      * @param message The message to send
      * @return A future containing the response text
      */
-    [[nodiscard]] std::future<std::string> send_message_async(const std::string& message);
+    [[nodiscard]] std::future<std::string> send_message_async(std::string message);
 
     /**
      * @brief Sends the current context as a message and waits for a response
@@ -118,12 +195,208 @@ public:
                              completion_callback on_complete = nullptr,
                              progress_callback cancel_check = nullptr);
 
+    /**
+     * @brief Sends the current context as a message and streams the response as typed events
+     * @param on_event Callback function to handle each event; return false to stop
+     * @param on_complete Optional callback function to handle completion
+     * @param cancel_check Optional callback to check if the operation should be cancelled
+     * @throws std::runtime_error If streaming is not supported or the request fails
+     */
+    void send_message_stream(stream_event_callback on_event,
+                             completion_callback on_complete = nullptr,
+                             progress_callback cancel_check = nullptr);
+
     /**
      * @brief Sends the current context as a message asynchronously
      * @return A future containing the response text
      */
     [[nodiscard]] std::future<std::string> send_message_async();
 
+    /**
+     * @brief Sets the pool that runs asynchronous requests
+     * @param executor Pool to use; must outlive every request submitted to it
+     *
+     * Waiting on a returned future from a task of the same pool can deadlock
+     * it once every worker is waiting.
+     */
+    void set_executor(thread_pool& executor) noexcept { m_executor = &executor; }
+
+    /**
+     * @brief Gets the pool that runs asynchronous requests
+     */
+    [[nodiscard]] thread_pool& get_executor() const noexcept { return *m_executor; }
+
+    /**
+     * @brief Sends a message from a coroutine
+     *
+     * The request goes through the async_transport, so no thread blocks while
+     * it is in flight and any number of conversations can wait at once:
+     *
+     * @code
+     * hyni::task<void> ask(hyni::chat_api& api) {
+     *     std::string answer = co_await api.co_send_message("Hello", hyni::pool_executor(pool));
+     * }
+     * @endcode
+     *
+     * The message is added to the context when the task starts; the chat_api
+     * must outlive the task.
+     *
+     * @param message The message to send
+     * @param executor Where the coroutine resumes; by default on the transport thread
+     * @return Task producing the response text
+     * @throws std::runtime_error From the task, if the request fails or the response cannot be parsed
+     */
+    [[nodiscard]] task<std::string> co_send_message(std::string message,
+                                                    resume_executor executor = {});
+
+    /**
+     * @brief Sends a message and returns an async generator of the response text
+     *
+     * The request starts at once. Deltas are queued as they arrive and read with
+     * `co_await stream.next()`; destroying the stream cancels the request.
+     * The stream's timing is added to stream_metrics::instance() when it ends.
+     *
+     * @param message The message to send
+     * @param executor Where a coroutine waiting in next() resumes; by default on the transport thread
+     * @return The stream of text deltas
+     * @throws streaming_not_supported_error If the provider cannot stream
+     */
+    [[nodiscard]] delta_stream co_send_message_stream(std::string message,
+                                                      resume_executor executor = {});
+
+    /**
+     * @brief Sends the current context as a message from a coroutine
+     * @param executor Where the coroutine resumes; by default on the transport thread
+     * @return Task producing the response text
+     * @throws std::runtime_error From the task, if the request fails or the response cannot be parsed
+     */
+    [[nodiscard]] task<std::string> co_send_message(resume_executor executor = {});
+
+    /**
+     * @brief Sends the current context as a message and returns an async generator of the response text
+     * @param executor Where a coroutine waiting in next() resumes; by default on the transport thread
+     * @return The stream of text deltas
+     * @throws streaming_not_supported_error If the provider cannot stream
+     */
+    [[nodiscard]] delta_stream co_send_message_stream(resume_executor executor = {});
+
+    /**
+     * @brief Sends many independent prompts concurrently
+     *
+     * Each prompt is sent as the next user turn of the current conversation,
+     * like batch_builder, and the context is left as it was. Up to
+     * max_concurrency requests are in flight on the async_transport at once,
+     * sharing its pooled connections, and new requests are paced to the
+     * configured per-minute limits. A 429 response pauses all requests for its
+     * Retry-After delay; 429, 5xx and transport failures are retried.
+     *
+     * @param prompts The prompts to send
+     * @param options Concurrency, rate limit and retry settings
+     * @param on_response Optional callback for each result as it completes, called on
+     *        the calling thread
+     * @return One result per prompt, in input order
+     * @throws std::invalid_argument If max_concurrency is 0
+     */
+    [[nodiscard]] std::vector<batch_response> send_batch(std::span<const std::string> prompts,
+                                                         const send_batch_options& options = {},
+                                                         batch_response_callback on_response = nullptr);
+
+    /**
+     * @brief Sets the transport used by the coroutine and batch APIs
+     * @param transport Transport to use; must outlive every request submitted to it
+     */
+    void set_transport(async_transport& transport) noexcept { m_transport = &transport; }
+
+    /**
+     * @brief Shares identical concurrent requests instead of sending each upstream
+     * @param enabled True to deduplicate; off by default
+     *
+     * While enabled, send_message() and the coroutine and batch APIs send their
+     * requests on the async_transport as single_flight requests: one that is
+     * byte-for-byte equivalent to a request already in flight, from this or any
+     * other chat_api on the same transport, waits for that request's response
+     * instead of sending its own. Streams are fanned out to every waiter.
+     *
+     * Only useful for deterministic requests, since all waiters get the same answer.
+     * Blocking sends made on the transport's event loop thread are not shared,
+     * since waiting there would stall the transport they wait on.
+     */
+    void set_single_flight(bool enabled) noexcept { m_single_flight = enabled; }
+
+    /**
+     * @brief Sets the cache for responses to deterministic requests
+     * @param cache Cache to use; must outlive this object
+     *
+     * send_message() and the coroutine and batch APIs answer a request from the
+     * cache when general_context::allows_response_caching() is true, and store
+     * successful responses there. Streamed responses are only cached on disk, see
+     * set_disk_cache().
+     * By default response_cache::instance() is used.
+     */
+    void set_response_cache(response_cache& cache) noexcept { m_response_cache = &cache; }
+
+    /**
+     * @brief Gets the cache for responses to deterministic requests
+     */
+    [[nodiscard]] response_cache& get_response_cache() const noexcept { return *m_response_cache; }
+
+    /**
+     * @brief Sets a persistent cache behind the response cache
+     * @param cache Cache to use, or nullptr for none (the default); must outlive this object
+     *
+     * Cacheable requests missing from the response cache are looked up on disk
+     * and successful responses are stored there too. Unlike the response cache,
+     * the disk cache also records streamed responses, which are replayed chunk
+     * by chunk on a hit.
+     */
+    void set_disk_cache(disk_cache* cache) noexcept { m_disk_cache = cache; }
+
+    /**
+     * @brief Sets the ledger that token usage is accounted to
+     * @param ledger Ledger to use; must outlive this object
+     *
+     * The usage block of every response received from the provider, and the
+     * usage events of every stream, are recorded under the context's provider,
+     * model and API key and the tag set with set_usage_tag(). Responses
+     * answered from a cache cost nothing and are not recorded.
+     * By default usage_ledger::instance() is used.
+     */
+    void set_usage_ledger(usage_ledger& ledger) noexcept { m_usage_ledger = &ledger; }
+
+    /**
+     * @brief Gets the ledger that token usage is accounted to
+     */
+    [[nodiscard]] usage_ledger& get_usage_ledger() const noexcept { return *m_usage_ledger; }
+
+    /**
+     * @brief Sets the tag usage of this object is accounted under, e.g. a tenant or feature
+     */
+    void set_usage_tag(std::string tag) { m_usage_tag = std::move(tag); }
+
+    /**
+     * @brief Records the requests of send_message() and send_message_stream() to a trace
+     * @param recorder Recorder to write to, or nullptr to stop recording
+     *
+     * Requests sent through the async_transport, such as those of the
+     * coroutine and batch APIs, are not recorded.
+     */
+    void set_traffic_recorder(std::shared_ptr<traffic_recorder> recorder) {
+        ensure_http_client();
+        m_http_client->set_traffic_recorder(std::move(recorder));
+    }
+
+    /**
+     * @brief Answers send_message() and send_message_stream() from a recorded trace
+     * @param replay Trace to replay, or nullptr to use the network again
+     *
+     * Lets the message path, the SSE decoder and stream consumers be
+     * benchmarked against real traffic without network access.
+     */
+    void set_traffic_replay(std::shared_ptr<traffic_replay> replay) {
+        ensure_http_client();
+        m_http_client->set_traffic_replay(std::move(replay));
+    }
+
     /**
      * @brief Gets the underlying context for advanced usage
      * @return Reference to the general context
@@ -138,18 +411,70 @@ public:
 
 private:
     /**
-     * @brief Parses a streaming response chunk and extracts content
+     * @brief Posts a streaming request and decodes its server-sent events
      *
-     * This method handles Server-Sent Events (SSE) format responses from streaming APIs.
-     * It processes lines starting with "data: " and extracts the actual content
-     * from the JSON payload.
+     * Each stream gets its own sse_decoder, so events split across network
+     * chunks are reassembled before the context's stream_event_parser types
+     * them. Once on_event returns false no further events are delivered and
+     * the transfer is cancelled. The stream is timed; see send_message_stream().
+     *
+     * @param body Serialized request with streaming enabled
+     * @param on_event Callback to invoke with each typed event
+     * @param on_complete Callback to invoke when the stream ends
+     * @param cancel_check Optional callback to check if the operation should be cancelled
+     *
+     * @note Exceptions thrown by on_event are caught and suppressed to prevent
+     *       callback interruption
+     */
+    void post_stream_request(request_body body, stream_event_callback on_event,
+                             completion_callback on_complete, progress_callback cancel_check);
+
+    /**
+     * @brief Builds a transport request for the current context
+     * @param streaming Whether to enable streaming in the request
+     */
+    [[nodiscard]] transport_request make_transport_request(bool streaming);
+
+    /**
+     * @brief Sends the current context as a blocking, non-streaming request
      *
-     * @param chunk Raw chunk received from the HTTP stream
-     * @param on_chunk Callback to invoke with extracted content
+     * Goes through the transport when single-flight is enabled, otherwise
+     * through the http_client. Answers from the response cache first; a fresh
+     * response is not cached here, since only the caller knows it parses.
      *
-     * @note Exceptions are caught and suppressed to prevent callback interruption
+     * @param cache_key Set to the response cache key, empty if the request is not cacheable
+     */
+    [[nodiscard]] http_response post_message(progress_callback cancel_check, std::string* cache_key);
+
+    /**
+     * @brief Gets the response cache key of a request, or an empty string if it must not be cached
+     */
+    [[nodiscard]] std::string response_cache_key(const transport_request& request) const;
+
+    /**
+     * @brief Looks up a response in the response cache, then in the disk cache
+     */
+    [[nodiscard]] response_cache::payload find_cached(const std::string& key);
+
+    /**
+     * @brief Stores a successful response in the response cache and the disk cache
+     */
+    void store_cached(const std::string& key, std::string body);
+
+    /**
+     * @brief Extracts the response text of a completed request and accounts its usage
+     * @param response The completed request
+     * @param usage Optional; receives the reported token usage of a response from the provider
+     * @throws std::runtime_error If the request failed
+     * @throws failed_api_response If the response cannot be parsed
+     */
+    [[nodiscard]] std::string parse_text_response(const http_response& response, token_usage* usage = nullptr);
+
+    /**
+     * @brief Records the token usage of a response to the usage ledger
+     * @return The reported usage; nullopt if the response came from a cache or reported none
      */
-    void parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk);
+    std::optional<token_usage> account_usage(const http_response& response, const nlohmann::json& body);
 
     /**
      * @brief Ensures that the HTTP client is initialized
@@ -176,6 +501,13 @@ private:
 private:
     std::unique_ptr<general_context> m_context;
     std::unique_ptr<http_client> m_http_client;  
+    thread_pool* m_executor = &thread_pool::shared_io();
+    async_transport* m_transport = &async_transport::shared();
+    bool m_single_flight = false;
+    response_cache* m_response_cache = &response_cache::instance();
+    disk_cache* m_disk_cache = nullptr;
+    usage_ledger* m_usage_ledger = &usage_ledger::instance();
+    std::string m_usage_tag;
 };
 
 struct needs_schema {};
@@ -0,0 +1,357 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "chat_client.h"
+#include "logger.h"
+
+namespace hyni {
+
+struct chat_session::job {
+    job* next = nullptr;
+    bool reset = false;
+    std::string message;
+    stream_callback on_chunk;  ///< Set for streamed requests
+    std::function<void(std::string text, std::exception_ptr error)> on_done;
+};
+
+struct chat_session::state {
+    state(chat_client& owner, std::unique_ptr<general_context> context)
+        : client(owner)
+        , api(std::move(context))
+        , initial(api.get_context().snapshot()) {}
+
+    // Marks a session whose requests are being worked through
+    static job* busy() noexcept {
+        static job marker;
+        return &marker;
+    }
+
+    chat_client& client;
+    chat_api api;               ///< Only used by the drain that owns the session
+    context_snapshot initial;
+    std::atomic<job*> head{nullptr}; ///< Submitted jobs, newest first; nullptr when idle
+};
+
+// A request waiting for rate limit budget
+struct chat_client::admission {
+    size_t tokens = 0;
+    std::coroutine_handle<> handle;
+    bool admitted = false;
+};
+
+void chat_session::submit(const std::shared_ptr<state>& target, std::unique_ptr<job> item) {
+    if (!target) {
+        throw std::logic_error("chat_session: the handle refers to no session");
+    }
+    job* node = item.release();
+    job* head = target->head.load(std::memory_order_relaxed);
+    do {
+        node->next = head == state::busy() ? nullptr : head;
+    } while (!target->head.compare_exchange_weak(head, node, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed));
+    if (head == nullptr) {
+        // The session was idle; this thread starts it
+        target->client.m_active.fetch_add(1, std::memory_order_relaxed);
+        spawn(target->client.drain(target));
+    }
+}
+
+std::future<std::string> chat_session::send(std::string message) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    auto future = promise->get_future();
+    auto item = std::make_unique<job>();
+    item->message = std::move(message);
+    item->on_done = [promise](std::string text, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(text));
+        }
+    };
+    submit(m_state, std::move(item));
+    return future;
+}
+
+task<std::string> chat_session::co_send(std::string message, resume_executor executor) {
+    // A static coroutine keeps the session alive instead of this handle
+    return await_reply(m_state, std::move(message), std::move(executor));
+}
+
+task<std::string> chat_session::await_reply(std::shared_ptr<state> target, std::string message,
+                                            resume_executor executor) {
+    struct awaiter {
+        awaiter(std::shared_ptr<state>& session, std::string& text_in, resume_executor& resume_on)
+            : target(session), message(text_in), executor(resume_on) {}
+
+        std::shared_ptr<state>& target;
+        std::string& message;
+        resume_executor& executor;
+        std::string text;
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> waiting) {
+            handle = waiting;
+            auto item = std::make_unique<job>();
+            item->message = std::move(message);
+            item->on_done = [this](std::string result, std::exception_ptr failure) {
+                text = std::move(result);
+                error = failure;
+                // Whoever comes second resumes: here, unless the reply arrived during submit
+                if (done.exchange(true, std::memory_order_acq_rel)) {
+                    if (executor) {
+                        // The frame holding executor may be gone before the call returns
+                        resume_executor resume_on = executor;
+                        resume_on(handle);
+                    } else {
+                        handle.resume();
+                    }
+                }
+            };
+            submit(target, std::move(item));
+            return !done.exchange(true, std::memory_order_acq_rel);
+        }
+        std::string await_resume() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(text);
+        }
+    };
+    co_return co_await awaiter(target, message, executor);
+}
+
+void chat_session::send_stream(std::string message, stream_callback on_chunk, completion_callback on_complete) {
+    auto item = std::make_unique<job>();
+    item->message = std::move(message);
+    item->on_chunk = on_chunk ? std::move(on_chunk) : [](const std::string&) {};
+    item->on_done = [on_complete = std::move(on_complete)](std::string, std::exception_ptr error) {
+        if (!on_complete) {
+            return;
+        }
+        http_response response;
+        response.success = !error;
+        if (error) {
+            try {
+                std::rethrow_exception(error);
+            } catch (const std::exception& e) {
+                response.error_message = e.what();
+            } catch (...) {
+                response.error_message = "Unknown error";
+            }
+        }
+        on_complete(response);
+    };
+    submit(m_state, std::move(item));
+}
+
+void chat_session::reset() {
+    auto item = std::make_unique<job>();
+    item->reset = true;
+    submit(m_state, std::move(item));
+}
+
+chat_client::chat_client(std::unique_ptr<general_context> prototype, const chat_client_options& options)
+    : m_prototype(std::move(prototype))
+    , m_options(options)
+    , m_response_cache(options.response_cache_bytes)
+    , m_limiter(options.requests_per_minute, options.tokens_per_minute)
+    , m_transport(options.max_host_connections) {
+    if (!m_prototype) {
+        throw std::invalid_argument("chat_client: prototype context cannot be null");
+    }
+    if (options.executor) {
+        m_resume = pool_executor(*options.executor);
+    }
+    if (!m_limiter.unlimited()) {
+        m_pacer = std::thread([this] { pace(); });
+    }
+}
+
+chat_client::~chat_client() {
+    m_stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_pace_mutex);
+        m_pace_stopping = true;
+    }
+    m_pace_ready.notify_all();
+    if (m_pacer.joinable()) {
+        m_pacer.join();
+    }
+
+    // Requests in flight finish; those queued behind them fail at once
+    std::unique_lock<std::mutex> lock(m_active_mutex);
+    m_idle.wait(lock, [this] { return m_active.load(std::memory_order_acquire) == 0; });
+}
+
+chat_session chat_client::open_session(std::string tag) {
+    std::unique_ptr<general_context> context;
+    {
+        std::lock_guard<std::mutex> lock(m_prototype_mutex);
+        context = m_prototype->fork();
+    }
+    auto shared = std::make_shared<chat_session::state>(*this, std::move(context));
+    chat_api& api = shared->api;
+    api.set_transport(m_transport);
+    api.set_response_cache(m_response_cache);
+    api.set_disk_cache(m_options.disk);
+    api.set_usage_ledger(m_options.ledger ? *m_options.ledger : usage_ledger::instance());
+    api.set_usage_tag(std::move(tag));
+    api.set_single_flight(m_options.single_flight);
+    return chat_session(std::move(shared));
+}
+
+task<void> chat_client::drain(std::shared_ptr<chat_session::state> session) {
+    using job = chat_session::job;
+    job* batch = session->head.exchange(chat_session::state::busy(), std::memory_order_acq_rel);
+    for (;;) {
+        // The list is newest first
+        job* ordered = nullptr;
+        while (batch) {
+            job* next = batch->next;
+            batch->next = ordered;
+            ordered = batch;
+            batch = next;
+        }
+        while (ordered) {
+            std::unique_ptr<job> current(ordered);
+            ordered = current->next;
+            co_await run(*session, *current);
+        }
+
+        job* expected = chat_session::state::busy();
+        if (session->head.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+            break;
+        }
+        batch = session->head.exchange(chat_session::state::busy(), std::memory_order_acq_rel);
+    }
+
+    // The last access to the client; the destructor may run as soon as the lock is released
+    std::lock_guard<std::mutex> lock(m_active_mutex);
+    if (m_active.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        m_idle.notify_all();
+    }
+}
+
+task<void> chat_client::run(chat_session::state& session, chat_session::job& item) {
+    general_context& context = session.api.get_context();
+    if (item.reset) {
+        context.restore(session.initial);
+        co_return;
+    }
+
+    std::string text;
+    std::exception_ptr error;
+    const context_snapshot before = context.snapshot();
+    try {
+        if (m_stopping.load(std::memory_order_acquire)) {
+            throw chat_api_error("chat_client is shutting down");
+        }
+        context.add_user_message(std::move(item.message));
+        co_await admit(context.get_estimated_history_tokens());
+        if (item.on_chunk) {
+            auto stream = session.api.co_send_message_stream(m_resume);
+            while (auto delta = co_await stream.next()) {
+                item.on_chunk(*delta);
+                text += *delta;
+            }
+        } else {
+            text = co_await session.api.co_send_message(m_resume);
+        }
+        context.add_assistant_message(text);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (error) {
+        context.restore(before);
+    }
+
+    try {
+        item.on_done(std::move(text), error);
+    } catch (const std::exception& e) {
+        LOG_ERROR(std::string("chat_session: completion callback threw: ") + e.what());
+    }
+}
+
+task<void> chat_client::admit(size_t tokens) {
+    struct awaiter {
+        awaiter(chat_client& owner, size_t tokens) : client(owner) { waiting.tokens = tokens; }
+
+        chat_client& client;
+        admission waiting;
+
+        bool await_ready() const noexcept { return client.m_limiter.unlimited(); }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> lock(client.m_pace_mutex);
+            if (client.m_pace_stopping) {
+                return false;
+            }
+            // Requests queued earlier go first
+            if (client.m_waiting.empty() &&
+                client.m_limiter.try_acquire(waiting.tokens) == rate_limiter::clock::duration::zero()) {
+                waiting.admitted = true;
+                return false;
+            }
+            waiting.handle = handle;
+            client.m_waiting.push_back(&waiting);
+            client.m_pace_ready.notify_one();
+            return true;
+        }
+        void await_resume() const {
+            if (!waiting.admitted && !client.m_limiter.unlimited()) {
+                throw chat_api_error("chat_client is shutting down");
+            }
+        }
+    };
+    co_await awaiter(*this, tokens);
+}
+
+void chat_client::pace() {
+    std::unique_lock<std::mutex> lock(m_pace_mutex);
+    while (!m_pace_stopping) {
+        if (m_waiting.empty()) {
+            m_pace_ready.wait(lock);
+            continue;
+        }
+        const auto wait = m_limiter.try_acquire(m_waiting.front()->tokens);
+        if (wait > rate_limiter::clock::duration::zero()) {
+            m_pace_ready.wait_for(lock, wait);
+            continue;
+        }
+        admission* next = m_waiting.front();
+        m_waiting.pop_front();
+        next->admitted = true;
+        lock.unlock();
+        resume(next->handle);
+        lock.lock();
+    }
+
+    // Fail the requests still waiting
+    std::deque<admission*> waiting;
+    waiting.swap(m_waiting);
+    lock.unlock();
+    for (admission* next : waiting) {
+        resume(next->handle);
+    }
+}
+
+void chat_client::resume(std::coroutine_handle<> handle) {
+    if (m_resume) {
+        m_resume(handle);
+    } else {
+        handle.resume();
+    }
+}
+
+} // hyni
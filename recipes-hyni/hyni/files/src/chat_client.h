@@ -0,0 +1,219 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "chat_api.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace hyni {
+
+class chat_client;
+
+/**
+ * @brief Options for chat_client
+ */
+struct chat_client_options {
+    size_t max_host_connections = 0;  ///< Connections kept open per host; 0 is unlimited
+    size_t requests_per_minute = 0;   ///< Request limit shared by every session; 0 is unlimited
+    size_t tokens_per_minute = 0;     ///< Token limit shared by every session, applied to estimated prompt tokens; 0 is unlimited
+    size_t response_cache_bytes = response_cache::DEFAULT_MAX_BYTES;
+    disk_cache* disk = nullptr;       ///< Optional persistent cache; must outlive the client
+    usage_ledger* ledger = nullptr;   ///< Where token usage is accounted; nullptr uses usage_ledger::instance()
+    bool single_flight = false;       ///< See chat_api::set_single_flight()
+    thread_pool* executor = nullptr;  ///< Where sessions continue after a response; nullptr runs them on the transport thread
+};
+
+/**
+ * @class chat_session
+ * @brief Handle to one conversation of a chat_client
+ *
+ * Handles are cheap to copy; copies refer to the same conversation. Any
+ * thread may submit requests to a session, also concurrently. They are sent
+ * one at a time, in the order they were submitted, each continuing the
+ * conversation: the message and the answer are appended to the session's
+ * history when the request succeeds, and a failed request leaves the
+ * history as it was.
+ *
+ * Submitting pushes the request onto a lock-free list. The thread that
+ * submits to an idle session starts it and builds the first request; a
+ * session that is busy picks the request up when the one before finishes.
+ *
+ * Callbacks and results are delivered on the thread the request finished on,
+ * the transport thread unless chat_client_options::executor is set, so they
+ * must not block. In particular, do not wait on the future of send() there.
+ *
+ * @note Thread-safe.
+ */
+class chat_session {
+public:
+    /**
+     * @brief Creates an empty handle; use chat_client::open_session()
+     */
+    chat_session() = default;
+
+    /**
+     * @brief Sends the next user message of the conversation
+     * @param message The message to send
+     * @return A future containing the response text, or the request's exception
+     */
+    [[nodiscard]] std::future<std::string> send(std::string message);
+
+    /**
+     * @brief Sends the next user message of the conversation from a coroutine
+     *
+     * The message is queued when the task starts.
+     *
+     * @param message The message to send
+     * @param executor Where the coroutine resumes; by default where the request finished
+     * @return Task producing the response text
+     * @throws std::runtime_error From the task, if the request fails or the response cannot be parsed
+     */
+    [[nodiscard]] task<std::string> co_send(std::string message, resume_executor executor = {});
+
+    /**
+     * @brief Sends the next user message of the conversation and streams the response
+     * @param message The message to send
+     * @param on_chunk Called with each text delta
+     * @param on_complete Optional; called when the stream ends, with success and error_message set
+     */
+    void send_stream(std::string message, stream_callback on_chunk, completion_callback on_complete = nullptr);
+
+    /**
+     * @brief Returns the conversation to its state when the session was opened
+     *
+     * Queued like a request: requests submitted before still continue the old
+     * conversation.
+     */
+    void reset();
+
+    /**
+     * @brief Checks whether the handle refers to a session
+     */
+    [[nodiscard]] explicit operator bool() const noexcept { return static_cast<bool>(m_state); }
+
+private:
+    friend class chat_client;
+
+    struct job;
+    struct state;
+
+    explicit chat_session(std::shared_ptr<state> shared) noexcept : m_state(std::move(shared)) {}
+
+    static void submit(const std::shared_ptr<state>& target, std::unique_ptr<job> item);
+    static task<std::string> await_reply(std::shared_ptr<state> target, std::string message,
+                                         resume_executor executor);
+
+    std::shared_ptr<state> m_state;
+};
+
+/**
+ * @class chat_client
+ * @brief Thread-safe client multiplexing many conversations over one transport
+ *
+ * chat_api and general_context must be confined to one thread at a time,
+ * which does not fit servers whose sessions move between threads. A
+ * chat_client owns what conversations share: an async_transport with its
+ * connection pool, a response cache, a rate limiter applied across every
+ * session, and the usage ledger and disk cache it is given. Each session
+ * opened from it has its own context, forked from the client's prototype,
+ * so opening one does not copy the prototype's history.
+ *
+ * Requests go through the coroutine path of chat_api, so none of them holds
+ * a thread while in flight. Without rate limits, submitting a request takes
+ * no lock; with limits, requests beyond the budget wait in a queue served by
+ * a pacing thread.
+ *
+ * Destroying the client fails every request that has not started and waits
+ * for those in flight. The client must outlive its sessions' use.
+ *
+ * @note Thread-safe.
+ */
+class chat_client {
+public:
+    /**
+     * @brief Creates a client
+     * @param prototype Context every session starts from: schema, API key,
+     *        system message, parameters and any shared history
+     * @param options Transport, cache and rate limit settings
+     * @throws std::invalid_argument If prototype is null
+     */
+    explicit chat_client(std::unique_ptr<general_context> prototype, const chat_client_options& options = {});
+    ~chat_client();
+
+    chat_client(const chat_client&) = delete;
+    chat_client& operator=(const chat_client&) = delete;
+
+    /**
+     * @brief Opens a conversation
+     * @param tag Tag its token usage is accounted under, see chat_api::set_usage_tag()
+     */
+    [[nodiscard]] chat_session open_session(std::string tag = {});
+
+    /**
+     * @brief Gets the transport every session sends on
+     */
+    [[nodiscard]] async_transport& get_transport() noexcept { return m_transport; }
+
+    /**
+     * @brief Gets the response cache shared by every session
+     */
+    [[nodiscard]] response_cache& get_response_cache() noexcept { return m_response_cache; }
+
+    /**
+     * @brief Gets the number of sessions currently working through their requests
+     */
+    [[nodiscard]] size_t active_sessions() const noexcept { return m_active.load(std::memory_order_relaxed); }
+
+private:
+    friend class chat_session;
+
+    struct admission;
+
+    // Works through a session's requests until it has none left
+    task<void> drain(std::shared_ptr<chat_session::state> session);
+    task<void> run(chat_session::state& session, chat_session::job& item);
+    task<void> admit(size_t tokens);
+    void pace();
+    void resume(std::coroutine_handle<> handle);
+
+    std::unique_ptr<general_context> m_prototype;
+    std::mutex m_prototype_mutex;  ///< Forking freezes the prototype's history
+    chat_client_options m_options;
+    resume_executor m_resume;
+    response_cache m_response_cache;
+
+    std::atomic<bool> m_stopping{false};
+    std::atomic<size_t> m_active{0};
+    std::mutex m_active_mutex;
+    std::condition_variable m_idle;
+
+    // Rate limits; only used when the limiter restricts anything
+    rate_limiter m_limiter;
+    std::mutex m_pace_mutex;
+    std::condition_variable m_pace_ready;
+    std::deque<admission*> m_waiting;
+    bool m_pace_stopping = false;
+    std::thread m_pacer;
+
+    async_transport m_transport;
+};
+
+} // hyni
@@ -0,0 +1,61 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "conversation.h"
+
+namespace hyni {
+
+conversation& conversation::set_system_message(std::string text) {
+    m_system_message = std::move(text);
+    return *this;
+}
+
+conversation& conversation::add_user_message(std::string content, std::vector<media_attachment> media) {
+    m_messages.push_back({"user", std::move(content), std::move(media)});
+    return *this;
+}
+
+conversation& conversation::add_assistant_message(std::string content) {
+    m_messages.push_back({"assistant", std::move(content), {}});
+    return *this;
+}
+
+conversation& conversation::set_parameter(const std::string& key, nlohmann::json value) {
+    m_parameters[key] = std::move(value);
+    return *this;
+}
+
+void conversation::apply_to(general_context& context) const {
+    if (m_system_message) {
+        if (context.supports_system_messages()) {
+            context.set_system_message(*m_system_message);
+        } else {
+            context.add_user_message(*m_system_message);
+        }
+    }
+
+    const auto& schema = context.get_schema();
+    for (const auto& [key, value] : m_parameters) {
+        if (schema.contains("parameters") && schema["parameters"].contains(key)) {
+            context.set_parameter(key, value);
+        }
+    }
+
+    for (const auto& message : m_messages) {
+        if (message.media.empty()) {
+            context.add_message(message.role, message.content);
+        } else {
+            context.add_message(message.role, message.content, message.media);
+        }
+    }
+}
+
+} // hyni
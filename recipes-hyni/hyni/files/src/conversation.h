@@ -0,0 +1,93 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "general_context.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief A message of a provider-neutral conversation
+ */
+struct conversation_message {
+    std::string role;                     ///< "user" or "assistant"
+    std::string content;
+    std::vector<media_attachment> media;  ///< Images, user messages only
+};
+
+/**
+ * @class conversation
+ * @brief A conversation kept independently of any provider's schema
+ *
+ * general_context stores messages in its provider's wire format. A
+ * conversation holds the same information neutrally, so one logical
+ * conversation can be sent to several providers: apply_to() writes it into
+ * a context of any schema, which then formats it for its provider.
+ */
+class conversation {
+public:
+    /**
+     * @brief Sets the system message
+     */
+    conversation& set_system_message(std::string text);
+
+    /**
+     * @brief Adds a user message, optionally with images
+     */
+    conversation& add_user_message(std::string content, std::vector<media_attachment> media = {});
+
+    /**
+     * @brief Adds an assistant message
+     */
+    conversation& add_assistant_message(std::string content);
+
+    /**
+     * @brief Sets a request parameter such as "temperature" or "max_tokens"
+     *
+     * Applied only to providers whose schema defines the parameter.
+     */
+    conversation& set_parameter(const std::string& key, nlohmann::json value);
+
+    /**
+     * @brief Writes the conversation into a context
+     *
+     * Meant for a fresh context, e.g. from context_factory::create_context().
+     * Providers without system message support get the system message as a
+     * leading user message.
+     *
+     * @throws validation_exception If the context rejects a message or parameter
+     */
+    void apply_to(general_context& context) const;
+
+    [[nodiscard]] const std::optional<std::string>& get_system_message() const noexcept {
+        return m_system_message;
+    }
+
+    [[nodiscard]] const std::vector<conversation_message>& get_messages() const noexcept {
+        return m_messages;
+    }
+
+    [[nodiscard]] const std::unordered_map<std::string, nlohmann::json>& get_parameters() const noexcept {
+        return m_parameters;
+    }
+
+private:
+    std::optional<std::string> m_system_message;
+    std::vector<conversation_message> m_messages;
+    std::unordered_map<std::string, nlohmann::json> m_parameters;
+};
+
+} // hyni
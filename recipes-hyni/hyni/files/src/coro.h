@@ -0,0 +1,424 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "async_transport.h"
+#include "thread_pool.h"
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace hyni {
+
+/**
+ * @brief Decides where a coroutine resumes after an I/O wait
+ *
+ * An empty executor resumes the coroutine directly on the thread that
+ * completed the wait, which for requests is the async_transport event loop.
+ */
+using resume_executor = std::function<void(std::coroutine_handle<> handle)>;
+
+/**
+ * @brief Resumes coroutines on a thread_pool
+ * @param pool Pool to use; must outlive the coroutines
+ */
+inline resume_executor pool_executor(thread_pool& pool) {
+    return [&pool](std::coroutine_handle<> handle) { pool.post([handle] { handle.resume(); }); };
+}
+
+template <typename T = void>
+class task;
+
+namespace detail {
+
+template <typename T>
+struct task_promise_base {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct task_promise : task_promise_base<T> {
+    std::optional<T> value;
+
+    task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+    T take() {
+        if (this->error) std::rethrow_exception(this->error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct task_promise<void> : task_promise_base<void> {
+    task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // detail
+
+/**
+ * @class task
+ * @brief Lazily started coroutine producing a T
+ *
+ * The body starts when the task is first awaited and the awaiting coroutine
+ * resumes when it finishes, by symmetric transfer, so chains of tasks use no
+ * extra threads or stack. Exceptions propagate to the awaiter.
+ *
+ * Start a task from ordinary code with spawn() or sync_wait().
+ */
+template <typename T>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task() noexcept = default;
+    explicit task(handle_type handle) noexcept : m_handle(handle) {}
+    task(task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ~task() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            handle_type handle;
+            bool await_ready() noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().take(); }
+        };
+        return awaiter{m_handle};
+    }
+
+    auto operator co_await() & noexcept { return std::move(*this).operator co_await(); }
+
+private:
+    handle_type m_handle;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+// Coroutine that owns itself: started at once, destroyed when it finishes
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+inline detached_task run_detached(task<void> work) {
+    try {
+        co_await std::move(work);
+    } catch (...) {
+        // Nobody awaits a spawned task; its exceptions are dropped
+    }
+}
+
+struct blocking_signal {
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool done = false;
+
+    // Notifies under the lock: the waiter may destroy the signal as soon as it wakes
+    void set() {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        ready.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return done; });
+    }
+};
+
+// Signals only once suspended at the end, so the waiter can destroy the frame
+struct sync_wait_task {
+    struct promise_type {
+        blocking_signal* signal = nullptr;
+
+        sync_wait_task get_return_object() noexcept {
+            return sync_wait_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct awaiter {
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    handle.promise().signal->set();
+                }
+                void await_resume() noexcept {}
+            };
+            return awaiter{};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T, typename Result>
+sync_wait_task run_sync_wait(task<T>& work, Result& result, std::exception_ptr& error) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(work);
+        } else {
+            result.emplace(co_await std::move(work));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+}
+
+} // detail
+
+/**
+ * @brief Starts a task without waiting for it
+ *
+ * The task owns itself and is destroyed when it finishes. Exceptions it lets
+ * escape are dropped, so spawned tasks should handle their own errors.
+ */
+inline void spawn(task<void> work) {
+    detail::run_detached(std::move(work));
+}
+
+/**
+ * @brief Runs a task and blocks the calling thread until it finishes
+ * @return The task's result; its exception is rethrown
+ *
+ * Must not be called from a thread the task needs in order to finish, such
+ * as the async_transport event loop.
+ */
+template <typename T>
+T sync_wait(task<T> work) {
+    std::conditional_t<std::is_void_v<T>, std::optional<std::monostate>, std::optional<T>> result;
+    std::exception_ptr error;
+    detail::blocking_signal signal;
+    auto waiter = detail::run_sync_wait(work, result, error);
+    waiter.handle.promise().signal = &signal;
+    waiter.handle.resume();
+    signal.wait();
+    waiter.handle.destroy();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*result);
+    }
+}
+
+/**
+ * @class transfer_awaiter
+ * @brief Awaits one async_transport request without blocking a thread
+ *
+ * The coroutine is suspended while the request is in flight and resumed
+ * through the executor when it completes.
+ */
+class transfer_awaiter {
+public:
+    transfer_awaiter(async_transport& transport, transport_request request,
+                     resume_executor executor = {})
+        : m_transport(transport), m_request(std::move(request)), m_executor(std::move(executor)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The completion may resume the coroutine, and so destroy this awaiter,
+        // before submit() returns; nothing of it is used after the resumption
+        m_transport.submit(std::move(m_request),
+                           [this, handle, executor = std::move(m_executor)](http_response response) {
+            m_response = std::move(response);
+            if (executor) {
+                executor(handle);
+            } else {
+                handle.resume();
+            }
+        });
+    }
+
+    http_response await_resume() { return std::move(m_response); }
+
+private:
+    async_transport& m_transport;
+    transport_request m_request;
+    resume_executor m_executor;
+    http_response m_response;
+};
+
+/**
+ * @class delta_stream
+ * @brief Async generator of the text deltas of a streamed response
+ *
+ * The transfer runs on the async_transport; deltas are queued as they are
+ * decoded and handed out by next():
+ *
+ * @code
+ * auto stream = api.co_send_message_stream("Tell me a story");
+ * while (auto delta = co_await stream.next()) {
+ *     std::cout << *delta;
+ * }
+ * @endcode
+ *
+ * Destroying the stream before the end cancels the transfer.
+ *
+ * @note One consumer at a time.
+ */
+class delta_stream {
+public:
+    /**
+     * @brief Shared between the stream and the transfer's callbacks
+     */
+    struct state {
+        std::mutex mutex;
+        std::deque<std::string> deltas;
+        bool finished = false;
+        std::string error;
+        std::coroutine_handle<> waiter;
+        resume_executor executor;
+        std::atomic<bool> abandoned{false};
+        async_transport* transport = nullptr;
+        async_transport::transfer_id id = 0;
+
+        // Called by the producer; resumes a waiting consumer
+        void push(std::string delta) { publish([&] { deltas.push_back(std::move(delta)); }); }
+        void finish(std::string message) {
+            publish([&] {
+                finished = true;
+                error = std::move(message);
+            });
+        }
+
+    private:
+        template <typename Update>
+        void publish(Update&& update) {
+            std::coroutine_handle<> resume;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                update();
+                resume = std::exchange(waiter, {});
+            }
+            if (!resume) return;
+            if (executor) {
+                executor(resume);
+            } else {
+                resume.resume();
+            }
+        }
+    };
+
+    explicit delta_stream(std::shared_ptr<state> shared) noexcept : m_state(std::move(shared)) {}
+    delta_stream(delta_stream&&) noexcept = default;
+    delta_stream& operator=(delta_stream&&) = delete;
+    ~delta_stream() {
+        if (m_state && !m_state->abandoned.exchange(true) && m_state->transport) {
+            m_state->transport->cancel(m_state->id);
+        }
+    }
+
+    /**
+     * @brief Awaits the next delta
+     * @return The delta, or std::nullopt once the response is complete
+     * @throws std::runtime_error If the request or the stream failed
+     */
+    auto next() noexcept {
+        struct awaiter {
+            state& shared;
+
+            bool await_ready() {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                return !shared.deltas.empty() || shared.finished;
+            }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                if (!shared.deltas.empty() || shared.finished) {
+                    return false; // Arrived in the meantime
+                }
+                shared.waiter = handle;
+                return true;
+            }
+            std::optional<std::string> await_resume() {
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                if (!shared.deltas.empty()) {
+                    std::string delta = std::move(shared.deltas.front());
+                    shared.deltas.pop_front();
+                    return delta;
+                }
+                if (!shared.error.empty()) {
+                    throw std::runtime_error(shared.error);
+                }
+                return std::nullopt;
+            }
+        };
+        return awaiter{*m_state};
+    }
+
+private:
+    std::shared_ptr<state> m_state;
+};
+
+} // hyni
@@ -0,0 +1,571 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "disk_cache.h"
+#include "hash.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t INDEX_MAGIC = 0x31584449494e5948ull;  // "HYNIIDX1"
+constexpr uint32_t RECORD_MAGIC = 0x43455248u;           // "HREC"
+constexpr size_t MIN_CAPACITY = 1024;
+
+struct record_header {
+    uint32_t magic;
+    uint32_t chunk_count;
+    uint64_t hash;
+    int64_t created;      ///< Nanoseconds since the epoch
+    uint32_t key_size;
+    uint32_t reserved;
+    uint64_t data_size;
+    uint64_t checksum;    ///< Hash of everything after the header
+};
+static_assert(sizeof(record_header) == 48);
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Index slots are shared between processes and must be lock-free");
+
+uint64_t key_hash(std::string_view key) {
+    const uint64_t hash = hyni::content_hash(key);
+    return hash != 0 ? hash : 1; // 0 marks an empty slot
+}
+
+size_t next_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::runtime_error("disk_cache: " + what + ": " + std::strerror(errno));
+}
+
+bool read_fully(int fd, void* buffer, size_t size, uint64_t offset) {
+    auto* out = static_cast<char*>(buffer);
+    while (size > 0) {
+        const ssize_t count = ::pread(fd, out, size, static_cast<off_t>(offset));
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) continue;
+            return false;
+        }
+        out += count;
+        size -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+void write_fully(int fd, const std::string& data, uint64_t offset) {
+    size_t written = 0;
+    while (written < data.size()) {
+        const ssize_t count = ::pwrite(fd, data.data() + written, data.size() - written,
+                                       static_cast<off_t>(offset + written));
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("write failed");
+        }
+        written += static_cast<size_t>(count);
+    }
+}
+
+// A complete record as stored, validated against its checksum
+struct raw_record {
+    record_header header;
+    std::string bytes; ///< Header followed by key, chunk sizes and data
+};
+
+std::optional<raw_record> read_raw(int fd, uint64_t offset, uint64_t committed) {
+    raw_record record;
+    if (offset + sizeof(record_header) > committed ||
+        !read_fully(fd, &record.header, sizeof(record_header), offset) ||
+        record.header.magic != RECORD_MAGIC) {
+        return std::nullopt;
+    }
+    const uint64_t body = uint64_t{record.header.key_size} +
+                          uint64_t{record.header.chunk_count} * sizeof(uint32_t) +
+                          record.header.data_size;
+    if (offset + sizeof(record_header) + body > committed) {
+        return std::nullopt;
+    }
+    record.bytes.resize(sizeof(record_header) + body);
+    std::memcpy(record.bytes.data(), &record.header, sizeof(record_header));
+    if (!read_fully(fd, record.bytes.data() + sizeof(record_header), body,
+                    offset + sizeof(record_header))) {
+        return std::nullopt;
+    }
+    const std::string_view rest(record.bytes.data() + sizeof(record_header), body);
+    if (hyni::content_hash(rest) != record.header.checksum) {
+        return std::nullopt; // Torn or corrupted
+    }
+    return record;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+struct disk_cache::index_header {
+    uint64_t magic;
+    uint64_t generation;
+    uint64_t capacity;                ///< Number of slots, a power of two
+    std::atomic<uint64_t> count;      ///< Occupied slots
+    std::atomic<uint64_t> data_size;  ///< Committed bytes of the data file
+    std::atomic<uint32_t> retired;    ///< Set once a newer generation replaced this one
+    uint32_t reserved[5];
+};
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+
+struct disk_cache::slot {
+    std::atomic<uint64_t> hash;   ///< Key hash; 0 if empty. Published last
+    std::atomic<uint64_t> offset; ///< Record offset in the data file
+};
+
+std::vector<std::string_view> disk_cache::entry::chunks() const {
+    std::vector<std::string_view> views;
+    views.reserve(chunk_sizes.size());
+    size_t offset = 0;
+    for (size_t size : chunk_sizes) {
+        views.emplace_back(data.data() + offset, size);
+        offset += size;
+    }
+    return views;
+}
+
+disk_cache::index_header* disk_cache::mapping::header() const noexcept {
+    return static_cast<index_header*>(address);
+}
+
+disk_cache::slot* disk_cache::mapping::slots() const noexcept {
+    return reinterpret_cast<slot*>(static_cast<char*>(address) + sizeof(index_header));
+}
+
+void disk_cache::mapping::close() noexcept {
+    if (address) ::munmap(address, length);
+    if (index_fd >= 0) ::close(index_fd);
+    if (data_fd >= 0) ::close(data_fd);
+    *this = mapping{};
+}
+
+disk_cache::disk_cache(std::filesystem::path directory, disk_cache_options options)
+    : m_directory(std::move(directory)), m_options(options) {
+    if (!m_options.read_only) {
+        std::filesystem::create_directories(m_directory);
+        const auto lock_path = m_directory / "lock";
+        m_lock_fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_lock_fd < 0) {
+            throw_errno("cannot open " + lock_path.string());
+        }
+        if (::flock(m_lock_fd, LOCK_EX | LOCK_NB) != 0) {
+            ::close(m_lock_fd);
+            throw std::runtime_error("disk_cache: " + m_directory.string() +
+                                     " is locked by another writer");
+        }
+    }
+    open_current();
+}
+
+disk_cache::~disk_cache() {
+    m_current.close();
+    if (m_lock_fd >= 0) {
+        ::close(m_lock_fd); // Releases the writer lock
+    }
+}
+
+void disk_cache::open_current() {
+    if (try_open_current(m_current)) {
+        if (!m_options.read_only) {
+            recover();
+        }
+        return;
+    }
+    if (!m_options.read_only) {
+        m_current = create_generation(1, MIN_CAPACITY);
+        publish_generation(m_current);
+    }
+}
+
+bool disk_cache::try_open_current(mapping& target) const {
+    const bool writable = !m_options.read_only;
+    mapping opened;
+    const auto index_path = m_directory / "index";
+    opened.index_fd = ::open(index_path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (opened.index_fd < 0) {
+        return false;
+    }
+
+    struct stat st {};
+    if (::fstat(opened.index_fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(index_header)) {
+        opened.close();
+        return false;
+    }
+    opened.length = static_cast<size_t>(st.st_size);
+    opened.address = ::mmap(nullptr, opened.length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED, opened.index_fd, 0);
+    if (opened.address == MAP_FAILED) {
+        opened.address = nullptr;
+        opened.close();
+        return false;
+    }
+
+    const index_header* header = opened.header();
+    const uint64_t capacity = header->capacity;
+    if (header->magic != INDEX_MAGIC || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        opened.length != sizeof(index_header) + capacity * sizeof(slot)) {
+        opened.close();
+        return false;
+    }
+
+    opened.generation = header->generation;
+    const auto data_path = m_directory / ("data." + std::to_string(opened.generation));
+    opened.data_fd = ::open(data_path.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (opened.data_fd < 0) {
+        opened.close(); // Replaced meanwhile; the caller tries again later
+        return false;
+    }
+    target = opened;
+    return true;
+}
+
+disk_cache::mapping disk_cache::create_generation(uint64_t generation, size_t capacity) {
+    const auto tmp_path = m_directory / "index.tmp";
+    const auto data_path = m_directory / ("data." + std::to_string(generation));
+
+    mapping created;
+    created.generation = generation;
+    created.data_fd = ::open(data_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (created.data_fd < 0) {
+        throw_errno("cannot create " + data_path.string());
+    }
+    created.index_fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (created.index_fd < 0) {
+        created.close();
+        throw_errno("cannot create " + tmp_path.string());
+    }
+    created.length = sizeof(index_header) + capacity * sizeof(slot);
+    if (::ftruncate(created.index_fd, static_cast<off_t>(created.length)) != 0) {
+        created.close();
+        throw_errno("cannot size " + tmp_path.string());
+    }
+    created.address = ::mmap(nullptr, created.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                             created.index_fd, 0);
+    if (created.address == MAP_FAILED) {
+        created.address = nullptr;
+        created.close();
+        throw_errno("cannot map " + tmp_path.string());
+    }
+
+    // A zero-filled file is an index of empty slots
+    index_header* header = created.header();
+    header->magic = INDEX_MAGIC;
+    header->generation = generation;
+    header->capacity = capacity;
+    return created;
+}
+
+void disk_cache::publish_generation(const mapping& created) {
+    // The new generation must be complete on disk before it replaces the old one
+    if (::fdatasync(created.data_fd) != 0 || ::msync(created.address, created.length, MS_SYNC) != 0) {
+        throw_errno("cannot sync cache files");
+    }
+    const auto index_path = m_directory / "index";
+    if (::rename((m_directory / "index.tmp").c_str(), index_path.c_str()) != 0) {
+        throw_errno("cannot replace " + index_path.string());
+    }
+}
+
+void disk_cache::recover() {
+    struct stat st {};
+    const uint64_t committed = m_current.header()->data_size.load(std::memory_order_acquire);
+    if (::fstat(m_current.data_fd, &st) == 0 && static_cast<uint64_t>(st.st_size) > committed) {
+        // Left by an append that was interrupted before it was committed
+        if (::ftruncate(m_current.data_fd, static_cast<off_t>(committed)) != 0) {
+            throw_errno("cannot truncate data file");
+        }
+    }
+}
+
+void disk_cache::refresh_if_retired() {
+    {
+        std::shared_lock lock(m_mutex);
+        if (m_current.address && !m_current.header()->retired.load(std::memory_order_acquire)) {
+            return;
+        }
+    }
+    std::unique_lock lock(m_mutex);
+    if (m_current.address && !m_current.header()->retired.load(std::memory_order_acquire)) {
+        return;
+    }
+    mapping next;
+    if (try_open_current(next)) {
+        m_current.close();
+        m_current = next;
+    }
+}
+
+std::optional<disk_cache::entry> disk_cache::find(std::string_view key) {
+    refresh_if_retired();
+
+    std::shared_lock lock(m_mutex);
+    if (!m_current.address) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    const uint64_t hash = key_hash(key);
+    const uint64_t mask = m_current.header()->capacity - 1;
+    slot* slots = m_current.slots();
+    for (uint64_t i = hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        const uint64_t stored = slots[i].hash.load(std::memory_order_acquire);
+        if (stored == 0) {
+            break;
+        }
+        if (stored != hash) {
+            continue;
+        }
+        bool matched = false;
+        auto found = read_record(slots[i].offset.load(std::memory_order_acquire), hash, key, &matched);
+        if (!matched) {
+            continue; // Hash collision
+        }
+        if (found && expired(found->created)) {
+            m_expired.fetch_add(1, std::memory_order_relaxed);
+            found.reset();
+        }
+        (found ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+}
+
+std::optional<disk_cache::entry> disk_cache::read_record(uint64_t offset, uint64_t hash,
+                                                         std::string_view key,
+                                                         bool* key_matched) const {
+    *key_matched = false;
+    const uint64_t committed = m_current.header()->data_size.load(std::memory_order_acquire);
+    auto record = read_raw(m_current.data_fd, offset, committed);
+    if (!record || record->header.hash != hash || record->header.key_size != key.size()) {
+        return std::nullopt;
+    }
+    const char* p = record->bytes.data() + sizeof(record_header);
+    if (std::string_view(p, key.size()) != key) {
+        return std::nullopt;
+    }
+    *key_matched = true;
+    p += key.size();
+
+    entry result;
+    result.created = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(record->header.created)));
+    result.chunk_sizes.resize(record->header.chunk_count);
+    for (auto& size : result.chunk_sizes) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        size = value;
+        p += sizeof(value);
+    }
+    result.data.assign(p, record->header.data_size);
+    return result;
+}
+
+bool disk_cache::expired(std::chrono::system_clock::time_point created) const {
+    return m_options.ttl.count() > 0 && std::chrono::system_clock::now() - created > m_options.ttl;
+}
+
+void disk_cache::store(std::string_view key, std::string_view body) {
+    if (m_options.read_only) {
+        return;
+    }
+    std::unique_lock lock(m_mutex);
+    append(key, {}, body);
+}
+
+void disk_cache::store_stream(std::string_view key, const std::vector<std::string>& chunks) {
+    if (m_options.read_only) {
+        return;
+    }
+    std::vector<uint32_t> sizes;
+    std::string data;
+    sizes.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+        sizes.push_back(static_cast<uint32_t>(chunk.size()));
+        data += chunk;
+    }
+    if (sizes.empty()) {
+        sizes.push_back(0); // Still a stream, of no chunks
+    }
+    std::unique_lock lock(m_mutex);
+    append(key, sizes, data);
+}
+
+void disk_cache::append(std::string_view key, const std::vector<uint32_t>& chunk_sizes,
+                        std::string_view data) {
+    if (!m_current.address) {
+        return;
+    }
+    index_header* header = m_current.header();
+    const uint64_t hash = key_hash(key);
+
+    record_header record{};
+    record.magic = RECORD_MAGIC;
+    record.chunk_count = static_cast<uint32_t>(chunk_sizes.size());
+    record.hash = hash;
+    record.created = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.key_size = static_cast<uint32_t>(key.size());
+    record.data_size = data.size();
+
+    std::string bytes(sizeof(record_header), '\0');
+    bytes.append(key);
+    bytes.append(reinterpret_cast<const char*>(chunk_sizes.data()), chunk_sizes.size() * sizeof(uint32_t));
+    bytes.append(data);
+    record.checksum = content_hash(std::string_view(bytes).substr(sizeof(record_header)));
+    std::memcpy(bytes.data(), &record, sizeof(record));
+
+    // Write, commit the size, then publish: a crash at any point leaves
+    // either an unreferenced tail, which recover() cuts off, or the new entry
+    const uint64_t offset = header->data_size.load(std::memory_order_relaxed);
+    write_fully(m_current.data_fd, bytes, offset);
+    if (m_options.sync_writes && ::fdatasync(m_current.data_fd) != 0) {
+        throw_errno("cannot sync data file");
+    }
+    header->data_size.store(offset + bytes.size(), std::memory_order_release);
+
+    const uint64_t mask = header->capacity - 1;
+    slot* slots = m_current.slots();
+    for (uint64_t i = hash & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+        const uint64_t stored = slots[i].hash.load(std::memory_order_relaxed);
+        if (stored == 0) {
+            slots[i].offset.store(offset, std::memory_order_relaxed);
+            slots[i].hash.store(hash, std::memory_order_release);
+            header->count.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if (stored == hash) {
+            bool matched = false;
+            (void)read_record(slots[i].offset.load(std::memory_order_relaxed), hash, key, &matched);
+            if (matched) {
+                slots[i].offset.store(offset, std::memory_order_release);
+                break;
+            }
+        }
+    }
+
+    if (header->count.load(std::memory_order_relaxed) * 2 > header->capacity) {
+        compact_locked(header->capacity * 2);
+    } else if (header->data_size.load(std::memory_order_relaxed) > m_options.max_bytes) {
+        compact_locked(0);
+    }
+}
+
+void disk_cache::compact() {
+    if (m_options.read_only) {
+        return;
+    }
+    std::unique_lock lock(m_mutex);
+    compact_locked(0);
+}
+
+void disk_cache::compact_locked(size_t min_capacity) {
+    if (!m_current.address) {
+        return;
+    }
+    const mapping& old = m_current;
+    const uint64_t committed = old.header()->data_size.load(std::memory_order_acquire);
+
+    std::vector<raw_record> live;
+    const slot* slots = old.slots();
+    for (uint64_t i = 0; i < old.header()->capacity; ++i) {
+        if (slots[i].hash.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        auto record = read_raw(old.data_fd, slots[i].offset.load(std::memory_order_relaxed), committed);
+        if (!record) {
+            continue;
+        }
+        const auto created = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(record->header.created)));
+        if (!expired(created)) {
+            live.push_back(std::move(*record));
+        }
+    }
+
+    // Keep the newest entries; when over budget, only within three quarters
+    // of it, so that appends do not trigger another compaction right away
+    std::sort(live.begin(), live.end(), [](const raw_record& a, const raw_record& b) {
+        return a.header.created > b.header.created;
+    });
+    const size_t budget = committed > m_options.max_bytes ? m_options.max_bytes / 4 * 3
+                                                          : m_options.max_bytes;
+    size_t kept = 0;
+    size_t bytes = 0;
+    while (kept < live.size() && bytes + live[kept].bytes.size() <= budget) {
+        bytes += live[kept].bytes.size();
+        ++kept;
+    }
+    live.resize(kept);
+    std::reverse(live.begin(), live.end()); // Oldest first, as they were appended
+
+    const size_t capacity = next_power_of_two(std::max({MIN_CAPACITY, min_capacity, kept * 4}));
+    mapping next = create_generation(old.generation + 1, capacity);
+    index_header* header = next.header();
+    slot* target = next.slots();
+    const uint64_t mask = capacity - 1;
+    uint64_t offset = 0;
+    for (const auto& record : live) {
+        write_fully(next.data_fd, record.bytes, offset);
+        for (uint64_t i = record.header.hash & mask;; i = (i + 1) & mask) {
+            if (target[i].hash.load(std::memory_order_relaxed) == 0) {
+                target[i].offset.store(offset, std::memory_order_relaxed);
+                target[i].hash.store(record.header.hash, std::memory_order_relaxed);
+                break;
+            }
+        }
+        offset += record.bytes.size();
+    }
+    header->count.store(live.size(), std::memory_order_relaxed);
+    header->data_size.store(offset, std::memory_order_release);
+    publish_generation(next);
+
+    const auto old_data = m_directory / ("data." + std::to_string(old.generation));
+    old.header()->retired.store(1, std::memory_order_release);
+    m_current.close();
+    m_current = next;
+    std::error_code ignored;
+    std::filesystem::remove(old_data, ignored);
+    m_compactions.fetch_add(1, std::memory_order_relaxed);
+}
+
+disk_cache::cache_stats disk_cache::get_cache_stats() const {
+    std::shared_lock lock(m_mutex);
+    cache_stats stats{0, 0, m_hits.load(), m_misses.load(), m_expired.load(), m_compactions.load()};
+    if (m_current.address) {
+        stats.entries = m_current.header()->count.load(std::memory_order_relaxed);
+        stats.bytes = m_current.header()->data_size.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+} // hyni
@@ -0,0 +1,176 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Settings of a disk_cache
+ */
+struct disk_cache_options {
+    std::chrono::seconds ttl{0};   ///< Age after which entries are ignored and compacted away; 0 keeps them
+    size_t max_bytes = 256 * 1024 * 1024; ///< Data file size that triggers compaction of the oldest entries
+    bool read_only = false;        ///< Open without taking the writer lock; store() is then ignored
+    bool sync_writes = false;      ///< Flush each record to disk before it becomes visible
+};
+
+/**
+ * @class disk_cache
+ * @brief Persistent response cache shared by processes through the file system
+ *
+ * A cache directory holds an append-only data file of records and a
+ * memory-mapped open-addressing hash index of their offsets:
+ *
+ * - Lookups take no locks across processes. Index slots are published with
+ *   atomic stores once their record is completely written, and every record
+ *   carries its key and a checksum, so a reader never returns torn data.
+ * - One process at a time holds the writer lock. Appends are crash-safe: the
+ *   committed data size is advanced before a record is published, and on
+ *   open the writer truncates anything beyond it.
+ * - Compaction rewrites live entries into a new generation of both files,
+ *   dropping expired entries and the oldest ones beyond max_bytes, and grows
+ *   the index. Readers notice the retired index and switch over.
+ *
+ * Streamed responses are stored with their chunk boundaries so they can be
+ * replayed chunk by chunk.
+ *
+ * @note Thread-safe. Lookups from threads of one process run concurrently.
+ */
+class disk_cache {
+public:
+    /**
+     * @brief A cached response
+     */
+    struct entry {
+        std::string data;                ///< Response body, or the concatenated stream chunks
+        std::vector<size_t> chunk_sizes; ///< Sizes of the stream chunks; empty for a plain body
+        std::chrono::system_clock::time_point created;
+
+        [[nodiscard]] bool is_stream() const noexcept { return !chunk_sizes.empty(); }
+
+        /**
+         * @brief Gets the stream chunks as views into data
+         */
+        [[nodiscard]] std::vector<std::string_view> chunks() const;
+    };
+
+    /**
+     * @brief Cache statistics of this process
+     */
+    struct cache_stats {
+        size_t entries;          ///< Entries in the index, including expired ones
+        size_t bytes;            ///< Size of the data file
+        size_t hit_count;        ///< Lookups answered from disk
+        size_t miss_count;       ///< Lookups that found nothing or an expired entry
+        size_t expired_count;    ///< Lookups that found an expired entry
+        size_t compaction_count; ///< Compactions run by this process
+        double hit_rate() const {
+            auto total = hit_count + miss_count;
+            return total > 0 ? static_cast<double>(hit_count) / total : 0.0;
+        }
+    };
+
+    /**
+     * @brief Opens or creates a cache directory
+     * @param directory Directory of the cache files; created unless read-only
+     * @param options Cache settings
+     * @throws std::runtime_error If the files cannot be opened or another process holds the
+     *         writer lock
+     */
+    explicit disk_cache(std::filesystem::path directory, disk_cache_options options = {});
+    ~disk_cache();
+
+    disk_cache(const disk_cache&) = delete;
+    disk_cache& operator=(const disk_cache&) = delete;
+
+    /**
+     * @brief Looks up a response
+     * @param key Request key, see response_cache::make_key()
+     * @return The entry, or std::nullopt if it is missing or expired
+     */
+    [[nodiscard]] std::optional<entry> find(std::string_view key);
+
+    /**
+     * @brief Stores a response body, replacing any previous entry for the key
+     */
+    void store(std::string_view key, std::string_view body);
+
+    /**
+     * @brief Stores a streamed response chunk by chunk
+     */
+    void store_stream(std::string_view key, const std::vector<std::string>& chunks);
+
+    /**
+     * @brief Rewrites the live entries into new files
+     *
+     * Runs automatically when the index fills up or the data file exceeds
+     * max_bytes. Does nothing when read-only.
+     */
+    void compact();
+
+    /**
+     * @brief Gets cache statistics
+     */
+    [[nodiscard]] cache_stats get_cache_stats() const;
+
+private:
+    struct index_header;
+    struct slot;
+
+    struct mapping {
+        int index_fd = -1;
+        int data_fd = -1;
+        void* address = nullptr;
+        size_t length = 0;
+        uint64_t generation = 0;
+
+        [[nodiscard]] index_header* header() const noexcept;
+        [[nodiscard]] slot* slots() const noexcept;
+        void close() noexcept;
+    };
+
+    void open_current();
+    bool try_open_current(mapping& target) const;
+    [[nodiscard]] mapping create_generation(uint64_t generation, size_t capacity);
+    void publish_generation(const mapping& created);
+    void recover();
+    void refresh_if_retired();
+    void append(std::string_view key, const std::vector<uint32_t>& chunk_sizes, std::string_view data);
+    [[nodiscard]] std::optional<entry> read_record(uint64_t offset, uint64_t hash,
+                                                   std::string_view key, bool* key_matched) const;
+    [[nodiscard]] bool expired(std::chrono::system_clock::time_point created) const;
+    void compact_locked(size_t min_capacity);
+
+    std::filesystem::path m_directory;
+    disk_cache_options m_options;
+    int m_lock_fd = -1;
+    mapping m_current;
+    mutable std::shared_mutex m_mutex; ///< Shared for lookups, exclusive for writes and remapping
+
+    mutable std::atomic<size_t> m_hits{0};
+    mutable std::atomic<size_t> m_misses{0};
+    mutable std::atomic<size_t> m_expired{0};
+    std::atomic<size_t> m_compactions{0};
+};
+
+} // hyni
@@ -11,6 +11,7 @@
 
 #include "general_context.h"
 #include "response_utils.h"
+#include "media_file.h"
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
@@ -46,6 +47,39 @@ general_context::general_context(const std::string& schema_path, const context_c
     build_headers();
 }
 
+general_context::general_context(general_context& other, fork_tag)
+    : m_schema(other.m_schema)
+    , m_request_template(other.m_request_template)
+    , m_stream_request_template(other.m_stream_request_template)
+    , m_config(other.m_config)
+    , m_provider_name(other.m_provider_name)
+    , m_endpoint(other.m_endpoint)
+    , m_headers(other.m_headers)
+    , m_model_name(other.m_model_name)
+    , m_system_message(other.m_system_message)
+    , m_messages(other.m_messages.fork())
+    , m_parameters(other.m_parameters)
+    , m_api_key(other.m_api_key)
+    , m_valid_roles(other.m_valid_roles)
+    , m_text_path(other.m_text_path)
+    , m_error_path(other.m_error_path)
+    , m_usage_path(other.m_usage_path)
+    , m_stream_parser(other.m_stream_parser)
+    , m_message_structure(other.m_message_structure)
+    , m_text_content_format(other.m_text_content_format)
+    , m_image_content_format(other.m_image_content_format)
+    , m_image_uses_url(other.m_image_uses_url)
+    , m_max_context_tokens(other.m_max_context_tokens)
+    , m_max_output_tokens(other.m_max_output_tokens)
+    , m_max_media_per_message(other.m_max_media_per_message)
+    , m_token_estimator(other.m_token_estimator)
+    , m_cache_marker(other.m_cache_marker)
+    , m_cache_max_breakpoints(other.m_cache_max_breakpoints)
+    , m_cache_min_prefix_tokens(other.m_cache_min_prefix_tokens)
+    , m_prompt_cache(other.m_prompt_cache)
+    , m_image_processor(other.m_image_processor) {
+}
+
 void general_context::load_schema(const std::string& schema_path) {
     std::ifstream file(schema_path);
     if (!file.is_open()) {
@@ -91,6 +125,7 @@ void general_context::validate_schema() {
 void general_context::cache_schema_elements() {
     // Cache provider info
     m_provider_name = m_schema["provider"]["name"].get<std::string>();
+    m_token_estimator = token_estimator::for_provider(m_provider_name);
     m_endpoint = m_schema["api"]["endpoint"].get<std::string>();
 
     if (m_schema.contains("message_roles")) {
@@ -101,13 +136,20 @@ void general_context::cache_schema_elements() {
 
     // Cache request template
     m_request_template = m_schema["request_template"];
+    if (m_schema.contains("stream_request_template")) {
+        m_stream_request_template = m_schema["stream_request_template"];
+    }
 
     // Cache response paths
     m_text_path = parse_json_path(m_schema["response_format"]["success"]["text_path"]);
+    if (m_schema["response_format"]["success"].contains("usage_path")) {
+        m_usage_path = parse_json_path(m_schema["response_format"]["success"]["usage_path"]);
+    }
     if (m_schema["response_format"].contains("error") &&
         m_schema["response_format"]["error"].contains("error_path")) {
         m_error_path = parse_json_path(m_schema["response_format"]["error"]["error_path"]);
     }
+    m_stream_parser = stream_event_parser(m_schema);
 
     // Cache message formats
     m_message_structure = m_schema["message_format"]["structure"];
@@ -116,6 +158,50 @@ void general_context::cache_schema_elements() {
     }
     if (m_schema["message_format"]["content_types"].contains("image")) {
         m_image_content_format = m_schema["message_format"]["content_types"]["image"];
+        m_image_uses_url = m_image_content_format.dump().find("<IMAGE_URL>") != std::string::npos;
+    }
+
+    // Cache context limits used for history windowing
+    if (m_schema.contains("limits")) {
+        const auto& limits = m_schema["limits"];
+        if (limits.contains("max_context_length") && limits["max_context_length"].is_number_unsigned()) {
+            m_max_context_tokens = limits["max_context_length"].get<size_t>();
+        }
+        if (limits.contains("max_output_tokens") && limits["max_output_tokens"].is_number_unsigned()) {
+            m_max_output_tokens = limits["max_output_tokens"].get<size_t>();
+        }
+    }
+
+    // Cache prompt caching markers; providers that cache automatically have none
+    if (supports_prompt_caching()) {
+        const auto& caching = m_schema["prompt_caching"];
+        if (caching.contains("marker") && caching["marker"].is_object()) {
+            m_cache_marker = caching["marker"];
+            m_cache_max_breakpoints = caching.value("max_breakpoints", size_t{1});
+        }
+        m_cache_min_prefix_tokens = caching.value("min_prefix_tokens", size_t{0});
+    }
+
+    // Providers name the per-message attachment limit differently
+    if (supports_multimodal()) {
+        const auto& multimodal = m_schema["multimodal"];
+        for (const char* key : {"max_images_per_message", "max_media_per_message"}) {
+            if (multimodal.contains(key) && multimodal[key].is_number_unsigned()) {
+                m_max_media_per_message = multimodal[key].get<size_t>();
+            }
+        }
+    }
+
+    // Image preprocessing is limited by the provider's accepted formats and size
+    if (m_config.image_preprocessing.enabled && supports_multimodal()) {
+        const auto& multimodal = m_schema["multimodal"];
+        std::vector<std::string> formats;
+        if (multimodal.contains("image_formats") && multimodal["image_formats"].is_array()) {
+            formats = multimodal["image_formats"].get<std::vector<std::string>>();
+        }
+        m_image_processor.emplace(m_config.image_preprocessing,
+                                  multimodal.value("max_image_size", size_t{0}),
+                                  std::move(formats));
     }
 }
 
@@ -182,12 +268,12 @@ general_context& general_context::set_model(const std::string& model) {
     return *this;
 }
 
-general_context& general_context::set_system_message(const std::string& system_text) {
+general_context& general_context::set_system_message(std::string system_text) {
     if (!supports_system_messages() && m_config.enable_validation) {
         throw validation_exception("Provider '" + m_provider_name +
                                    "' does not support system messages");
     }
-    m_system_message = system_text;
+    m_system_message = std::move(system_text);
     return *this;
 }
 
@@ -218,30 +304,56 @@ general_context& general_context::set_api_key(const std::string& api_key) {
     return *this;
 }
 
-general_context &general_context::add_user_message(const std::string& content,
-                                      const std::optional<std::string>& media_type,
-                                      const std::optional<std::string>& media_data) {
-    return add_message("user", content, media_type, media_data);
+general_context &general_context::add_user_message(std::string content,
+                                                   std::optional<std::string> media_type,
+                                                   std::optional<std::string> media_data) {
+    return add_message("user", std::move(content), std::move(media_type), std::move(media_data));
+}
+
+general_context &general_context::add_user_message(std::string content,
+                                                   const std::vector<media_attachment>& media) {
+    return add_message("user", std::move(content), media);
 }
 
-general_context &general_context::add_assistant_message(const std::string& content) {
-    return add_message("assistant", content);
+general_context &general_context::add_assistant_message(std::string content) {
+    return add_message("assistant", std::move(content));
 }
 
-general_context &general_context::add_message(const std::string& role, const std::string& content,
-                                 const std::optional<std::string>& media_type,
-                                 const std::optional<std::string>& media_data) {
-    auto message = create_message(role, content, media_type, media_data);
+general_context &general_context::add_message(const std::string& role, std::string content,
+                                              std::optional<std::string> media_type,
+                                              std::optional<std::string> media_data) {
+    std::vector<media_ref> media;
+    if (media_type && media_data) {
+        media.push_back({&*media_type, &*media_data});
+    }
+    return add_message(role, std::move(content), media);
+}
+
+general_context &general_context::add_message(const std::string& role, std::string content,
+                                              const std::vector<media_attachment>& media) {
+    std::vector<media_ref> refs;
+    refs.reserve(media.size());
+    for (const auto& item : media) {
+        refs.push_back({&item.media_type, &item.data});
+    }
+    return add_message(role, std::move(content), refs);
+}
+
+general_context &general_context::add_message(const std::string& role, std::string content,
+                                              const std::vector<media_ref>& media) {
+    auto message = create_message(role, std::move(content), media);
+    // Stored messages are sent as they are, so they are cleaned once here
+    remove_nulls_recursive(message);
     if (m_config.enable_validation) {
         validate_message(message);
     }
-    m_messages.push_back(message);
+    const size_t tokens = estimate_message_tokens(message);
+    m_messages.push_back(std::move(message), tokens);
     return *this;
 }
 
-nlohmann::json general_context::create_message(const std::string& role, const std::string& content,
-                                              const std::optional<std::string>& media_type,
-                                              const std::optional<std::string>& media_data) {
+nlohmann::json general_context::create_message(const std::string& role, std::string content,
+                                              const std::vector<media_ref>& media) {
     nlohmann::json message;
 
     // Check if there's a specific structure for this role
@@ -261,16 +373,16 @@ nlohmann::json general_context::create_message(const std::string& role, const st
 
         if (message.contains("content") && message["content"].is_string() &&
             message["content"] == "<TEXT>") {
-            message["content"] = content;
+            message["content"] = std::move(content);
         }
 
         // If media is provided and this is not a plain text message, handle it
-        if (media_type && media_data && message.contains("content") &&
+        if (!media.empty() && message.contains("content") &&
             message["content"].is_array()) {
             nlohmann::json content_array = nlohmann::json::array();
-            content_array.push_back(create_text_content(content));
-            content_array.push_back(create_image_content(*media_type, *media_data));
-            message["content"] = content_array;
+            content_array.push_back(create_text_content(std::move(content)));
+            append_media_content(content_array, media);
+            message["content"] = std::move(content_array);
         }
     } else {
         // Use default structure
@@ -287,73 +399,145 @@ nlohmann::json general_context::create_message(const std::string& role, const st
         if (message.contains("content") && message["content"].is_array()) {
             // Content is an array (most providers)
             nlohmann::json content_array = nlohmann::json::array();
-            content_array.push_back(create_text_content(content));
+            content_array.push_back(create_text_content(std::move(content)));
 
-            // Add image if provided
-            if (media_type && media_data) {
+            // Add images if provided
+            if (!media.empty()) {
                 if (!supports_multimodal() && m_config.enable_validation) {
                     throw validation_exception("Provider '" + m_provider_name +
                                                "' does not support multimodal content");
                 }
-                content_array.push_back(create_image_content(*media_type, *media_data));
+                append_media_content(content_array, media);
             }
 
-            message["content"] = content_array;
+            message["content"] = std::move(content_array);
         } else if (message.contains("content")) {
             // Content is a simple field
-            message["content"] = content;
+            message["content"] = std::move(content);
         }
     }
 
     return message;
 }
 
-nlohmann::json general_context::create_text_content(const std::string& text) {
+nlohmann::json general_context::create_text_content(std::string text) {
     nlohmann::json content = m_text_content_format;
-    content["text"] = text;
+    content["text"] = std::move(text);
     return content;
 }
 
+void general_context::append_media_content(nlohmann::json& content_array,
+                                           const std::vector<media_ref>& media) {
+    if (m_config.enable_validation && m_max_media_per_message > 0 &&
+        media.size() > m_max_media_per_message) {
+        throw validation_exception("Provider '" + m_provider_name + "' accepts at most " +
+                                   std::to_string(m_max_media_per_message) +
+                                   " attachments per message, got " +
+                                   std::to_string(media.size()));
+    }
+
+    // Encode image files in parallel: the first on this thread, the rest on the
+    // shared pool. Data that is already base64 is validated here only, and left
+    // without a payload. On a pool worker everything runs inline, since waiting there
+    // for queued work could deadlock the pool.
+    auto& pool = thread_pool::shared();
+    const bool parallel = !pool.in_worker();
+    std::vector<media_cache::payload> encoded(media.size());
+    std::vector<std::pair<size_t, std::future<media_cache::payload>>> pending;
+    std::optional<size_t> inline_index;
+    for (size_t i = 0; i < media.size(); ++i) {
+        if (is_base64_encoded(*media[i].data)) {
+            continue;
+        }
+        if (!inline_index) {
+            inline_index = i;
+        } else if (parallel) {
+            const std::string* path = media[i].data;
+            pending.emplace_back(i, pool.submit([this, path] {
+                return encode_image_to_base64(*path);
+            }));
+        }
+    }
+
+    // Every task must finish before returning; they reference this context
+    std::exception_ptr error;
+    auto collect = [&](size_t index, auto&& encode) {
+        try {
+            encoded[index] = encode();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    };
+    if (inline_index) {
+        collect(*inline_index, [&] { return encode_image_to_base64(*media[*inline_index].data); });
+    }
+    if (parallel) {
+        for (auto& [index, future] : pending) {
+            collect(index, [&future] { return future.get(); });
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    for (size_t i = 0; i < media.size(); ++i) {
+        content_array.push_back(
+            create_image_content(*media[i].media_type, *media[i].data, std::move(encoded[i])));
+    }
+}
+
 nlohmann::json general_context::create_image_content(const std::string& media_type,
-                                                     const std::string& data) {
+                                                     const std::string& data,
+                                                     media_cache::payload encoded) {
     nlohmann::json content = m_image_content_format;
 
     // Get base64 data
-    std::string base64_data;
-    if (is_base64_encoded(data)) {
-        // Already base64 encoded
+    std::string_view base64_data = data;
+    std::string_view effective_type = media_type;
+    if (!encoded) {
+        // Already base64 encoded; extract just the base64 part from a data URI
         if (data.starts_with("data:")) {
-            // Extract just the base64 part from data URI
             size_t comma_pos = data.find(',');
             if (comma_pos != std::string::npos) {
-                base64_data = data.substr(comma_pos + 1);
-            } else {
-                base64_data = data;
+                base64_data.remove_prefix(comma_pos + 1);
             }
-        } else {
-            base64_data = data;
         }
     } else {
-        // Assume it's a file path and encode it
-        base64_data = encode_image_to_base64(data);
+        // A file that append_media_content has encoded
+        base64_data = *encoded;
+
+        // Preprocessing may have changed the format, e.g. PNG photos become JPEG
+        if (m_image_processor) {
+            const auto actual = image_processor::sniff_base64(base64_data);
+            if (actual != image_processor::format::unknown) {
+                effective_type = image_processor::media_type(actual);
+            }
+        }
+    }
+
+    // Only build the data URI if the template uses it; it is a second copy of the image
+    std::string image_url;
+    if (m_image_uses_url) {
+        image_url.reserve(effective_type.size() + base64_data.size() + 13);
+        image_url.append("data:").append(effective_type).append(";base64,").append(base64_data);
     }
 
     // Now apply the format based on the schema template
     apply_template_values(content, {
-        {"<IMAGE_URL>", "data:" + media_type + ";base64," + base64_data},
+        {"<IMAGE_URL>", image_url},
         {"<BASE64_DATA>", base64_data},
-        {"<MEDIA_TYPE>", media_type}
+        {"<MEDIA_TYPE>", effective_type}
     });
 
     return content;
 }
 
-nlohmann::json general_context::build_request(bool streaming) {
-    nlohmann::json request = m_request_template;
-    nlohmann::json messages_array = nlohmann::json::array();
-    for (const auto& msg : m_messages) {
-        messages_array.push_back(msg);
-    }
+general_context::request_parts general_context::build_request_parts(bool streaming) {
+    request_parts parts;
+    parts.request = m_request_template;
+    parts.request.erase("messages");
+    parts.window_start = get_history_window_start();
+    auto& request = parts.request;
 
     // Set model
     if (!m_model_name.empty()) {
@@ -366,16 +550,15 @@ nlohmann::json general_context::build_request(bool streaming) {
 
         if (system_in_roles) {
             // Insert system message at beginning
-            messages_array.insert(messages_array.begin(),
-                                  create_message("system", *m_system_message));
+            parts.leading.push_back(create_message("system", *m_system_message));
         } else {
             // Claude style - use separate system field
             request["system"] = *m_system_message;
         }
     }
 
-    // Set messages
-    request["messages"] = std::move(messages_array);
+    // Mark stable prefixes for provider-side caching
+    apply_prompt_caching(parts);
 
     // Apply custom parameters FIRST (so they take precedence)
     for (const auto& [key, value] : m_parameters) {
@@ -400,9 +583,248 @@ nlohmann::json general_context::build_request(bool streaming) {
         }
     }
 
+    // Fields only valid on streamed requests, such as OpenAI's stream_options
+    if (request.value("stream", false) && m_stream_request_template.is_object()) {
+        for (const auto& [key, value] : m_stream_request_template.items()) {
+            if (!request.contains(key)) {
+                request[key] = value;
+            }
+        }
+    }
+
+    // History messages were cleaned when they were added
     remove_nulls_recursive(request);
+    remove_nulls_recursive(parts.leading);
+    for (auto& [index, message] : parts.overrides) {
+        remove_nulls_recursive(message);
+    }
+
+    return parts;
+}
+
+const nlohmann::json& general_context::window_message(const request_parts& parts,
+                                                      size_t index) const {
+    auto it = parts.overrides.find(index);
+    return it != parts.overrides.end() ? it->second : m_messages[index];
+}
+
+nlohmann::json general_context::build_request(bool streaming) {
+    auto parts = build_request_parts(streaming);
+
+    // A "messages" parameter replaces the conversation entirely
+    if (!parts.request.contains("messages")) {
+        nlohmann::json messages_array = std::move(parts.leading);
+        for (size_t i = parts.window_start; i < m_messages.size(); ++i) {
+            auto it = parts.overrides.find(i);
+            if (it != parts.overrides.end()) {
+                messages_array.push_back(std::move(it->second));
+            } else {
+                messages_array.push_back(m_messages[i]);
+            }
+        }
+        parts.request["messages"] = std::move(messages_array);
+    }
+
+    return std::move(parts.request);
+}
+
+std::string general_context::build_request_body(bool streaming) {
+    auto parts = build_request_parts(streaming);
+    if (parts.request.contains("messages")) {
+        return parts.request.dump();
+    }
+
+    std::string body;
+    body.reserve(m_request_size_hint);
+
+    auto write_messages = [&] {
+        body.append("\"messages\":[");
+        bool first = true;
+        auto write = [&](const nlohmann::json& message) {
+            if (!first) body.push_back(',');
+            first = false;
+            body.append(message.dump());
+        };
+        for (const auto& message : parts.leading) {
+            write(message);
+        }
+        for (size_t i = parts.window_start; i < m_messages.size(); ++i) {
+            write(window_message(parts, i));
+        }
+        body.push_back(']');
+    };
+
+    // Objects serialize in key order; "messages" is written in its place
+    static const std::string MESSAGES_KEY = "messages";
+    bool messages_written = false;
+    bool first = true;
+    body.push_back('{');
+    for (auto it = parts.request.begin(); it != parts.request.end(); ++it) {
+        if (!messages_written && it.key() > MESSAGES_KEY) {
+            if (!first) body.push_back(',');
+            write_messages();
+            messages_written = true;
+            first = false;
+        }
+        if (!first) body.push_back(',');
+        first = false;
+        body.append(nlohmann::json(it.key()).dump());
+        body.push_back(':');
+        body.append(it.value().dump());
+    }
+    if (!messages_written) {
+        if (!first) body.push_back(',');
+        write_messages();
+    }
+    body.push_back('}');
+
+    m_request_size_hint = body.size();
+    return body;
+}
+
+size_t general_context::get_history_window_start() const {
+    const size_t count = m_messages.size();
+    if (!m_config.enable_history_window || count == 0) {
+        return 0;
+    }
 
-    return request;
+    const auto context_limit = m_config.max_context_tokens ? m_config.max_context_tokens
+                                                           : m_max_context_tokens;
+    if (!context_limit) {
+        return 0;
+    }
+
+    size_t fixed_tokens = reserved_output_tokens();
+    if (m_system_message && supports_system_messages()) {
+        fixed_tokens += m_token_estimator.model().per_message +
+                        m_token_estimator.count(*m_system_message);
+    }
+    const size_t budget = *context_limit > fixed_tokens ? *context_limit - fixed_tokens : 0;
+
+    const size_t total = m_messages.total_weight();
+    if (total <= budget) {
+        return 0;
+    }
+
+    // Find the first message from which the remaining history fits the budget.
+    // Cumulative weights are monotonic, so a binary search over them suffices.
+    const size_t latest_start = count > m_config.history_window_min_recent
+                                    ? count - m_config.history_window_min_recent
+                                    : 0;
+    const size_t must_drop = total - budget;
+    size_t low = 0;
+    size_t high = latest_start;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if (m_messages.weight_before(mid) >= must_drop) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    // Providers expect the conversation to open with a user turn
+    size_t start = low;
+    while (start < latest_start && m_messages[start].value("role", "") != "user") {
+        ++start;
+    }
+    return start;
+}
+
+void general_context::apply_prompt_caching(request_parts& parts) {
+    if (!m_config.enable_prompt_caching || m_cache_marker.is_null()) {
+        return;
+    }
+
+    auto& request = parts.request;
+    const size_t window_start = parts.window_start;
+    const size_t system_hash = m_system_message ? std::hash<std::string>{}(*m_system_message) : 0;
+    const size_t end = m_messages.size();
+    size_t breakpoints = 0;
+
+    // Breakpoint 1: a separate system field long enough to be cached on its own
+    size_t system_tokens = 0;
+    if (m_system_message && request.contains("system") && request["system"].is_string()) {
+        system_tokens = m_token_estimator.count(*m_system_message);
+        if (system_tokens >= m_cache_min_prefix_tokens && breakpoints < m_cache_max_breakpoints) {
+            auto block = create_text_content(*m_system_message);
+            block.update(m_cache_marker);
+            request["system"] = nlohmann::json::array({std::move(block)});
+            ++breakpoints;
+        }
+    }
+
+    auto prefix_tokens = [&](size_t index) {
+        return system_tokens + m_messages.weight_before(index + 1) -
+               m_messages.weight_before(window_start);
+    };
+
+    auto mark = [&](size_t index) {
+        if (breakpoints >= m_cache_max_breakpoints ||
+            prefix_tokens(index) < m_cache_min_prefix_tokens) {
+            return false;
+        }
+        const auto& original = window_message(parts, index);
+        auto original_content = original.find("content");
+        if (original_content == original.end() ||
+            !(original_content->is_string() ||
+              (original_content->is_array() && !original_content->empty()))) {
+            return false;
+        }
+
+        // Only marked messages are copied; the rest are sent from the history
+        auto it = parts.overrides.find(index);
+        if (it == parts.overrides.end()) {
+            it = parts.overrides.emplace(index, original).first;
+        }
+        auto& content = it->second["content"];
+        if (content.is_string()) {
+            content = nlohmann::json::array(
+                {create_text_content(std::move(content.get_ref<std::string&>()))});
+        }
+        content.back().update(m_cache_marker);
+        ++breakpoints;
+        return true;
+    };
+
+    // Breakpoint 2: the end of the prefix cached by the previous request, if it is
+    // still sent unchanged. Identity of the boundary message implies the whole
+    // history before it is unchanged.
+    const auto& previous = m_prompt_cache;
+    const bool prefix_unchanged = previous.boundary &&
+                                  previous.system_hash == system_hash &&
+                                  previous.window_start == window_start &&
+                                  previous.index + 1 < end &&
+                                  m_messages.share(previous.index) == previous.boundary;
+    if (prefix_unchanged) {
+        mark(previous.index);
+    }
+
+    // Breakpoint 3: the end of this request, to be read back by the next turn
+    if (end > window_start && mark(end - 1)) {
+        m_prompt_cache = {m_messages.share(end - 1), end - 1, window_start, system_hash};
+    } else if (!prefix_unchanged) {
+        m_prompt_cache = {};
+    }
+}
+
+size_t general_context::estimate_message_tokens(const nlohmann::json& message) const {
+    return m_token_estimator.count_message(message);
+}
+
+size_t general_context::reserved_output_tokens() const {
+    auto it = m_parameters.find("max_tokens");
+    if (it != m_parameters.end() && it->second.is_number_unsigned()) {
+        return it->second.get<size_t>();
+    }
+    if (m_config.default_max_tokens && *m_config.default_max_tokens > 0) {
+        return static_cast<size_t>(*m_config.default_max_tokens);
+    }
+    if (m_request_template.contains("max_tokens") &&
+        m_request_template["max_tokens"].is_number_unsigned()) {
+        return m_request_template["max_tokens"].get<size_t>();
+    }
+    return m_max_output_tokens.value_or(0);
 }
 
 std::string general_context::extract_text_response(const nlohmann::json& response) {
@@ -437,28 +859,45 @@ std::string general_context::extract_error(const nlohmann::json& response) {
     }
 }
 
+std::optional<token_usage> general_context::extract_usage(const nlohmann::json& response) const {
+    if (m_usage_path.empty()) {
+        return std::nullopt;
+    }
+    const nlohmann::json* current = &response;
+    for (const auto& key : m_usage_path) {
+        auto it = current->is_object() ? current->find(key) : current->end();
+        if (it == current->end()) {
+            return std::nullopt;
+        }
+        current = &*it;
+    }
+    return token_usage::from_json(*current);
+}
+
 nlohmann::json general_context::resolve_path(const nlohmann::json& json,
                                            const std::vector<std::string>& path) const {
-    nlohmann::json current = json;
+    // Walk by pointer and copy only the node that is found
+    const nlohmann::json* current = &json;
 
     for (const auto& key : path) {
         if (key.find_first_not_of("0123456789") == std::string::npos) {
             // It's an array index
             int index = std::stoi(key);
-            if (!current.is_array() || index >= static_cast<int>(current.size())) {
+            if (!current->is_array() || index >= static_cast<int>(current->size())) {
                 throw std::runtime_error("Invalid array access: index " + key);
             }
-            current = current[index];
+            current = &(*current)[index];
         } else {
             // It's an object key
-            if (!current.is_object() || !current.contains(key)) {
+            auto it = current->is_object() ? current->find(key) : current->end();
+            if (it == current->end()) {
                 throw std::runtime_error("Invalid object access: key " + key);
             }
-            current = current[key];
+            current = &*it;
         }
     }
 
-    return current;
+    return *current;
 }
 
 std::vector<std::string> general_context::parse_json_path(const nlohmann::json& path_array) const {
@@ -505,6 +944,37 @@ bool general_context::supports_streaming() const noexcept {
     return false;
 }
 
+bool general_context::supports_prompt_caching() const noexcept {
+    auto caching_it = m_schema.find("prompt_caching");
+    if (caching_it != m_schema.end() && caching_it->is_object()) {
+        auto supported_it = caching_it->find("supported");
+        if (supported_it != caching_it->end() && supported_it->is_boolean()) {
+            return supported_it->get<bool>();
+        }
+    }
+    return false;
+}
+
+bool general_context::allows_response_caching() const {
+    if (!m_config.enable_caching) {
+        return false;
+    }
+    if (m_config.force_response_caching) {
+        return true;
+    }
+
+    // Same precedence as build_request_parts()
+    nlohmann::json temperature;
+    if (auto it = m_parameters.find("temperature"); it != m_parameters.end()) {
+        temperature = it->second;
+    } else if (auto it = m_request_template.find("temperature"); it != m_request_template.end()) {
+        temperature = *it;
+    } else if (m_config.default_temperature) {
+        temperature = *m_config.default_temperature;
+    }
+    return temperature.is_number() && temperature.get<double>() <= 0.0;
+}
+
 bool general_context::supports_system_messages() const noexcept {
     auto system_it = m_schema.find("system_message");
     if (system_it != m_schema.end() && system_it->is_object()) {
@@ -715,33 +1185,44 @@ void general_context::validate_parameter(const std::string& key,
     }
 }
 
-std::string general_context::encode_image_to_base64(const std::string& image_path) const {
-    // Check existence and size first
-    std::filesystem::path path(image_path);
-    if (!std::filesystem::exists(path)) {
-        throw std::runtime_error("Image file does not exist: " + image_path);
-    }
-
-    auto file_size = std::filesystem::file_size(path);
+media_cache::payload general_context::encode_image_to_base64(const std::string& image_path) const {
     const size_t MAX_IMAGE_SIZE = 10 * 1024 * 1024; // 10MB limit
 
-    if (file_size > MAX_IMAGE_SIZE) {
-        throw std::runtime_error("Image file too large: " + std::to_string(file_size) + " bytes");
+    // One open() and fstat(); the contents are only mapped if they must be encoded
+    auto file = media_file::open(image_path, MAX_IMAGE_SIZE);
+
+    if (m_image_processor) {
+        // Processed output is cached under the file identity plus the options
+        // that produced it, so a repeat attachment skips decoding entirely
+        auto key = file.key();
+        key.path += '#' + m_image_processor->signature();
+        auto& cache = media_cache::instance();
+        if (m_config.enable_media_cache) {
+            if (auto cached = cache.find(key)) {
+                return cached;
+            }
+        }
+        const auto processed = m_image_processor->process(file.contents());
+        const std::string_view raw = processed ? std::string_view(processed->data)
+                                               : file.contents();
+        if (m_config.enable_media_cache) {
+            return cache.insert(key, raw);
+        }
+        return std::make_shared<const std::string>(base64::encode(raw));
     }
 
-    std::ifstream file(image_path, std::ios::binary);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open image file: " + image_path);
+    if (m_config.enable_media_cache) {
+        // The same file attached again is served from the cache without reading it
+        auto& cache = media_cache::instance();
+        if (auto cached = cache.find(file.key())) {
+            return cached;
+        }
+        return cache.insert(file.key(), file.contents());
     }
-
-    std::vector<char> buffer((std::istreambuf_iterator<char>(file)),
-                             std::istreambuf_iterator<char>());
-
-    return response_utils::base64_encode(reinterpret_cast<const unsigned char*>(buffer.data()),
-                                         buffer.size());
+    return std::make_shared<const std::string>(file.encode_base64());
 }
 
-bool general_context::is_base64_encoded(const std::string& data) const noexcept {
+bool general_context::is_base64_encoded(std::string_view data) const noexcept {
     if (data.empty()) return false;
 
     // Check for data URI scheme (e.g., "data:image/png;base64,...")
@@ -749,32 +1230,22 @@ bool general_context::is_base64_encoded(const std::string& data) const noexcept
         return true;
     }
 
-    // Check for valid Base64 characters (ignoring whitespace)
-    constexpr std::string_view base64_chars =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
-
-    size_t padding = 0;
-    size_t data_len = 0;  // Counts non-whitespace chars
-
-    for (char c : data) {
-        if (std::isspace(c)) continue;  // Skip whitespace
-        if (base64_chars.find(c) == std::string_view::npos) {
-            return false;  // Invalid character
-        }
-        if (c == '=') {
-            if (++padding > 2) return false;  // Max 2 padding chars
-        }
-        data_len++;
-    }
-
-    // Validate length and padding (Base64 length must be divisible by 4)
-    return (data_len % 4 == 0) && (padding != 1);  // 1 padding char is invalid
+    // Raw base64, possibly line-wrapped
+    return base64::is_valid(data);
 }
 
-void general_context::apply_template_values(nlohmann::json& j,
-                                           const std::unordered_map<std::string, std::string>& replacements) {
+void general_context::apply_template_values(
+    nlohmann::json& j,
+    const std::vector<std::pair<std::string_view, std::string_view>>& replacements) {
     if (j.is_string()) {
-        std::string str = j.get<std::string>();
+        // Edit in place; a value that is exactly a placeholder is assigned directly
+        auto& str = j.get_ref<std::string&>();
+        for (const auto& [placeholder, value] : replacements) {
+            if (str == placeholder) {
+                str.assign(value);
+                return;
+            }
+        }
         for (const auto& [placeholder, value] : replacements) {
             size_t pos = 0;
             while ((pos = str.find(placeholder, pos)) != std::string::npos) {
@@ -782,7 +1253,6 @@ void general_context::apply_template_values(nlohmann::json& j,
                 pos += value.length();
             }
         }
-        j = str;
     } else if (j.is_object()) {
         for (auto& [key, value] : j.items()) {
             apply_template_values(value, replacements);
@@ -802,6 +1272,21 @@ void general_context::reset() {
     apply_defaults();
 }
 
+std::unique_ptr<general_context> general_context::fork() {
+    return std::unique_ptr<general_context>(new general_context(*this, fork_tag{}));
+}
+
+context_snapshot general_context::snapshot() {
+    return {m_messages.fork(), m_system_message, m_parameters, m_model_name};
+}
+
+void general_context::restore(const context_snapshot& snap) {
+    m_messages = snap.messages;
+    m_system_message = snap.system_message;
+    m_parameters = snap.parameters;
+    m_model_name = snap.model_name;
+}
+
 void general_context::clear_user_messages() noexcept {
     m_messages.clear();
 }
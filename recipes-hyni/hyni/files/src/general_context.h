@@ -11,8 +11,15 @@
 
 #pragma once
 
+#include "message_history.h"
+#include "token_estimator.h"
+#include "usage_accounting.h"
+#include "media_cache.h"
+#include "image_processor.h"
+#include "stream_events.h"
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 #include <memory>
@@ -46,16 +53,44 @@ public:
     explicit validation_exception(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/**
+ * @brief An image attached to a message
+ */
+struct media_attachment {
+    std::string media_type; ///< MIME type, e.g. "image/png"
+    std::string data;       ///< File path, raw base64 data or a base64 data URI
+};
+
 /**
  * @brief Configuration structure for additional context options
  */
 struct context_config {
     bool enable_streaming_support = false;  ///< Whether to enable streaming support
     bool enable_validation = true;          ///< Whether to enable validation
-    bool enable_caching = true;             ///< Whether to enable caching
+    bool enable_caching = true;             ///< Whether to reuse responses to identical deterministic requests
+    bool force_response_caching = false;    ///< Whether to cache responses even when temperature > 0
     std::optional<int> default_max_tokens;  ///< Default maximum tokens for responses
     std::optional<double> default_temperature; ///< Default temperature for responses
     std::unordered_map<std::string, nlohmann::json> custom_parameters; ///< Custom parameters
+    bool enable_history_window = false;        ///< Whether to drop old turns that exceed the context budget
+    size_t history_window_min_recent = 2;      ///< Most recent messages always sent when windowing
+    std::optional<size_t> max_context_tokens;  ///< Overrides the schema's limits.max_context_length
+    bool enable_prompt_caching = true;         ///< Whether to mark stable prompt prefixes for provider caching
+    bool enable_media_cache = true;            ///< Whether to reuse encoded images from media_cache::instance()
+    image_options image_preprocessing;         ///< Downscaling of attached image files to provider limits
+};
+
+/**
+ * @brief Saved conversation state produced by general_context::snapshot()
+ *
+ * The message history is shared with the context it was taken from, so taking
+ * and restoring snapshots does not copy messages.
+ */
+struct context_snapshot {
+    message_history messages;                                  ///< Shared message history
+    std::optional<std::string> system_message;                 ///< System message at snapshot time
+    std::unordered_map<std::string, nlohmann::json> parameters; ///< Parameters at snapshot time
+    std::string model_name;                                    ///< Model at snapshot time
 };
 
 /**
@@ -115,11 +150,11 @@ public:
 
     /**
      * @brief Sets the system message for the conversation
-     * @param system_text The system message text
+     * @param system_text The system message text; moved in when passed an rvalue
      * @return Reference to this context for method chaining
      * @throws validation_exception If system messages are not supported and validation is enabled
      */
-    general_context& set_system_message(const std::string& system_text);
+    general_context& set_system_message(std::string system_text);
 
     /**
      * @brief Sets a single parameter for the request
@@ -148,15 +183,35 @@ public:
 
     /**
      * @brief Adds a user message to the conversation
+     *
+     * Text and media passed as rvalues are moved into the message, so a large
+     * prompt reaches the history without being copied.
+     *
      * @param content The message content
      * @param media_type Optional media type for multimodal content
      * @param media_data Optional media data for multimodal content
      * @return Reference to this context for method chaining
      * @throws validation_exception If the message is invalid and validation is enabled
      */
-    general_context& add_user_message(const std::string& content,
-                                      const std::optional<std::string>& media_type = {},
-                                      const std::optional<std::string>& media_data = {});
+    general_context& add_user_message(std::string content,
+                                      std::optional<std::string> media_type = {},
+                                      std::optional<std::string> media_data = {});
+
+    /**
+     * @brief Adds a user message with several attachments
+     *
+     * Image files are encoded in parallel on thread_pool::shared(); the content
+     * array keeps the attachments in the given order.
+     *
+     * @param content The message content
+     * @param media Attachments, in the order they appear in the message
+     * @return Reference to this context for method chaining
+     * @throws validation_exception If the message is invalid or has more attachments
+     *         than the schema's multimodal limit, and validation is enabled
+     * @throws std::runtime_error If an image file cannot be read
+     */
+    general_context& add_user_message(std::string content,
+                                      const std::vector<media_attachment>& media);
 
     /**
      * @brief Adds an assistant message to the conversation
@@ -164,7 +219,7 @@ public:
      * @return Reference to this context for method chaining
      * @throws validation_exception If the message is invalid and validation is enabled
      */
-    general_context& add_assistant_message(const std::string& content);
+    general_context& add_assistant_message(std::string content);
 
     /**
      * @brief Adds a message with the specified role to the conversation
@@ -175,9 +230,16 @@ public:
      * @return Reference to this context for method chaining
      * @throws validation_exception If the message is invalid and validation is enabled
      */
-    general_context& add_message(const std::string& role, const std::string& content,
-                    const std::optional<std::string>& media_type = {},
-                    const std::optional<std::string>& media_data = {});
+    general_context& add_message(const std::string& role, std::string content,
+                                 std::optional<std::string> media_type = {},
+                                 std::optional<std::string> media_data = {});
+
+    /**
+     * @brief Adds a message with the specified role and several attachments
+     * @see add_user_message(std::string, const std::vector<media_attachment>&)
+     */
+    general_context& add_message(const std::string& role, std::string content,
+                                 const std::vector<media_attachment>& media);
 
     /**
      * @brief Builds a request object based on the current context
@@ -186,6 +248,46 @@ public:
      */
     [[nodiscard]] nlohmann::json build_request(bool streaming = false);
 
+    /**
+     * @brief Builds and serializes a request in one step
+     *
+     * Produces the same bytes as build_request().dump(), but writes the message
+     * history straight into the result instead of first copying every message
+     * into a request object. This is what chat_api sends.
+     *
+     * @param streaming Whether to enable streaming for this request
+     * @return Serialized JSON request body
+     */
+    [[nodiscard]] std::string build_request_body(bool streaming = false);
+
+    /**
+     * @brief Gets the index of the oldest message that build_request() will send
+     *
+     * With context_config::enable_history_window set, old turns are dropped until the
+     * estimated tokens of the remaining history, the system message and the reserved
+     * output tokens fit into limits.max_context_length. The system message and the
+     * last context_config::history_window_min_recent messages are always kept, and the
+     * window starts on a user turn where possible. Per-message estimates are recorded
+     * when messages are added, so this is O(log n) in the history length.
+     *
+     * @return Index into get_messages(); 0 when nothing is dropped
+     */
+    [[nodiscard]] size_t get_history_window_start() const;
+
+    /**
+     * @brief Gets the estimated token count of the whole message history
+     * @return Sum of the per-message estimates recorded when messages were added
+     */
+    [[nodiscard]] size_t get_estimated_history_tokens() const noexcept
+    { return m_messages.total_weight(); }
+
+    /**
+     * @brief Gets the token estimator selected for this provider
+     * @return The estimator used for history windowing
+     */
+    [[nodiscard]] const token_estimator& get_token_estimator() const noexcept
+    { return m_token_estimator; }
+
     /**
      * @brief Extracts the text response from a JSON response
      * @param response The JSON response from the API
@@ -209,12 +311,43 @@ public:
      */
     [[nodiscard]] std::string extract_error(const nlohmann::json& response);
 
+    /**
+     * @brief Extracts the token usage from a JSON response
+     * @param response The JSON response from the API
+     * @return The counts at the schema's usage_path; nullopt if the schema or response has none
+     */
+    [[nodiscard]] std::optional<token_usage> extract_usage(const nlohmann::json& response) const;
+
     /**
      * @brief Resets the context to its initial state
      * @throws nlohmann::json::type_error If the inital content cannot be parsed
      */
     void reset();
 
+    /**
+     * @brief Creates an independent context that continues from this conversation
+     *
+     * The returned context shares the current message history through structural
+     * sharing and copies only on divergence, so forking is O(1) in the history length.
+     * Schema, configuration, parameters and API key are copied.
+     *
+     * @return A new context with the same state as this one
+     */
+    [[nodiscard]] std::unique_ptr<general_context> fork();
+
+    /**
+     * @brief Captures the conversation state without copying messages
+     * @return Snapshot that can later be passed to restore()
+     */
+    [[nodiscard]] context_snapshot snapshot();
+
+    /**
+     * @brief Restores the conversation state captured by snapshot()
+     * @param snap The snapshot to restore, possibly taken from another context
+     *             created from the same schema
+     */
+    void restore(const context_snapshot& snap);
+
     /**
      * @brief Clears all user messages in the context
      */
@@ -236,6 +369,11 @@ public:
      */
     [[nodiscard]] bool has_api_key() const noexcept { return !m_api_key.empty(); }
 
+    /**
+     * @brief Gets the API key requests are sent with
+     */
+    [[nodiscard]] const std::string& get_api_key() const noexcept { return m_api_key; }
+
     /**
      * @brief Gets the schema used by this context
      * @return The schema as JSON
@@ -248,12 +386,36 @@ public:
      */
     [[nodiscard]] const std::string& get_provider_name() const noexcept { return m_provider_name; }
 
+    /**
+     * @brief Gets the model requests are sent to
+     * @return The model name; empty if the schema has no default and none was set
+     */
+    [[nodiscard]] const std::string& get_model() const noexcept { return m_model_name; }
+
     /**
      * @brief Gets the API endpoint
      * @return The API endpoint URL
      */
     [[nodiscard]] const std::string& get_endpoint() const noexcept { return m_endpoint; }
 
+    /**
+     * @brief Gets the schema's path to the response text
+     * @return Object keys and array indices, outermost first
+     */
+    [[nodiscard]] const std::vector<std::string>& get_text_path() const noexcept { return m_text_path; }
+
+    /**
+     * @brief Gets the schema's path to the error message
+     * @return Object keys and array indices, outermost first; empty if the schema has none
+     */
+    [[nodiscard]] const std::vector<std::string>& get_error_path() const noexcept { return m_error_path; }
+
+    /**
+     * @brief Gets the parser for this provider's streaming events
+     * @return Parser compiled from the schema's response_format.stream section
+     */
+    [[nodiscard]] const stream_event_parser& get_stream_parser() const noexcept { return m_stream_parser; }
+
     /**
      * @brief Gets the HTTP headers for API requests
      * @return Map of header names to values
@@ -279,6 +441,21 @@ public:
      */
     [[nodiscard]] bool supports_streaming() const noexcept;
 
+    /**
+     * @brief Checks if the provider caches repeated prompt prefixes
+     * @return True if the schema declares prompt_caching support, false otherwise
+     */
+    [[nodiscard]] bool supports_prompt_caching() const noexcept;
+
+    /**
+     * @brief Checks if responses to the current request may be served from a response_cache
+     *
+     * Requires enable_caching and a deterministic request, one whose effective
+     * temperature is 0. Without an explicit temperature the provider's default
+     * applies, which is not 0. force_response_caching skips the temperature check.
+     */
+    [[nodiscard]] bool allows_response_caching() const;
+
     /**
      * @brief Checks if the provider supports system messages
      * @return True if system messages are supported, false otherwise
@@ -355,39 +532,70 @@ public:
 
     /**
      * @brief Gets all messages in the context
-     * @return Vector of message objects
+     * @return The message history, in conversation order
      */
-    [[nodiscard]] const std::vector<nlohmann::json>& get_messages() const noexcept
+    [[nodiscard]] const message_history& get_messages() const noexcept
     { return m_messages; }
 
 private:
+    struct fork_tag {};
+    general_context(general_context& other, fork_tag);
+
     void load_schema(const std::string& schema_path);
     void validate_schema();
     void apply_defaults();
     void cache_schema_elements();
     void build_headers();
 
-    nlohmann::json create_message(const std::string& role, const std::string& content,
-                                  const std::optional<std::string>& media_type = {},
-                                  const std::optional<std::string>& media_data = {});
-    nlohmann::json create_text_content(const std::string& text);
-    nlohmann::json create_image_content(const std::string& media_type, const std::string& data);
+    // Non-owning view of an attachment, so callers' strings are not copied
+    struct media_ref {
+        const std::string* media_type;
+        const std::string* data;
+    };
+
+    // A request without its history window, which is spliced in when
+    // assembling or serializing so that history messages are not copied
+    struct request_parts {
+        nlohmann::json request;                               ///< All fields but "messages"
+        nlohmann::json leading = nlohmann::json::array();     ///< Messages before the window
+        std::unordered_map<size_t, nlohmann::json> overrides; ///< History messages changed for this request
+        size_t window_start = 0;
+    };
+
+    general_context& add_message(const std::string& role, std::string content,
+                                 const std::vector<media_ref>& media);
+    nlohmann::json create_message(const std::string& role, std::string content,
+                                  const std::vector<media_ref>& media = {});
+    nlohmann::json create_text_content(std::string text);
+    [[nodiscard]] request_parts build_request_parts(bool streaming);
+    [[nodiscard]] const nlohmann::json& window_message(const request_parts& parts,
+                                                       size_t index) const;
+    void append_media_content(nlohmann::json& content_array, const std::vector<media_ref>& media);
+    // encoded is the file's payload, or null when data is already base64
+    nlohmann::json create_image_content(const std::string& media_type, const std::string& data,
+                                        media_cache::payload encoded);
 
     [[nodiscard]] nlohmann::json resolve_path(const nlohmann::json& json,
                                               const std::vector<std::string>& path) const;
     [[nodiscard]] std::vector<std::string> parse_json_path(const nlohmann::json& path_array) const;
 
+    void apply_prompt_caching(request_parts& parts);
+    [[nodiscard]] size_t estimate_message_tokens(const nlohmann::json& message) const;
+    [[nodiscard]] size_t reserved_output_tokens() const;
+
     void validate_message(const nlohmann::json& message) const;
     void validate_parameter(const std::string& key, const nlohmann::json& value) const;
 
-    [[nodiscard]] std::string encode_image_to_base64(const std::string& image_path) const;
-    [[nodiscard]] bool is_base64_encoded(const std::string& data) const noexcept;
-    void apply_template_values(nlohmann::json& j,
-                               const std::unordered_map<std::string, std::string>& replacements);
+    [[nodiscard]] media_cache::payload encode_image_to_base64(const std::string& image_path) const;
+    [[nodiscard]] bool is_base64_encoded(std::string_view data) const noexcept;
+    void apply_template_values(
+        nlohmann::json& j,
+        const std::vector<std::pair<std::string_view, std::string_view>>& replacements);
 
 private:
     nlohmann::json m_schema;
     nlohmann::json m_request_template;
+    nlohmann::json m_stream_request_template;  ///< Added to the request when streaming
     context_config m_config;
 
     std::string m_provider_name;
@@ -395,16 +603,38 @@ private:
     std::unordered_map<std::string, std::string> m_headers;
     std::string m_model_name;
     std::optional<std::string> m_system_message;
-    std::vector<nlohmann::json> m_messages;
+    message_history m_messages;
     std::unordered_map<std::string, nlohmann::json> m_parameters;
     std::string m_api_key;
     std::unordered_set<std::string> m_valid_roles;
 
     std::vector<std::string> m_text_path;
     std::vector<std::string> m_error_path;
+    std::vector<std::string> m_usage_path;
+    stream_event_parser m_stream_parser;
     nlohmann::json m_message_structure;
     nlohmann::json m_text_content_format;
     nlohmann::json m_image_content_format;
+    bool m_image_uses_url = false;      ///< Whether the image template has an <IMAGE_URL>
+    size_t m_request_size_hint = 0;     ///< Size of the last serialized request
+    std::optional<size_t> m_max_context_tokens;
+    std::optional<size_t> m_max_output_tokens;
+    size_t m_max_media_per_message = 0; ///< Attachments allowed per message; 0 is unlimited
+    token_estimator m_token_estimator;
+
+    // Prompt caching: marker inserted at breakpoints and the prefix sent last time
+    struct prompt_cache_state {
+        std::shared_ptr<const nlohmann::json> boundary; ///< Last message marked for caching
+        size_t index = 0;                               ///< Position of the boundary message
+        size_t window_start = 0;                        ///< History window start at that time
+        size_t system_hash = 0;                         ///< Hash of the system message sent
+    };
+    nlohmann::json m_cache_marker;
+    size_t m_cache_max_breakpoints = 0;
+    size_t m_cache_min_prefix_tokens = 0;
+    prompt_cache_state m_prompt_cache;
+
+    std::optional<image_processor> m_image_processor; ///< Set when image preprocessing is enabled
 };
 
 } // hyni
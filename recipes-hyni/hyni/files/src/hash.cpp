@@ -0,0 +1,79 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "hash.h"
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ull;
+
+inline uint64_t rotl(uint64_t x, int r) noexcept { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const char* p) noexcept {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t hash_round(uint64_t acc, uint64_t input) noexcept {
+    return rotl(acc + input * PRIME_2, 31) * PRIME_1;
+}
+
+inline uint64_t avalanche(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= PRIME_2;
+    h ^= h >> 29;
+    h *= PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+uint64_t content_hash(std::string_view data) noexcept {
+    const char* p = data.data();
+    const size_t len = data.size();
+    uint64_t h;
+
+    // Four independent lanes keep the multipliers busy
+    size_t i = 0;
+    if (len >= 32) {
+        uint64_t v1 = PRIME_1 + PRIME_2, v2 = PRIME_2, v3 = 0, v4 = 0 - PRIME_1;
+        for (; i + 32 <= len; i += 32) {
+            v1 = hash_round(v1, read64(p + i));
+            v2 = hash_round(v2, read64(p + i + 8));
+            v3 = hash_round(v3, read64(p + i + 16));
+            v4 = hash_round(v4, read64(p + i + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        for (uint64_t v : {v1, v2, v3, v4}) {
+            h = (h ^ hash_round(0, v)) * PRIME_1 + PRIME_3;
+        }
+    } else {
+        h = PRIME_3;
+    }
+
+    h += len;
+    for (; i + 8 <= len; i += 8) {
+        h = rotl(h ^ hash_round(0, read64(p + i)), 27) * PRIME_1 + PRIME_3;
+    }
+    for (; i < len; ++i) {
+        h = rotl(h ^ (static_cast<uint8_t>(p[i]) * PRIME_3), 11) * PRIME_1;
+    }
+    return avalanche(h);
+}
+
+} // hyni
@@ -0,0 +1,26 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @brief Hashes raw content, several GB/s on 64-bit targets
+ *
+ * Not cryptographic: equal hashes do not prove equal content.
+ */
+[[nodiscard]] uint64_t content_hash(std::string_view data) noexcept;
+
+} // hyni
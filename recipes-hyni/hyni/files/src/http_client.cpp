@@ -1,9 +1,33 @@
 #include "http_client.h"
 #include "logger.h"
+#include "thread_pool.h"
+#include "traffic_recording.h"
 #include <sstream>
 
 namespace hyni {
 
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+std::chrono::microseconds elapsed_since(clock_type::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start);
+}
+
+recorded_exchange make_exchange(const std::string& url, const request_body& body,
+                                const http_response& response) {
+    recorded_exchange exchange;
+    exchange.url = url;
+    exchange.request_body = body ? *body : std::string();
+    exchange.status_code = response.status_code;
+    exchange.headers = response.headers;
+    exchange.body = response.body;
+    exchange.error_message = response.error_message;
+    return exchange;
+}
+
+} // anonymous namespace
+
 http_client::http_client() {
     LOG_INFO("http_client::http_client()");
     m_curl.reset(curl_easy_init());
@@ -67,24 +91,21 @@ http_client& http_client::set_proxy(const std::string& proxy) {
     return *this;
 }
 
+http_client& http_client::set_traffic_recorder(std::shared_ptr<traffic_recorder> recorder) {
+    m_recorder = std::move(recorder);
+    return *this;
+}
+
+http_client& http_client::set_traffic_replay(std::shared_ptr<traffic_replay> replay) {
+    m_replay = std::move(replay);
+    return *this;
+}
+
 http_response http_client::post(const std::string& url, const nlohmann::json& payload,
                                 progress_callback cancel_check) {
     http_response response;
     response.success = false;
 
-    // Validate inputs
-    if (url.empty()) {
-        response.error_message = "URL cannot be empty";
-        LOG_ERROR(response.error_message);
-        return response;
-    }
-
-    if (!m_curl) {
-        response.error_message = "cURL handle is null";
-        LOG_ERROR(response.error_message);
-        return response;
-    }
-
     // Serialize JSON payload
     std::string payload_str;
     try {
@@ -107,6 +128,53 @@ http_response http_client::post(const std::string& url, const nlohmann::json& pa
         return response;
     }
 
+    return post(url, std::make_shared<const std::string>(std::move(payload_str)), cancel_check);
+}
+
+http_response http_client::post(const std::string& url, request_body body,
+                                progress_callback cancel_check) {
+    if (m_replay) {
+        return m_replay->respond(url, body ? *body : std::string(), cancel_check);
+    }
+    if (!m_recorder) {
+        return perform_post(url, body, cancel_check);
+    }
+
+    const auto start = clock_type::now();
+    http_response response = perform_post(url, body, cancel_check);
+    recorded_exchange exchange = make_exchange(url, body, response);
+    exchange.duration = elapsed_since(start);
+    m_recorder->record(exchange);
+    return response;
+}
+
+http_response http_client::perform_post(const std::string& url, const request_body& body,
+                                        const progress_callback& cancel_check) {
+    http_response response;
+    response.success = false;
+
+    // Validate inputs
+    if (url.empty()) {
+        response.error_message = "URL cannot be empty";
+        LOG_ERROR(response.error_message);
+        return response;
+    }
+
+    if (!m_curl) {
+        response.error_message = "cURL handle is null";
+        LOG_ERROR(response.error_message);
+        return response;
+    }
+
+    if (!body) {
+        response.error_message = "Request body is null";
+        LOG_ERROR(response.error_message);
+        return response;
+    }
+
+    // curl reads the body in place; body keeps it alive until we return
+    const std::string& payload_str = *body;
+
     // Set basic cURL options first
     CURLcode opt_result;
 
@@ -170,7 +238,7 @@ http_response http_client::post(const std::string& url, const nlohmann::json& pa
         return response;
     }
 
-    opt_result = curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response.headers);
+    opt_result = curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response);
     if (opt_result != CURLE_OK) {
         response.error_message = std::string("Failed to set header data: ") + curl_easy_strerror(opt_result);
         LOG_ERROR(response.error_message);
@@ -247,8 +315,9 @@ http_response http_client::get(const std::string& url, progress_callback cancel_
     curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &response.body);
     curl_easy_setopt(m_curl.get(), CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response.headers);
-    curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &cancel_check);
+    curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response);
+    m_current_progress_callback = cancel_check;
+    curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, this);
     curl_easy_setopt(m_curl.get(), CURLOPT_NOPROGRESS, 0L);
 
     CURLcode res = curl_easy_perform(m_curl.get());
@@ -268,29 +337,69 @@ void http_client::post_stream(const std::string& url, const nlohmann::json& payl
                               stream_callback on_chunk,
                               completion_callback on_complete,
                               progress_callback cancel_check) {
+    // Serialize on the calling thread rather than copying the payload into the task
+    post_stream(url, std::make_shared<const std::string>(payload.dump()),
+                [on_chunk = std::move(on_chunk)](std::string_view chunk) {
+                    on_chunk(std::string(chunk));
+                },
+                std::move(on_complete), std::move(cancel_check));
+}
+
+void http_client::post_stream(const std::string& url, request_body body,
+                              stream_view_callback on_chunk,
+                              completion_callback on_complete,
+                              progress_callback cancel_check) {
     // This would typically run in a separate thread
     auto task = [=, this]() {
         http_response response;
 
-        std::string payload_str = payload.dump();
+        if (!body) {
+            response.error_message = "Request body is null";
+            if (on_complete) {
+                on_complete(response);
+            }
+            return;
+        }
+
+        if (m_replay) {
+            response = m_replay->stream(url, *body, on_chunk, cancel_check);
+            if (on_complete) {
+                on_complete(response);
+            }
+            return;
+        }
+
+        // Chunks are timed from the start of the request, to replay them as they arrived
+        const auto start = clock_type::now();
+        std::vector<recorded_chunk> recorded;
+        stream_view_callback deliver = on_chunk;
+        if (m_recorder) {
+            deliver = [&recorded, &start, &on_chunk](std::string_view chunk) {
+                recorded.push_back({elapsed_since(start), std::string(chunk)});
+                on_chunk(chunk);
+            };
+        }
+
         curl_easy_setopt(m_curl.get(), CURLOPT_URL, url.c_str());
         curl_easy_setopt(m_curl.get(), CURLOPT_POST, 1L);
-        curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDS, payload_str.c_str());
-        curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDSIZE, payload_str.size());
+        curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDS, body->c_str());
+        curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDSIZE, body->size());
 
         // Custom write function for streaming
         auto stream_writer = [](void* contents, size_t size, size_t nmemb, void* userp) -> size_t {
-            auto callback = static_cast<stream_callback*>(userp);
-            std::string chunk(static_cast<char*>(contents), size * nmemb);
-            (*callback)(chunk);
+            auto callback = static_cast<stream_view_callback*>(userp);
+            (*callback)(std::string_view(static_cast<char*>(contents), size * nmemb));
             return size * nmemb;
         };
 
-        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, stream_writer);
-        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &on_chunk);
+        // curl_easy_setopt() is variadic: pass a function pointer, not the closure object
+        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, +stream_writer);
+        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &deliver);
         curl_easy_setopt(m_curl.get(), CURLOPT_HEADERFUNCTION, header_callback);
-        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response.headers);
-        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &cancel_check);
+        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response);
+        // progress_callback_wrapper expects the client, not the callback
+        m_current_progress_callback = cancel_check;
+        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, this);
         curl_easy_setopt(m_curl.get(), CURLOPT_NOPROGRESS, 0L);
 
         CURLcode res = curl_easy_perform(m_curl.get());
@@ -303,6 +412,14 @@ void http_client::post_stream(const std::string& url, const nlohmann::json& payl
             response.success = (response.status_code >= 200 && response.status_code < 300);
         }
 
+        if (m_recorder) {
+            recorded_exchange exchange = make_exchange(url, body, response);
+            exchange.streamed = true;
+            exchange.chunks = std::move(recorded);
+            exchange.duration = elapsed_since(start);
+            m_recorder->record(exchange);
+        }
+
         if (on_complete) {
             on_complete(response);
         }
@@ -312,19 +429,13 @@ void http_client::post_stream(const std::string& url, const nlohmann::json& payl
 }
 
 std::future<http_response> http_client::post_async(const std::string& url, const nlohmann::json& payload) {
-    auto promise = std::make_shared<std::promise<http_response>>();
-
-    auto task = [=, this]() {
-        try {
-            auto response = post(url, payload);
-            promise->set_value(response);
-        } catch (...) {
-            promise->set_exception(std::current_exception());
-        }
-    };
+    return post_async(url, std::make_shared<const std::string>(payload.dump()));
+}
 
-    std::thread(task).detach();
-    return promise->get_future();
+std::future<http_response> http_client::post_async(const std::string& url, request_body body) {
+    return thread_pool::shared_io().submit([this, url, body = std::move(body)]() {
+        return post(url, body);
+    });
 }
 
 size_t http_client::write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -334,7 +445,10 @@ size_t http_client::write_callback(void* contents, size_t size, size_t nmemb, vo
 }
 
 size_t http_client::header_callback(void* contents, size_t size, size_t nmemb, void* userp) {
-    auto* headers = static_cast<std::unordered_map<std::string, std::string>*>(userp);
+    auto* response = static_cast<http_response*>(userp);
+    if (response->headers_received == std::chrono::steady_clock::time_point{}) {
+        response->headers_received = std::chrono::steady_clock::now();
+    }
     std::string header_line(static_cast<char*>(contents), size * nmemb);
 
     size_t separator = header_line.find(':');
@@ -345,8 +459,8 @@ size_t http_client::header_callback(void* contents, size_t size, size_t nmemb, v
         key.erase(0, key.find_first_not_of(" \t"));
         key.erase(key.find_last_not_of(" \t") + 1);
         value.erase(0, value.find_first_not_of(" \t"));
-        value.erase(value.find_last_not_of(" \t") + 1);
-        (*headers)[key] = value;
+        value.erase(value.find_last_not_of(" \t\r\n") + 1);
+        response->headers[key] = value;
     }
 
     return size * nmemb;
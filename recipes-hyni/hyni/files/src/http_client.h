@@ -2,12 +2,18 @@
 
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <future>
+#include <string_view>
 
 namespace hyni {
 
+class traffic_recorder;
+class traffic_replay;
+struct stream_timing;
+
 // Response structure
 struct http_response {
     long status_code = 0;
@@ -15,13 +21,31 @@ struct http_response {
     std::unordered_map<std::string, std::string> headers;
     bool success = false;
     std::string error_message;
+    std::chrono::steady_clock::time_point headers_received{}; ///< First response header; the epoch if none arrived
+    std::shared_ptr<const stream_timing> timing;              ///< Set by chat_api for streams
+    bool from_cache = false;                                  ///< Answered by a response or disk cache
 };
 
+// Describes why a response failed: the error message, or else the HTTP status
+inline std::string failure_message(const http_response& response) {
+    if (!response.error_message.empty()) {
+        return response.error_message;
+    }
+    return "HTTP " + std::to_string(response.status_code);
+}
+
 // Callback types for different scenarios
 using progress_callback = std::function<bool()>; // return true to cancel
 using stream_callback = std::function<void(const std::string& chunk)>;
 using completion_callback = std::function<void(const http_response&)>;
 
+// Chunk callback that reads straight from curl's buffer; the view is only
+// valid for the duration of the call
+using stream_view_callback = std::function<void(std::string_view chunk)>;
+
+// Serialized request body, shared with worker threads instead of copied
+using request_body = std::shared_ptr<const std::string>;
+
 // HTTP client with RAII and factory pattern
 class http_client {
 public:
@@ -40,9 +64,16 @@ public:
     http_client& set_user_agent(const std::string& user_agent);
     http_client& set_proxy(const std::string& proxy);
 
+    // Write each POST exchange, with its stream chunk timing, to a trace
+    http_client& set_traffic_recorder(std::shared_ptr<traffic_recorder> recorder);
+    // Answer POST requests from a trace instead of the network
+    http_client& set_traffic_replay(std::shared_ptr<traffic_replay> replay);
+
     // Synchronous requests
     http_response post(const std::string& url, const nlohmann::json& payload,
                        progress_callback cancel_check = nullptr);
+    http_response post(const std::string& url, request_body body,
+                       progress_callback cancel_check = nullptr);
 
     http_response get(const std::string& url, progress_callback cancel_check = nullptr);
 
@@ -51,9 +82,14 @@ public:
                      stream_callback on_chunk,
                      completion_callback on_complete = nullptr,
                      progress_callback cancel_check = nullptr);
+    void post_stream(const std::string& url, request_body body,
+                     stream_view_callback on_chunk,
+                     completion_callback on_complete = nullptr,
+                     progress_callback cancel_check = nullptr);
 
-    // Async requests returning futures
+    // Async requests returning futures, run on thread_pool::shared_io()
     std::future<http_response> post_async(const std::string& url, const nlohmann::json& payload);
+    std::future<http_response> post_async(const std::string& url, request_body body);
 
 private:
     struct curl_global_raii {
@@ -70,8 +106,12 @@ private:
     struct curl_slist* m_headers = nullptr;
     long m_timeout_ms = 60000;
     progress_callback m_current_progress_callback;
+    std::shared_ptr<traffic_recorder> m_recorder;
+    std::shared_ptr<traffic_replay> m_replay;
 
     void setup_common_options();
+    http_response perform_post(const std::string& url, const request_body& body,
+                               const progress_callback& cancel_check);
     static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp);
     static size_t header_callback(void* contents, size_t size, size_t nmemb, void* userp);
     static int progress_callback_wrapper(void* clientp, curl_off_t dltotal, curl_off_t dlnow,
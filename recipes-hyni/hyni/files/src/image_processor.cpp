@@ -0,0 +1,573 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "image_processor.h"
+#include "base64.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef HYNI_HAS_IMAGE_CODECS
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+#include <png.h>
+#endif
+
+namespace {
+
+using format = hyni::image_processor::format;
+
+constexpr uint32_t MIN_DIMENSION = 16;
+constexpr int MIN_JPEG_QUALITY = 50;
+constexpr int QUALITY_STEP = 10;
+constexpr int MAX_SHRINK_STEPS = 8;
+
+uint32_t be16(std::string_view d, size_t at) {
+    return (uint32_t(uint8_t(d[at])) << 8) | uint8_t(d[at + 1]);
+}
+
+uint32_t be32(std::string_view d, size_t at) {
+    return (be16(d, at) << 16) | be16(d, at + 2);
+}
+
+uint32_t le16(std::string_view d, size_t at) {
+    return uint8_t(d[at]) | (uint32_t(uint8_t(d[at + 1])) << 8);
+}
+
+uint32_t le24(std::string_view d, size_t at) {
+    return le16(d, at) | (uint32_t(uint8_t(d[at + 2])) << 16);
+}
+
+format detect(std::string_view d) noexcept {
+    if (d.size() >= 3 && d.substr(0, 3) == "\xFF\xD8\xFF") return format::jpeg;
+    if (d.size() >= 8 && d.substr(0, 8) == "\x89PNG\r\n\x1A\n") return format::png;
+    if (d.size() >= 6 && (d.substr(0, 6) == "GIF87a" || d.substr(0, 6) == "GIF89a")) {
+        return format::gif;
+    }
+    if (d.size() >= 12 && d.substr(0, 4) == "RIFF" && d.substr(8, 4) == "WEBP") return format::webp;
+    return format::unknown;
+}
+
+// Walks the JPEG marker segments up to the first start-of-frame
+bool jpeg_dimensions(std::string_view d, uint32_t& width, uint32_t& height) {
+    size_t pos = 2;
+    while (pos + 4 <= d.size()) {
+        if (uint8_t(d[pos]) != 0xFF) return false;
+        const uint8_t marker = uint8_t(d[pos + 1]);
+        if (marker == 0xFF) { // Fill byte
+            ++pos;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) { // No payload
+            pos += 2;
+            continue;
+        }
+        const size_t length = be16(d, pos + 2);
+        const bool is_sof = marker >= 0xC0 && marker <= 0xCF &&
+                            marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (is_sof) {
+            if (pos + 9 > d.size()) return false;
+            height = be16(d, pos + 5);
+            width = be16(d, pos + 7);
+            return true;
+        }
+        if (marker == 0xDA || length < 2) return false; // Scan data before any frame
+        pos += 2 + length;
+    }
+    return false;
+}
+
+bool webp_dimensions(std::string_view d, uint32_t& width, uint32_t& height) {
+    if (d.size() < 30) return false;
+    const std::string_view chunk = d.substr(12, 4);
+    if (chunk == "VP8X") {
+        width = le24(d, 24) + 1;
+        height = le24(d, 27) + 1;
+        return true;
+    }
+    if (chunk == "VP8 " && d.substr(23, 3) == "\x9D\x01\x2A") {
+        width = le16(d, 26) & 0x3FFF;
+        height = le16(d, 28) & 0x3FFF;
+        return true;
+    }
+    if (chunk == "VP8L" && uint8_t(d[20]) == 0x2F) {
+        const uint32_t bits = le16(d, 21) | (le16(d, 23) << 16);
+        width = (bits & 0x3FFF) + 1;
+        height = ((bits >> 14) & 0x3FFF) + 1;
+        return true;
+    }
+    return false;
+}
+
+#ifdef HYNI_HAS_IMAGE_CODECS
+
+struct bitmap {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Per output pixel: the first contributing source pixel and the fraction of
+// each source pixel covered by the output pixel's footprint
+struct box_span {
+    uint32_t first = 0;
+    std::vector<float> weights;
+};
+
+std::vector<box_span> box_weights(uint32_t src, uint32_t dst) {
+    std::vector<box_span> spans(dst);
+    const double scale = double(src) / dst;
+    for (uint32_t i = 0; i < dst; ++i) {
+        const double start = i * scale;
+        const double end = std::min<double>(src, (i + 1) * scale);
+        auto& span = spans[i];
+        span.first = static_cast<uint32_t>(start);
+        const auto last = std::min<uint32_t>(src - 1, static_cast<uint32_t>(std::ceil(end)) - 1);
+        for (uint32_t j = span.first; j <= last; ++j) {
+            const double cover = std::min<double>(end, j + 1.0) - std::max<double>(start, j);
+            span.weights.push_back(static_cast<float>(cover / (end - start)));
+        }
+    }
+    return spans;
+}
+
+// Area-averaging downscale. Works one output row at a time, so the only
+// temporary is a pair of float rows rather than a full intermediate image.
+bitmap downscale(const bitmap& src, uint32_t width, uint32_t height) {
+    if (width == src.width && height == src.height) {
+        return src;
+    }
+    const uint32_t c = src.channels;
+    const auto columns = box_weights(src.width, width);
+    const auto rows = box_weights(src.height, height);
+
+    bitmap out{width, height, c, std::vector<uint8_t>(size_t(width) * height * c)};
+    std::vector<float> line(size_t(width) * c);
+    std::vector<float> acc(size_t(width) * c);
+
+    for (uint32_t y = 0; y < height; ++y) {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        const auto& row_span = rows[y];
+        for (size_t k = 0; k < row_span.weights.size(); ++k) {
+            const uint8_t* in = src.pixels.data() + size_t(row_span.first + k) * src.width * c;
+            for (uint32_t x = 0; x < width; ++x) {
+                const auto& col_span = columns[x];
+                const uint8_t* px = in + size_t(col_span.first) * c;
+                float sum[4] = {0, 0, 0, 0};
+                for (float w : col_span.weights) {
+                    for (uint32_t ch = 0; ch < c; ++ch) sum[ch] += w * px[ch];
+                    px += c;
+                }
+                for (uint32_t ch = 0; ch < c; ++ch) line[size_t(x) * c + ch] = sum[ch];
+            }
+            const float w = row_span.weights[k];
+            for (size_t i = 0; i < acc.size(); ++i) acc[i] += w * line[i];
+        }
+        uint8_t* dst = out.pixels.data() + size_t(y) * width * c;
+        for (size_t i = 0; i < acc.size(); ++i) {
+            dst[i] = static_cast<uint8_t>(std::clamp(acc[i] + 0.5f, 0.0f, 255.0f));
+        }
+    }
+    return out;
+}
+
+// libjpeg reports fatal errors through error_exit, which must not return;
+// jump back to the caller and turn it into an exception there.
+struct jpeg_error {
+    jpeg_error_mgr base;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void on_jpeg_error(j_common_ptr info) {
+    auto* err = reinterpret_cast<jpeg_error*>(info->err);
+    (*info->err->format_message)(info, err->message);
+    std::longjmp(err->jump, 1);
+}
+
+void on_jpeg_message(j_common_ptr, int) {} // Ignore warnings
+
+// Runs libjpeg calls so that error_exit jumps back here. The callers' locals
+// live outside the frame that calls setjmp and keep their values after a
+// jump; work must not create objects with destructors.
+template <typename Work>
+bool jpeg_guarded(jpeg_error& err, Work&& work) {
+    if (setjmp(err.jump)) {
+        return false;
+    }
+    work();
+    return true;
+}
+
+// Rejects images whose decoded size the header alone would let grow without bound
+void check_pixels(uint64_t width, uint64_t height, uint64_t max_pixels, const char* type) {
+    if (max_pixels > 0 && width * height > max_pixels) {
+        throw std::runtime_error(std::string(type) + " image of " + std::to_string(width) + "x" +
+                                 std::to_string(height) + " pixels exceeds the limit of " +
+                                 std::to_string(max_pixels) + " pixels");
+    }
+}
+
+// Decodes to RGB. Uses libjpeg's DCT scaling to skip most of the work when the
+// image is much larger than needed; the result is never smaller than min_long_edge.
+std::optional<bitmap> decode_jpeg(std::string_view data, uint32_t min_long_edge, uint64_t max_pixels) {
+    jpeg_decompress_struct info;
+    jpeg_error err;
+    info.err = jpeg_std_error(&err.base);
+    err.base.error_exit = on_jpeg_error;
+    err.base.emit_message = on_jpeg_message;
+
+    const auto fail = [&] {
+        jpeg_destroy_decompress(&info);
+        throw std::runtime_error(std::string("Failed to decode JPEG image: ") + err.message);
+    };
+
+    jpeg_create_decompress(&info);
+    if (!jpeg_guarded(err, [&] {
+            jpeg_mem_src(&info, reinterpret_cast<unsigned char*>(const_cast<char*>(data.data())),
+                         static_cast<unsigned long>(data.size()));
+            jpeg_read_header(&info, TRUE);
+        })) {
+        fail();
+    }
+    if (info.jpeg_color_space == JCS_CMYK || info.jpeg_color_space == JCS_YCCK) {
+        jpeg_destroy_decompress(&info);
+        return std::nullopt; // No RGB conversion for print images; send them unchanged
+    }
+    try {
+        check_pixels(info.image_width, info.image_height, max_pixels, "JPEG");
+    } catch (...) {
+        jpeg_destroy_decompress(&info);
+        throw;
+    }
+
+    const uint32_t long_edge = std::max(info.image_width, info.image_height);
+    unsigned int denom = 8;
+    while (denom > 1 && long_edge / denom < min_long_edge) {
+        denom /= 2;
+    }
+    info.scale_num = 1;
+    info.scale_denom = denom;
+    info.out_color_space = JCS_RGB;
+    info.dct_method = JDCT_ISLOW;
+    if (!jpeg_guarded(err, [&] { jpeg_start_decompress(&info); })) {
+        fail();
+    }
+
+    bitmap image;
+    image.width = info.output_width;
+    image.height = info.output_height;
+    image.channels = 3;
+    try {
+        image.pixels.resize(size_t(image.width) * image.height * 3);
+    } catch (...) {
+        jpeg_destroy_decompress(&info);
+        throw;
+    }
+    uint8_t* const pixels = image.pixels.data();
+    const size_t stride = size_t(image.width) * 3;
+    if (!jpeg_guarded(err, [&] {
+            while (info.output_scanline < info.output_height) {
+                JSAMPROW row = pixels + size_t(info.output_scanline) * stride;
+                jpeg_read_scanlines(&info, &row, 1);
+            }
+            jpeg_finish_decompress(&info);
+        })) {
+        fail();
+    }
+    jpeg_destroy_decompress(&info);
+    return image;
+}
+
+std::string encode_jpeg(const bitmap& image, int quality) {
+    jpeg_compress_struct info;
+    jpeg_error err;
+    info.err = jpeg_std_error(&err.base);
+    err.base.error_exit = on_jpeg_error;
+    err.base.emit_message = on_jpeg_message;
+
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    jpeg_create_compress(&info);
+    if (!jpeg_guarded(err, [&] {
+            jpeg_mem_dest(&info, &buffer, &size);
+            info.image_width = image.width;
+            info.image_height = image.height;
+            info.input_components = 3;
+            info.in_color_space = JCS_RGB;
+            jpeg_set_defaults(&info);
+            jpeg_set_quality(&info, quality, TRUE);
+            info.optimize_coding = TRUE;
+            jpeg_start_compress(&info, TRUE);
+            while (info.next_scanline < info.image_height) {
+                auto* row = const_cast<JSAMPLE*>(image.pixels.data() +
+                                                 size_t(info.next_scanline) * image.width * 3);
+                jpeg_write_scanlines(&info, &row, 1);
+            }
+            jpeg_finish_compress(&info);
+        })) {
+        jpeg_destroy_compress(&info);
+        std::free(buffer);
+        throw std::runtime_error(std::string("Failed to encode JPEG image: ") + err.message);
+    }
+
+    std::string encoded(reinterpret_cast<const char*>(buffer), size);
+    jpeg_destroy_compress(&info);
+    std::free(buffer);
+    return encoded;
+}
+
+// Decodes to RGB, or RGBA if any pixel is not fully opaque
+bitmap decode_png(std::string_view data, uint64_t max_pixels) {
+    png_image info{};
+    info.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&info, data.data(), data.size())) {
+        throw std::runtime_error(std::string("Failed to decode PNG image: ") + info.message);
+    }
+    // Frees the decoder on every way out; a no-op once png_image_finish_read has freed it
+    struct png_image_guard {
+        png_image& image;
+        ~png_image_guard() { png_image_free(&image); }
+    } guard{info};
+    check_pixels(info.width, info.height, max_pixels, "PNG");
+
+    const bool has_alpha = (info.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+    info.format = has_alpha ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+    bitmap image{info.width, info.height, has_alpha ? 4u : 3u, {}};
+    image.pixels.resize(PNG_IMAGE_SIZE(info));
+    if (!png_image_finish_read(&info, nullptr, image.pixels.data(), 0, nullptr)) {
+        throw std::runtime_error(std::string("Failed to decode PNG image: ") + info.message);
+    }
+
+    if (has_alpha) {
+        bool opaque = true;
+        for (size_t i = 3; i < image.pixels.size() && opaque; i += 4) {
+            opaque = image.pixels[i] == 0xFF;
+        }
+        if (opaque) {
+            size_t out = 0;
+            for (size_t i = 0; i < image.pixels.size(); i += 4) {
+                image.pixels[out++] = image.pixels[i];
+                image.pixels[out++] = image.pixels[i + 1];
+                image.pixels[out++] = image.pixels[i + 2];
+            }
+            image.pixels.resize(out);
+            image.channels = 3;
+        }
+    }
+    return image;
+}
+
+std::string encode_png(const bitmap& image) {
+    png_image info{};
+    info.version = PNG_IMAGE_VERSION;
+    info.width = image.width;
+    info.height = image.height;
+    info.format = image.channels == 4 ? PNG_FORMAT_RGBA : PNG_FORMAT_RGB;
+
+    png_alloc_size_t size = 0;
+    if (!png_image_write_get_memory_size(info, size, 0, image.pixels.data(), 0, nullptr)) {
+        throw std::runtime_error(std::string("Failed to encode PNG image: ") + info.message);
+    }
+    std::string encoded(size, '\0');
+    if (!png_image_write_to_memory(&info, encoded.data(), &size, 0, image.pixels.data(), 0,
+                                   nullptr)) {
+        throw std::runtime_error(std::string("Failed to encode PNG image: ") + info.message);
+    }
+    encoded.resize(size);
+    return encoded;
+}
+
+#endif // HYNI_HAS_IMAGE_CODECS
+
+} // anonymous namespace
+
+namespace hyni {
+
+image_processor::image_processor(image_options options, size_t max_bytes,
+                                 std::vector<std::string> accepted_formats)
+    : m_options(options)
+    , m_max_bytes(options.max_bytes ? options.max_bytes : max_bytes)
+    , m_accepted_formats(std::move(accepted_formats)) {
+    m_options.max_dimension = std::max(m_options.max_dimension, MIN_DIMENSION);
+    m_options.jpeg_quality = std::clamp(m_options.jpeg_quality, 1, 100);
+}
+
+bool image_processor::codecs_available() noexcept {
+#ifdef HYNI_HAS_IMAGE_CODECS
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::optional<image_processor::image_info> image_processor::probe(std::string_view data) noexcept {
+    image_info info;
+    info.type = detect(data);
+    bool ok = false;
+    switch (info.type) {
+    case format::jpeg:
+        ok = jpeg_dimensions(data, info.width, info.height);
+        break;
+    case format::png:
+        ok = data.size() >= 24 && data.substr(12, 4) == "IHDR";
+        if (ok) {
+            info.width = be32(data, 16);
+            info.height = be32(data, 20);
+        }
+        break;
+    case format::gif:
+        ok = data.size() >= 10;
+        if (ok) {
+            info.width = le16(data, 6);
+            info.height = le16(data, 8);
+        }
+        break;
+    case format::webp:
+        ok = webp_dimensions(data, info.width, info.height);
+        break;
+    case format::unknown:
+        break;
+    }
+    if (!ok || info.width == 0 || info.height == 0) {
+        return std::nullopt;
+    }
+    return info;
+}
+
+image_processor::format image_processor::sniff_base64(std::string_view encoded) noexcept {
+    // 16 characters decode to the 12 bytes the longest signature (WebP) needs
+    const size_t prefix = std::min<size_t>(16, encoded.size() & ~size_t{3});
+    if (prefix == 0) {
+        return format::unknown;
+    }
+    const auto head = base64::decode(encoded.substr(0, prefix));
+    return head ? detect(*head) : format::unknown;
+}
+
+const char* image_processor::media_type(format type) noexcept {
+    switch (type) {
+    case format::jpeg: return "image/jpeg";
+    case format::png:  return "image/png";
+    case format::gif:  return "image/gif";
+    case format::webp: return "image/webp";
+    case format::unknown: break;
+    }
+    return "";
+}
+
+bool image_processor::is_accepted(format type) const noexcept {
+    if (m_accepted_formats.empty()) {
+        return true;
+    }
+    const std::string_view mime = media_type(type);
+    return std::find(m_accepted_formats.begin(), m_accepted_formats.end(), mime) !=
+           m_accepted_formats.end();
+}
+
+bool image_processor::needs_processing(std::string_view data) const noexcept {
+    if (!m_options.enabled) {
+        return false;
+    }
+    const auto info = probe(data);
+    if (!info) {
+        return false;
+    }
+    return std::max(info->width, info->height) > m_options.max_dimension ||
+           (m_max_bytes > 0 && base64::encoded_size(data.size()) > m_max_bytes) ||
+           !is_accepted(info->type);
+}
+
+std::optional<image_processor::result> image_processor::process(std::string_view data) const {
+    if (!codecs_available() || !needs_processing(data)) {
+        return std::nullopt;
+    }
+    const auto info = probe(data);
+    if (info->type != format::jpeg && info->type != format::png) {
+        return std::nullopt; // No decoder; the provider gets the original
+    }
+
+#ifdef HYNI_HAS_IMAGE_CODECS
+    const uint32_t long_edge = std::max(info->width, info->height);
+    const uint32_t target_edge = std::min(long_edge, m_options.max_dimension);
+
+    std::optional<bitmap> decoded;
+    if (info->type == format::jpeg) {
+        decoded = decode_jpeg(data, target_edge, m_options.max_pixels);
+    } else {
+        decoded = decode_png(data, m_options.max_pixels);
+    }
+    if (!decoded) {
+        return std::nullopt;
+    }
+
+    const auto fits = [this](const std::string& encoded) {
+        return m_max_bytes == 0 || base64::encoded_size(encoded.size()) <= m_max_bytes;
+    };
+
+    // Dimensions come from the header; DCT scaling may have shrunk the decode already
+    double scale = double(target_edge) / long_edge;
+    for (int step = 0; step < MAX_SHRINK_STEPS; ++step) {
+        const auto width = std::max<uint32_t>(1, uint32_t(std::lround(info->width * scale)));
+        const auto height = std::max<uint32_t>(1, uint32_t(std::lround(info->height * scale)));
+        if (std::max(width, height) < MIN_DIMENSION) {
+            break;
+        }
+        const bitmap resized = downscale(*decoded, std::min(width, decoded->width),
+                                         std::min(height, decoded->height));
+
+        result out;
+        out.width = resized.width;
+        out.height = resized.height;
+        if (resized.channels == 4 || !is_accepted(format::jpeg)) {
+            out.data = encode_png(resized);
+            out.media_type = media_type(format::png);
+        } else {
+            int quality = m_options.jpeg_quality;
+            out.data = encode_jpeg(resized, quality);
+            while (!fits(out.data) && quality > MIN_JPEG_QUALITY) {
+                quality = std::max(MIN_JPEG_QUALITY, quality - QUALITY_STEP);
+                out.data = encode_jpeg(resized, quality);
+            }
+            out.media_type = media_type(format::jpeg);
+        }
+        if (fits(out.data)) {
+            return out;
+        }
+        scale *= 0.75;
+    }
+    throw std::runtime_error("Image cannot be reduced below " + std::to_string(m_max_bytes) +
+                             " bytes");
+#else
+    return std::nullopt;
+#endif
+}
+
+std::future<std::optional<image_processor::result>> image_processor::process_async(
+    std::string_view data, thread_pool& pool) const {
+    return pool.submit([processor = *this, data] { return processor.process(data); });
+}
+
+std::string image_processor::signature() const {
+    std::string sig = "max_dimension=" + std::to_string(m_options.max_dimension) +
+                      ";quality=" + std::to_string(m_options.jpeg_quality) +
+                      ";max_bytes=" + std::to_string(m_max_bytes) + ";formats=";
+    for (const auto& type : m_accepted_formats) {
+        sig += type;
+        sig += ',';
+    }
+    return sig;
+}
+
+} // hyni
@@ -0,0 +1,139 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Options for shrinking images before they are attached to a message
+ */
+struct image_options {
+    bool enabled = false;          ///< Whether images are downscaled and recompressed at all
+    uint32_t max_dimension = 1568; ///< Longest edge in pixels after downscaling
+    int jpeg_quality = 85;         ///< Initial JPEG quality (1-100)
+    size_t max_bytes = 0;          ///< Encoded size limit; 0 uses the schema's multimodal.max_image_size
+    uint64_t max_pixels = 64 * 1024 * 1024; ///< Images with more pixels are rejected before decoding; 0 is unlimited
+};
+
+/**
+ * @class image_processor
+ * @brief Downscales and recompresses images to fit provider limits
+ *
+ * JPEG and PNG input is decoded, box-filtered down to the configured maximum
+ * dimension and re-encoded as JPEG, or as PNG when the image has transparency.
+ * If the result is still larger than the byte limit, quality and then
+ * dimensions are reduced until it fits.
+ *
+ * Images that already satisfy every limit are left untouched, as are formats
+ * that cannot be decoded (GIF, WebP) and all input when the library was built
+ * without image codecs.
+ *
+ * @note Thread-safe; process() only reads the processor's configuration.
+ */
+class image_processor {
+public:
+    enum class format { unknown, jpeg, png, gif, webp };
+
+    /**
+     * @brief Image header information read without decoding pixels
+     */
+    struct image_info {
+        format type = format::unknown;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    /**
+     * @brief Re-encoded image
+     */
+    struct result {
+        std::string data;       ///< Raw (not base64) encoded image
+        std::string media_type; ///< MIME type of data, e.g. "image/jpeg"
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    /**
+     * @brief Creates a processor
+     * @param options Resize and quality options
+     * @param max_bytes Limit on the base64-encoded size, used when options.max_bytes is 0
+     * @param accepted_formats MIME types the provider accepts ("image/jpeg", ...); empty accepts all
+     */
+    image_processor(image_options options, size_t max_bytes,
+                    std::vector<std::string> accepted_formats = {});
+
+    /**
+     * @brief Checks whether the library was built with the JPEG and PNG codecs
+     */
+    [[nodiscard]] static bool codecs_available() noexcept;
+
+    /**
+     * @brief Reads the format and dimensions from an image header
+     */
+    [[nodiscard]] static std::optional<image_info> probe(std::string_view data) noexcept;
+
+    /**
+     * @brief Detects the format of base64-encoded image data from its first bytes
+     */
+    [[nodiscard]] static format sniff_base64(std::string_view encoded) noexcept;
+
+    /**
+     * @brief Gets the MIME type of a format, or an empty string for format::unknown
+     */
+    [[nodiscard]] static const char* media_type(format type) noexcept;
+
+    /**
+     * @brief Checks whether an image exceeds any configured limit
+     */
+    [[nodiscard]] bool needs_processing(std::string_view data) const noexcept;
+
+    /**
+     * @brief Shrinks an image to fit the configured limits
+     * @return The re-encoded image, or nullopt if the input should be sent unchanged
+     * @throws std::runtime_error If the image is corrupt, has more than
+     *         image_options::max_pixels pixels, or cannot be made to fit
+     */
+    [[nodiscard]] std::optional<result> process(std::string_view data) const;
+
+    /**
+     * @brief Runs process() on a worker pool
+     * @note data must stay valid until the future is ready.
+     */
+    [[nodiscard]] std::future<std::optional<result>> process_async(
+        std::string_view data, thread_pool& pool = thread_pool::shared()) const;
+
+    /**
+     * @brief Gets a string identifying the options, for keying cached output
+     */
+    [[nodiscard]] std::string signature() const;
+
+    [[nodiscard]] const image_options& options() const noexcept { return m_options; }
+    [[nodiscard]] size_t max_bytes() const noexcept { return m_max_bytes; }
+
+private:
+    [[nodiscard]] bool is_accepted(format type) const noexcept;
+
+    image_options m_options;
+    size_t m_max_bytes;
+    std::vector<std::string> m_accepted_formats;
+};
+
+} // hyni
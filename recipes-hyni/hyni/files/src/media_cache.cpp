@@ -0,0 +1,196 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "media_cache.h"
+#include "base64.h"
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#include <sys/stat.h>
+
+namespace {
+
+// Checks a payload against raw bytes without allocating; equal hashes alone may collide
+bool same_content(const std::string& encoded, std::string_view raw) noexcept {
+    if (encoded.size() != hyni::base64::encoded_size(raw.size())) {
+        return false;
+    }
+    constexpr size_t BLOCK = 3 * 1024; // Whole base64 groups, so the blocks' encodings concatenate
+    char buffer[hyni::base64::encoded_size(BLOCK)];
+    const auto* data = reinterpret_cast<const unsigned char*>(raw.data());
+    size_t offset = 0;
+    for (size_t i = 0; i < raw.size(); i += BLOCK) {
+        const size_t written = hyni::base64::encode_to(data + i, std::min(BLOCK, raw.size() - i), buffer);
+        if (std::memcmp(buffer, encoded.data() + offset, written) != 0) {
+            return false;
+        }
+        offset += written;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+media_cache::file_key media_cache::file_key::of(const std::string& path) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        throw std::filesystem::filesystem_error("Cannot stat media file", path,
+                                                std::error_code(errno, std::generic_category()));
+    }
+    file_key key;
+    key.path = std::filesystem::absolute(path).lexically_normal().string();
+    key.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    key.size = static_cast<uint64_t>(st.st_size);
+    key.regular = S_ISREG(st.st_mode);
+    return key;
+}
+
+media_cache& media_cache::instance() {
+    static media_cache cache;
+    return cache;
+}
+
+media_cache::payload media_cache::find(const file_key& key) {
+    if (!key.regular) {
+        return nullptr;
+    }
+    std::lock_guard lock(m_mutex);
+    auto file_it = m_files.find(key.path);
+    if (file_it == m_files.end() || file_it->second.mtime != key.mtime ||
+        file_it->second.size != key.size) {
+        return nullptr;
+    }
+
+    auto it = m_entries.find(file_it->second.content);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    ++m_hits;
+    return it->second.data;
+}
+
+media_cache::payload media_cache::insert(const file_key& key, std::string_view raw) {
+    // Content is still shared, but a non-regular file is never linked to it
+    return insert_content({content_hash(raw), raw.size()}, raw, key.regular ? &key : nullptr);
+}
+
+media_cache::payload media_cache::insert(std::string_view raw) {
+    return insert_content({content_hash(raw), raw.size()}, raw, nullptr);
+}
+
+media_cache::payload media_cache::insert_content(const content_key& key, std::string_view raw,
+                                                 const file_key* file) {
+    {
+        std::lock_guard lock(m_mutex);
+        if (auto data = find_content_locked(key, raw, file)) {
+            ++m_content_hits;
+            return data;
+        }
+        ++m_misses;
+    }
+
+    // Encode without holding the lock; concurrent misses on the same content
+    // both encode, and the first one to finish is kept.
+    auto data = std::make_shared<const std::string>(base64::encode(raw));
+
+    std::lock_guard lock(m_mutex);
+    if (auto existing = find_content_locked(key, raw, file)) {
+        return existing;
+    }
+    if (data->size() > m_max_bytes || m_entries.count(key) != 0) {
+        // Never fits, or other content with the same hash holds the slot: hand it out uncached
+        return data;
+    }
+
+    m_lru.push_front(key);
+    auto& e = m_entries[key];
+    e.data = data;
+    e.lru = m_lru.begin();
+    m_bytes += data->size();
+    if (file) {
+        link_locked(*file, key, e);
+    }
+
+    evict_locked();
+    return data;
+}
+
+media_cache::payload media_cache::find_content_locked(const content_key& key, std::string_view raw,
+                                                      const file_key* file) {
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || !same_content(*it->second.data, raw)) {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    if (file) {
+        link_locked(*file, key, it->second);
+    }
+    return it->second.data;
+}
+
+void media_cache::link_locked(const file_key& file, const content_key& key, entry& e) {
+    auto [file_it, inserted] = m_files.try_emplace(file.path, file_record{file.mtime, file.size, key});
+    if (!inserted) {
+        const content_key previous = file_it->second.content;
+        file_it->second = {file.mtime, file.size, key};
+        if (previous == key) {
+            return;
+        }
+        // The file changed; unlink it from the content it used to have
+        auto prev_it = m_entries.find(previous);
+        if (prev_it != m_entries.end()) {
+            auto& paths = prev_it->second.paths;
+            paths.erase(std::remove(paths.begin(), paths.end(), file.path), paths.end());
+        }
+    }
+    e.paths.push_back(file.path);
+}
+
+void media_cache::evict_locked() {
+    while (m_bytes > m_max_bytes && !m_lru.empty()) {
+        auto it = m_entries.find(m_lru.back());
+        m_bytes -= it->second.data->size();
+        for (const auto& path : it->second.paths) {
+            m_files.erase(path);
+        }
+        m_entries.erase(it);
+        m_lru.pop_back();
+        ++m_evictions;
+    }
+}
+
+void media_cache::set_max_bytes(size_t max_bytes) {
+    std::lock_guard lock(m_mutex);
+    m_max_bytes = max_bytes;
+    evict_locked();
+}
+
+void media_cache::clear() {
+    std::lock_guard lock(m_mutex);
+    m_entries.clear();
+    m_files.clear();
+    m_lru.clear();
+    m_bytes = 0;
+    m_hits = m_content_hits = m_misses = m_evictions = 0;
+}
+
+media_cache::cache_stats media_cache::get_cache_stats() const {
+    std::lock_guard lock(m_mutex);
+    return {m_entries.size(), m_bytes, m_max_bytes, m_hits, m_content_hits, m_misses, m_evictions};
+}
+
+} // hyni
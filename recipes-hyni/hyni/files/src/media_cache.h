@@ -0,0 +1,174 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @class media_cache
+ * @brief Process-wide, size-bounded cache of base64-encoded media
+ *
+ * Payloads are addressed by content (hash and size of the raw bytes, confirmed
+ * by comparing the bytes) and are additionally indexed by file identity (path,
+ * modification time and size), so a file that is attached again is neither
+ * read nor encoded a second time, and identical content reached through
+ * different paths is stored once.
+ *
+ * Payloads are immutable and handed out as shared pointers. Evicting an entry
+ * never invalidates a payload that is still referenced elsewhere.
+ *
+ * @note Thread-safe. Use instance() to share one cache across all contexts.
+ */
+class media_cache {
+public:
+    using payload = std::shared_ptr<const std::string>;
+
+    static constexpr size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * @brief Identity of a file at a point in time
+     */
+    struct file_key {
+        std::string path;        ///< Absolute, normalized path
+        int64_t mtime = 0;       ///< Last write time in nanoseconds since the epoch
+        uint64_t size = 0;       ///< File size in bytes
+        bool regular = true;     ///< Pipes, devices and procfs files can change without touching
+                                 ///< mtime or size, so only regular files are looked up by identity
+
+        /**
+         * @brief Reads the identity of a file
+         * @throws std::filesystem::filesystem_error If the file cannot be inspected
+         */
+        static file_key of(const std::string& path);
+    };
+
+    /**
+     * @brief Cache statistics
+     */
+    struct cache_stats {
+        size_t entries;          ///< Cached payloads
+        size_t bytes;            ///< Encoded bytes held by the cache
+        size_t max_bytes;        ///< Configured budget
+        size_t hit_count;        ///< Lookups answered by file identity
+        size_t content_hit_count; ///< Inserts that found the same content already cached
+        size_t miss_count;       ///< Payloads that had to be encoded
+        size_t eviction_count;   ///< Payloads dropped to stay within budget
+        double hit_rate() const {
+            auto total = hit_count + content_hit_count + miss_count;
+            return total > 0 ? static_cast<double>(hit_count + content_hit_count) / total : 0.0;
+        }
+    };
+
+    explicit media_cache(size_t max_bytes = DEFAULT_MAX_BYTES) : m_max_bytes(max_bytes) {}
+
+    media_cache(const media_cache&) = delete;
+    media_cache& operator=(const media_cache&) = delete;
+
+    /**
+     * @brief Gets the process-wide cache
+     */
+    static media_cache& instance();
+
+    /**
+     * @brief Looks up the payload of a file by identity
+     * @return The cached payload, or nullptr if the file (in this version) is unknown
+     */
+    [[nodiscard]] payload find(const file_key& key);
+
+    /**
+     * @brief Gets the payload for raw file contents, encoding them on a miss
+     *
+     * Links the file identity to the content, so the next find() with the same
+     * key is a hit.
+     *
+     * @param key Identity of the file the bytes were read from
+     * @param raw The file contents
+     */
+    [[nodiscard]] payload insert(const file_key& key, std::string_view raw);
+
+    /**
+     * @brief Gets the payload for raw bytes that did not come from a file
+     */
+    [[nodiscard]] payload insert(std::string_view raw);
+
+    /**
+     * @brief Sets the budget for encoded bytes, evicting least recently used payloads
+     */
+    void set_max_bytes(size_t max_bytes);
+
+    /**
+     * @brief Drops all payloads and resets the statistics
+     */
+    void clear();
+
+    /**
+     * @brief Gets cache statistics
+     */
+    [[nodiscard]] cache_stats get_cache_stats() const;
+
+private:
+    struct content_key {
+        uint64_t hash;
+        uint64_t size;
+        bool operator==(const content_key& other) const noexcept {
+            return hash == other.hash && size == other.size;
+        }
+    };
+
+    struct content_key_hash {
+        size_t operator()(const content_key& key) const noexcept {
+            return static_cast<size_t>(key.hash ^ (key.size * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    struct entry {
+        payload data;
+        std::list<content_key>::iterator lru;
+        std::vector<std::string> paths; ///< File identities linked to this content
+    };
+
+    struct file_record {
+        int64_t mtime;
+        uint64_t size;
+        content_key content;
+    };
+
+    payload insert_content(const content_key& key, std::string_view raw, const file_key* file);
+    // Compares the bytes as well, so a hash collision is a miss
+    payload find_content_locked(const content_key& key, std::string_view raw, const file_key* file);
+    void link_locked(const file_key& file, const content_key& key, entry& e);
+    void evict_locked();
+
+    mutable std::mutex m_mutex;
+    size_t m_max_bytes;
+    size_t m_bytes = 0;
+    std::list<content_key> m_lru; ///< Most recently used first
+    std::unordered_map<content_key, entry, content_key_hash> m_entries;
+    std::unordered_map<std::string, file_record> m_files;
+
+    size_t m_hits = 0;
+    size_t m_content_hits = 0;
+    size_t m_misses = 0;
+    size_t m_evictions = 0;
+};
+
+} // hyni
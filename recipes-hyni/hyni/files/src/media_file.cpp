@@ -0,0 +1,177 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "media_file.h"
+#include "base64.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t READ_CHUNK = 256 * 1024;
+
+std::string error_text() {
+    return std::strerror(errno);
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+media_file media_file::open(const std::string& path, size_t max_size) {
+    media_file file;
+    file.m_max_size = max_size;
+    file.m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file.m_fd < 0) {
+        if (errno == ENOENT) {
+            throw std::runtime_error("Image file does not exist: " + path);
+        }
+        throw std::runtime_error("Failed to open image file: " + path + ": " + error_text());
+    }
+
+    struct stat st {};
+    if (::fstat(file.m_fd, &st) != 0) {
+        throw std::runtime_error("Failed to stat image file: " + path + ": " + error_text());
+    }
+    if (S_ISDIR(st.st_mode)) {
+        throw std::runtime_error("Failed to open image file: " + path + ": is a directory");
+    }
+
+    file.m_regular = S_ISREG(st.st_mode);
+    if (file.m_regular && static_cast<size_t>(st.st_size) > max_size) {
+        throw std::runtime_error("Image file too large: " + std::to_string(st.st_size) + " bytes");
+    }
+
+    file.m_key.path = std::filesystem::absolute(path).lexically_normal().string();
+    file.m_key.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    file.m_key.size = static_cast<uint64_t>(st.st_size);
+    file.m_key.regular = file.m_regular;
+    return file;
+}
+
+media_file::media_file(media_file&& other) noexcept
+    : m_fd(other.m_fd),
+      m_regular(other.m_regular),
+      m_max_size(other.m_max_size),
+      m_key(std::move(other.m_key)),
+      m_mapping(other.m_mapping),
+      m_mapping_size(other.m_mapping_size),
+      m_buffer(std::move(other.m_buffer)),
+      m_loaded(other.m_loaded) {
+    other.m_fd = -1;
+    other.m_mapping = nullptr;
+    other.m_mapping_size = 0;
+}
+
+media_file& media_file::operator=(media_file&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_fd = other.m_fd;
+        m_regular = other.m_regular;
+        m_max_size = other.m_max_size;
+        m_key = std::move(other.m_key);
+        m_mapping = other.m_mapping;
+        m_mapping_size = other.m_mapping_size;
+        m_buffer = std::move(other.m_buffer);
+        m_loaded = other.m_loaded;
+        other.m_fd = -1;
+        other.m_mapping = nullptr;
+        other.m_mapping_size = 0;
+    }
+    return *this;
+}
+
+media_file::~media_file() {
+    close();
+}
+
+void media_file::close() noexcept {
+    if (m_mapping) {
+        ::munmap(m_mapping, m_mapping_size);
+        m_mapping = nullptr;
+        m_mapping_size = 0;
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+std::string_view media_file::contents() {
+    if (m_mapping) {
+        return {static_cast<const char*>(m_mapping), m_mapping_size};
+    }
+    if (m_loaded) {
+        return m_buffer;
+    }
+
+    if (m_regular && m_key.size > 0) {
+        void* mapping = ::mmap(nullptr, m_key.size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::madvise(mapping, m_key.size, MADV_SEQUENTIAL);
+            m_mapping = mapping;
+            m_mapping_size = m_key.size;
+            return {static_cast<const char*>(m_mapping), m_mapping_size};
+        }
+        // Fall back to reading, e.g. on file systems without mmap support
+    }
+
+    // Read in chunks; pread() keeps regular files independent of the descriptor
+    // offset, read() serves pipes and devices that cannot seek.
+    off_t offset = 0;
+    bool seekable = m_regular;
+    for (;;) {
+        const size_t used = m_buffer.size();
+        if (used > m_max_size) {
+            throw std::runtime_error("Image file too large: more than " +
+                                     std::to_string(m_max_size) + " bytes");
+        }
+        m_buffer.resize(used + READ_CHUNK);
+        ssize_t n = seekable ? ::pread(m_fd, m_buffer.data() + used, READ_CHUNK, offset)
+                             : ::read(m_fd, m_buffer.data() + used, READ_CHUNK);
+        if (n < 0 && seekable && errno == ESPIPE) {
+            seekable = false;
+            n = ::read(m_fd, m_buffer.data() + used, READ_CHUNK);
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                m_buffer.resize(used);
+                continue;
+            }
+            throw std::runtime_error("Failed to read image file: " + m_key.path + ": " +
+                                     error_text());
+        }
+        m_buffer.resize(used + static_cast<size_t>(n));
+        offset += n;
+        if (n == 0) {
+            break;
+        }
+    }
+    if (m_buffer.size() > m_max_size) {
+        throw std::runtime_error("Image file too large: " + std::to_string(m_buffer.size()) +
+                                 " bytes");
+    }
+    m_loaded = true;
+    return m_buffer;
+}
+
+std::string media_file::encode_base64() {
+    const std::string_view data = contents();
+    return base64::encode(data);
+}
+
+} // hyni
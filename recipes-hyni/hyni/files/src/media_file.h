@@ -0,0 +1,87 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "media_cache.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @class media_file
+ * @brief Read-only view of a media file's contents without an intermediate copy
+ *
+ * Regular files are memory-mapped, so encoding reads straight from the page
+ * cache and the only allocation is the encoded result. Pipes, character devices
+ * and other files without a reliable size are read in chunks into an owned
+ * buffer instead.
+ *
+ * Opening performs a single open() and fstat(); the identity returned by key()
+ * is taken from the opened descriptor, so it always matches the contents.
+ *
+ * @note Not thread-safe. Move-only.
+ */
+class media_file {
+public:
+    /**
+     * @brief Opens a file for reading
+     * @param path File to open
+     * @param max_size Largest accepted file size in bytes
+     * @throws std::runtime_error If the file does not exist, cannot be read or is too large
+     */
+    static media_file open(const std::string& path, size_t max_size);
+
+    media_file(media_file&& other) noexcept;
+    media_file& operator=(media_file&& other) noexcept;
+    media_file(const media_file&) = delete;
+    media_file& operator=(const media_file&) = delete;
+    ~media_file();
+
+    /**
+     * @brief Gets the file contents, mapping or reading them on first use
+     * @throws std::runtime_error If the contents cannot be read
+     */
+    [[nodiscard]] std::string_view contents();
+
+    /**
+     * @brief Gets the identity of the opened file for media_cache lookups
+     */
+    [[nodiscard]] const media_cache::file_key& key() const noexcept { return m_key; }
+
+    /**
+     * @brief Checks whether the contents are served from a memory mapping
+     */
+    [[nodiscard]] bool is_mapped() const noexcept { return m_mapping != nullptr; }
+
+    /**
+     * @brief Encodes the whole file to base64 in one pass into the result buffer
+     */
+    [[nodiscard]] std::string encode_base64();
+
+private:
+    media_file() = default;
+    void close() noexcept;
+
+    int m_fd = -1;
+    bool m_regular = false;
+    size_t m_max_size = 0;
+    media_cache::file_key m_key;
+
+    void* m_mapping = nullptr;
+    size_t m_mapping_size = 0;
+    std::string m_buffer;
+    bool m_loaded = false;
+};
+
+} // hyni
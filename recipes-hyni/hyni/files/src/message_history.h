@@ -0,0 +1,257 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @class message_history
+ * @brief Append-only conversation history with structural sharing
+ *
+ * Messages are kept in a chain of immutable, reference-counted segments plus a
+ * privately owned tail. fork() freezes the tail into a new segment and hands out
+ * a history that shares every segment with this one, so branching a long
+ * conversation is O(1). Appending after a fork only touches the private tail.
+ *
+ * Frozen segments are merged with their parent whenever they grow at least as
+ * large, which keeps the chain depth logarithmic in the number of messages.
+ * Merging copies message pointers, never the messages themselves.
+ *
+ * Each message may carry a caller-defined weight (e.g. an estimated token count).
+ * Running totals are stored with the messages, so the weight of any prefix or
+ * suffix is available without rescanning the history.
+ *
+ * @note Not thread-safe for mutation. Frozen segments are immutable and may be
+ *       read concurrently by histories owned by different threads.
+ */
+class message_history {
+    struct entry {
+        std::shared_ptr<const nlohmann::json> message;
+        size_t cumulative_weight = 0; ///< Sum of weights up to and including this message
+    };
+
+    struct segment {
+        std::shared_ptr<const segment> parent;
+        std::vector<entry> messages;
+        size_t offset = 0; ///< Number of messages stored in all ancestors
+    };
+
+public:
+    /**
+     * @brief Random access iterator over the messages in order
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = nlohmann::json;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const nlohmann::json*;
+        using reference = const nlohmann::json&;
+
+        const_iterator() = default;
+        const_iterator(const message_history* history, size_t index)
+            : m_history(history), m_index(index) {}
+
+        reference operator*() const { return (*m_history)[m_index]; }
+        pointer operator->() const { return &(*m_history)[m_index]; }
+        reference operator[](difference_type n) const { return (*m_history)[m_index + n]; }
+
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { auto tmp = *this; ++m_index; return tmp; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--(int) { auto tmp = *this; --m_index; return tmp; }
+        const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const const_iterator& a, const const_iterator& b) {
+            return static_cast<difference_type>(a.m_index) -
+                   static_cast<difference_type>(b.m_index);
+        }
+
+        friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a.m_index == b.m_index;
+        }
+        friend auto operator<=>(const const_iterator& a, const const_iterator& b) {
+            return a.m_index <=> b.m_index;
+        }
+
+    private:
+        const message_history* m_history = nullptr;
+        size_t m_index = 0;
+    };
+
+    using value_type = nlohmann::json;
+    using size_type = size_t;
+    using iterator = const_iterator;
+
+    message_history() = default;
+
+    /**
+     * @brief Gets the number of messages
+     */
+    [[nodiscard]] size_t size() const noexcept {
+        return (m_shared ? m_shared->offset + m_shared->messages.size() : 0) + m_tail.size();
+    }
+
+    /**
+     * @brief Checks whether the history holds no messages
+     */
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    /**
+     * @brief Accesses a message by position, O(log n) in the worst case
+     */
+    [[nodiscard]] const nlohmann::json& operator[](size_t index) const {
+        return *entry_at(index).message;
+    }
+
+    /**
+     * @brief Accesses a message by position with bounds checking
+     * @throws std::out_of_range If the index is past the end
+     */
+    [[nodiscard]] const nlohmann::json& at(size_t index) const {
+        if (index >= size()) {
+            throw std::out_of_range("message_history index out of range");
+        }
+        return (*this)[index];
+    }
+
+    /**
+     * @brief Gets shared ownership of a message by position
+     *
+     * Messages are immutable once added, and a message object only ever appears
+     * at one position behind one fixed prefix. Comparing the returned pointer with
+     * a later history's message at the same position therefore tells whether the
+     * whole prefix up to it is unchanged.
+     */
+    [[nodiscard]] std::shared_ptr<const nlohmann::json> share(size_t index) const {
+        return entry_at(index).message;
+    }
+
+    [[nodiscard]] const nlohmann::json& front() const { return (*this)[0]; }
+    [[nodiscard]] const nlohmann::json& back() const { return (*this)[size() - 1]; }
+
+    [[nodiscard]] const_iterator begin() const noexcept { return {this, 0}; }
+    [[nodiscard]] const_iterator end() const noexcept { return {this, size()}; }
+
+    /**
+     * @brief Appends a message to the private tail
+     * @param message The message to append
+     * @param weight Caller-defined weight of the message, counted by weight_before()
+     */
+    void push_back(nlohmann::json message, size_t weight = 0) {
+        m_tail.push_back({std::make_shared<const nlohmann::json>(std::move(message)),
+                          total_weight() + weight});
+    }
+
+    /**
+     * @brief Gets the summed weight of all messages
+     */
+    [[nodiscard]] size_t total_weight() const noexcept {
+        if (!m_tail.empty()) return m_tail.back().cumulative_weight;
+        if (m_shared) return m_shared->messages.back().cumulative_weight;
+        return 0;
+    }
+
+    /**
+     * @brief Gets the summed weight of the messages before the given position
+     * @param index Position in [0, size()]
+     */
+    [[nodiscard]] size_t weight_before(size_t index) const {
+        return index == 0 ? 0 : entry_at(index - 1).cumulative_weight;
+    }
+
+    /**
+     * @brief Removes all messages, releasing this history's reference to shared segments
+     */
+    void clear() noexcept {
+        m_shared.reset();
+        m_tail.clear();
+    }
+
+    /**
+     * @brief Creates a history that shares all current messages with this one
+     *
+     * Freezes the private tail, so both histories start out with nothing but
+     * shared segments. The cost does not depend on the history length.
+     */
+    [[nodiscard]] message_history fork() {
+        freeze();
+        message_history branch;
+        branch.m_shared = m_shared;
+        return branch;
+    }
+
+    /**
+     * @brief Checks whether two histories share at least one frozen segment
+     */
+    [[nodiscard]] bool shares_storage_with(const message_history& other) const noexcept {
+        for (const segment* a = m_shared.get(); a; a = a->parent.get()) {
+            for (const segment* b = other.m_shared.get(); b; b = b->parent.get()) {
+                if (a == b) return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    [[nodiscard]] const entry& entry_at(size_t index) const {
+        const size_t shared_size = size() - m_tail.size();
+        if (index >= shared_size) {
+            return m_tail[index - shared_size];
+        }
+
+        const segment* seg = m_shared.get();
+        while (index < seg->offset) {
+            seg = seg->parent.get();
+        }
+        return seg->messages[index - seg->offset];
+    }
+
+    void freeze() {
+        if (m_tail.empty()) {
+            return;
+        }
+
+        auto frozen = std::make_shared<segment>();
+        frozen->messages = std::move(m_tail);
+        m_tail.clear();
+
+        // Fold in ancestors that are no larger than the new segment so the chain
+        // depth stays logarithmic. Ancestors are left untouched for other branches.
+        std::shared_ptr<const segment> parent = m_shared;
+        while (parent && parent->messages.size() <= frozen->messages.size()) {
+            frozen->messages.insert(frozen->messages.begin(),
+                                    parent->messages.begin(), parent->messages.end());
+            parent = parent->parent;
+        }
+
+        frozen->offset = parent ? parent->offset + parent->messages.size() : 0;
+        frozen->parent = std::move(parent);
+        m_shared = std::move(frozen);
+    }
+
+    std::shared_ptr<const segment> m_shared;
+    std::vector<entry> m_tail;
+};
+
+} // hyni
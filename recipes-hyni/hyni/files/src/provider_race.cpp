@@ -0,0 +1,256 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "provider_race.h"
+#include "chat_api.h"
+#include "sse_decoder.h"
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+namespace hyni {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+} // anonymous namespace
+
+// One race; shared with the transfer callbacks, which run on the transport thread
+struct provider_race::race {
+    struct runner {
+        std::string provider;
+        std::unique_ptr<general_context> context;
+        async_transport::transfer_id id = 0;
+        std::string error;
+        sse_decoder decoder;
+        stream_event_parser parser;
+        sse_decoder::event_callback on_sse;
+    };
+
+    async_transport* transport = nullptr;
+    clock_type::time_point start = clock_type::now();
+    stream_event_callback on_event;
+
+    std::mutex mutex;
+    std::condition_variable settled;
+    std::vector<runner> runners;
+    std::optional<size_t> winner;
+    size_t failed = 0;
+    bool finished = false;  ///< The winner's response is complete, or every runner failed
+    bool stopped = false;   ///< on_event asked to end the stream
+    race_result result;
+
+    // Declares a winner and cancels everyone else; called with the mutex held
+    void win(size_t index) {
+        winner = index;
+        result.provider = runners[index].provider;
+        result.latency = std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start);
+        for (size_t i = 0; i < runners.size(); ++i) {
+            if (i != index) {
+                transport->cancel(runners[i].id);
+            }
+        }
+    }
+
+    // Why each runner dropped out; called with the mutex held
+    std::string errors() const {
+        std::string text;
+        for (const auto& entrant : runners) {
+            text += (text.empty() ? "" : "; ") + entrant.provider + ": " + entrant.error;
+        }
+        return text;
+    }
+
+    // Records a runner that dropped out; called with the mutex held
+    void fail(size_t index, std::string error) {
+        runners[index].error = std::move(error);
+        if (++failed == runners.size()) {
+            finished = true;
+            settled.notify_all();
+        }
+    }
+
+    void complete(size_t index, const http_response& response) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (winner) {
+            return; // A loser, cancelled
+        }
+        runner& entrant = runners[index];
+        if (!response.success) {
+            fail(index, failure_message(response));
+            return;
+        }
+        try {
+            result.text = entrant.context->extract_text_response(nlohmann::json::parse(response.body));
+        } catch (const std::exception& e) {
+            fail(index, e.what());
+            return;
+        }
+        win(index);
+        result.response = response;
+        finished = true;
+        settled.notify_all();
+    }
+
+    // Typed stream events of one runner; false once it has lost
+    bool handle(size_t index, const stream_event& event) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (event.type == stream_event_type::text_delta && !winner) {
+                win(index);
+            }
+            if (winner != index) {
+                if (event.type == stream_event_type::error) {
+                    runners[index].error = std::string(event.text);
+                }
+                return !winner; // Losers stop decoding; others wait for their first token
+            }
+            if (stopped) {
+                return false;
+            }
+        }
+
+        // Only the winner's transfer gets here, always on the transport thread
+        if (event.type == stream_event_type::text_delta) {
+            result.text += event.text;
+        } else if (event.type == stream_event_type::error) {
+            runners[index].error = std::string(event.text);
+        }
+        if (on_event && !on_event(event)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+            transport->cancel(runners[index].id);
+            return false;
+        }
+        return true;
+    }
+
+    void complete_stream(size_t index, const http_response& response) {
+        runners[index].decoder.finish(runners[index].on_sse);
+        std::lock_guard<std::mutex> lock(mutex);
+        runner& entrant = runners[index];
+        if (!winner) {
+            if (response.success && entrant.error.empty()) {
+                win(index); // Complete without any text
+            } else {
+                fail(index, entrant.error.empty() ? failure_message(response) : entrant.error);
+                return;
+            }
+        }
+        if (winner != index) {
+            return;
+        }
+        result.response = response;
+        if (entrant.error.empty() && !response.success && !stopped) {
+            entrant.error = failure_message(response);
+        }
+        finished = true;
+        settled.notify_all();
+    }
+};
+
+provider_race::provider_race(std::shared_ptr<context_factory> factory, std::vector<race_entrant> entrants)
+    : m_factory(std::move(factory)), m_entrants(std::move(entrants)) {
+    if (!m_factory) {
+        throw std::invalid_argument("provider_race: factory cannot be null");
+    }
+    if (m_entrants.empty()) {
+        throw std::invalid_argument("provider_race: at least one entrant is required");
+    }
+}
+
+std::shared_ptr<provider_race::race> provider_race::start(const conversation& messages, bool streaming,
+                                                          stream_event_callback on_event) {
+    // The callers wait for callbacks that only the event loop could run
+    if (m_transport->in_event_loop()) {
+        throw std::logic_error("provider_race: cannot wait for a race on the transport's event loop");
+    }
+    auto shared = std::make_shared<race>();
+    shared->transport = m_transport;
+    shared->on_event = std::move(on_event);
+    shared->runners.resize(m_entrants.size());
+
+    // Contexts first, so a bad entrant throws before anything is sent
+    std::vector<transport_request> requests;
+    for (size_t i = 0; i < m_entrants.size(); ++i) {
+        const race_entrant& entrant = m_entrants[i];
+        race::runner& runner = shared->runners[i];
+        runner.provider = entrant.provider;
+        runner.context = m_factory->create_context(entrant.provider, entrant.config);
+        if (streaming && !runner.context->supports_streaming()) {
+            throw streaming_not_supported_error();
+        }
+        runner.context->set_api_key(entrant.api_key);
+        if (entrant.model) {
+            runner.context->set_model(*entrant.model);
+        }
+        messages.apply_to(*runner.context);
+
+        transport_request request;
+        request.url = runner.context->get_endpoint();
+        request.headers = runner.context->get_headers();
+        request.body = std::make_shared<const std::string>(runner.context->build_request_body(streaming));
+        if (streaming) {
+            runner.parser = runner.context->get_stream_parser();
+            runner.on_sse = [state = shared.get(), i](const sse_event& event) {
+                state->runners[i].parser.parse(event, [state, i](const stream_event& typed) {
+                    return state->handle(i, typed);
+                });
+            };
+            request.on_chunk = [state = shared.get(), i](std::string_view chunk) {
+                state->runners[i].decoder.feed(chunk, state->runners[i].on_sse);
+            };
+        }
+        requests.push_back(std::move(request));
+    }
+
+    // Callbacks wait for the lock until every transfer id is known
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->start = clock_type::now();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        shared->runners[i].id = m_transport->submit(std::move(requests[i]),
+            [shared, i, streaming](http_response response) {
+                if (streaming) {
+                    shared->complete_stream(i, response);
+                } else {
+                    shared->complete(i, response);
+                }
+            });
+    }
+    return shared;
+}
+
+race_result provider_race::send(const conversation& messages) {
+    auto shared = start(messages, false, nullptr);
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->settled.wait(lock, [&] { return shared->finished; });
+    if (!shared->winner) {
+        throw std::runtime_error("All providers failed: " + shared->errors());
+    }
+    return shared->result;
+}
+
+race_result provider_race::send_stream(const conversation& messages, stream_event_callback on_event) {
+    auto shared = start(messages, true, std::move(on_event));
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->settled.wait(lock, [&] { return shared->finished; });
+    if (!shared->winner) {
+        throw std::runtime_error("All providers failed: " + shared->errors());
+    }
+    const auto& winner = shared->runners[*shared->winner];
+    if (!winner.error.empty()) {
+        throw std::runtime_error("Stream from " + winner.provider + " failed: " + winner.error);
+    }
+    return shared->result;
+}
+
+} // hyni
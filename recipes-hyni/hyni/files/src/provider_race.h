@@ -0,0 +1,110 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "async_transport.h"
+#include "context_factory.h"
+#include "conversation.h"
+#include "stream_events.h"
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief A provider taking part in a race
+ */
+struct race_entrant {
+    std::string provider;               ///< Provider name known to the context_factory
+    std::string api_key;
+    std::optional<std::string> model;   ///< The schema's default model if unset
+    context_config config;
+};
+
+/**
+ * @brief Outcome of a race
+ */
+struct race_result {
+    std::string provider;               ///< The winning entrant
+    std::string text;                   ///< Response text; for streams, all text deltas
+    http_response response;             ///< The winner's final response; the body is empty for streams
+    std::chrono::milliseconds latency{0}; ///< Until the complete response, or for streams the first token
+};
+
+/**
+ * @class provider_race
+ * @brief Sends one conversation to several providers and keeps the fastest answer
+ *
+ * Each call builds a context per entrant from the context_factory, writes the
+ * conversation into it so it is formatted for that provider, and starts all
+ * requests at once on an async_transport. The first entrant to deliver a
+ * complete, parseable response wins, or for streams the first to deliver a
+ * text delta; every other transfer is cancelled at that moment. Entrants that
+ * fail drop out, so a race also fails over between providers.
+ *
+ * @note Thread-safe; concurrent races are independent.
+ */
+class provider_race {
+public:
+    /**
+     * @brief Creates a race between the given entrants
+     * @throws std::invalid_argument If factory is null or there are no entrants
+     */
+    provider_race(std::shared_ptr<context_factory> factory, std::vector<race_entrant> entrants);
+
+    /**
+     * @brief Sets the transport the requests run on
+     * @param transport Transport to use; must outlive every race started on it
+     */
+    void set_transport(async_transport& transport) noexcept { m_transport = &transport; }
+
+    /**
+     * @brief Races a request for a complete response
+     * @return The first complete response
+     * @throws std::runtime_error If every entrant failed
+     * @throws std::logic_error If called on the transport's event loop, such as from a
+     *         transport callback, where waiting for the race would deadlock
+     */
+    [[nodiscard]] race_result send(const conversation& messages);
+
+    /**
+     * @brief Races a streamed request, keeping the stream that starts first
+     *
+     * Events of the winning stream are delivered from its first text delta on,
+     * on the transport thread; bookkeeping events that came before it and
+     * everything from the losers are dropped.
+     *
+     * @param messages The conversation to send
+     * @param on_event Receives the winner's events; returning false ends the stream
+     * @return The winner and its complete text, once the stream has ended
+     * @throws std::runtime_error If every entrant failed before its first token, or the
+     *         winning stream failed
+     * @throws streaming_not_supported_error If an entrant's provider cannot stream
+     * @throws std::logic_error If called on the transport's event loop, as for send()
+     */
+    race_result send_stream(const conversation& messages, stream_event_callback on_event);
+
+private:
+    struct race;
+
+    [[nodiscard]] std::shared_ptr<race> start(const conversation& messages, bool streaming,
+                                              stream_event_callback on_event);
+
+    std::shared_ptr<context_factory> m_factory;
+    std::vector<race_entrant> m_entrants;
+    async_transport* m_transport = &async_transport::shared();
+};
+
+} // hyni
@@ -0,0 +1,428 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "provider_router.h"
+#include "chat_api.h"
+#include "sse_decoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace hyni {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double elapsed_ms(clock_type::time_point since) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - since).count();
+}
+
+std::optional<double> parse_number(const std::string& text) {
+    try {
+        size_t used = 0;
+        const double value = std::stod(text, &used);
+        return used > 0 && value >= 0 ? std::optional<double>(value) : std::nullopt;
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+// OpenAI's reset durations such as "20ms", "1s" or "6m0s"; RFC 3339 timestamps
+// (Anthropic) are not parsed
+std::optional<clock_type::duration> parse_reset(const std::string& text) {
+    double total_ms = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t used = 0;
+        double value = 0;
+        try {
+            value = std::stod(text.substr(pos), &used);
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+        pos += used;
+        if (text.compare(pos, 2, "ms") == 0) {
+            total_ms += value;
+            pos += 2;
+        } else if (pos < text.size() && (text[pos] == 's' || text[pos] == 'm' || text[pos] == 'h')) {
+            total_ms += value * (text[pos] == 's' ? 1e3 : text[pos] == 'm' ? 6e4 : 3.6e6);
+            ++pos;
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (text.empty()) {
+        return std::nullopt;
+    }
+    return std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double, std::milli>(total_ms));
+}
+
+// The rate-limit headers of one response, with the names of either provider
+struct rate_limits {
+    std::optional<double> requests_remaining;
+    std::optional<double> requests_limit;
+    std::optional<double> tokens_remaining;
+    std::optional<double> tokens_limit;
+    std::optional<clock_type::duration> requests_reset;
+    std::optional<clock_type::duration> tokens_reset;
+    std::optional<clock_type::duration> retry_after;
+
+    explicit rate_limits(const std::unordered_map<std::string, std::string>& headers) {
+        for (const auto& [raw_name, value] : headers) {
+            std::string name = raw_name;
+            std::transform(name.begin(), name.end(), name.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (name == "x-ratelimit-remaining-requests" || name == "anthropic-ratelimit-requests-remaining") {
+                requests_remaining = parse_number(value);
+            } else if (name == "x-ratelimit-limit-requests" || name == "anthropic-ratelimit-requests-limit") {
+                requests_limit = parse_number(value);
+            } else if (name == "x-ratelimit-remaining-tokens" || name == "anthropic-ratelimit-tokens-remaining") {
+                tokens_remaining = parse_number(value);
+            } else if (name == "x-ratelimit-limit-tokens" || name == "anthropic-ratelimit-tokens-limit") {
+                tokens_limit = parse_number(value);
+            } else if (name == "x-ratelimit-reset-requests") {
+                requests_reset = parse_reset(value);
+            } else if (name == "x-ratelimit-reset-tokens") {
+                tokens_reset = parse_reset(value);
+            } else if (name == "retry-after") {
+                if (auto seconds = parse_number(value)) {
+                    retry_after = std::chrono::duration_cast<clock_type::duration>(
+                        std::chrono::duration<double>(*seconds));
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] bool any() const noexcept {
+        return requests_remaining || tokens_remaining;
+    }
+
+    [[nodiscard]] std::optional<double> headroom() const noexcept {
+        std::optional<double> fraction;
+        if (requests_remaining && requests_limit && *requests_limit > 0) {
+            fraction = *requests_remaining / *requests_limit;
+        }
+        if (tokens_remaining && tokens_limit && *tokens_limit > 0) {
+            fraction = std::min(fraction.value_or(1.0), *tokens_remaining / *tokens_limit);
+        }
+        return fraction;
+    }
+};
+
+} // anonymous namespace
+
+provider_router::provider_router(std::shared_ptr<context_factory> factory, std::vector<route_candidate> candidates,
+                                 router_options options)
+    : m_factory(std::move(factory)), m_candidates(std::move(candidates)), m_options(options),
+      m_stats(m_candidates.size()), m_observed(m_candidates.size()) {
+    if (!m_factory) {
+        throw std::invalid_argument("provider_router: factory cannot be null");
+    }
+    if (m_candidates.empty()) {
+        throw std::invalid_argument("provider_router: at least one candidate is required");
+    }
+}
+
+route_stats provider_router::get_stats(size_t index) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index >= m_stats.size()) {
+        throw std::out_of_range("provider_router: no candidate " + std::to_string(index));
+    }
+    return current_stats(index, clock_type::now());
+}
+
+route_stats provider_router::current_stats(size_t index, clock_type::time_point now) const {
+    route_stats stats = m_stats[index];
+    const double half_lives = std::chrono::duration<double>(now - m_observed[index]) /
+                              std::chrono::duration<double>(m_options.error_half_life);
+    if (half_lives > 0) {
+        stats.error_rate *= std::exp2(-half_lives);
+    }
+    return stats;
+}
+
+std::unique_ptr<general_context> provider_router::make_context(size_t index, const conversation& messages) const {
+    const route_candidate& candidate = m_candidates[index];
+    auto context = m_factory->create_context(candidate.provider, candidate.config);
+    context->set_api_key(candidate.api_key);
+    if (candidate.model) {
+        context->set_model(*candidate.model);
+    }
+    messages.apply_to(*context);
+    return context;
+}
+
+std::vector<size_t> provider_router::estimate_input_tokens(const conversation& messages) const {
+    std::vector<size_t> tokens;
+    tokens.reserve(m_candidates.size());
+    for (const auto& candidate : m_candidates) {
+        const auto estimator = token_estimator::for_provider(candidate.provider);
+        size_t count = messages.get_system_message() ? estimator.count(*messages.get_system_message()) : 0;
+        for (const auto& message : messages.get_messages()) {
+            count += estimator.count(message.content);
+        }
+        tokens.push_back(count);
+    }
+    return tokens;
+}
+
+std::vector<size_t> provider_router::rank(const conversation& messages, const route_target& target,
+                                          bool streaming) const {
+    return rank_by_tokens(estimate_input_tokens(messages), target, streaming);
+}
+
+std::vector<size_t> provider_router::rank_by_tokens(const std::vector<size_t>& input_tokens,
+                                                    const route_target& target, bool streaming) const {
+    struct score {
+        int tier;           ///< 0 on target, 1 off target, failing or low on headroom, 2 throttled
+        double preference;  ///< Lower is better within the tier
+    };
+
+    const auto now = clock_type::now();
+    std::vector<score> scores(m_candidates.size());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_candidates.size(); ++i) {
+            const route_candidate& candidate = m_candidates[i];
+            const route_stats stats = current_stats(i, now);
+            const size_t tokens = input_tokens[i] + target.expected_output_tokens;
+
+            // Expected time to a good answer; failures cost another round
+            const auto& measured = streaming ? stats.ttft_ms : stats.latency_ms;
+            const double latency = measured.value_or(0.0) / std::max(1.0 - stats.error_rate, 0.05);
+            const double cost = (static_cast<double>(input_tokens[i]) * candidate.input_cost +
+                                 static_cast<double>(target.expected_output_tokens) * candidate.output_cost) / 1e6;
+            const bool fresh_limits = now < stats.limits_expire;
+
+            score& s = scores[i];
+            if (now < stats.throttled_until ||
+                (fresh_limits && stats.tokens_remaining && *stats.tokens_remaining < tokens)) {
+                s.tier = 2;
+            } else if ((target.max_latency && latency > static_cast<double>(target.max_latency->count())) ||
+                       (target.max_cost && cost > *target.max_cost) ||
+                       stats.error_rate > m_options.max_error_rate ||
+                       (fresh_limits && stats.headroom && *stats.headroom < m_options.low_headroom)) {
+                s.tier = 1;
+            } else {
+                s.tier = 0;
+            }
+            // Meet a latency target as cheaply as possible; otherwise be fast
+            s.preference = s.tier == 0 && target.max_latency ? cost : latency;
+        }
+    }
+
+    std::vector<size_t> order(m_candidates.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (scores[a].tier != scores[b].tier) {
+            return scores[a].tier < scores[b].tier;
+        }
+        return scores[a].preference < scores[b].preference;
+    });
+    return order;
+}
+
+void provider_router::observe(size_t index, const http_response& response, bool succeeded, bool streaming,
+                              double latency_ms) {
+    const rate_limits limits(response.headers);
+    const auto now = clock_type::now();
+    const double alpha = m_options.smoothing;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    route_stats& stats = m_stats[index];
+    stats.error_rate = current_stats(index, now).error_rate;
+    m_observed[index] = now;
+    ++stats.requests;
+    if (succeeded) {
+        auto& average = streaming ? stats.ttft_ms : stats.latency_ms;
+        average = average ? alpha * latency_ms + (1 - alpha) * *average : latency_ms;
+        stats.error_rate *= 1 - alpha;
+    } else {
+        ++stats.failures;
+        stats.error_rate = alpha + (1 - alpha) * stats.error_rate;
+    }
+
+    if (limits.any()) {
+        stats.headroom = limits.headroom();
+        stats.tokens_remaining.reset();
+        if (limits.tokens_remaining) {
+            stats.tokens_remaining = static_cast<size_t>(*limits.tokens_remaining);
+        }
+        const auto reset = std::max(limits.requests_reset.value_or(clock_type::duration::zero()),
+                                    limits.tokens_reset.value_or(clock_type::duration::zero()));
+        stats.limits_expire = now + (reset > clock_type::duration::zero() ? reset : m_options.throttle_cooldown);
+    }
+
+    const bool exhausted = limits.requests_remaining && *limits.requests_remaining < 1;
+    if (response.status_code == 429 || exhausted) {
+        auto pause = limits.retry_after ? *limits.retry_after
+                   : exhausted && limits.requests_reset ? *limits.requests_reset
+                   : std::chrono::duration_cast<clock_type::duration>(m_options.throttle_cooldown);
+        stats.throttled_until = now + pause;
+    }
+}
+
+void provider_router::check_not_in_event_loop() const {
+    // Each attempt waits for a callback that only the event loop could run
+    if (m_transport->in_event_loop()) {
+        throw std::logic_error("provider_router: cannot wait for a response on the transport's event loop");
+    }
+}
+
+route_result provider_router::send(const conversation& messages, const route_target& target) {
+    check_not_in_event_loop();
+    route_result result;
+    std::string errors;
+    for (size_t index : rank(messages, target)) {
+        const route_candidate& candidate = m_candidates[index];
+        auto context = make_context(index, messages);
+        ++result.attempts;
+
+        transport_request request;
+        request.url = context->get_endpoint();
+        request.headers = context->get_headers();
+        request.body = std::make_shared<const std::string>(context->build_request_body());
+
+        std::promise<http_response> done;
+        auto pending = done.get_future();
+        const auto start = clock_type::now();
+        m_transport->submit(std::move(request), [&done](http_response response) {
+            done.set_value(std::move(response));
+        });
+        http_response response = pending.get();
+        const double latency = elapsed_ms(start);
+
+        std::string error;
+        if (response.success) {
+            try {
+                result.text = context->extract_text_response(nlohmann::json::parse(response.body));
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+        } else {
+            error = failure_message(response);
+        }
+        observe(index, response, error.empty(), false, latency);
+
+        if (error.empty()) {
+            result.provider = candidate.provider;
+            result.model = candidate.model.value_or("");
+            result.response = std::move(response);
+            result.latency = std::chrono::milliseconds(static_cast<long long>(latency));
+            return result;
+        }
+        errors += (errors.empty() ? "" : "; ") + candidate.provider + ": " + error;
+    }
+    throw std::runtime_error("All providers failed: " + errors);
+}
+
+route_result provider_router::send_stream(const conversation& messages, stream_event_callback on_event,
+                                          const route_target& target) {
+    check_not_in_event_loop();
+    route_result result;
+    std::string errors;
+    bool can_stream = false;
+    for (size_t index : rank(messages, target, true)) {
+        const route_candidate& candidate = m_candidates[index];
+        auto context = make_context(index, messages);
+        if (!context->supports_streaming()) {
+            errors += (errors.empty() ? "" : "; ") + candidate.provider + ": streaming not supported";
+            continue;
+        }
+        can_stream = true;
+        ++result.attempts;
+
+        // Touched by the transport thread until the completion callback has run
+        sse_decoder decoder;
+        const stream_event_parser parser = context->get_stream_parser();
+        const auto start = clock_type::now();
+        std::optional<double> first_token_ms;
+        std::atomic<bool> stopped{false};   // on_event ended the stream
+        std::atomic<bool> abandoned{false}; // Failed before the first token
+        std::string error;
+        std::string text;
+
+        const auto on_typed = [&](const stream_event& event) {
+            if (event.type == stream_event_type::error) {
+                error = std::string(event.text);
+                if (!first_token_ms) {
+                    abandoned = true; // Nothing delivered yet, so fall over quietly
+                    return false;
+                }
+            } else if (event.type == stream_event_type::text_delta) {
+                if (!first_token_ms) {
+                    first_token_ms = elapsed_ms(start);
+                }
+                text += event.text;
+            }
+            if (on_event && !on_event(event)) {
+                stopped = true;
+                return false;
+            }
+            return true;
+        };
+        const sse_decoder::event_callback on_sse = [&](const sse_event& event) {
+            parser.parse(event, on_typed);
+        };
+
+        transport_request request;
+        request.url = context->get_endpoint();
+        request.headers = context->get_headers();
+        request.body = std::make_shared<const std::string>(context->build_request_body(true));
+        request.on_chunk = [&](std::string_view chunk) {
+            if (!stopped && error.empty()) {
+                decoder.feed(chunk, on_sse);
+            }
+        };
+        request.cancel_check = [&stopped, &abandoned] { return stopped || abandoned; };
+
+        std::promise<http_response> done;
+        auto pending = done.get_future();
+        m_transport->submit(std::move(request), [&](http_response response) {
+            if (!stopped && error.empty()) {
+                decoder.finish(on_sse);
+            }
+            done.set_value(std::move(response));
+        });
+        http_response response = pending.get();
+
+        if (error.empty() && !response.success && !stopped) {
+            error = failure_message(response);
+        }
+        observe(index, response, error.empty(), true, first_token_ms.value_or(elapsed_ms(start)));
+
+        if (error.empty() || first_token_ms) {
+            result.provider = candidate.provider;
+            result.model = candidate.model.value_or("");
+            result.text = std::move(text);
+            result.response = std::move(response);
+            result.latency = std::chrono::milliseconds(static_cast<long long>(first_token_ms.value_or(0)));
+            if (!error.empty()) {
+                throw std::runtime_error("Stream from " + candidate.provider + " failed: " + error);
+            }
+            return result;
+        }
+        errors += (errors.empty() ? "" : "; ") + candidate.provider + ": " + error;
+    }
+    if (!can_stream) {
+        throw streaming_not_supported_error();
+    }
+    throw std::runtime_error("All providers failed: " + errors);
+}
+
+} // hyni
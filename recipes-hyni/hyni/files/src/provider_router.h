@@ -0,0 +1,194 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "async_transport.h"
+#include "context_factory.h"
+#include "conversation.h"
+#include "stream_events.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief A provider and model the router may send requests to
+ */
+struct route_candidate {
+    std::string provider;               ///< Provider name known to the context_factory
+    std::string api_key;
+    std::optional<std::string> model;   ///< The schema's default model if unset
+    context_config config;
+    double input_cost = 0.0;            ///< Price per million input tokens
+    double output_cost = 0.0;           ///< Price per million output tokens
+};
+
+/**
+ * @brief What a single request aims for; both limits are soft
+ */
+struct route_target {
+    std::optional<std::chrono::milliseconds> max_latency; ///< Complete response, or first token for streams
+    std::optional<double> max_cost;     ///< In the unit of the candidates' prices
+    size_t expected_output_tokens = 256; ///< Output size used for the cost estimate
+};
+
+/**
+ * @brief Router tuning
+ */
+struct router_options {
+    double smoothing = 0.2;             ///< EWMA weight of the newest sample
+    double low_headroom = 0.1;          ///< Remaining/limit fraction below which a candidate is avoided
+    double max_error_rate = 0.1;        ///< Error rate above which a candidate is avoided
+    std::chrono::milliseconds error_half_life{30000}; ///< Time for the error rate to halve, so an
+                                                      ///< avoided candidate gets another chance
+    std::chrono::milliseconds throttle_cooldown{1000}; ///< Pause after a 429 or an exhausted limit
+                                                       ///< when the provider gives no Retry-After
+};
+
+/**
+ * @brief What the router has learned about a candidate
+ */
+struct route_stats {
+    std::optional<double> latency_ms;   ///< EWMA of successful complete responses; unset until the first one
+    std::optional<double> ttft_ms;      ///< EWMA of the first token of successful streams; unset until the first one
+    double error_rate = 0.0;            ///< EWMA of failures, decayed over time; between 0 and 1
+    std::optional<double> headroom;     ///< Smallest remaining/limit fraction of the last rate-limit headers
+    std::optional<size_t> tokens_remaining; ///< From the last rate-limit headers
+    std::chrono::steady_clock::time_point limits_expire{};   ///< The rate-limit readings are stale from then
+    std::chrono::steady_clock::time_point throttled_until{}; ///< Avoided until then
+    size_t requests = 0;
+    size_t failures = 0;
+};
+
+/**
+ * @brief Outcome of a routed request
+ */
+struct route_result {
+    std::string provider;               ///< The candidate that answered
+    std::string model;                  ///< Its model; empty for the schema's default
+    std::string text;                   ///< Response text; for streams, all text deltas
+    http_response response;             ///< The final response; the body is empty for streams
+    std::chrono::milliseconds latency{0}; ///< Until the complete response, or for streams the first token
+    size_t attempts = 0;                ///< Candidates tried, including the one that answered
+};
+
+/**
+ * @class provider_router
+ * @brief Picks the provider and model for each request from live measurements
+ *
+ * Where provider_race sends every request to all providers, the router sends it
+ * to one: the candidate expected to answer fastest, or with a latency target
+ * the cheapest one expected to meet it. Expectations come from each candidate's
+ * own traffic: an EWMA of its latency, inflated by an EWMA of its error rate,
+ * and the rate-limit headers of its last response (OpenAI's x-ratelimit-* and
+ * Anthropic's anthropic-ratelimit-*). Candidates that fail often or are near
+ * their limits are tried only after the others, and those that answered 429 or
+ * ran out of requests are tried last until their limit resets. The error rate
+ * decays while a candidate sits out, so it is eventually tried again. A
+ * candidate without measurements ranks as instantly fast, so every candidate
+ * gets measured. Latency means the complete response for send() and the first
+ * token for send_stream(); the two are averaged apart, since a provider can be
+ * quick to start yet slow to finish.
+ *
+ * A failed request falls over to the next candidate in the ranking, so one
+ * slow or failing provider no longer holds up every request.
+ *
+ * @note Thread-safe; concurrent requests share the measurements.
+ */
+class provider_router {
+public:
+    /**
+     * @brief Creates a router over the given candidates
+     * @throws std::invalid_argument If factory is null or there are no candidates
+     */
+    provider_router(std::shared_ptr<context_factory> factory, std::vector<route_candidate> candidates,
+                    router_options options = {});
+
+    /**
+     * @brief Sets the transport the requests run on
+     * @param transport Transport to use; must outlive every request sent through the router
+     */
+    void set_transport(async_transport& transport) noexcept { m_transport = &transport; }
+
+    /**
+     * @brief Sends a request to the best candidate, falling over on failure
+     * @throws std::runtime_error If every candidate failed
+     * @throws std::logic_error If called on the transport's event loop, such as from a
+     *         transport callback, where waiting for the response would deadlock
+     */
+    [[nodiscard]] route_result send(const conversation& messages, const route_target& target = {});
+
+    /**
+     * @brief Sends a streamed request to the best candidate
+     *
+     * Falls over to the next candidate while nothing has been delivered; once
+     * on_event has seen a text delta, a failure of that stream is final.
+     * Candidates whose provider cannot stream are skipped. Events are delivered
+     * on the transport thread.
+     *
+     * @param messages The conversation to send
+     * @param on_event Receives the stream's events; returning false ends the stream
+     * @param target What the request aims for
+     * @throws std::runtime_error If every candidate failed, or the stream failed after its first token
+     * @throws streaming_not_supported_error If no candidate's provider can stream
+     * @throws std::logic_error If called on the transport's event loop, as for send()
+     */
+    route_result send_stream(const conversation& messages, stream_event_callback on_event,
+                             const route_target& target = {});
+
+    /**
+     * @brief Gets the candidate indexes in the order a request would try them
+     * @param streaming Rank by time to the first token instead of the complete response
+     */
+    [[nodiscard]] std::vector<size_t> rank(const conversation& messages, const route_target& target = {},
+                                           bool streaming = false) const;
+
+    /**
+     * @brief Gets what the router has learned about a candidate
+     * @throws std::out_of_range If index is not a candidate
+     */
+    [[nodiscard]] route_stats get_stats(size_t index) const;
+
+    [[nodiscard]] const std::vector<route_candidate>& get_candidates() const noexcept { return m_candidates; }
+
+private:
+    [[nodiscard]] std::unique_ptr<general_context> make_context(size_t index, const conversation& messages) const;
+
+    // Estimated input tokens of the conversation for each candidate's tokenizer
+    [[nodiscard]] std::vector<size_t> estimate_input_tokens(const conversation& messages) const;
+    [[nodiscard]] std::vector<size_t> rank_by_tokens(const std::vector<size_t>& input_tokens,
+                                                     const route_target& target, bool streaming) const;
+
+    void check_not_in_event_loop() const;
+
+    // Folds the outcome of one request into the candidate's stats; latency_ms is
+    // the time to the first token for streams
+    void observe(size_t index, const http_response& response, bool succeeded, bool streaming, double latency_ms);
+
+    std::shared_ptr<context_factory> m_factory;
+    std::vector<route_candidate> m_candidates;
+    router_options m_options;
+    async_transport* m_transport = &async_transport::shared();
+
+    // The stats with their error rate as of the last request; called with m_mutex held
+    [[nodiscard]] route_stats current_stats(size_t index, std::chrono::steady_clock::time_point now) const;
+
+    mutable std::mutex m_mutex;
+    std::vector<route_stats> m_stats;
+    std::vector<std::chrono::steady_clock::time_point> m_observed; ///< When each error rate was last updated
+};
+
+} // hyni
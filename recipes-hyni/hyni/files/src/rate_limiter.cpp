@@ -0,0 +1,91 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "rate_limiter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using seconds = std::chrono::duration<double>;
+
+// Time until a bucket refilling at rate holds the amount needed
+hyni::rate_limiter::clock::duration time_to(double needed, double available, double rate) {
+    const double wait = (needed - available) / rate;
+    return std::chrono::ceil<hyni::rate_limiter::clock::duration>(seconds(std::max(wait, 0.0)));
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+rate_limiter::rate_limiter(size_t requests_per_minute, size_t tokens_per_minute,
+                           clock::time_point now)
+    : m_request_rate(requests_per_minute / 60.0)
+    , m_token_rate(tokens_per_minute / 60.0)
+    , m_request_capacity(std::max(1.0, m_request_rate))
+    , m_token_capacity(m_token_rate)
+    , m_updated(now)
+    , m_paused_until(now) {
+    // Start with a second of budget rather than a full minute
+    m_requests = m_request_capacity;
+    m_tokens = m_token_capacity;
+}
+
+rate_limiter::clock::duration rate_limiter::try_acquire(size_t tokens, clock::time_point now) {
+    if (now < m_paused_until) {
+        return m_paused_until - now;
+    }
+    refill(now);
+
+    clock::duration wait{0};
+    if (m_request_rate > 0.0 && m_requests < 1.0) {
+        wait = std::max(wait, time_to(1.0, m_requests, m_request_rate));
+    }
+    const double needed = std::min(static_cast<double>(tokens), m_token_capacity);
+    if (m_token_rate > 0.0 && m_tokens < needed) {
+        wait = std::max(wait, time_to(needed, m_tokens, m_token_rate));
+    }
+    if (wait > clock::duration::zero()) {
+        return wait;
+    }
+
+    if (m_request_rate > 0.0) {
+        m_requests -= 1.0;
+    }
+    if (m_token_rate > 0.0) {
+        m_tokens -= static_cast<double>(tokens); // May go negative for an oversized request
+    }
+    return clock::duration::zero();
+}
+
+void rate_limiter::correct_tokens(size_t estimated, size_t actual) noexcept {
+    if (m_token_rate > 0.0) {
+        m_tokens = std::min(m_token_capacity,
+                            m_tokens + static_cast<double>(estimated) - static_cast<double>(actual));
+    }
+}
+
+void rate_limiter::pause_until(clock::time_point until) noexcept {
+    m_paused_until = std::max(m_paused_until, until);
+}
+
+void rate_limiter::refill(clock::time_point now) noexcept {
+    const double elapsed = seconds(now - m_updated).count();
+    if (elapsed <= 0.0) {
+        return;
+    }
+    m_updated = now;
+    m_requests = std::min(m_request_capacity, m_requests + elapsed * m_request_rate);
+    m_tokens = std::min(m_token_capacity, m_tokens + elapsed * m_token_rate);
+}
+
+} // hyni
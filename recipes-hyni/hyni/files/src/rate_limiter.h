@@ -0,0 +1,88 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace hyni {
+
+/**
+ * @class rate_limiter
+ * @brief Token buckets for a provider's requests-per-minute and tokens-per-minute limits
+ *
+ * Each bucket refills continuously at its per-minute rate and holds at most
+ * one second of budget, so requests are paced evenly through the minute
+ * instead of being sent in a burst that the provider would reject.
+ *
+ * @note Not thread-safe.
+ */
+class rate_limiter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Constructs a limiter
+     * @param requests_per_minute Request budget; 0 is unlimited
+     * @param tokens_per_minute Token budget; 0 is unlimited
+     */
+    explicit rate_limiter(size_t requests_per_minute = 0, size_t tokens_per_minute = 0,
+                          clock::time_point now = clock::now());
+
+    /**
+     * @brief Takes budget for one request if it is available
+     * @param tokens Estimated tokens of the request
+     * @param now Current time
+     * @return Zero if the budget was taken; otherwise how long to wait before trying again
+     *
+     * A request larger than the token bucket is let through once the bucket is full.
+     */
+    [[nodiscard]] clock::duration try_acquire(size_t tokens = 0, clock::time_point now = clock::now());
+
+    /**
+     * @brief Replaces a token estimate taken by try_acquire() with the actual count
+     * @param estimated Tokens taken when the request was sent
+     * @param actual Tokens the provider reported for it
+     *
+     * Underestimates leave the bucket in debt, so the requests that follow
+     * wait for the budget the provider actually charged.
+     */
+    void correct_tokens(size_t estimated, size_t actual) noexcept;
+
+    /**
+     * @brief Holds back all requests until the given time
+     *
+     * Used when the provider answers 429 with a Retry-After delay.
+     */
+    void pause_until(clock::time_point until) noexcept;
+
+    /**
+     * @brief Checks whether the limiter restricts anything
+     */
+    [[nodiscard]] bool unlimited() const noexcept {
+        return m_request_rate == 0.0 && m_token_rate == 0.0;
+    }
+
+private:
+    void refill(clock::time_point now) noexcept;
+
+    double m_request_rate = 0.0; ///< Requests per second
+    double m_token_rate = 0.0;   ///< Tokens per second
+    double m_request_capacity = 0.0;
+    double m_token_capacity = 0.0;
+    double m_requests = 0.0;     ///< Available request budget
+    double m_tokens = 0.0;       ///< Available token budget
+    clock::time_point m_updated;
+    clock::time_point m_paused_until;
+};
+
+} // hyni
@@ -0,0 +1,112 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "response_cache.h"
+#include "hash.h"
+
+namespace hyni {
+
+response_cache& response_cache::instance() {
+    static response_cache cache;
+    return cache;
+}
+
+std::string response_cache::make_key(std::string_view endpoint, std::string_view body) {
+    std::string key;
+    key.reserve(endpoint.size() + 1 + body.size());
+    key.append(endpoint);
+    key.push_back('\n');
+    key.append(body);
+    return key;
+}
+
+response_cache::payload response_cache::find(std::string_view key) {
+    const uint64_t hash = content_hash(key);
+    shard& s = shard_for(hash);
+    std::lock_guard lock(s.mutex);
+    auto it = s.entries.find(hash);
+    if (it == s.entries.end() || it->second.key != key) {
+        ++s.misses;
+        return nullptr;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second.lru);
+    ++s.hits;
+    return it->second.data;
+}
+
+void response_cache::insert(std::string_view key, std::string response) {
+    const size_t budget = m_max_bytes.load(std::memory_order_relaxed) / SHARD_COUNT;
+    const size_t size = key.size() + response.size();
+    if (size > budget) {
+        return; // Never fits
+    }
+
+    const uint64_t hash = content_hash(key);
+    auto data = std::make_shared<const std::string>(std::move(response));
+    shard& s = shard_for(hash);
+    std::lock_guard lock(s.mutex);
+    if (auto it = s.entries.find(hash); it != s.entries.end()) {
+        erase_locked(s, it); // Same key refreshed, or a colliding key replaced
+    }
+
+    s.lru.push_front(hash);
+    s.entries.emplace(hash, entry{std::string(key), std::move(data), s.lru.begin()});
+    s.bytes += size;
+    evict_locked(s, budget);
+}
+
+void response_cache::set_max_bytes(size_t max_bytes) {
+    m_max_bytes.store(max_bytes, std::memory_order_relaxed);
+    for (auto& s : m_shards) {
+        std::lock_guard lock(s.mutex);
+        evict_locked(s, max_bytes / SHARD_COUNT);
+    }
+}
+
+void response_cache::clear() {
+    for (auto& s : m_shards) {
+        std::lock_guard lock(s.mutex);
+        s.lru.clear();
+        s.entries.clear();
+        s.bytes = 0;
+        s.hits = 0;
+        s.misses = 0;
+        s.evictions = 0;
+    }
+}
+
+response_cache::cache_stats response_cache::get_cache_stats() const {
+    cache_stats stats{0, 0, m_max_bytes.load(std::memory_order_relaxed), 0, 0, 0};
+    for (const auto& s : m_shards) {
+        std::lock_guard lock(s.mutex);
+        stats.entries += s.entries.size();
+        stats.bytes += s.bytes;
+        stats.hit_count += s.hits;
+        stats.miss_count += s.misses;
+        stats.eviction_count += s.evictions;
+    }
+    return stats;
+}
+
+void response_cache::erase_locked(shard& s, std::unordered_map<uint64_t, entry>::iterator it) {
+    s.bytes -= it->second.key.size() + it->second.data->size();
+    s.lru.erase(it->second.lru);
+    s.entries.erase(it);
+}
+
+void response_cache::evict_locked(shard& s, size_t budget) {
+    while (s.bytes > budget && !s.lru.empty()) {
+        erase_locked(s, s.entries.find(s.lru.back()));
+        ++s.evictions;
+    }
+}
+
+} // hyni
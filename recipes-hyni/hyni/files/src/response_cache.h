@@ -0,0 +1,136 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace hyni {
+
+/**
+ * @class response_cache
+ * @brief Process-wide, size-bounded cache of API response bodies
+ *
+ * Responses are keyed by the exact request: the endpoint and the serialized
+ * request body, which general_context writes in canonical form (sorted keys,
+ * no whitespace), so it covers the model, the messages and every parameter.
+ * chat_api consults it only for requests that are deterministic, see
+ * general_context::allows_response_caching().
+ *
+ * Keys are spread over independently locked shards by their content hash, so
+ * concurrent lookups rarely contend. Each shard evicts its least recently
+ * used responses to stay within its share of the byte budget.
+ *
+ * @note Thread-safe. Use instance() to share one cache across all chat_api objects.
+ */
+class response_cache {
+public:
+    using payload = std::shared_ptr<const std::string>;
+
+    static constexpr size_t DEFAULT_MAX_BYTES = 32 * 1024 * 1024;
+    static constexpr size_t SHARD_COUNT = 16;
+
+    /**
+     * @brief Cache statistics
+     */
+    struct cache_stats {
+        size_t entries;          ///< Cached responses
+        size_t bytes;            ///< Key and response bytes held by the cache
+        size_t max_bytes;        ///< Configured budget
+        size_t hit_count;        ///< Lookups answered from the cache
+        size_t miss_count;       ///< Lookups that found nothing
+        size_t eviction_count;   ///< Responses dropped to stay within budget
+        double hit_rate() const {
+            auto total = hit_count + miss_count;
+            return total > 0 ? static_cast<double>(hit_count) / total : 0.0;
+        }
+    };
+
+    explicit response_cache(size_t max_bytes = DEFAULT_MAX_BYTES) : m_max_bytes(max_bytes) {}
+
+    response_cache(const response_cache&) = delete;
+    response_cache& operator=(const response_cache&) = delete;
+
+    /**
+     * @brief Gets the process-wide cache
+     */
+    static response_cache& instance();
+
+    /**
+     * @brief Builds the cache key of a request
+     * @param endpoint URL the request is sent to
+     * @param body Serialized request body
+     */
+    [[nodiscard]] static std::string make_key(std::string_view endpoint, std::string_view body);
+
+    /**
+     * @brief Looks up a response
+     * @return The cached response body, or nullptr on a miss
+     */
+    [[nodiscard]] payload find(std::string_view key);
+
+    /**
+     * @brief Stores a response, replacing any previous one for the key
+     *
+     * Responses larger than a shard's share of the budget are not stored.
+     */
+    void insert(std::string_view key, std::string response);
+
+    /**
+     * @brief Sets the budget for cached bytes, evicting least recently used responses
+     */
+    void set_max_bytes(size_t max_bytes);
+
+    /**
+     * @brief Drops all responses and resets the statistics
+     */
+    void clear();
+
+    /**
+     * @brief Gets cache statistics
+     */
+    [[nodiscard]] cache_stats get_cache_stats() const;
+
+private:
+    struct entry {
+        std::string key;                  ///< Full key, to tell hash collisions apart
+        payload data;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    struct shard {
+        mutable std::mutex mutex;
+        std::list<uint64_t> lru;          ///< Key hashes, most recently used first
+        std::unordered_map<uint64_t, entry> entries;
+        size_t bytes = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    [[nodiscard]] shard& shard_for(uint64_t hash) noexcept { return m_shards[hash % SHARD_COUNT]; }
+    void erase_locked(shard& s, std::unordered_map<uint64_t, entry>::iterator it);
+    void evict_locked(shard& s, size_t budget);
+
+    std::atomic<size_t> m_max_bytes;
+    std::array<shard, SHARD_COUNT> m_shards;
+};
+
+} // hyni
@@ -1,6 +1,7 @@
 #ifndef RESPONSE_UTILS_H
 #define RESPONSE_UTILS_H
 
+#include "base64.h"
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -295,30 +296,7 @@ public:
     }
 
     [[nodiscard]] static std::string base64_encode(const unsigned char* data, size_t len) {
-        static constexpr char encoding_table[] =
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz"
-            "0123456789+/";
-
-        std::string ret;
-        ret.reserve(4 * ((len + 2) / 3));
-
-        for (size_t i = 0; i < len;) {
-            size_t bytes_left = len - i;
-
-            uint32_t octet_a = data[i++];
-            uint32_t octet_b = (bytes_left > 1) ? data[i++] : 0;
-            uint32_t octet_c = (bytes_left > 2) ? data[i++] : 0;
-
-            uint32_t triple = (octet_a << 16) | (octet_b << 8) | octet_c;
-
-            ret += encoding_table[(triple >> 18) & 0x3F];
-            ret += encoding_table[(triple >> 12) & 0x3F];
-            ret += (bytes_left > 1) ? encoding_table[(triple >> 6) & 0x3F] : '=';
-            ret += (bytes_left > 2) ? encoding_table[triple & 0x3F] : '=';
-        }
-
-        return ret;
+        return base64::encode(data, len);
     }
 
     [[nodiscard]] static std::string base64_encode(std::string_view input) {
@@ -0,0 +1,186 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "sse_decoder.h"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr std::string_view UTF8_BOM = "\xEF\xBB\xBF";
+
+const char* find_newline(std::string_view text) noexcept {
+    return text.empty() ? nullptr
+                        : static_cast<const char*>(std::memchr(text.data(), '\n', text.size()));
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+void sse_decoder::field::set(std::string_view value, bool stable) {
+    if (stable) {
+        view = value;
+        is_owned = false;
+    } else {
+        owned.assign(value.data(), value.size());
+        is_owned = true;
+    }
+    is_set = true;
+}
+
+void sse_decoder::field::append_line(std::string_view value, bool stable) {
+    if (!is_set) {
+        set(value, stable);
+        return;
+    }
+    keep();
+    owned.push_back('\n');
+    owned.append(value.data(), value.size());
+}
+
+void sse_decoder::field::keep() {
+    if (is_set && !is_owned) {
+        owned.assign(view.data(), view.size());
+        is_owned = true;
+    }
+}
+
+void sse_decoder::field::clear() noexcept {
+    view = {};
+    owned.clear();
+    is_owned = false;
+    is_set = false;
+}
+
+void sse_decoder::feed(std::string_view chunk, const event_callback& on_event) {
+    if (!m_started) {
+        // A byte order mark may start the stream; hold back what could be part of one
+        if (m_carry.size() + chunk.size() < UTF8_BOM.size()) {
+            m_carry.append(chunk.data(), chunk.size());
+            if (UTF8_BOM.starts_with(m_carry)) {
+                return;
+            }
+            chunk = {};
+        }
+        m_started = true;
+        if (!m_carry.empty()) {
+            std::string head = std::move(m_carry);
+            m_carry.clear();
+            head.append(chunk.data(), chunk.size());
+            if (std::string_view(head).starts_with(UTF8_BOM)) {
+                head.erase(0, UTF8_BOM.size());
+            }
+            feed(head, on_event);
+            return;
+        }
+        if (chunk.starts_with(UTF8_BOM)) {
+            chunk.remove_prefix(UTF8_BOM.size());
+        }
+    }
+
+    // Complete the line left over from the previous chunk
+    if (!m_carry.empty()) {
+        const char* newline = find_newline(chunk);
+        if (!newline) {
+            m_carry.append(chunk.data(), chunk.size());
+            return;
+        }
+        const size_t length = static_cast<size_t>(newline - chunk.data());
+        m_carry.append(chunk.data(), length);
+        process_line(m_carry, false, on_event);
+        m_carry.clear();
+        chunk.remove_prefix(length + 1);
+    }
+
+    // Whole lines are decoded in place
+    while (const char* newline = find_newline(chunk)) {
+        const size_t length = static_cast<size_t>(newline - chunk.data());
+        process_line(chunk.substr(0, length), true, on_event);
+        chunk.remove_prefix(length + 1);
+    }
+    m_carry.assign(chunk.data(), chunk.size());
+
+    // The chunk goes away after this call; an unfinished event keeps copies
+    m_data.keep();
+    m_type.keep();
+}
+
+void sse_decoder::finish(const event_callback& on_event) {
+    if (!m_carry.empty()) {
+        std::string line = std::move(m_carry);
+        m_carry.clear();
+        process_line(line, false, on_event);
+    }
+    dispatch(on_event);
+    reset();
+}
+
+void sse_decoder::reset() noexcept {
+    m_carry.clear();
+    m_data.clear();
+    m_type.clear();
+    m_last_id.clear();
+    m_retry_ms = 0;
+    m_started = false;
+}
+
+void sse_decoder::process_line(std::string_view line, bool stable, const event_callback& on_event) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    if (line.empty()) {
+        dispatch(on_event);
+        return;
+    }
+    if (line.front() == ':') {
+        return; // Comment, used by servers as a keep-alive
+    }
+
+    std::string_view name = line;
+    std::string_view value;
+    if (const size_t colon = line.find(':'); colon != std::string_view::npos) {
+        name = line.substr(0, colon);
+        value = line.substr(colon + 1);
+        if (!value.empty() && value.front() == ' ') {
+            value.remove_prefix(1);
+        }
+    }
+
+    if (name == "data") {
+        m_data.append_line(value, stable);
+    } else if (name == "event") {
+        m_type.set(value, stable);
+    } else if (name == "id") {
+        if (value.find('\0') == std::string_view::npos) {
+            m_last_id.assign(value.data(), value.size());
+        }
+    } else if (name == "retry") {
+        size_t retry = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), retry);
+        if (!value.empty() && error == std::errc() && end == value.data() + value.size()) {
+            m_retry_ms = retry;
+        }
+    }
+    // Other field names are ignored
+}
+
+void sse_decoder::dispatch(const event_callback& on_event) {
+    // An event without data is not dispatched, but still ends the event
+    if (m_data.is_set && on_event) {
+        on_event(sse_event{m_type.value(), m_data.value(), m_last_id});
+    }
+    m_data.clear();
+    m_type.clear();
+}
+
+} // hyni
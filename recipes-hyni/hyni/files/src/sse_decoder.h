@@ -0,0 +1,115 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @brief One server-sent event
+ *
+ * The views are valid only for the duration of the callback that receives them.
+ */
+struct sse_event {
+    std::string_view type; ///< Value of the last "event:" field; empty for the default "message" type
+    std::string_view data; ///< "data:" lines joined with '\n'
+    std::string_view id;   ///< Last event ID seen on the stream, if any
+};
+
+/**
+ * @class sse_decoder
+ * @brief Incremental decoder for a text/event-stream body
+ *
+ * Network chunks are fed as they arrive and may split lines, fields and events
+ * anywhere. A partial line is kept in a carry-over buffer until the rest arrives.
+ * Line ends are located with memchr; LF and CRLF line ends are accepted.
+ *
+ * A single-line event that arrives within one chunk is reported with views into
+ * that chunk, so the common case copies and allocates nothing. Multi-line data
+ * and events spanning chunks are assembled in buffers whose capacity is reused.
+ *
+ * One decoder handles one stream.
+ *
+ * @note Not thread-safe.
+ */
+class sse_decoder {
+public:
+    /**
+     * @brief Receives each complete event
+     */
+    using event_callback = std::function<void(const sse_event& event)>;
+
+    /**
+     * @brief Decodes the next piece of the stream
+     * @param chunk Bytes as received; need not end on a line or event boundary
+     * @param on_event Called for every event that the chunk completes, in order
+     */
+    void feed(std::string_view chunk, const event_callback& on_event);
+
+    /**
+     * @brief Ends the stream, reporting an event left without a terminating blank line
+     * @param on_event Called for that event, if any
+     *
+     * The decoder is reset afterwards and can decode a new stream.
+     */
+    void finish(const event_callback& on_event);
+
+    /**
+     * @brief Discards any partial line and event
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief Gets the reconnection delay last sent in a "retry:" field
+     * @return Milliseconds, or 0 if the server sent none
+     */
+    [[nodiscard]] size_t retry_ms() const noexcept { return m_retry_ms; }
+
+    /**
+     * @brief Gets the number of bytes held back waiting for the end of a line
+     */
+    [[nodiscard]] size_t pending_bytes() const noexcept { return m_carry.size(); }
+
+private:
+    // A field value that is a view while its source is alive and is copied
+    // into the owned buffer when the source goes away
+    struct field {
+        std::string_view view;
+        std::string owned;
+        bool is_owned = false;
+        bool is_set = false;
+
+        [[nodiscard]] std::string_view value() const noexcept {
+            return is_owned ? std::string_view(owned) : view;
+        }
+        void set(std::string_view value, bool stable);
+        void append_line(std::string_view value, bool stable);
+        void keep();
+        void clear() noexcept;
+    };
+
+    void process_line(std::string_view line, bool stable, const event_callback& on_event);
+    void dispatch(const event_callback& on_event);
+
+    std::string m_carry;
+    field m_data;
+    field m_type;
+    std::string m_last_id;
+    size_t m_retry_ms = 0;
+    bool m_started = false;
+};
+
+} // hyni
@@ -0,0 +1,205 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "stream_events.h"
+
+namespace {
+
+constexpr std::string_view DONE_SENTINEL = "[DONE]";
+constexpr std::string_view PING_EVENT = "ping";
+constexpr std::string_view ERROR_EVENT = "error";
+
+const nlohmann::json* find_member(const nlohmann::json& object, const char* key) noexcept {
+    if (!object.is_object()) {
+        return nullptr;
+    }
+    auto it = object.find(key);
+    return it == object.end() ? nullptr : &*it;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+stream_event_parser::stream_event_parser(const nlohmann::json& schema) {
+    const nlohmann::json* format = find_member(schema, "response_format");
+    if (!format) {
+        return;
+    }
+
+    if (const nlohmann::json* error = find_member(*format, "error")) {
+        if (const nlohmann::json* path = find_member(*error, "error_path")) {
+            m_error_path = compile(*path);
+        }
+    }
+
+    const nlohmann::json* stream = find_member(*format, "stream");
+    if (!stream) {
+        return;
+    }
+    if (const nlohmann::json* path = find_member(*stream, "content_delta_path")) {
+        m_text_path = compile(*path);
+    }
+    if (const nlohmann::json* path = find_member(*stream, "usage_delta_path")) {
+        m_usage_path = compile(*path);
+    }
+    if (const nlohmann::json* path = find_member(*stream, "usage_start_path")) {
+        m_usage_start_path = compile(*path);
+    }
+    if (const nlohmann::json* path = find_member(*stream, "finish_reason_path")) {
+        m_finish_path = compile(*path);
+    }
+    if (const nlohmann::json* done = find_member(*stream, "done_event"); done && done->is_string()) {
+        m_done_event = done->get<std::string>();
+    }
+}
+
+bool stream_event_parser::parse(const sse_event& event, const stream_event_callback& on_event) const {
+    stream_event typed;
+    typed.name = event.type;
+
+    if (event.data == DONE_SENTINEL) {
+        typed.type = stream_event_type::done;
+        return on_event(typed);
+    }
+
+    const nlohmann::json payload = nlohmann::json::parse(event.data, nullptr, false);
+    if (payload.is_discarded()) {
+        const std::string message = "Malformed stream event: " + std::string(event.data);
+        typed.type = stream_event_type::error;
+        typed.text = message;
+        return on_event(typed);
+    }
+    typed.payload = &payload;
+
+    // The event name is sent on the "event:" line, in the payload, or both
+    const nlohmann::json* type_field = find_member(payload, "type");
+    if (typed.name.empty() && type_field && type_field->is_string()) {
+        typed.name = type_field->get_ref<const std::string&>();
+    }
+
+    const nlohmann::json* error = find_member(payload, "error");
+    if (typed.name == ERROR_EVENT || (error && !error->is_null())) {
+        const nlohmann::json* message = m_error_path.empty() ? nullptr : find(payload, m_error_path);
+        typed.type = stream_event_type::error;
+        typed.text = message && message->is_string()
+            ? std::string_view(message->get_ref<const std::string&>())
+            : std::string_view("Unknown error");
+        return on_event(typed);
+    }
+    if (typed.name == PING_EVENT) {
+        typed.type = stream_event_type::ping;
+        return on_event(typed);
+    }
+    if (!m_done_event.empty() && typed.name == m_done_event) {
+        typed.type = stream_event_type::done;
+        return on_event(typed);
+    }
+
+    bool delivered = false;
+    const auto deliver = [&](stream_event_type type) {
+        typed.type = type;
+        delivered = true;
+        return on_event(typed);
+    };
+
+    if (!m_text_path.empty()) {
+        const nlohmann::json* text = find(payload, m_text_path);
+        if (text && text->is_string() && !text->get_ref<const std::string&>().empty()) {
+            typed.text = text->get_ref<const std::string&>();
+            if (!deliver(stream_event_type::text_delta)) return false;
+            typed.text = {};
+        }
+    }
+
+    const nlohmann::json* usage = m_usage_path.empty() ? nullptr : find(payload, m_usage_path);
+    if ((!usage || !usage->is_object()) && !m_usage_start_path.empty()) {
+        usage = find(payload, m_usage_start_path);
+    }
+    if (usage && usage->is_object()) {
+        typed.usage = usage;
+        if (!deliver(stream_event_type::usage)) return false;
+        typed.usage = nullptr;
+    }
+
+    if (!m_finish_path.empty()) {
+        const nlohmann::json* reason = find(payload, m_finish_path);
+        if (reason && reason->is_string()) {
+            typed.text = reason->get_ref<const std::string&>();
+            if (!deliver(stream_event_type::finish)) return false;
+        }
+    }
+
+    if (!delivered) {
+        typed.type = stream_event_type::other;
+        return on_event(typed);
+    }
+    return true;
+}
+
+bool stream_event_parser::supports(stream_event_type type) const noexcept {
+    switch (type) {
+    case stream_event_type::text_delta:
+        return !m_text_path.empty();
+    case stream_event_type::usage:
+        return !m_usage_path.empty() || !m_usage_start_path.empty();
+    case stream_event_type::finish:
+        return !m_finish_path.empty();
+    default:
+        return true;
+    }
+}
+
+stream_event_parser::compiled_path stream_event_parser::compile(const nlohmann::json& path) {
+    compiled_path compiled;
+    if (!path.is_array()) {
+        return compiled;
+    }
+    for (const auto& element : path) {
+        path_step step;
+        if (element.is_string()) {
+            step.key = element.get<std::string>();
+        } else if (element.is_number_unsigned() ||
+                   (element.is_number_integer() && element.get<int64_t>() >= 0)) {
+            step.index = element.get<size_t>();
+            step.is_index = true;
+        } else {
+            continue;
+        }
+        compiled.push_back(std::move(step));
+    }
+    return compiled;
+}
+
+const nlohmann::json* stream_event_parser::find(const nlohmann::json& root,
+                                                const compiled_path& path) noexcept {
+    const nlohmann::json* current = &root;
+    for (const auto& step : path) {
+        if (step.is_index) {
+            if (!current->is_array() || step.index >= current->size()) {
+                return nullptr;
+            }
+            current = &(*current)[step.index];
+        } else {
+            if (!current->is_object()) {
+                return nullptr;
+            }
+            auto it = current->find(step.key);
+            if (it == current->end()) {
+                return nullptr;
+            }
+            current = &*it;
+        }
+    }
+    return current;
+}
+
+} // hyni
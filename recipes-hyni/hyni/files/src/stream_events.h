@@ -0,0 +1,116 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "sse_decoder.h"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Kind of a typed streaming event
+ */
+enum class stream_event_type {
+    text_delta, ///< New response text
+    usage,      ///< Token usage reported by the provider
+    finish,     ///< Reason the model stopped generating
+    ping,       ///< Keep-alive sent by the provider
+    error,      ///< Error reported inside the stream
+    done,       ///< End of the response
+    other       ///< Provider bookkeeping event that carries none of the above
+};
+
+/**
+ * @brief One typed event decoded from a provider's response stream
+ *
+ * The views and pointers are valid only for the duration of the callback that
+ * receives them.
+ */
+struct stream_event {
+    stream_event_type type = stream_event_type::other;
+    std::string_view text;                   ///< Delta text, finish reason or error message
+    const nlohmann::json* usage = nullptr;   ///< Usage object as the provider sends it
+    const nlohmann::json* payload = nullptr; ///< Whole parsed event; null if the data is not JSON
+    std::string_view name;                   ///< Event name from the stream or the payload's "type"
+};
+
+/**
+ * @brief Receives typed streaming events
+ * @return false to stop the stream; no further events are delivered
+ */
+using stream_event_callback = std::function<bool(const stream_event& event)>;
+
+/**
+ * @class stream_event_parser
+ * @brief Turns server-sent events into typed events using a provider schema
+ *
+ * The paths of the schema's response_format.stream section are compiled once:
+ * content_delta_path, usage_delta_path, usage_start_path, finish_reason_path
+ * and done_event, plus the error path of response_format.error. Parsing an
+ * event then walks the payload by pointer without copying any part of it.
+ *
+ * A single server-sent event may produce several typed events, delivered in
+ * the order text, usage, finish.
+ */
+class stream_event_parser {
+public:
+    /**
+     * @brief Constructs a parser that recognizes only "[DONE]", pings and errors
+     */
+    stream_event_parser() = default;
+
+    /**
+     * @brief Constructs a parser for a provider
+     * @param schema The provider schema
+     */
+    explicit stream_event_parser(const nlohmann::json& schema);
+
+    /**
+     * @brief Decodes one server-sent event
+     * @param event Event from the sse_decoder
+     * @param on_event Called for each typed event
+     * @return false if on_event asked to stop
+     */
+    bool parse(const sse_event& event, const stream_event_callback& on_event) const;
+
+    /**
+     * @brief Checks whether the schema declares where a kind of event is found
+     * @param type text_delta, usage or finish; other kinds are always recognized
+     */
+    [[nodiscard]] bool supports(stream_event_type type) const noexcept;
+
+private:
+    struct path_step {
+        std::string key;
+        size_t index = 0;
+        bool is_index = false;
+    };
+    using compiled_path = std::vector<path_step>;
+
+    [[nodiscard]] static compiled_path compile(const nlohmann::json& path);
+    [[nodiscard]] static const nlohmann::json* find(const nlohmann::json& root,
+                                                    const compiled_path& path) noexcept;
+
+    compiled_path m_text_path;
+    compiled_path m_usage_path;
+    compiled_path m_usage_start_path;
+    compiled_path m_finish_path;
+    compiled_path m_error_path;
+    std::string m_done_event;
+};
+
+} // hyni
@@ -0,0 +1,139 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "stream_metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace hyni {
+
+namespace {
+
+std::chrono::microseconds between(stream_timing::clock::time_point from, stream_timing::clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+
+} // anonymous namespace
+
+void latency_histogram::add(duration value) noexcept {
+    const uint64_t us = value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+    const size_t index = std::min<size_t>(std::bit_width(us), BUCKET_COUNT - 1);
+    ++m_buckets[index];
+    ++m_count;
+    m_sum_us += us;
+    m_max_us = std::max(m_max_us, us);
+}
+
+latency_histogram& latency_histogram::operator+=(const latency_histogram& other) noexcept {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_sum_us += other.m_sum_us;
+    m_max_us = std::max(m_max_us, other.m_max_us);
+    return *this;
+}
+
+latency_histogram::duration latency_histogram::mean() const noexcept {
+    return duration(m_count > 0 ? static_cast<duration::rep>(m_sum_us / m_count) : 0);
+}
+
+latency_histogram::duration latency_histogram::percentile(double fraction) const noexcept {
+    if (m_count == 0) {
+        return duration(0);
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(m_count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            const uint64_t upper = i == 0 ? 0 : (uint64_t{1} << i) - 1;
+            return duration(static_cast<duration::rep>(std::min(upper, m_max_us)));
+        }
+    }
+    return max();
+}
+
+void stream_timing::add_delta(clock::time_point now) noexcept {
+    if (deltas == 0) {
+        first_delta = now;
+    } else {
+        gaps.add(between(last_delta, now));
+    }
+    last_delta = now;
+    ++deltas;
+}
+
+std::optional<std::chrono::microseconds> stream_timing::time_to_headers() const noexcept {
+    if (headers_received == clock::time_point{}) {
+        return std::nullopt;
+    }
+    return between(start, headers_received);
+}
+
+std::optional<std::chrono::microseconds> stream_timing::time_to_first_token() const noexcept {
+    if (deltas == 0) {
+        return std::nullopt;
+    }
+    return between(start, first_delta);
+}
+
+std::chrono::microseconds stream_timing::duration() const noexcept {
+    return between(start, end);
+}
+
+stream_metrics& stream_metrics::instance() {
+    static stream_metrics metrics;
+    return metrics;
+}
+
+void stream_metrics::record(const std::string& provider, const std::string& model, const stream_timing& timing,
+                            bool succeeded) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stream_metrics_summary& summary = m_summaries[{provider, model}];
+    ++summary.streams;
+    if (!succeeded) {
+        ++summary.failures;
+    }
+    summary.deltas += timing.deltas;
+    summary.bytes += timing.bytes;
+    if (auto headers = timing.time_to_headers()) {
+        summary.time_to_headers.add(*headers);
+    }
+    if (auto first_token = timing.time_to_first_token()) {
+        summary.time_to_first_token.add(*first_token);
+    }
+    summary.inter_token += timing.gaps;
+    summary.duration.add(timing.duration());
+}
+
+std::optional<stream_metrics_summary> stream_metrics::get(const std::string& provider,
+                                                          const std::string& model) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_summaries.find({provider, model});
+    if (it == m_summaries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::map<stream_metrics::key, stream_metrics_summary> stream_metrics::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_summaries;
+}
+
+void stream_metrics::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_summaries.clear();
+}
+
+} // hyni
@@ -0,0 +1,174 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace hyni {
+
+/**
+ * @class latency_histogram
+ * @brief Fixed-size histogram of durations with power-of-two microsecond buckets
+ *
+ * Bucket i counts durations of [2^(i-1), 2^i) microseconds, so percentiles
+ * are exact to within a factor of two at any scale, from microseconds to
+ * half an hour, at a constant 32 counters. Histograms add up, so per-stream
+ * histograms can be merged into per-provider ones.
+ */
+class latency_histogram {
+public:
+    using duration = std::chrono::microseconds;
+
+    static constexpr size_t BUCKET_COUNT = 32;
+
+    /**
+     * @brief Adds one duration
+     */
+    void add(duration value) noexcept;
+
+    /**
+     * @brief Adds every duration of another histogram
+     */
+    latency_histogram& operator+=(const latency_histogram& other) noexcept;
+
+    [[nodiscard]] uint64_t count() const noexcept { return m_count; }
+    [[nodiscard]] duration max() const noexcept { return duration(m_max_us); }
+
+    /**
+     * @brief Gets the mean duration, zero if empty
+     */
+    [[nodiscard]] duration mean() const noexcept;
+
+    /**
+     * @brief Gets an upper bound of the given percentile
+     * @param fraction Percentile as a fraction, e.g. 0.99
+     * @return The upper edge of the bucket holding the percentile, at most max(); zero if empty
+     */
+    [[nodiscard]] duration percentile(double fraction) const noexcept;
+
+    /**
+     * @brief Gets the count of bucket i, covering [2^(i-1), 2^i) microseconds
+     */
+    [[nodiscard]] uint64_t bucket(size_t index) const noexcept { return m_buckets[index]; }
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> m_buckets{};
+    uint64_t m_count = 0;
+    uint64_t m_sum_us = 0;
+    uint64_t m_max_us = 0;
+};
+
+/**
+ * @brief Timing of one streamed response
+ *
+ * Delivered to the completion callback of chat_api::send_message_stream()
+ * through http_response::timing.
+ */
+struct stream_timing {
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point start;            ///< Request handed to the transport
+    clock::time_point headers_received; ///< First response header; the epoch if none arrived
+    clock::time_point first_delta;      ///< First text delta; the epoch if none arrived
+    clock::time_point last_delta;       ///< Latest text delta
+    clock::time_point end;              ///< Stream complete
+    size_t deltas = 0;                  ///< Text deltas
+    size_t bytes = 0;                   ///< Response body bytes received
+    latency_histogram gaps;             ///< Time between consecutive text deltas
+
+    /**
+     * @brief Records a text delta arriving now
+     */
+    void add_delta(clock::time_point now) noexcept;
+
+    [[nodiscard]] std::optional<std::chrono::microseconds> time_to_headers() const noexcept;
+    [[nodiscard]] std::optional<std::chrono::microseconds> time_to_first_token() const noexcept;
+    [[nodiscard]] std::chrono::microseconds duration() const noexcept;
+};
+
+/**
+ * @brief Aggregated timing of every stream to one provider and model
+ */
+struct stream_metrics_summary {
+    uint64_t streams = 0;
+    uint64_t failures = 0;              ///< Streams that ended with an error
+    uint64_t deltas = 0;
+    uint64_t bytes = 0;
+    latency_histogram time_to_headers;
+    latency_histogram time_to_first_token;
+    latency_histogram inter_token;      ///< Gaps between consecutive text deltas
+    latency_histogram duration;
+};
+
+/**
+ * @class stream_metrics
+ * @brief Registry of stream timing per provider and model
+ *
+ * chat_api records every stream it sends here when the stream ends; replays
+ * of cached streams are not recorded, since they say nothing about the
+ * provider.
+ *
+ * @note Thread-safe. Use instance() for the registry chat_api records to.
+ */
+class stream_metrics {
+public:
+    using key = std::pair<std::string, std::string>; ///< Provider and model
+
+    stream_metrics() = default;
+    stream_metrics(const stream_metrics&) = delete;
+    stream_metrics& operator=(const stream_metrics&) = delete;
+
+    /**
+     * @brief Gets the process-wide registry
+     */
+    static stream_metrics& instance();
+
+    /**
+     * @brief Adds one finished stream
+     * @param provider Provider name
+     * @param model Model name
+     * @param timing The stream's timing
+     * @param succeeded False if the stream ended with an error
+     */
+    void record(const std::string& provider, const std::string& model, const stream_timing& timing,
+                bool succeeded);
+
+    /**
+     * @brief Gets the totals of one provider and model, if it has streamed
+     */
+    [[nodiscard]] std::optional<stream_metrics_summary> get(const std::string& provider,
+                                                            const std::string& model) const;
+
+    /**
+     * @brief Gets the totals of every provider and model
+     */
+    [[nodiscard]] std::map<key, stream_metrics_summary> snapshot() const;
+
+    /**
+     * @brief Forgets everything recorded
+     */
+    void reset();
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<key, stream_metrics_summary> m_summaries;
+};
+
+} // hyni
@@ -0,0 +1,127 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+
+thread_local const hyni::thread_pool* t_current_pool = nullptr;
+thread_local size_t t_worker_index = 0;
+
+size_t hardware_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+thread_pool::thread_pool(size_t threads) {
+    if (threads == 0) {
+        threads = hardware_threads();
+    }
+    m_queues.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        m_queues.push_back(std::make_unique<work_queue>());
+    }
+    m_workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back([this, i] { run(i); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_ready.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+thread_pool& thread_pool::shared() {
+    static thread_pool pool;
+    return pool;
+}
+
+thread_pool& thread_pool::shared_io() {
+    static thread_pool pool(std::clamp<size_t>(4 * hardware_threads(), 8, 64));
+    return pool;
+}
+
+void thread_pool::enqueue(std::function<void()> job) {
+    const size_t index = in_worker()
+        ? t_worker_index
+        : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+    // Counted first, so the count never drops below the number of queued tasks
+    m_pending.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->jobs.push_back(std::move(job));
+    }
+
+    // Taking the lock orders the count with a worker checking it before sleeping
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_ready.notify_one();
+}
+
+bool thread_pool::in_worker() const noexcept {
+    return t_current_pool == this;
+}
+
+bool thread_pool::try_take(size_t index, std::function<void()>& job) {
+    {
+        auto& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.front());
+            own.jobs.pop_front();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        auto& victim = *m_queues[(index + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.back());
+            victim.jobs.pop_back();
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::run(size_t index) {
+    t_current_pool = this;
+    t_worker_index = index;
+    for (;;) {
+        std::function<void()> job;
+        if (try_take(index, job)) {
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock, [this] {
+            return m_stopping || m_pending.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping && m_pending.load(std::memory_order_acquire) == 0) {
+            return; // Stopping and drained
+        }
+    }
+}
+
+} // hyni
@@ -0,0 +1,141 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @class thread_pool
+ * @brief Fixed-size pool of worker threads with work-stealing queues
+ *
+ * Each worker owns a queue. Tasks submitted from outside the pool are spread
+ * over the queues round-robin; tasks submitted by a worker go to its own queue.
+ * A worker takes from the front of its own queue and, when that is empty,
+ * steals from the back of another worker's queue, so a burst of submissions
+ * is picked up by every idle worker without a single queue lock shared by all.
+ *
+ * The destructor drains every queue before joining, so every returned future
+ * becomes ready.
+ *
+ * @note Thread-safe.
+ */
+class thread_pool {
+public:
+    /**
+     * @brief Starts the workers
+     * @param threads Number of workers; 0 uses std::thread::hardware_concurrency()
+     */
+    explicit thread_pool(size_t threads = 0);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /**
+     * @brief Gets the process-wide pool for CPU-bound work such as media encoding
+     *
+     * Sized to the number of hardware threads.
+     */
+    static thread_pool& shared();
+
+    /**
+     * @brief Gets the process-wide pool for blocking requests
+     *
+     * Used by chat_api::send_message_async and http_client::post_async. Its
+     * workers spend most of their time waiting on the network, so it has more
+     * threads than cores: four per hardware thread, at least 8 and at most 64.
+     * Requests beyond that wait in the queues instead of starting new threads.
+     */
+    static thread_pool& shared_io();
+
+    /**
+     * @brief Queues a task
+     * @return Future for the task's result; exceptions are rethrown by get()
+     */
+    template <typename F>
+    [[nodiscard]] auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using result_type = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+        enqueue([packaged] { (*packaged)(); });
+        return future;
+    }
+
+    /**
+     * @brief Queues a task without a future
+     *
+     * For callbacks such as coroutine resumption, where nobody waits for a
+     * result. The task must not throw.
+     */
+    template <typename F>
+    void post(F&& task) {
+        enqueue(std::function<void()>(std::forward<F>(task)));
+    }
+
+    /**
+     * @brief Gets the number of worker threads
+     */
+    [[nodiscard]] size_t size() const noexcept { return m_workers.size(); }
+
+    /**
+     * @brief Gets the number of tasks queued and not yet started
+     */
+    [[nodiscard]] size_t pending() const noexcept { return m_pending.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Gets the number of tasks a worker took from another worker's queue
+     */
+    [[nodiscard]] size_t steals() const noexcept { return m_steals.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Checks whether the calling thread is one of this pool's workers
+     *
+     * A task that blocks on other tasks of the same pool can deadlock it;
+     * callers use this to run such work inline instead.
+     */
+    [[nodiscard]] bool in_worker() const noexcept;
+
+private:
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    void enqueue(std::function<void()> job);
+    [[nodiscard]] bool try_take(size_t index, std::function<void()>& job);
+    void run(size_t index);
+
+    std::vector<std::unique_ptr<work_queue>> m_queues;
+    std::atomic<size_t> m_next_queue{0};
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_steals{0};
+
+    // Idle workers sleep here until a task is queued
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+} // hyni
@@ -0,0 +1,214 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "token_estimator.h"
+#include <cmath>
+
+namespace {
+
+enum char_class : uint8_t {
+    CLASS_NONE = 0,
+    CLASS_LETTER,
+    CLASS_DIGIT,
+    CLASS_SPACE,
+    CLASS_NEWLINE,
+    CLASS_PUNCT,
+    CLASS_NON_ASCII
+};
+
+// Branch-free predicates so that the scanning loop vectorizes
+inline uint32_t is_letter(uint8_t b) noexcept { return static_cast<uint8_t>((b | 0x20) - 'a') < 26; }
+inline uint32_t is_digit(uint8_t b) noexcept { return static_cast<uint8_t>(b - '0') < 10; }
+inline uint32_t is_space(uint8_t b) noexcept { return (b == ' ') | (b == '\t'); }
+inline uint32_t is_newline(uint8_t b) noexcept { return (b == '\n') | (b == '\r'); }
+inline uint32_t is_non_ascii(uint8_t b) noexcept { return b >> 7; }
+
+inline uint8_t classify(uint8_t b) noexcept {
+    if (is_letter(b)) return CLASS_LETTER;
+    if (is_digit(b)) return CLASS_DIGIT;
+    if (is_space(b)) return CLASS_SPACE;
+    if (is_newline(b)) return CLASS_NEWLINE;
+    if (is_non_ascii(b)) return CLASS_NON_ASCII;
+    return CLASS_PUNCT;
+}
+
+// Per-family coefficients. Re-calibrate with benchmarks/token_estimator_bench
+// against usage numbers captured from real responses when tokenizers change.
+hyni::token_model openai_model() {
+    hyni::token_model model; // o200k/cl100k: the generic model
+    return model;
+}
+
+hyni::token_model claude_model() {
+    hyni::token_model model;
+    model.per_word = 0.9;
+    model.per_letter = 0.07;
+    model.per_non_ascii = 0.45;
+    model.scale = 1.08;
+    model.per_message = 5;
+    model.per_image = 1600;
+    return model;
+}
+
+hyni::token_model deepseek_model() {
+    hyni::token_model model;
+    model.per_word = 0.88;
+    model.per_digit = 1.0;       // Digits are tokenized one by one
+    model.per_non_ascii = 0.3;   // Large CJK vocabulary
+    return model;
+}
+
+hyni::token_model mistral_model() {
+    hyni::token_model model;     // SentencePiece, 32k vocabulary
+    model.per_word = 0.95;
+    model.per_letter = 0.09;
+    model.per_digit = 1.0;
+    model.per_punct = 1.0;
+    model.per_extra_space = 1.0;
+    model.per_non_ascii = 0.6;
+    model.scale = 1.05;
+    return model;
+}
+
+} // anonymous namespace
+
+namespace hyni {
+
+token_estimator::text_stats& token_estimator::text_stats::operator+=(const text_stats& other) noexcept {
+    letters += other.letters;
+    word_runs += other.word_runs;
+    digits += other.digits;
+    punct += other.punct;
+    spaces += other.spaces;
+    space_runs += other.space_runs;
+    newline_runs += other.newline_runs;
+    non_ascii += other.non_ascii;
+    return *this;
+}
+
+token_estimator::text_stats token_estimator::scan(std::string_view text,
+                                                  uint8_t& last_class) noexcept {
+    text_stats stats;
+    if (text.empty()) {
+        return stats;
+    }
+
+    const auto* data = reinterpret_cast<const uint8_t*>(text.data());
+    const size_t size = text.size();
+
+    // The first byte continues a run from the previous piece of text
+    const uint8_t first = classify(data[0]);
+    stats.letters += first == CLASS_LETTER;
+    stats.word_runs += first == CLASS_LETTER && last_class != CLASS_LETTER;
+    stats.digits += first == CLASS_DIGIT;
+    stats.spaces += first == CLASS_SPACE;
+    stats.space_runs += first == CLASS_SPACE && last_class != CLASS_SPACE;
+    stats.newline_runs += first == CLASS_NEWLINE && last_class != CLASS_NEWLINE;
+    stats.non_ascii += first == CLASS_NON_ASCII;
+    stats.punct += first == CLASS_PUNCT;
+
+    // Every run start depends only on the current and the previous byte, so the
+    // loop carries no state and the compiler turns it into SIMD reductions.
+    uint64_t letters = 0, word_runs = 0, digits = 0, spaces = 0;
+    uint64_t space_runs = 0, newline_runs = 0, non_ascii = 0, punct = 0;
+    for (size_t i = 1; i < size; ++i) {
+        const uint8_t b = data[i];
+        const uint8_t p = data[i - 1];
+        const uint32_t letter = is_letter(b);
+        const uint32_t digit = is_digit(b);
+        const uint32_t space = is_space(b);
+        const uint32_t newline = is_newline(b);
+        const uint32_t high = is_non_ascii(b);
+
+        letters += letter;
+        word_runs += letter & (is_letter(p) ^ 1);
+        digits += digit;
+        spaces += space;
+        space_runs += space & (is_space(p) ^ 1);
+        newline_runs += newline & (is_newline(p) ^ 1);
+        non_ascii += high;
+        punct += (letter | digit | space | newline | high) ^ 1;
+    }
+
+    stats.letters += letters;
+    stats.word_runs += word_runs;
+    stats.digits += digits;
+    stats.spaces += spaces;
+    stats.space_runs += space_runs;
+    stats.newline_runs += newline_runs;
+    stats.non_ascii += non_ascii;
+    stats.punct += punct;
+
+    last_class = classify(data[size - 1]);
+    return stats;
+}
+
+size_t token_estimator::tokens_for(const text_stats& stats) const noexcept {
+    const double extra_spaces = static_cast<double>(stats.spaces - stats.space_runs);
+    const double estimate = m_model.per_word * static_cast<double>(stats.word_runs) +
+                            m_model.per_letter * static_cast<double>(stats.letters) +
+                            m_model.per_digit * static_cast<double>(stats.digits) +
+                            m_model.per_punct * static_cast<double>(stats.punct) +
+                            m_model.per_newline_run * static_cast<double>(stats.newline_runs) +
+                            m_model.per_extra_space * extra_spaces +
+                            m_model.per_non_ascii * static_cast<double>(stats.non_ascii);
+    return static_cast<size_t>(std::ceil(estimate * m_model.scale));
+}
+
+size_t token_estimator::count(std::string_view text) const noexcept {
+    uint8_t last_class = CLASS_NONE;
+    return tokens_for(scan(text, last_class));
+}
+
+size_t token_estimator::count_message(const nlohmann::json& message) const {
+    text_stats stats;
+    size_t images = 0;
+
+    auto visit = [&](const auto& self, const nlohmann::json& node) -> void {
+        if (node.is_string()) {
+            uint8_t last_class = CLASS_NONE;
+            stats += scan(node.get_ref<const std::string&>(), last_class);
+        } else if (node.is_object()) {
+            auto type_it = node.find("type");
+            if (type_it != node.end() && type_it->is_string() &&
+                type_it->get_ref<const std::string&>().starts_with("image")) {
+                ++images;
+                return;
+            }
+            for (const auto& [key, value] : node.items()) {
+                if (key != "type" && key != "role") {
+                    self(self, value);
+                }
+            }
+        } else if (node.is_array()) {
+            for (const auto& item : node) {
+                self(self, item);
+            }
+        }
+    };
+    visit(visit, message);
+
+    return tokens_for(stats) + m_model.per_message + images * m_model.per_image;
+}
+
+token_estimator token_estimator::for_provider(std::string_view provider_name) noexcept {
+    if (provider_name == "openai") return token_estimator(openai_model());
+    if (provider_name == "claude") return token_estimator(claude_model());
+    if (provider_name == "deepseek") return token_estimator(deepseek_model());
+    if (provider_name == "mistral") return token_estimator(mistral_model());
+    return token_estimator();
+}
+
+void token_estimator::counter::append(std::string_view text) noexcept {
+    m_stats += scan(text, m_last_class);
+}
+
+} // hyni
@@ -0,0 +1,152 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @brief Calibrated coefficients of the token estimation model for one tokenizer family
+ *
+ * The estimate is a linear combination of character class statistics collected in a
+ * single pass over the text. The coefficients approximate how a BPE tokenizer splits
+ * words, numbers, punctuation, whitespace and non-ASCII text.
+ */
+struct token_model {
+    double per_word = 0.85;         ///< Tokens per run of ASCII letters
+    double per_letter = 0.06;       ///< Additional tokens per ASCII letter (long words split)
+    double per_digit = 0.34;        ///< Tokens per digit (numbers split into short groups)
+    double per_punct = 0.9;         ///< Tokens per punctuation or symbol byte
+    double per_newline_run = 1.0;   ///< Tokens per run of line breaks
+    double per_extra_space = 0.25;  ///< Tokens per space beyond the first in a run
+    double per_non_ascii = 0.4;     ///< Tokens per non-ASCII byte
+    double scale = 1.0;             ///< Final multiplier for the whole estimate
+    size_t per_message = 4;         ///< Fixed overhead per chat message
+    size_t per_image = 1600;        ///< Tokens charged per attached image
+};
+
+/**
+ * @class token_estimator
+ * @brief Fast local token count estimate for a provider's tokenizer family
+ *
+ * No vocabulary is shipped: counting classifies every byte with branch-free range
+ * checks that the compiler vectorizes, so throughput is in the GB/s range. Use
+ * token_estimator::counter to count text that arrives in pieces (e.g. streamed
+ * deltas); it yields the same result as counting the concatenated text at once.
+ *
+ * @note Thread-safe. Estimators are immutable after construction.
+ */
+class token_estimator {
+public:
+    /**
+     * @brief Character class statistics of a text
+     */
+    struct text_stats {
+        uint64_t letters = 0;
+        uint64_t word_runs = 0;
+        uint64_t digits = 0;
+        uint64_t punct = 0;
+        uint64_t spaces = 0;
+        uint64_t space_runs = 0;
+        uint64_t newline_runs = 0;
+        uint64_t non_ascii = 0;
+
+        text_stats& operator+=(const text_stats& other) noexcept;
+    };
+
+    /**
+     * @brief Incremental counter for text that is appended in pieces
+     */
+    class counter {
+    public:
+        explicit counter(const token_estimator& estimator) noexcept : m_estimator(&estimator) {}
+
+        /**
+         * @brief Adds the next piece of text
+         */
+        void append(std::string_view text) noexcept;
+
+        /**
+         * @brief Gets the estimated token count of everything appended so far
+         */
+        [[nodiscard]] size_t tokens() const noexcept { return m_estimator->tokens_for(m_stats); }
+
+        /**
+         * @brief Gets the raw statistics collected so far
+         */
+        [[nodiscard]] const text_stats& stats() const noexcept { return m_stats; }
+
+    private:
+        const token_estimator* m_estimator;
+        text_stats m_stats;
+        uint8_t m_last_class = 0;
+    };
+
+    /**
+     * @brief Constructs an estimator with the generic model
+     */
+    token_estimator() = default;
+
+    /**
+     * @brief Constructs an estimator with the given model
+     */
+    explicit token_estimator(const token_model& model) noexcept : m_model(model) {}
+
+    /**
+     * @brief Creates the estimator for a provider, as named in the schema's provider.name
+     * @param provider_name Provider name, e.g. "claude" or "openai"
+     * @return Estimator for the provider's tokenizer family, generic if unknown
+     */
+    [[nodiscard]] static token_estimator for_provider(std::string_view provider_name) noexcept;
+
+    /**
+     * @brief Estimates the token count of a text
+     */
+    [[nodiscard]] size_t count(std::string_view text) const noexcept;
+
+    /**
+     * @brief Estimates the token count of a chat message in any provider format
+     *
+     * Counts every string in the message except structural fields ("type", "role"),
+     * charges image content parts at token_model::per_image and adds the per-message
+     * overhead.
+     */
+    [[nodiscard]] size_t count_message(const nlohmann::json& message) const;
+
+    /**
+     * @brief Converts collected statistics into a token estimate
+     */
+    [[nodiscard]] size_t tokens_for(const text_stats& stats) const noexcept;
+
+    /**
+     * @brief Collects character class statistics of a text
+     * @param text The text to scan
+     * @param last_class Class of the byte preceding the text; updated to the class
+     *                   of the last byte so that runs continue across calls
+     */
+    static text_stats scan(std::string_view text, uint8_t& last_class) noexcept;
+
+    /**
+     * @brief Gets the model in use
+     */
+    [[nodiscard]] const token_model& model() const noexcept { return m_model; }
+
+private:
+    token_model m_model;
+};
+
+} // hyni
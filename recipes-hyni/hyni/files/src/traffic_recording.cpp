@@ -0,0 +1,253 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "traffic_recording.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace hyni {
+
+namespace {
+
+constexpr char TRACE_MAGIC[8] = {'H', 'Y', 'N', 'I', 'T', 'R', 'C', '1'};
+
+// Longest sleep between polls of a cancel_check
+constexpr auto CANCEL_POLL = std::chrono::milliseconds(10);
+
+// Bodies and chunks are stored as CBOR byte strings: stream chunks may split
+// a UTF-8 sequence
+nlohmann::json bytes(const std::string& text) {
+    return nlohmann::json::binary(std::vector<uint8_t>(text.begin(), text.end()));
+}
+
+std::string text(const nlohmann::json& value) {
+    const auto& data = value.get_binary();
+    return std::string(data.begin(), data.end());
+}
+
+std::string request_key(const std::string& url, const std::string& body) {
+    std::string key;
+    key.reserve(url.size() + 1 + body.size());
+    key += url;
+    key += '\n';
+    key += body;
+    return key;
+}
+
+// Waits until the deadline; false if cancelled first
+bool wait_until(std::chrono::steady_clock::time_point deadline, const progress_callback& cancel_check) {
+    for (;;) {
+        if (cancel_check && cancel_check()) {
+            return false;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return true;
+        }
+        std::this_thread::sleep_for(cancel_check ? std::min<std::chrono::steady_clock::duration>(
+                                                       deadline - now, CANCEL_POLL)
+                                                 : deadline - now);
+    }
+}
+
+http_response cancelled_response() {
+    http_response response;
+    response.error_message = "Request cancelled";
+    return response;
+}
+
+http_response final_response(const recorded_exchange& exchange) {
+    http_response response;
+    response.status_code = exchange.status_code;
+    response.headers = exchange.headers;
+    response.error_message = exchange.error_message;
+    response.success = exchange.error_message.empty() &&
+                       exchange.status_code >= 200 && exchange.status_code < 300;
+    return response;
+}
+
+} // anonymous namespace
+
+traffic_recorder::traffic_recorder(const std::filesystem::path& path)
+    : m_file(path, std::ios::binary | std::ios::trunc) {
+    if (!m_file || !m_file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC)).flush()) {
+        throw std::runtime_error("Cannot write traffic trace " + path.string());
+    }
+}
+
+void traffic_recorder::record(const recorded_exchange& exchange) {
+    nlohmann::json record = {
+        {"url", exchange.url},
+        {"request", bytes(exchange.request_body)},
+        {"streamed", exchange.streamed},
+        {"status", exchange.status_code},
+        {"headers", exchange.headers},
+        {"body", bytes(exchange.body)},
+        {"duration_us", exchange.duration.count()},
+        {"error", exchange.error_message},
+    };
+    auto& chunks = record["chunks"] = nlohmann::json::array();
+    for (const auto& chunk : exchange.chunks) {
+        chunks.push_back({chunk.at.count(), bytes(chunk.data)});
+    }
+    const std::vector<uint8_t> encoded = nlohmann::json::to_cbor(record);
+
+    // Length prefix in little-endian byte order
+    const auto size = static_cast<uint32_t>(encoded.size());
+    const char prefix[4] = {static_cast<char>(size), static_cast<char>(size >> 8),
+                            static_cast<char>(size >> 16), static_cast<char>(size >> 24)};
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.write(prefix, sizeof(prefix));
+    m_file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    if (!m_file.flush()) {
+        throw std::runtime_error("Cannot write traffic trace");
+    }
+    ++m_count;
+}
+
+size_t traffic_recorder::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+traffic_replay::traffic_replay(const std::filesystem::path& path, replay_options options)
+    : traffic_replay(load(path), options) {
+}
+
+traffic_replay::traffic_replay(std::vector<recorded_exchange> exchanges, replay_options options)
+    : m_exchanges(std::move(exchanges)), m_options(options) {
+    if (m_options.speed < 0) {
+        throw std::invalid_argument("traffic_replay: speed must not be negative");
+    }
+    for (size_t i = 0; i < m_exchanges.size(); ++i) {
+        m_by_request[request_key(m_exchanges[i].url, m_exchanges[i].request_body)].push_back(i);
+    }
+}
+
+std::vector<recorded_exchange> traffic_replay::load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(TRACE_MAGIC)];
+    if (!file || !file.read(magic, sizeof(magic)) || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a traffic trace: " + path.string());
+    }
+
+    std::vector<recorded_exchange> exchanges;
+    unsigned char prefix[4];
+    std::vector<uint8_t> encoded;
+    while (file.read(reinterpret_cast<char*>(prefix), sizeof(prefix))) {
+        const uint32_t size = prefix[0] | (prefix[1] << 8) | (prefix[2] << 16) |
+                              (static_cast<uint32_t>(prefix[3]) << 24);
+        encoded.resize(size);
+        if (!file.read(reinterpret_cast<char*>(encoded.data()), size)) {
+            break; // Cut off while recording
+        }
+        try {
+            const auto record = nlohmann::json::from_cbor(encoded);
+            recorded_exchange exchange;
+            exchange.url = record.at("url").get<std::string>();
+            exchange.request_body = text(record.at("request"));
+            exchange.streamed = record.at("streamed").get<bool>();
+            exchange.status_code = record.at("status").get<long>();
+            exchange.headers = record.at("headers").get<std::unordered_map<std::string, std::string>>();
+            exchange.body = text(record.at("body"));
+            exchange.duration = std::chrono::microseconds(record.at("duration_us").get<int64_t>());
+            exchange.error_message = record.at("error").get<std::string>();
+            for (const auto& chunk : record.at("chunks")) {
+                exchange.chunks.push_back({std::chrono::microseconds(chunk.at(0).get<int64_t>()),
+                                           text(chunk.at(1))});
+            }
+            exchanges.push_back(std::move(exchange));
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error("Corrupt traffic trace " + path.string() + ": " + e.what());
+        }
+    }
+    return exchanges;
+}
+
+const recorded_exchange* traffic_replay::next(const std::string& url, const std::string& body) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_exchanges.empty()) {
+        return nullptr;
+    }
+    if (!m_options.match_requests) {
+        return &m_exchanges[m_cursor++ % m_exchanges.size()];
+    }
+    const std::string key = request_key(url, body);
+    auto found = m_by_request.find(key);
+    if (found == m_by_request.end()) {
+        return nullptr;
+    }
+    size_t& cursor = m_cursors[key];
+    return &m_exchanges[found->second[cursor++ % found->second.size()]];
+}
+
+std::chrono::steady_clock::duration traffic_replay::scaled(std::chrono::microseconds at) const {
+    if (m_options.speed == 0) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::micro>(at.count() / m_options.speed));
+}
+
+http_response traffic_replay::respond(const std::string& url, const std::string& body,
+                                      const progress_callback& cancel_check) {
+    const auto start = std::chrono::steady_clock::now();
+    const recorded_exchange* exchange = next(url, body);
+    if (!exchange) {
+        http_response response;
+        response.error_message = "No recorded response for request to " + url;
+        return response;
+    }
+    if (!wait_until(start + scaled(exchange->duration), cancel_check)) {
+        return cancelled_response();
+    }
+
+    http_response response = final_response(*exchange);
+    response.body = exchange->body;
+    for (const auto& chunk : exchange->chunks) {
+        response.body += chunk.data; // A stream answered as a whole
+    }
+    return response;
+}
+
+http_response traffic_replay::stream(const std::string& url, const std::string& body,
+                                     const stream_view_callback& on_chunk,
+                                     const progress_callback& cancel_check) {
+    const auto start = std::chrono::steady_clock::now();
+    const recorded_exchange* exchange = next(url, body);
+    if (!exchange) {
+        http_response response;
+        response.error_message = "No recorded response for request to " + url;
+        return response;
+    }
+
+    for (const auto& chunk : exchange->chunks) {
+        if (!wait_until(start + scaled(chunk.at), cancel_check)) {
+            return cancelled_response();
+        }
+        if (on_chunk) {
+            on_chunk(chunk.data);
+        }
+    }
+    if (!wait_until(start + scaled(exchange->duration), cancel_check)) {
+        return cancelled_response();
+    }
+    if (!exchange->body.empty() && on_chunk) {
+        on_chunk(exchange->body); // A complete response answered as a stream
+    }
+    return final_response(*exchange);
+}
+
+} // hyni
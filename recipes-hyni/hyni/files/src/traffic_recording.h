@@ -0,0 +1,166 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "http_client.h"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief A piece of a streamed response and when it arrived
+ */
+struct recorded_chunk {
+    std::chrono::microseconds at{0}; ///< Time since the request was sent
+    std::string data;
+};
+
+/**
+ * @brief One request and its response as seen by http_client
+ *
+ * Request headers are not recorded, so traces carry no API keys.
+ */
+struct recorded_exchange {
+    std::string url;
+    std::string request_body;
+    bool streamed = false;
+    long status_code = 0;
+    std::unordered_map<std::string, std::string> headers; ///< Response headers
+    std::string body;                    ///< Response body; empty when streamed
+    std::vector<recorded_chunk> chunks;  ///< Stream chunks with their timing
+    std::chrono::microseconds duration{0}; ///< Time until the response was complete
+    std::string error_message;
+};
+
+/**
+ * @class traffic_recorder
+ * @brief Writes http_client traffic to a trace file
+ *
+ * The trace is a small header followed by one length-prefixed CBOR record per
+ * exchange. Records are flushed as they are written, so a trace stays usable
+ * if the process ends abruptly.
+ *
+ * @note Thread-safe
+ */
+class traffic_recorder {
+public:
+    /**
+     * @brief Creates or truncates a trace file
+     * @throws std::runtime_error If the file cannot be written
+     */
+    explicit traffic_recorder(const std::filesystem::path& path);
+
+    traffic_recorder(const traffic_recorder&) = delete;
+    traffic_recorder& operator=(const traffic_recorder&) = delete;
+
+    /**
+     * @brief Appends an exchange to the trace
+     * @throws std::runtime_error If the write fails
+     */
+    void record(const recorded_exchange& exchange);
+
+    /**
+     * @brief Gets the number of exchanges recorded so far
+     */
+    [[nodiscard]] size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::ofstream m_file;
+    size_t m_count = 0;
+};
+
+/**
+ * @brief Settings of a traffic_replay
+ */
+struct replay_options {
+    double speed = 1.0;          ///< Playback rate; 2 replays twice as fast, 0 without any delay
+    bool match_requests = true;  ///< Answer by URL and request body; otherwise in recorded order
+};
+
+/**
+ * @class traffic_replay
+ * @brief Answers http_client requests from a recorded trace
+ *
+ * Responses are played back with their recorded latency and, for streams,
+ * the recorded gaps between chunks, scaled by replay_options::speed. With
+ * match_requests, repeated identical requests cycle through the exchanges
+ * recorded for them; requests that were never recorded fail like a
+ * connection error. Without it, every request gets the next exchange of the
+ * trace, which replays production traces against different prompts.
+ *
+ * @note Thread-safe
+ */
+class traffic_replay {
+public:
+    /**
+     * @brief Loads a trace written by traffic_recorder
+     * @throws std::runtime_error If the file cannot be read or is not a trace
+     */
+    explicit traffic_replay(const std::filesystem::path& path, replay_options options = {});
+
+    /**
+     * @brief Replays the given exchanges
+     */
+    explicit traffic_replay(std::vector<recorded_exchange> exchanges, replay_options options = {});
+
+    traffic_replay(const traffic_replay&) = delete;
+    traffic_replay& operator=(const traffic_replay&) = delete;
+
+    /**
+     * @brief Reads all exchanges of a trace file
+     * @throws std::runtime_error If the file cannot be read or is not a trace
+     */
+    [[nodiscard]] static std::vector<recorded_exchange> load(const std::filesystem::path& path);
+
+    /**
+     * @brief Answers a request as a complete response
+     * @param cancel_check Polled while waiting; returning true cancels the response
+     */
+    [[nodiscard]] http_response respond(const std::string& url, const std::string& body,
+                                        const progress_callback& cancel_check = nullptr);
+
+    /**
+     * @brief Answers a request as a stream of chunks
+     * @param on_chunk Invoked on the calling thread with each chunk when it is due
+     * @param cancel_check Polled while waiting; returning true ends the stream
+     * @return The final response, with an empty body
+     */
+    http_response stream(const std::string& url, const std::string& body,
+                         const stream_view_callback& on_chunk,
+                         const progress_callback& cancel_check = nullptr);
+
+    /**
+     * @brief Gets the recorded exchanges
+     */
+    [[nodiscard]] const std::vector<recorded_exchange>& exchanges() const noexcept { return m_exchanges; }
+
+private:
+    const recorded_exchange* next(const std::string& url, const std::string& body);
+    [[nodiscard]] std::chrono::steady_clock::duration scaled(std::chrono::microseconds at) const;
+
+    std::vector<recorded_exchange> m_exchanges;
+    replay_options m_options;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::vector<size_t>> m_by_request; ///< Exchange indexes per request
+    std::unordered_map<std::string, size_t> m_cursors;                 ///< Next use per request
+    size_t m_cursor = 0;                                               ///< Next exchange in order
+};
+
+} // hyni
@@ -0,0 +1,233 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "usage_accounting.h"
+#include "hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <functional>
+
+namespace hyni {
+
+namespace {
+
+uint64_t count_at(const nlohmann::json& object, const char* key) {
+    auto it = object.find(key);
+    if (it == object.end() || !it->is_number_integer()) {
+        return 0;
+    }
+    return it->is_number_unsigned() ? it->get<uint64_t>() : static_cast<uint64_t>(std::max<int64_t>(it->get<int64_t>(), 0));
+}
+
+uint64_t combine(uint64_t seed, std::string_view part) {
+    // boost::hash_combine over the hash of each part
+    return seed ^ (std::hash<std::string_view>{}(part) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+} // anonymous namespace
+
+token_usage token_usage::from_json(const nlohmann::json& usage) {
+    token_usage result;
+    if (!usage.is_object()) {
+        return result;
+    }
+    if (usage.contains("input_tokens") || usage.contains("output_tokens")) {
+        // Anthropic counts cache reads and writes apart from input_tokens
+        result.cached_tokens = count_at(usage, "cache_read_input_tokens");
+        result.input_tokens = count_at(usage, "input_tokens") + result.cached_tokens +
+                              count_at(usage, "cache_creation_input_tokens");
+        result.output_tokens = count_at(usage, "output_tokens");
+    } else {
+        result.input_tokens = count_at(usage, "prompt_tokens");
+        result.output_tokens = count_at(usage, "completion_tokens");
+        if (auto details = usage.find("prompt_tokens_details"); details != usage.end() && details->is_object()) {
+            result.cached_tokens = count_at(*details, "cached_tokens");
+        } else {
+            result.cached_tokens = count_at(usage, "prompt_cache_hit_tokens");
+        }
+    }
+    return result;
+}
+
+void token_usage::update(const token_usage& report) noexcept {
+    input_tokens = std::max(input_tokens, report.input_tokens);
+    output_tokens = std::max(output_tokens, report.output_tokens);
+    cached_tokens = std::max(cached_tokens, report.cached_tokens);
+}
+
+token_usage& token_usage::operator+=(const token_usage& other) noexcept {
+    input_tokens += other.input_tokens;
+    output_tokens += other.output_tokens;
+    cached_tokens += other.cached_tokens;
+    return *this;
+}
+
+bool usage_filter::matches(const usage_entry& entry) const noexcept {
+    return (!provider || *provider == entry.provider) && (!model || *model == entry.model) &&
+           (!api_key || *api_key == entry.api_key) && (!tag || *tag == entry.tag);
+}
+
+usage_totals usage_snapshot::total(const usage_filter& filter) const noexcept {
+    usage_totals sum;
+    for (const auto& entry : entries) {
+        if (filter.matches(entry)) {
+            sum.requests += entry.totals.requests;
+            sum.usage += entry.totals.usage;
+        }
+    }
+    return sum;
+}
+
+// Immutable once published in a slot
+struct usage_ledger::slot_key {
+    uint64_t hash;
+    std::string provider;
+    std::string model;
+    std::string api_key;
+    std::string tag;
+
+    [[nodiscard]] bool equals(uint64_t other_hash, std::string_view other_provider, std::string_view other_model,
+                              std::string_view other_api_key, std::string_view other_tag) const noexcept {
+        return hash == other_hash && provider == other_provider && model == other_model &&
+               api_key == other_api_key && tag == other_tag;
+    }
+};
+
+// One cache line per slot, so hot keys do not share one
+struct alignas(64) usage_ledger::slot {
+    std::atomic<const slot_key*> key{nullptr};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> input_tokens{0};
+    std::atomic<uint64_t> output_tokens{0};
+    std::atomic<uint64_t> cached_tokens{0};
+
+    [[nodiscard]] usage_totals load() const noexcept {
+        usage_totals totals;
+        totals.requests = requests.load(std::memory_order_relaxed);
+        totals.usage.input_tokens = input_tokens.load(std::memory_order_relaxed);
+        totals.usage.output_tokens = output_tokens.load(std::memory_order_relaxed);
+        totals.usage.cached_tokens = cached_tokens.load(std::memory_order_relaxed);
+        return totals;
+    }
+};
+
+usage_ledger::usage_ledger(size_t capacity)
+    : m_mask(std::bit_ceil(std::max<size_t>(capacity, 1)) - 1)
+    , m_slots(new slot[m_mask + 1])
+    , m_overflow(std::make_unique<slot>()) {
+    m_overflow->key.store(new slot_key{0, "*", "*", "*", "*"}, std::memory_order_relaxed);
+}
+
+usage_ledger::~usage_ledger() {
+    for (size_t i = 0; i <= m_mask; ++i) {
+        delete m_slots[i].key.load(std::memory_order_relaxed);
+    }
+    delete m_overflow->key.load(std::memory_order_relaxed);
+}
+
+usage_ledger& usage_ledger::instance() {
+    static usage_ledger ledger;
+    return ledger;
+}
+
+std::string usage_ledger::api_key_id(std::string_view api_key) {
+    if (api_key.empty()) {
+        return {};
+    }
+    // The whole key identifies it; the tail only helps a reader recognise it
+    char id[9];
+    std::snprintf(id, sizeof(id), "%08x", static_cast<unsigned>(content_hash(api_key) >> 32));
+    std::string result = id;
+    if (api_key.size() >= 8) {
+        result += "...";
+        result += api_key.substr(api_key.size() - 4);
+    }
+    return result;
+}
+
+usage_ledger::slot& usage_ledger::find_slot(uint64_t hash, std::string_view provider, std::string_view model,
+                                            std::string_view api_key, std::string_view tag) {
+    std::unique_ptr<slot_key> claim;
+    for (size_t probe = 0, index = hash & m_mask; probe <= m_mask; ++probe, index = (index + 1) & m_mask) {
+        slot& candidate = m_slots[index];
+        const slot_key* key = candidate.key.load(std::memory_order_acquire);
+        if (!key) {
+            if (!claim) {
+                claim.reset(new slot_key{hash, std::string(provider), std::string(model),
+                                         std::string(api_key), std::string(tag)});
+            }
+            if (candidate.key.compare_exchange_strong(key, claim.get(), std::memory_order_acq_rel,
+                                                      std::memory_order_acquire)) {
+                claim.release();
+                return candidate;
+            }
+            // Lost the race; key now holds the winner's
+        }
+        if (key->equals(hash, provider, model, api_key, tag)) {
+            return candidate;
+        }
+    }
+    return *m_overflow;
+}
+
+void usage_ledger::record(std::string_view provider, std::string_view model, std::string_view api_key,
+                          std::string_view tag, const token_usage& usage) {
+    const std::string key_id = api_key_id(api_key);
+    uint64_t hash = 0;
+    for (std::string_view part : {provider, model, std::string_view(key_id), tag}) {
+        hash = combine(hash, part);
+    }
+
+    slot& target = find_slot(hash, provider, model, key_id, tag);
+    target.requests.fetch_add(1, std::memory_order_relaxed);
+    target.input_tokens.fetch_add(usage.input_tokens, std::memory_order_relaxed);
+    target.output_tokens.fetch_add(usage.output_tokens, std::memory_order_relaxed);
+    target.cached_tokens.fetch_add(usage.cached_tokens, std::memory_order_relaxed);
+}
+
+usage_snapshot usage_ledger::snapshot() const {
+    usage_snapshot result;
+    const auto add = [&result](const slot& entry) {
+        const slot_key* key = entry.key.load(std::memory_order_acquire);
+        if (!key) {
+            return;
+        }
+        usage_totals totals = entry.load();
+        if (totals.requests > 0) {
+            result.entries.push_back({key->provider, key->model, key->api_key, key->tag, totals});
+        }
+    };
+    for (size_t i = 0; i <= m_mask; ++i) {
+        add(m_slots[i]);
+    }
+    add(*m_overflow);
+    return result;
+}
+
+usage_totals usage_ledger::total(const usage_filter& filter) const {
+    return snapshot().total(filter);
+}
+
+void usage_ledger::reset() noexcept {
+    const auto clear = [](slot& entry) {
+        entry.requests.store(0, std::memory_order_relaxed);
+        entry.input_tokens.store(0, std::memory_order_relaxed);
+        entry.output_tokens.store(0, std::memory_order_relaxed);
+        entry.cached_tokens.store(0, std::memory_order_relaxed);
+    };
+    for (size_t i = 0; i <= m_mask; ++i) {
+        clear(m_slots[i]);
+    }
+    clear(*m_overflow);
+}
+
+} // hyni
@@ -0,0 +1,184 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Token counts of one response, in a provider-neutral form
+ */
+struct token_usage {
+    uint64_t input_tokens = 0;   ///< All prompt tokens, cached ones included
+    uint64_t output_tokens = 0;
+    uint64_t cached_tokens = 0;  ///< Prompt tokens read from the provider's prompt cache
+
+    /**
+     * @brief Reads a provider's usage object
+     *
+     * Understands Anthropic's input_tokens/output_tokens with
+     * cache_read_input_tokens and cache_creation_input_tokens, and the
+     * prompt_tokens/completion_tokens of OpenAI-style APIs with
+     * prompt_tokens_details.cached_tokens or DeepSeek's prompt_cache_hit_tokens.
+     * Missing counts are zero.
+     */
+    [[nodiscard]] static token_usage from_json(const nlohmann::json& usage);
+
+    /**
+     * @brief Folds in a usage report of a stream
+     *
+     * Streams report cumulative counts, possibly split over several events
+     * (Anthropic sends the input in message_start and the output in
+     * message_delta), so each count keeps its largest value.
+     */
+    void update(const token_usage& report) noexcept;
+
+    token_usage& operator+=(const token_usage& other) noexcept;
+
+    [[nodiscard]] uint64_t total_tokens() const noexcept { return input_tokens + output_tokens; }
+    [[nodiscard]] bool empty() const noexcept { return total_tokens() == 0 && cached_tokens == 0; }
+};
+
+/**
+ * @brief Requests and tokens accounted to one key, or summed over several
+ */
+struct usage_totals {
+    uint64_t requests = 0;
+    token_usage usage;
+};
+
+/**
+ * @brief The totals of one provider, model, API key and tag
+ */
+struct usage_entry {
+    std::string provider;
+    std::string model;
+    std::string api_key;   ///< Redacted, see usage_ledger::api_key_id()
+    std::string tag;
+    usage_totals totals;
+};
+
+/**
+ * @brief Selects entries of a usage_snapshot; unset fields match everything
+ */
+struct usage_filter {
+    std::optional<std::string> provider;
+    std::optional<std::string> model;
+    std::optional<std::string> api_key;  ///< Redacted, see usage_ledger::api_key_id()
+    std::optional<std::string> tag;
+
+    [[nodiscard]] bool matches(const usage_entry& entry) const noexcept;
+};
+
+/**
+ * @brief A point-in-time copy of a usage_ledger
+ */
+struct usage_snapshot {
+    std::vector<usage_entry> entries;
+
+    /**
+     * @brief Sums the entries selected by a filter
+     */
+    [[nodiscard]] usage_totals total(const usage_filter& filter = {}) const noexcept;
+};
+
+/**
+ * @class usage_ledger
+ * @brief Lock-free token accounting per provider, model, API key and tag
+ *
+ * Each distinct provider, model, API key and caller-supplied tag gets a slot
+ * in a fixed-size open-addressing table. A slot is claimed once with a
+ * compare-and-swap of its key and then only sees relaxed atomic additions,
+ * so recording never blocks and concurrent requests to the same key contend
+ * on nothing but a cache line. When every slot is taken, further keys are
+ * accounted under an overflow entry with the provider "*", keeping the
+ * totals right.
+ *
+ * Snapshots read the counters without stopping writers; each count is exact
+ * but counts of a response recorded at that moment may be partly included.
+ *
+ * @note Thread-safe. Use instance() for the ledger chat_api records to.
+ */
+class usage_ledger {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    /**
+     * @brief Creates a ledger
+     * @param capacity Distinct keys it can hold; rounded up to a power of two
+     */
+    explicit usage_ledger(size_t capacity = DEFAULT_CAPACITY);
+    ~usage_ledger();
+
+    usage_ledger(const usage_ledger&) = delete;
+    usage_ledger& operator=(const usage_ledger&) = delete;
+
+    /**
+     * @brief Gets the process-wide ledger
+     */
+    static usage_ledger& instance();
+
+    /**
+     * @brief Gets the redacted form under which an API key is accounted
+     * @return Eight hex digits of the whole key's hash, then "..." and its last four
+     *         characters; just the digits for keys shorter than eight, empty for no key
+     */
+    [[nodiscard]] static std::string api_key_id(std::string_view api_key);
+
+    /**
+     * @brief Accounts one response
+     * @param provider Provider name
+     * @param model Model name
+     * @param api_key The API key the request was sent with; only its api_key_id() is kept
+     * @param tag Caller-supplied tag, e.g. a tenant or feature; may be empty
+     * @param usage The response's token counts
+     */
+    void record(std::string_view provider, std::string_view model, std::string_view api_key,
+                std::string_view tag, const token_usage& usage);
+
+    /**
+     * @brief Copies every non-empty entry
+     */
+    [[nodiscard]] usage_snapshot snapshot() const;
+
+    /**
+     * @brief Sums the entries selected by a filter, e.g. for a budget check
+     */
+    [[nodiscard]] usage_totals total(const usage_filter& filter = {}) const;
+
+    /**
+     * @brief Zeroes every count; keys stay allocated
+     */
+    void reset() noexcept;
+
+private:
+    struct slot_key;
+    struct slot;
+
+    [[nodiscard]] slot& find_slot(uint64_t hash, std::string_view provider, std::string_view model,
+                                  std::string_view api_key, std::string_view tag);
+
+    size_t m_mask;
+    std::unique_ptr<slot[]> m_slots;
+    std::unique_ptr<slot> m_overflow;
+};
+
+} // hyni
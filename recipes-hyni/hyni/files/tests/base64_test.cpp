@@ -0,0 +1,188 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/base64.h"
+#include <algorithm>
+#include <random>
+
+using namespace hyni;
+
+namespace {
+
+// The original byte-at-a-time encoder, kept as the reference
+std::string reference_encode(const std::string& input) {
+    static constexpr char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const auto* data = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t len = input.size();
+    std::string ret;
+    for (size_t i = 0; i < len;) {
+        size_t bytes_left = len - i;
+        uint32_t a = data[i++];
+        uint32_t b = (bytes_left > 1) ? data[i++] : 0;
+        uint32_t c = (bytes_left > 2) ? data[i++] : 0;
+        uint32_t triple = (a << 16) | (b << 8) | c;
+        ret += table[(triple >> 18) & 0x3F];
+        ret += table[(triple >> 12) & 0x3F];
+        ret += (bytes_left > 1) ? table[(triple >> 6) & 0x3F] : '=';
+        ret += (bytes_left > 2) ? table[triple & 0x3F] : '=';
+    }
+    return ret;
+}
+
+std::string random_bytes(size_t len, std::mt19937& rng) {
+    std::string result(len, '\0');
+    for (auto& c : result) c = static_cast<char>(rng() & 0xFF);
+    return result;
+}
+
+bool is_alphabet(unsigned char c) {
+    return std::isalnum(c) || c == '+' || c == '/';
+}
+
+} // anonymous namespace
+
+class Base64Test : public ::testing::TestWithParam<base64::kernel> {
+protected:
+    void SetUp() override {
+        if (!base64::is_supported(GetParam())) {
+            GTEST_SKIP() << base64::kernel_name(GetParam()) << " not supported on this CPU";
+        }
+    }
+};
+
+TEST_P(Base64Test, EncodeMatchesReference) {
+    std::mt19937 rng(42);
+    for (size_t len = 0; len < 300; ++len) {
+        const std::string input = random_bytes(len, rng);
+        ASSERT_EQ(base64::encode(input, GetParam()), reference_encode(input)) << "length " << len;
+    }
+    for (size_t len : {4095u, 4096u, 4097u, 1u << 20}) {
+        const std::string input = random_bytes(len, rng);
+        ASSERT_EQ(base64::encode(input, GetParam()), reference_encode(input)) << "length " << len;
+    }
+}
+
+TEST_P(Base64Test, EncodeAllByteValues) {
+    std::string input;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (int b = 0; b < 256; ++b) input += static_cast<char>(b);
+    }
+    EXPECT_EQ(base64::encode(input, GetParam()), reference_encode(input));
+}
+
+TEST_P(Base64Test, DecodeRoundTrip) {
+    std::mt19937 rng(7);
+    for (size_t len = 0; len < 300; ++len) {
+        const std::string input = random_bytes(len, rng);
+        const std::string encoded = reference_encode(input);
+        EXPECT_EQ(base64::decoded_size(encoded), len);
+        auto decoded = base64::decode(encoded, GetParam());
+        ASSERT_TRUE(decoded.has_value()) << "length " << len;
+        ASSERT_EQ(*decoded, input) << "length " << len;
+    }
+
+    const std::string large = random_bytes(3 << 20, rng);
+    auto decoded = base64::decode(reference_encode(large), GetParam());
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(*decoded, large);
+}
+
+TEST_P(Base64Test, DecodeRejectsEveryInvalidByteAtEveryPosition) {
+    std::mt19937 rng(3);
+    const std::string encoded = reference_encode(random_bytes(150, rng)); // 200 characters
+
+    for (int b = 0; b < 256; ++b) {
+        if (is_alphabet(static_cast<unsigned char>(b))) continue;
+        for (size_t pos = 0; pos < encoded.size(); pos += 7) {
+            std::string corrupted = encoded;
+            corrupted[pos] = static_cast<char>(b);
+            ASSERT_FALSE(base64::decode(corrupted, GetParam()).has_value())
+                << "byte " << b << " at " << pos;
+        }
+    }
+}
+
+TEST_P(Base64Test, DecodeRejectsMalformedPadding) {
+    const auto k = GetParam();
+    EXPECT_EQ(base64::decode("", k), std::string());
+    EXPECT_EQ(base64::decode("QQ==", k), std::string("A"));
+    EXPECT_EQ(base64::decode("QUI=", k), std::string("AB"));
+    EXPECT_FALSE(base64::decode("QQ", k).has_value());
+    EXPECT_FALSE(base64::decode("Q===", k).has_value());
+    EXPECT_FALSE(base64::decode("====", k).has_value());
+    EXPECT_FALSE(base64::decode("Q=Q=", k).has_value());
+    EXPECT_FALSE(base64::decode("QQ==QUJD", k).has_value());
+    EXPECT_FALSE(base64::decode("QUJD QUJD", k).has_value());
+}
+
+TEST_P(Base64Test, ValidateAcceptsEncodings) {
+    std::mt19937 rng(11);
+    for (size_t len = 1; len < 200; ++len) {
+        const std::string encoded = reference_encode(random_bytes(len, rng));
+        ASSERT_TRUE(base64::is_valid(encoded, GetParam())) << encoded;
+
+        // Line-wrapped at 76 characters like MIME
+        std::string wrapped;
+        for (size_t i = 0; i < encoded.size(); i += 76) {
+            wrapped += encoded.substr(i, 76) + "\r\n";
+        }
+        ASSERT_TRUE(base64::is_valid(wrapped, GetParam())) << wrapped;
+    }
+}
+
+TEST_P(Base64Test, ValidateRejectsMalformedText) {
+    const auto k = GetParam();
+    const std::string body(128, 'A');
+    EXPECT_FALSE(base64::is_valid("", k));
+    EXPECT_FALSE(base64::is_valid("   \n", k));
+    EXPECT_FALSE(base64::is_valid(body + "A", k));
+    EXPECT_FALSE(base64::is_valid(body + "A===", k));
+    EXPECT_FALSE(base64::is_valid(body + "=A==", k));
+    EXPECT_FALSE(base64::is_valid("QQ==" + body, k));
+    EXPECT_FALSE(base64::is_valid(body + "AA-_", k));
+    EXPECT_FALSE(base64::is_valid("/path/to/image.png", k));
+    EXPECT_TRUE(base64::is_valid(body + "AAAA", k));
+    EXPECT_TRUE(base64::is_valid(body + "AAA=", k));
+    EXPECT_TRUE(base64::is_valid(body + "AA\n==", k));
+
+    // A stray character anywhere in a long text
+    std::string text(1000, 'A');
+    for (size_t pos = 0; pos < text.size(); pos += 13) {
+        std::string corrupted = text;
+        corrupted[pos] = '*';
+        ASSERT_FALSE(base64::is_valid(corrupted, k)) << pos;
+        corrupted[pos] = static_cast<char>(0xC3);
+        ASSERT_FALSE(base64::is_valid(corrupted, k)) << pos;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, Base64Test,
+                         ::testing::Values(base64::kernel::scalar, base64::kernel::sse41,
+                                           base64::kernel::avx2, base64::kernel::avx512,
+                                           base64::kernel::neon),
+                         [](const auto& info) {
+                             std::string name = base64::kernel_name(info.param);
+                             name.erase(std::remove(name.begin(), name.end(), '.'), name.end());
+                             return name;
+                         });
+
+TEST(Base64DispatchTest, ActiveKernelIsSupported) {
+    const auto active = base64::active_kernel();
+    EXPECT_TRUE(base64::is_supported(active));
+    EXPECT_TRUE(base64::is_supported(base64::kernel::scalar));
+
+    const auto kernels = base64::supported_kernels();
+    ASSERT_FALSE(kernels.empty());
+    EXPECT_EQ(kernels.front(), base64::kernel::scalar);
+    EXPECT_NE(std::find(kernels.begin(), kernels.end(), active), kernels.end());
+}
@@ -0,0 +1,209 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/batch_builder.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+class BatchBuilderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+
+        m_dir = std::filesystem::temp_directory_path() /
+                ("hyni_batch_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::vector<json> read_lines(const std::filesystem::path& path) {
+        std::vector<json> lines;
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            lines.push_back(json::parse(line));
+        }
+        return lines;
+    }
+
+    // Answers like the chat completions endpoint, echoing the last user message
+    static json echo(const json& body) {
+        const std::string prompt = body["messages"].back()["content"][0]["text"];
+        if (prompt == "fail") throw std::runtime_error("refused");
+        return {{"choices", {{{"message", {{"role", "assistant"}, {"content", "re: " + prompt}}}}}}};
+    }
+
+    json m_schema;
+    std::filesystem::path m_dir;
+};
+
+TEST_F(BatchBuilderTest, WritesOneRequestPerLine) {
+    general_context context(m_schema);
+    context.set_system_message("Be brief.");
+    context.set_parameter("temperature", 0.5);
+
+    {
+        batch_builder builder(context, m_dir / "requests.jsonl");
+        EXPECT_TRUE(builder.add("a", "first"));
+        EXPECT_TRUE(builder.add("b", "second \"quoted\"\n"));
+        EXPECT_EQ(builder.size(), 2u);
+    }
+
+    // The body is what the context would send for the prompt on its own
+    general_context expected(m_schema);
+    expected.set_system_message("Be brief.");
+    expected.set_parameter("temperature", 0.5);
+    expected.add_user_message("second \"quoted\"\n");
+
+    const auto lines = read_lines(m_dir / "requests.jsonl");
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0]["custom_id"], "a");
+    EXPECT_EQ(lines[0]["method"], "POST");
+    EXPECT_EQ(lines[0]["url"], "/v1/chat/completions");
+    EXPECT_EQ(lines[1]["custom_id"], "b");
+    EXPECT_EQ(lines[1]["body"], json::parse(expected.build_request_body()));
+    EXPECT_EQ(lines[1]["body"]["messages"].size(), 2u); // System message and prompt only
+
+    // The context is left as it was
+    EXPECT_EQ(context.get_messages().size(), 0u);
+}
+
+TEST_F(BatchBuilderTest, BuildsOnExistingConversation) {
+    general_context context(m_schema);
+    context.add_user_message("shared question");
+    context.add_assistant_message("shared answer");
+
+    batch_builder builder(context, m_dir / "requests.jsonl");
+    builder.add("1", "follow-up one");
+    builder.add("2", "follow-up two");
+    builder.finish();
+
+    const auto lines = read_lines(builder.path());
+    ASSERT_EQ(lines.size(), 2u);
+    for (const auto& line : lines) {
+        EXPECT_EQ(line["body"]["messages"].size(), 3u);
+    }
+    EXPECT_EQ(lines[1]["body"]["messages"][2]["content"][0]["text"], "follow-up two");
+    EXPECT_EQ(context.get_messages().size(), 2u);
+    EXPECT_EQ(builder.bytes(), std::filesystem::file_size(builder.path()));
+}
+
+TEST_F(BatchBuilderTest, RejectsBadIds) {
+    general_context context(m_schema);
+    batch_builder builder(context, m_dir / "requests.jsonl");
+    EXPECT_THROW(builder.add("", "x"), validation_exception);
+    builder.add("same", "x");
+    EXPECT_THROW(builder.add("same", "y"), validation_exception);
+    builder.finish();
+    EXPECT_THROW(builder.add("later", "z"), std::logic_error);
+}
+
+TEST_F(BatchBuilderTest, StopsAtLimits) {
+    general_context context(m_schema);
+    batch_options options;
+    options.max_requests = 3;
+    options.buffer_size = 64; // Forces a write per line
+    batch_builder builder(context, m_dir / "requests.jsonl", options);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(builder.add(std::to_string(i), "prompt"));
+    }
+    EXPECT_FALSE(builder.add("3", "prompt"));
+    builder.finish();
+    EXPECT_EQ(read_lines(builder.path()).size(), 3u);
+
+    options.max_requests = 100;
+    options.max_file_bytes = builder.bytes() + 10; // Room for three lines, not four
+    batch_builder sized(context, m_dir / "sized.jsonl", options);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(sized.add(std::to_string(i), "prompt"));
+    }
+    EXPECT_FALSE(sized.add("3", "prompt"));
+    sized.finish();
+    EXPECT_LE(sized.bytes(), options.max_file_bytes);
+}
+
+TEST_F(BatchBuilderTest, RoundTripsThroughLocalUploader) {
+    general_context context(m_schema);
+    {
+        batch_builder builder(context, m_dir / "requests.jsonl");
+        for (int i = 0; i < 100; ++i) {
+            builder.add("item-" + std::to_string(i), i == 42 ? "fail" : "prompt " + std::to_string(i));
+        }
+    }
+
+    local_batch_uploader uploader(echo);
+    const auto batch_id = uploader.submit(m_dir / "requests.jsonl");
+    const auto results = uploader.results(batch_id);
+    ASSERT_TRUE(results.has_value());
+    EXPECT_THROW(uploader.results("batch_missing"), std::runtime_error);
+
+    batch_result_reader reader(context, *results);
+    size_t index = 0;
+    const size_t count = reader.for_each([&](const batch_outcome& outcome) {
+        EXPECT_EQ(outcome.custom_id, "item-" + std::to_string(index));
+        if (index == 42) {
+            EXPECT_FALSE(outcome.success);
+            EXPECT_EQ(outcome.error, "refused");
+        } else {
+            EXPECT_TRUE(outcome.success) << outcome.error;
+            EXPECT_EQ(outcome.status_code, 200);
+            EXPECT_EQ(outcome.text, "re: prompt " + std::to_string(index));
+        }
+        ++index;
+    });
+    EXPECT_EQ(count, 100u);
+}
+
+TEST_F(BatchBuilderTest, ReaderReportsBadLinesAndErrors) {
+    general_context context(m_schema);
+    const auto path = m_dir / "output.jsonl";
+    std::ofstream(path)
+        << R"({"id":"r0","custom_id":"ok","response":{"status_code":200,"body":{"id":"c","choices":[{"index":0,"message":{"content":"hi","annotations":[]}},{"message":{"content":"other"}}],"usage":{"total_tokens":3}}},"error":null})" "\n"
+        << "not json\n"
+        << "\n"
+        << R"({"custom_id":"limited","response":{"status_code":429,"body":{"error":{"message":"slow down"}}},"error":null})" "\n"
+        << R"({"custom_id":"expired","response":null,"error":{"code":"batch_expired","message":"not run"}})" "\n";
+
+    batch_result_reader reader(context, path);
+    batch_outcome outcome;
+    ASSERT_TRUE(reader.next(outcome));
+    EXPECT_TRUE(outcome.success);
+    EXPECT_EQ(outcome.text, "hi");
+
+    ASSERT_TRUE(reader.next(outcome));
+    EXPECT_FALSE(outcome.success);
+    EXPECT_TRUE(outcome.custom_id.empty());
+    EXPECT_FALSE(outcome.error.empty());
+
+    ASSERT_TRUE(reader.next(outcome));
+    EXPECT_EQ(outcome.custom_id, "limited");
+    EXPECT_FALSE(outcome.success);
+    EXPECT_EQ(outcome.status_code, 429);
+    EXPECT_EQ(outcome.error, "slow down");
+
+    ASSERT_TRUE(reader.next(outcome));
+    EXPECT_EQ(outcome.custom_id, "expired");
+    EXPECT_FALSE(outcome.success);
+    EXPECT_EQ(outcome.error, "not run");
+
+    EXPECT_FALSE(reader.next(outcome));
+}
@@ -0,0 +1,225 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "local_http_server.h"
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::last_prompt;
+using hyni::testing::openai_reply;
+using json = nlohmann::json;
+using namespace std::chrono_literals;
+
+namespace {
+
+std::vector<std::string> numbered_prompts(size_t count) {
+    std::vector<std::string> prompts;
+    for (size_t i = 0; i < count; ++i) {
+        std::string prompt = "q";
+        prompt += std::to_string(i);
+        prompts.push_back(std::move(prompt));
+    }
+    return prompts;
+}
+
+} // anonymous namespace
+
+class BatchTest : public hyni::testing::openai_server_test {
+protected:
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_transport(m_transport);
+        return api;
+    }
+
+    async_transport m_transport;
+};
+
+TEST_F(BatchTest, ReturnsResultsInInputOrder) {
+    // Earlier prompts answer more slowly, so completions arrive out of order
+    serve([](const local_http_request& request) {
+        const std::string prompt = last_prompt(request);
+        std::this_thread::sleep_for(std::chrono::milliseconds(40 - 5 * std::stoi(prompt.substr(1))));
+        return openai_reply("re: " + prompt);
+    });
+    auto api = make_api();
+    const auto prompts = numbered_prompts(8);
+
+    std::vector<size_t> completion_order;
+    send_batch_options options;
+    options.max_concurrency = 8;
+    auto results = api->send_batch(prompts, options, [&](const batch_response& response) {
+        completion_order.push_back(response.index);
+    });
+
+    ASSERT_EQ(results.size(), prompts.size());
+    for (size_t i = 0; i < prompts.size(); ++i) {
+        EXPECT_TRUE(results[i].success) << results[i].error;
+        EXPECT_EQ(results[i].index, i);
+        EXPECT_EQ(results[i].text, "re: " + prompts[i]);
+        EXPECT_EQ(results[i].attempts, 1u);
+    }
+    ASSERT_EQ(completion_order.size(), prompts.size());
+    EXPECT_NE(completion_order.front(), 0u);
+}
+
+TEST_F(BatchTest, BoundsConcurrencyAndReusesConnections) {
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+    serve([&](const local_http_request& request) {
+        const int now = ++active;
+        int previous = peak.load();
+        while (now > previous && !peak.compare_exchange_weak(previous, now)) {}
+        std::this_thread::sleep_for(5ms);
+        --active;
+        return openai_reply("re: " + last_prompt(request));
+    });
+    auto api = make_api();
+    const auto prompts = numbered_prompts(24);
+
+    send_batch_options options;
+    options.max_concurrency = 3;
+    auto results = api->send_batch(prompts, options);
+
+    for (const auto& result : results) {
+        EXPECT_TRUE(result.success) << result.error;
+    }
+    EXPECT_LE(peak.load(), 3);
+    EXPECT_EQ(m_server->requests(), prompts.size());
+    EXPECT_LE(m_server->connections(), 3u);
+}
+
+TEST_F(BatchTest, RetriesRateLimitedRequestsAfterRetryAfter) {
+    std::atomic<int> calls{0};
+    serve([&](const local_http_request& request) {
+        if (++calls == 1) {
+            local_http_response response;
+            response.status = 429;
+            response.headers.emplace_back("Retry-After", "0.05");
+            response.body = R"({"error":{"message":"Rate limit reached","type":"requests"}})";
+            return response;
+        }
+        return openai_reply("re: " + last_prompt(request));
+    });
+    auto api = make_api();
+    const std::vector<std::string> prompts = {"only"};
+
+    send_batch_options options;
+    options.retry_delay = 10s; // Retry-After takes precedence
+    const auto start = std::chrono::steady_clock::now();
+    auto results = api->send_batch(prompts, options);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_TRUE(results[0].success) << results[0].error;
+    EXPECT_EQ(results[0].attempts, 2u);
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 5s);
+}
+
+TEST_F(BatchTest, ReportsClientErrorsWithoutRetrying) {
+    serve([](const local_http_request& request) {
+        if (last_prompt(request) == "bad") {
+            local_http_response response;
+            response.status = 400;
+            response.body = R"({"error":{"message":"Invalid request","type":"invalid"}})";
+            return response;
+        }
+        return openai_reply("ok");
+    });
+    auto api = make_api();
+    const std::vector<std::string> prompts = {"good", "bad"};
+
+    auto results = api->send_batch(prompts);
+
+    EXPECT_TRUE(results[0].success);
+    EXPECT_FALSE(results[1].success);
+    EXPECT_EQ(results[1].status_code, 400);
+    EXPECT_EQ(results[1].attempts, 1u);
+    EXPECT_NE(results[1].error.find("Invalid request"), std::string::npos);
+    EXPECT_EQ(m_server->requests(), 2u);
+}
+
+TEST_F(BatchTest, SharesConversationWithoutChangingIt) {
+    std::atomic<size_t> message_count{0};
+    serve([&](const local_http_request& request) {
+        message_count = json::parse(request.body)["messages"].size();
+        return openai_reply("ok");
+    });
+    auto api = make_api();
+    api->get_context().add_user_message("context");
+    api->get_context().add_assistant_message("noted");
+
+    const std::vector<std::string> prompts = {"a", "b"};
+    auto results = api->send_batch(prompts);
+
+    EXPECT_TRUE(results[1].success);
+    EXPECT_EQ(message_count.load(), 3u);
+    EXPECT_EQ(api->get_context().get_messages().size(), 2u);
+    EXPECT_THROW((void)api->send_batch(prompts, send_batch_options{.max_concurrency = 0}),
+                 std::invalid_argument);
+}
+
+TEST(RateLimiterTest, PacesRequestsPerMinute) {
+    const auto start = rate_limiter::clock::time_point{};
+    rate_limiter limiter(120, 0, start); // Two per second
+
+    EXPECT_EQ(limiter.try_acquire(0, start), rate_limiter::clock::duration::zero());
+    EXPECT_EQ(limiter.try_acquire(0, start), rate_limiter::clock::duration::zero());
+    const auto wait = limiter.try_acquire(0, start);
+    EXPECT_GT(wait, 490ms);
+    EXPECT_LE(wait, 500ms);
+    EXPECT_EQ(limiter.try_acquire(0, start + 500ms), rate_limiter::clock::duration::zero());
+}
+
+TEST(RateLimiterTest, PacesTokensPerMinute) {
+    const auto start = rate_limiter::clock::time_point{};
+    rate_limiter limiter(0, 6000, start); // 100 tokens per second
+
+    EXPECT_EQ(limiter.try_acquire(80, start), rate_limiter::clock::duration::zero());
+    EXPECT_EQ(limiter.try_acquire(50, start), 300ms);
+    EXPECT_EQ(limiter.try_acquire(50, start + 300ms), rate_limiter::clock::duration::zero());
+
+    // A request larger than the bucket waits for a full bucket and then overdraws it
+    EXPECT_EQ(limiter.try_acquire(250, start + 1300ms), rate_limiter::clock::duration::zero());
+    EXPECT_EQ(limiter.try_acquire(10, start + 2s), 900ms);
+}
+
+TEST(RateLimiterTest, PauseHoldsBackEverything) {
+    const auto start = rate_limiter::clock::time_point{};
+    rate_limiter limiter(0, 0, start);
+    EXPECT_TRUE(limiter.unlimited());
+    EXPECT_EQ(limiter.try_acquire(1000000, start), rate_limiter::clock::duration::zero());
+
+    limiter.pause_until(start + 2s);
+    EXPECT_EQ(limiter.try_acquire(0, start + 500ms), 1500ms);
+    EXPECT_EQ(limiter.try_acquire(0, start + 2s), rate_limiter::clock::duration::zero());
+}
+
+TEST(RateLimiterTest, CorrectionsReplaceTokenEstimates) {
+    const auto start = rate_limiter::clock::time_point{};
+    rate_limiter limiter(0, 6000, start); // 100 tokens per second
+
+    // Underestimated: the provider charged 120 tokens, not 20
+    EXPECT_EQ(limiter.try_acquire(20, start), rate_limiter::clock::duration::zero());
+    limiter.correct_tokens(20, 120);
+    EXPECT_EQ(limiter.try_acquire(10, start), 300ms);
+
+    // Overestimated: the difference is given back, up to a full bucket
+    limiter.correct_tokens(500, 10);
+    EXPECT_EQ(limiter.try_acquire(100, start), rate_limiter::clock::duration::zero());
+    EXPECT_EQ(limiter.try_acquire(10, start), 100ms);
+}
@@ -0,0 +1,209 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_client.h"
+#include "local_http_server.h"
+#include <algorithm>
+#include <thread>
+
+using namespace hyni;
+using hyni::testing::last_prompt;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::openai_reply;
+using hyni::testing::openai_stream;
+using json = nlohmann::json;
+using std::chrono::milliseconds;
+
+namespace {
+
+// Answers "<conversation messages>:<last user message>", so tests can see the history sent
+local_http_response echo_history(const local_http_request& request, milliseconds delay) {
+    const json body = json::parse(request.body);
+    const size_t turns = std::count_if(body.at("messages").begin(), body.at("messages").end(),
+                                       [](const json& message) { return message.at("role") != "system"; });
+    const std::string last = last_prompt(body);
+    std::this_thread::sleep_for(delay);
+
+    local_http_response response;
+    if (last == "fail") {
+        response.status = 500;
+        response.body = R"({"error":{"message":"boom","type":"server_error"}})";
+        return response;
+    }
+    const std::string answer = std::to_string(turns) + ":" + last;
+    const json usage = {{"prompt_tokens", 10}, {"completion_tokens", 2}};
+    if (body.value("stream", false)) {
+        return openai_stream({answer.substr(0, 2), answer.substr(2)}, usage, milliseconds(0));
+    }
+    return openai_reply(answer, usage);
+}
+
+} // anonymous namespace
+
+class ChatClientTest : public hyni::testing::openai_server_test {
+protected:
+    void SetUp() override {
+        openai_server_test::SetUp();
+        if (IsSkipped()) return;
+        serve([this](const local_http_request& request) {
+            return echo_history(request, milliseconds(m_delay_ms.load()));
+        });
+    }
+
+    std::unique_ptr<chat_client> make_client(chat_client_options options = {}) {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key-1234");
+        options.ledger = &m_ledger;
+        return std::make_unique<chat_client>(std::move(context), options);
+    }
+
+    std::atomic<int> m_delay_ms{0};
+    usage_ledger m_ledger;
+};
+
+TEST_F(ChatClientTest, SessionsContinueTheirOwnConversation) {
+    auto client = make_client();
+    chat_session first = client->open_session("first");
+    chat_session second = client->open_session("second");
+
+    // Queued without waiting: each request still sees the answer to the one before
+    auto a1 = first.send("a1");
+    auto a2 = first.send("a2");
+    auto b1 = second.send("b1");
+    EXPECT_EQ(a1.get(), "1:a1");
+    EXPECT_EQ(a2.get(), "3:a2");
+    EXPECT_EQ(b1.get(), "1:b1");
+
+    usage_filter tag;
+    tag.tag = "first";
+    EXPECT_EQ(m_ledger.total(tag).requests, 2u);
+    EXPECT_EQ(m_ledger.total().requests, 3u);
+}
+
+TEST_F(ChatClientTest, SessionsStartFromThePrototype) {
+    auto context = std::make_unique<general_context>(m_schema);
+    context->set_api_key("test-key-1234");
+    context->add_user_message("preamble");
+    context->add_assistant_message("understood");
+    chat_client client(std::move(context));
+
+    chat_session session = client.open_session();
+    EXPECT_EQ(session.send("q1").get(), "3:q1");
+    EXPECT_EQ(session.send("q2").get(), "5:q2");
+
+    session.reset();
+    EXPECT_EQ(session.send("q3").get(), "3:q3");
+    EXPECT_EQ(client.open_session().send("other").get(), "3:other");
+}
+
+TEST_F(ChatClientTest, ConcurrentSubmissionsAreSerialized) {
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 10;
+    auto client = make_client();
+    chat_session shared = client->open_session();
+
+    std::vector<std::future<std::string>> replies[THREADS];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            chat_session handle = shared; // Copies refer to the same session
+            for (int i = 0; i < MESSAGES; ++i) {
+                std::string message = "t";
+                message += std::to_string(t) + "-" + std::to_string(i);
+                replies[t].push_back(handle.send(std::move(message)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // One request at a time: every request saw a different, complete history
+    std::vector<int> turns;
+    for (int t = 0; t < THREADS; ++t) {
+        int previous = 0;
+        for (int i = 0; i < MESSAGES; ++i) {
+            const std::string reply = replies[t][i].get();
+            const auto colon = reply.find(':');
+            std::string message = "t";
+            message += std::to_string(t) + "-" + std::to_string(i);
+            EXPECT_EQ(reply.substr(colon + 1), message);
+            const int turn = std::stoi(reply.substr(0, colon));
+            EXPECT_GT(turn, previous); // A thread's messages keep their order
+            previous = turn;
+            turns.push_back(turn);
+        }
+    }
+    std::sort(turns.begin(), turns.end());
+    for (size_t i = 0; i < turns.size(); ++i) {
+        EXPECT_EQ(turns[i], static_cast<int>(2 * i + 1));
+    }
+}
+
+TEST_F(ChatClientTest, FailedRequestsLeaveTheHistory) {
+    auto client = make_client();
+    chat_session session = client->open_session();
+    EXPECT_EQ(session.send("one").get(), "1:one");
+    auto failed = session.send("fail");
+    EXPECT_THROW(failed.get(), std::runtime_error);
+    EXPECT_EQ(session.send("two").get(), "3:two");
+}
+
+TEST_F(ChatClientTest, CoroutinesAndStreamsShareTheConversation) {
+    auto client = make_client();
+    chat_session session = client->open_session("streams");
+
+    std::promise<http_response> done;
+    std::string streamed;
+    session.send_stream("hello", [&](const std::string& delta) { streamed += delta; },
+                        [&](const http_response& response) { done.set_value(response); });
+    EXPECT_TRUE(done.get_future().get().success);
+    EXPECT_EQ(streamed, "1:hello");
+
+    EXPECT_EQ(sync_wait(session.co_send("again")), "3:again");
+
+    usage_filter tag;
+    tag.tag = "streams";
+    EXPECT_EQ(m_ledger.total(tag).requests, 2u);
+}
+
+TEST_F(ChatClientTest, RateLimitIsSharedBySessions) {
+    chat_client_options options;
+    options.requests_per_minute = 120; // Two per second
+    auto client = make_client(options);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<std::string>> replies;
+    for (int i = 0; i < 4; ++i) {
+        std::string prompt = "q";
+        prompt += std::to_string(i);
+        replies.push_back(client->open_session().send(std::move(prompt)));
+    }
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(replies[i].get(), "1:q" + std::to_string(i));
+    }
+    // The first two go at once, the others are paced half a second apart
+    EXPECT_GE(std::chrono::steady_clock::now() - start, milliseconds(800));
+}
+
+TEST_F(ChatClientTest, DestroyingTheClientFailsQueuedRequests) {
+    m_delay_ms = 200;
+    auto client = make_client();
+    chat_session session = client->open_session();
+    auto in_flight = session.send("first");
+    auto queued = session.send("second");
+    client.reset();
+
+    EXPECT_EQ(in_flight.get(), "1:first");
+    EXPECT_THROW(queued.get(), chat_api_error);
+}
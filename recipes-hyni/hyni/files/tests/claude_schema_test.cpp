@@ -410,6 +410,76 @@ TEST_F(ClaudeSchemaTest, LimitsConfiguration) {
     }
 }
 
+// Test prompt caching configuration and automatic breakpoints
+TEST_F(ClaudeSchemaTest, PromptCachingConfiguration) {
+    ASSERT_TRUE(m_schema.contains("prompt_caching"));
+    auto caching = m_schema["prompt_caching"];
+    EXPECT_TRUE(caching["supported"].get<bool>());
+    EXPECT_EQ(caching["marker"]["cache_control"]["type"], "ephemeral");
+    EXPECT_EQ(caching["max_breakpoints"], 4);
+    EXPECT_TRUE(m_context->supports_prompt_caching());
+
+    // Short prompts are below the minimum cacheable prefix and stay unmarked
+    m_context->set_system_message("Short system prompt");
+    m_context->add_user_message("Hello");
+    auto request = m_context->build_request();
+    EXPECT_TRUE(request["system"].is_string());
+    EXPECT_FALSE(request["messages"][0]["content"][0].contains("cache_control"));
+}
+
+TEST_F(ClaudeSchemaTest, PromptCachingBreakpoints) {
+    std::string preamble;
+    for (int i = 0; i < 400; ++i) {
+        preamble += "This document preamble sentence is repeated on every turn. ";
+    }
+
+    m_context->set_system_message(preamble);
+    m_context->add_user_message("First question");
+
+    // Turn 1: system prompt and the end of the request are marked
+    auto first = m_context->build_request();
+    ASSERT_TRUE(first["system"].is_array());
+    EXPECT_EQ(first["system"][0]["text"], preamble);
+    EXPECT_EQ(first["system"][0]["cache_control"]["type"], "ephemeral");
+    EXPECT_EQ(first["messages"][0]["content"].back()["cache_control"]["type"], "ephemeral");
+
+    // Turn 2: the previously cached prefix ends at message 0 and is still unchanged
+    m_context->add_assistant_message("First answer");
+    m_context->add_user_message("Second question");
+    auto second = m_context->build_request();
+    const auto& messages = second["messages"];
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_TRUE(messages[0]["content"].back().contains("cache_control"));
+    EXPECT_FALSE(messages[1]["content"].back().contains("cache_control"));
+    EXPECT_TRUE(messages[2]["content"].back().contains("cache_control"));
+
+    size_t markers = second["system"].is_array() ? 1 : 0;
+    for (const auto& message : messages) {
+        for (const auto& block : message["content"]) {
+            markers += block.contains("cache_control") ? 1 : 0;
+        }
+    }
+    EXPECT_LE(markers, 4u);
+
+    // A changed system prompt invalidates the cached prefix
+    m_context->set_system_message(preamble + "Changed.");
+    m_context->add_assistant_message("Second answer");
+    m_context->add_user_message("Third question");
+    auto third = m_context->build_request();
+    EXPECT_FALSE(third["messages"][2]["content"].back().contains("cache_control"));
+    EXPECT_TRUE(third["messages"][4]["content"].back().contains("cache_control"));
+
+    // Prompt caching can be turned off
+    context_config config;
+    config.enable_prompt_caching = false;
+    general_context plain(m_schema, config);
+    plain.set_system_message(preamble);
+    plain.add_user_message("First question");
+    auto plain_request = plain.build_request();
+    EXPECT_TRUE(plain_request["system"].is_string());
+    EXPECT_FALSE(plain_request["messages"][0]["content"][0].contains("cache_control"));
+}
+
 // Test streaming configuration
 TEST_F(ClaudeSchemaTest, StreamingConfiguration) {
     ASSERT_TRUE(m_schema["response_format"].contains("stream"));
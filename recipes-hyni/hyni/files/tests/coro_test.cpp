@@ -0,0 +1,191 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/asio_adapter.h"
+#include "local_http_server.h"
+#include <set>
+
+using namespace hyni;
+
+class CoroTest : public hyni::testing::openai_server_test {
+protected:
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        return std::make_unique<chat_api>(std::move(context));
+    }
+};
+
+TEST_F(CoroTest, TransportRunsConcurrentRequestsOnOneThread) {
+    async_transport transport;
+    std::atomic<int> succeeded{0};
+    std::atomic<bool> on_loop{true};
+    const int count = 64;
+    for (int i = 0; i < count; ++i) {
+        transport_request request;
+        request.url = m_server->url();
+        request.body = std::make_shared<const std::string>(
+            R"({"messages":[{"role":"user","content":[{"type":"text","text":"q)" +
+            std::to_string(i) + R"("}]}]})");
+        transport.submit(std::move(request), [&](http_response response) {
+            on_loop = on_loop && transport.in_event_loop();
+            if (response.success && response.body.find("re: q") != std::string::npos) {
+                ++succeeded;
+            }
+        });
+    }
+    while (transport.in_flight() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(succeeded.load(), count);
+    EXPECT_TRUE(on_loop.load());
+    EXPECT_EQ(m_server->requests(), static_cast<size_t>(count));
+}
+
+TEST_F(CoroTest, CoSendMessageReturnsText) {
+    auto api = make_api();
+    EXPECT_EQ(sync_wait(api->co_send_message("hi")), "re: hi");
+
+    // The conversation continues on the same context
+    EXPECT_EQ(sync_wait(api->co_send_message("again")), "re: again");
+    EXPECT_EQ(api->get_context().get_messages().size(), 1u);
+}
+
+TEST_F(CoroTest, CoSendMessageReportsApiErrors) {
+    auto api = make_api();
+    try {
+        (void)sync_wait(api->co_send_message("unauthorized"));
+        FAIL() << "Expected an exception";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("401"), std::string::npos) << e.what();
+        EXPECT_NE(std::string(e.what()).find("Invalid API key"), std::string::npos) << e.what();
+    }
+}
+
+TEST_F(CoroTest, ManyConversationsResumeOnChosenPool) {
+    thread_pool pool(2);
+    const int conversations = 50;
+    std::vector<std::unique_ptr<chat_api>> apis;
+    for (int i = 0; i < conversations; ++i) {
+        apis.push_back(make_api());
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> answers;
+    std::atomic<int> off_pool{0};
+    detail::blocking_signal all_done;
+    std::atomic<int> remaining{conversations};
+
+    auto converse = [&](chat_api& api, int index) -> task<void> {
+        std::string answer = co_await api.co_send_message("n" + std::to_string(index),
+                                                          pool_executor(pool));
+        if (!pool.in_worker()) ++off_pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            answers.push_back(std::move(answer));
+        }
+        if (--remaining == 0) all_done.set();
+    };
+    for (int i = 0; i < conversations; ++i) {
+        spawn(converse(*apis[i], i));
+    }
+    all_done.wait();
+
+    EXPECT_EQ(off_pool.load(), 0);
+    ASSERT_EQ(answers.size(), static_cast<size_t>(conversations));
+    std::set<std::string> unique(answers.begin(), answers.end());
+    EXPECT_EQ(unique.size(), static_cast<size_t>(conversations));
+    EXPECT_TRUE(unique.count("re: n7"));
+}
+
+TEST_F(CoroTest, DeltaStreamYieldsTextDeltas) {
+    auto api = make_api();
+    auto read_all = [&]() -> task<std::vector<std::string>> {
+        auto stream = api->co_send_message_stream("stream please");
+        std::vector<std::string> deltas;
+        while (auto delta = co_await stream.next()) {
+            deltas.push_back(std::move(*delta));
+        }
+        co_return deltas;
+    };
+    EXPECT_EQ(sync_wait(read_all()), (std::vector<std::string>{"Hello", " there"}));
+}
+
+TEST_F(CoroTest, DroppingDeltaStreamCancelsRequest) {
+    auto api = make_api();
+    async_transport transport;
+    api->set_transport(transport);
+
+    auto first_only = [&]() -> task<std::string> {
+        auto stream = api->co_send_message_stream("slow");
+        auto delta = co_await stream.next();
+        co_return delta.value_or("");
+    };
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(sync_wait(first_only()), "Hello");
+    while (transport.in_flight() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Reading to the end would take three 200 ms chunk delays
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(550));
+}
+
+TEST_F(CoroTest, AsioAdapterCompletesOnIoContext) {
+    auto api = make_api();
+    boost::asio::io_context io_context;
+    const auto io_thread = std::this_thread::get_id();
+
+    std::string from_callback;
+    bool callback_on_io = false;
+    async_send_message(*api, "callback", boost::asio::bind_executor(io_context,
+        [&](std::exception_ptr error, std::string text) {
+            EXPECT_FALSE(error);
+            from_callback = std::move(text);
+            callback_on_io = std::this_thread::get_id() == io_thread;
+        }));
+
+    std::string from_coroutine;
+    std::string error_message;
+    boost::asio::co_spawn(io_context, [&]() -> boost::asio::awaitable<void> {
+        from_coroutine = co_await async_send_message(*api, "coroutine", boost::asio::use_awaitable);
+        try {
+            co_await async_send_message(*api, "unauthorized", boost::asio::use_awaitable);
+        } catch (const std::runtime_error& e) {
+            error_message = e.what();
+        }
+    }, boost::asio::detached);
+
+    io_context.run();
+    EXPECT_EQ(from_callback, "re: callback");
+    EXPECT_TRUE(callback_on_io);
+    EXPECT_EQ(from_coroutine, "re: coroutine");
+    EXPECT_NE(error_message.find("Invalid API key"), std::string::npos);
+}
+
+TEST_F(CoroTest, AsioExecutorResumesOnIoContext) {
+    auto api = make_api();
+    boost::asio::io_context io_context;
+    auto guard = boost::asio::make_work_guard(io_context);
+    const auto io_thread = std::this_thread::get_id();
+
+    bool resumed_on_io = false;
+    std::string answer;
+    auto ask = [&]() -> task<void> {
+        answer = co_await api->co_send_message("io", asio_executor(io_context));
+        resumed_on_io = std::this_thread::get_id() == io_thread;
+        guard.reset();
+    };
+    spawn(ask());
+    io_context.run();
+    EXPECT_EQ(answer, "re: io");
+    EXPECT_TRUE(resumed_on_io);
+}
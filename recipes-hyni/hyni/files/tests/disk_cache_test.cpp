@@ -0,0 +1,289 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/disk_cache.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+#include <thread>
+#include <unistd.h>
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::local_http_server;
+using json = nlohmann::json;
+
+class DiskCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        m_directory = std::filesystem::temp_directory_path() /
+                      ("hyni_disk_cache_" + std::to_string(::getpid()) + "_" + info->name());
+        std::filesystem::remove_all(m_directory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_directory);
+    }
+
+    std::filesystem::path m_directory;
+};
+
+TEST_F(DiskCacheTest, StoresBodiesAndStreams) {
+    disk_cache cache(m_directory);
+    EXPECT_FALSE(cache.find("missing"));
+
+    cache.store("plain", "response");
+    cache.store_stream("stream", {"data: a\n\n", "", "data: [DONE]\n\n"});
+
+    auto plain = cache.find("plain");
+    ASSERT_TRUE(plain);
+    EXPECT_EQ(plain->data, "response");
+    EXPECT_FALSE(plain->is_stream());
+
+    auto stream = cache.find("stream");
+    ASSERT_TRUE(stream);
+    ASSERT_TRUE(stream->is_stream());
+    EXPECT_EQ(stream->chunks(), (std::vector<std::string_view>{"data: a\n\n", "", "data: [DONE]\n\n"}));
+
+    // Replacing keeps one entry
+    cache.store("plain", "newer");
+    EXPECT_EQ(cache.find("plain")->data, "newer");
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_EQ(stats.hit_count, 3u);
+    EXPECT_EQ(stats.miss_count, 1u);
+}
+
+TEST_F(DiskCacheTest, PersistsAcrossReopen) {
+    {
+        disk_cache cache(m_directory);
+        cache.store("key", "value");
+    }
+    disk_cache cache(m_directory);
+    auto found = cache.find("key");
+    ASSERT_TRUE(found);
+    EXPECT_EQ(found->data, "value");
+}
+
+TEST_F(DiskCacheTest, AllowsOneWriterAndManyReaders) {
+    disk_cache writer(m_directory);
+    EXPECT_THROW(disk_cache second(m_directory), std::runtime_error);
+
+    disk_cache_options read_only;
+    read_only.read_only = true;
+    disk_cache reader(m_directory, read_only);
+
+    writer.store("key", "value");
+    ASSERT_TRUE(reader.find("key"));
+    EXPECT_EQ(reader.find("key")->data, "value");
+
+    // Readers follow the writer to the compacted files
+    writer.compact();
+    writer.store("later", "value 2");
+    EXPECT_EQ(reader.find("key")->data, "value");
+    EXPECT_EQ(reader.find("later")->data, "value 2");
+    EXPECT_EQ(writer.get_cache_stats().compaction_count, 1u);
+    EXPECT_FALSE(std::filesystem::exists(m_directory / "data.1"));
+}
+
+TEST_F(DiskCacheTest, ConcurrentReadersSeeCompleteRecords) {
+    disk_cache writer(m_directory);
+    disk_cache_options read_only;
+    read_only.read_only = true;
+    disk_cache reader(m_directory, read_only);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::thread reading([&] {
+        while (!done) {
+            for (int i = 0; i < 50; ++i) {
+                std::string key = "k";
+                key += std::to_string(i);
+                if (auto found = reader.find(key); found && found->data != std::string(100, 'a' + i % 26)) {
+                    ++torn;
+                }
+            }
+        }
+    });
+    // Enough entries to grow the index several times
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            std::string key = "k";
+            key += std::to_string(i);
+            writer.store(key, std::string(100, 'a' + i % 26));
+        }
+    }
+    done = true;
+    reading.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(writer.get_cache_stats().entries, 2000u);
+    EXPECT_EQ(reader.find("k1999")->data, std::string(100, 'a' + 1999 % 26));
+}
+
+TEST_F(DiskCacheTest, ExpiresEntriesAfterTtl) {
+    disk_cache_options options;
+    options.ttl = std::chrono::seconds(1);
+    disk_cache cache(m_directory, options);
+    cache.store("key", "value");
+    EXPECT_TRUE(cache.find("key"));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_FALSE(cache.find("key"));
+    EXPECT_EQ(cache.get_cache_stats().expired_count, 1u);
+
+    cache.compact();
+    EXPECT_EQ(cache.get_cache_stats().entries, 0u);
+}
+
+TEST_F(DiskCacheTest, CompactionKeepsNewestWithinMaxBytes) {
+    disk_cache_options options;
+    options.max_bytes = 8192;
+    disk_cache cache(m_directory, options);
+    for (int i = 0; i < 100; ++i) {
+        cache.store("key " + std::to_string(i), std::string(200, 'x'));
+    }
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_GT(stats.compaction_count, 0u);
+    EXPECT_LE(stats.bytes, options.max_bytes);
+    EXPECT_TRUE(cache.find("key 99"));
+    EXPECT_FALSE(cache.find("key 0"));
+}
+
+TEST_F(DiskCacheTest, RecoveryDropsUncommittedTail) {
+    {
+        disk_cache cache(m_directory);
+        cache.store("key", "value");
+    }
+    // An append interrupted before its size was committed
+    const auto data = m_directory / "data.1";
+    const auto committed = std::filesystem::file_size(data);
+    {
+        std::ofstream torn(data, std::ios::binary | std::ios::app);
+        torn << std::string(30, '\x7f');
+    }
+
+    disk_cache cache(m_directory);
+    EXPECT_EQ(std::filesystem::file_size(data), committed);
+    EXPECT_EQ(cache.find("key")->data, "value");
+    cache.store("next", "value 2");
+    EXPECT_EQ(cache.find("next")->data, "value 2");
+}
+
+class DiskCachingTest : public DiskCacheTest {
+protected:
+    void SetUp() override {
+        DiskCacheTest::SetUp();
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        m_server = std::make_unique<local_http_server>([](const local_http_request& request) {
+            const json body = json::parse(request.body);
+            local_http_response response;
+            if (body.value("stream", false)) {
+                response.content_type = "text/event-stream";
+                for (const char* word : {"Hello", " there"}) {
+                    json chunk = {{"choices", {{{"index", 0}, {"delta", {{"content", word}}}}}}};
+                    response.chunks.push_back("data: " + chunk.dump() + "\n\n");
+                }
+                if (body["messages"].back()["content"][0]["text"] == "overloaded") {
+                    // A provider error inside a 200 stream
+                    response.chunks.push_back(R"(data: {"error":{"message":"Overloaded","type":"server_error"}})"
+                                              "\n\n");
+                }
+                response.chunks.push_back("data: [DONE]\n\n");
+                return response;
+            }
+            response.body = json{{"choices", {{{"message", {{"role", "assistant"},
+                                                            {"content", "answer"}}}}}}}.dump();
+            return response;
+        });
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+    }
+
+    std::unique_ptr<chat_api> make_api(disk_cache& cache) {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        context->set_parameter("temperature", 0.0);
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_response_cache(m_memory);
+        api->set_transport(m_transport);
+        api->set_disk_cache(&cache);
+        return api;
+    }
+
+    std::string stream_text(chat_api& api, const std::string& prompt = "story") {
+        std::string text;
+        std::promise<bool> done;
+        api.send_message_stream(prompt, [&](std::string chunk) { text += chunk; },
+                                [&](const http_response& response) { done.set_value(response.success); });
+        EXPECT_TRUE(done.get_future().get());
+        return text;
+    }
+
+    json m_schema;
+    std::unique_ptr<local_http_server> m_server;
+    response_cache m_memory;
+    async_transport m_transport;
+};
+
+TEST_F(DiskCachingTest, ResponsesSurviveTheProcessCache) {
+    {
+        disk_cache cache(m_directory);
+        EXPECT_EQ(make_api(cache)->send_message("hi"), "answer");
+    }
+    m_memory.clear();
+
+    disk_cache cache(m_directory);
+    auto api = make_api(cache);
+    EXPECT_EQ(api->send_message("hi"), "answer");
+    EXPECT_EQ(sync_wait(api->co_send_message("hi")), "answer"); // Now from memory
+    EXPECT_EQ(m_server->requests(), 1u);
+    EXPECT_EQ(cache.get_cache_stats().hit_count, 1u);
+}
+
+TEST_F(DiskCachingTest, StreamsAreReplayedChunkByChunk) {
+    disk_cache cache(m_directory);
+    auto api = make_api(cache);
+    EXPECT_EQ(stream_text(*api), "Hello there");
+    EXPECT_EQ(stream_text(*api), "Hello there");
+
+    auto read_all = [&]() -> task<std::vector<std::string>> {
+        auto stream = api->co_send_message_stream("story");
+        std::vector<std::string> deltas;
+        while (auto delta = co_await stream.next()) {
+            deltas.push_back(std::move(*delta));
+        }
+        co_return deltas;
+    };
+    EXPECT_EQ(sync_wait(read_all()), (std::vector<std::string>{"Hello", " there"}));
+    EXPECT_EQ(m_server->requests(), 1u);
+
+    auto recorded = cache.find(response_cache::make_key(m_server->url("/v1/chat/completions"),
+                                                        api->get_context().build_request_body(true)));
+    ASSERT_TRUE(recorded);
+    EXPECT_TRUE(recorded->is_stream());
+}
+
+TEST_F(DiskCachingTest, StreamsWithErrorEventsAreNotRecorded) {
+    disk_cache cache(m_directory);
+    auto api = make_api(cache);
+    EXPECT_EQ(stream_text(*api, "overloaded"), "Hello there");
+    EXPECT_EQ(stream_text(*api, "overloaded"), "Hello there");
+    EXPECT_EQ(m_server->requests(), 2u);
+    EXPECT_EQ(cache.get_cache_stats().entries, 0u);
+}
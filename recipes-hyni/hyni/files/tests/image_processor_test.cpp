@@ -0,0 +1,326 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/image_processor.h"
+#include "../src/base64.h"
+#include "../src/general_context.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <unistd.h>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+namespace {
+
+void put_be32(std::string& out, uint32_t v) {
+    out.push_back(char(v >> 24));
+    out.push_back(char(v >> 16));
+    out.push_back(char(v >> 8));
+    out.push_back(char(v));
+}
+
+uint32_t crc32(std::string_view data) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (unsigned char b : data) c = table[(c ^ b) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+void put_chunk(std::string& out, const char* type, const std::string& body) {
+    put_be32(out, static_cast<uint32_t>(body.size()));
+    const std::string typed = type + body;
+    out += typed;
+    put_be32(out, crc32(typed));
+}
+
+// Writes an uncompressed PNG (stored deflate blocks), independent of any codec library
+std::string make_png(uint32_t width, uint32_t height, uint32_t channels,
+                     const std::function<uint8_t(uint32_t, uint32_t, uint32_t)>& pixel) {
+    std::string raw;
+    raw.reserve(size_t(height) * (width * channels + 1));
+    for (uint32_t y = 0; y < height; ++y) {
+        raw.push_back('\0'); // Filter: none
+        for (uint32_t x = 0; x < width; ++x) {
+            for (uint32_t c = 0; c < channels; ++c) raw.push_back(char(pixel(x, y, c)));
+        }
+    }
+
+    std::string zlib = "\x78\x01";
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t pos = 0; pos < raw.size() || pos == 0; pos += 65535) {
+        const size_t len = std::min<size_t>(65535, raw.size() - pos);
+        zlib.push_back(pos + len >= raw.size() ? '\x01' : '\x00');
+        zlib.push_back(char(len & 0xFF));
+        zlib.push_back(char(len >> 8));
+        zlib.push_back(char(~len & 0xFF));
+        zlib.push_back(char((~len >> 8) & 0xFF));
+        zlib.append(raw, pos, len);
+    }
+    put_be32(zlib, (b << 16) | a);
+
+    std::string png = "\x89PNG\r\n\x1A\n";
+    std::string ihdr;
+    put_be32(ihdr, width);
+    put_be32(ihdr, height);
+    ihdr += '\x08';                              // Bit depth
+    ihdr += channels == 4 ? '\x06' : '\x02';     // RGBA or RGB
+    ihdr += std::string("\0\0\0", 3);            // Compression, filter, interlace
+    put_chunk(png, "IHDR", ihdr);
+    put_chunk(png, "IDAT", zlib);
+    put_chunk(png, "IEND", "");
+    return png;
+}
+
+uint8_t gradient(uint32_t x, uint32_t y, uint32_t c) {
+    return uint8_t((x * 7 + y * 3 + c * 85) & 0xFF);
+}
+
+uint8_t noise(uint32_t x, uint32_t y, uint32_t c) {
+    uint32_t h = x * 73856093u ^ y * 19349663u ^ c * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    return uint8_t(h >> 24);
+}
+
+image_options enabled_options() {
+    image_options options;
+    options.enabled = true;
+    return options;
+}
+
+} // anonymous namespace
+
+class ImageProcessorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!image_processor::codecs_available()) {
+            GTEST_SKIP() << "Built without image codecs";
+        }
+    }
+};
+
+TEST(ImageProbeTest, ReadsDimensionsFromHeaders) {
+    auto png = image_processor::probe(make_png(300, 200, 3, gradient));
+    ASSERT_TRUE(png);
+    EXPECT_EQ(png->type, image_processor::format::png);
+    EXPECT_EQ(png->width, 300u);
+    EXPECT_EQ(png->height, 200u);
+
+    // SOI, an APP0 segment to skip, then a baseline frame header
+    const std::string jpeg("\xFF\xD8\xFF\xE0\x00\x04\xAB\xCD"
+                           "\xFF\xC0\x00\x11\x08\x0B\xB8\x0F\xA0\x03", 18);
+    auto info = image_processor::probe(jpeg);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->type, image_processor::format::jpeg);
+    EXPECT_EQ(info->width, 4000u);
+    EXPECT_EQ(info->height, 3000u);
+
+    auto gif = image_processor::probe(std::string("GIF89a\x40\x01\xF0\x00", 10));
+    ASSERT_TRUE(gif);
+    EXPECT_EQ(gif->width, 320u);
+    EXPECT_EQ(gif->height, 240u);
+
+    EXPECT_FALSE(image_processor::probe("not an image"));
+    EXPECT_FALSE(image_processor::probe(jpeg.substr(0, 10)));
+}
+
+TEST(ImageProbeTest, SniffsBase64Payloads) {
+    const auto png = base64::encode(make_png(4, 4, 3, gradient));
+    EXPECT_EQ(image_processor::sniff_base64(png), image_processor::format::png);
+    EXPECT_EQ(image_processor::sniff_base64(base64::encode("\xFF\xD8\xFF\xE0 jpeg body")),
+              image_processor::format::jpeg);
+    EXPECT_EQ(image_processor::sniff_base64("aGVsbG8gd29ybGQh"), image_processor::format::unknown);
+    EXPECT_EQ(image_processor::sniff_base64(""), image_processor::format::unknown);
+    EXPECT_STREQ(image_processor::media_type(image_processor::format::webp), "image/webp");
+}
+
+TEST_F(ImageProcessorTest, SmallImagesPassThrough) {
+    image_processor processor(enabled_options(), 5 * 1024 * 1024);
+    const auto png = make_png(64, 48, 3, gradient);
+    EXPECT_FALSE(processor.needs_processing(png));
+    EXPECT_FALSE(processor.process(png));
+
+    image_processor disabled({}, 1);
+    EXPECT_FALSE(disabled.process(make_png(3000, 10, 3, gradient)));
+}
+
+TEST_F(ImageProcessorTest, LargeImageIsDownscaledToJpeg) {
+    image_processor processor(enabled_options(), 5 * 1024 * 1024);
+    const auto png = make_png(3000, 2000, 3, gradient);
+    ASSERT_TRUE(processor.needs_processing(png));
+
+    auto out = processor.process(png);
+    ASSERT_TRUE(out);
+    EXPECT_EQ(out->media_type, "image/jpeg");
+    EXPECT_EQ(out->width, 1568u);
+    EXPECT_EQ(out->height, 1045u);
+    EXPECT_LT(out->data.size(), png.size() / 10);
+
+    auto info = image_processor::probe(out->data);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->type, image_processor::format::jpeg);
+    EXPECT_EQ(info->width, out->width);
+    EXPECT_EQ(info->height, out->height);
+
+    // A re-encoded image already fits and is left alone
+    EXPECT_FALSE(processor.process(out->data));
+}
+
+TEST_F(ImageProcessorTest, TransparencyIsKeptAsPng) {
+    image_processor processor(enabled_options(), 0);
+    const auto png = make_png(2000, 100, 4, [](uint32_t x, uint32_t y, uint32_t c) {
+        return c == 3 ? uint8_t(x & 0xFF) : gradient(x, y, c);
+    });
+    auto out = processor.process(png);
+    ASSERT_TRUE(out);
+    EXPECT_EQ(out->media_type, "image/png");
+    EXPECT_EQ(out->width, 1568u);
+
+    // Fully opaque alpha is dropped, so the result can be a JPEG
+    const auto opaque = make_png(2000, 100, 4, [](uint32_t x, uint32_t y, uint32_t c) {
+        return c == 3 ? uint8_t(0xFF) : gradient(x, y, c);
+    });
+    auto flattened = processor.process(opaque);
+    ASSERT_TRUE(flattened);
+    EXPECT_EQ(flattened->media_type, "image/jpeg");
+}
+
+TEST_F(ImageProcessorTest, ByteLimitIsHonoured) {
+    auto options = enabled_options();
+    options.max_dimension = 1024;
+    const size_t limit = 120 * 1024;
+    image_processor processor(options, limit);
+
+    const auto png = make_png(1024, 1024, 3, noise); // Fits the dimension but not the limit
+    ASSERT_TRUE(processor.needs_processing(png));
+    auto out = processor.process(png);
+    ASSERT_TRUE(out);
+    EXPECT_LE(base64::encoded_size(out->data.size()), limit);
+    EXPECT_LE(out->width, 1024u);
+
+    image_processor impossible(options, 100);
+    EXPECT_THROW((void)impossible.process(png), std::runtime_error);
+}
+
+TEST_F(ImageProcessorTest, OversizedImagesAreRejectedBeforeDecoding) {
+    image_processor processor(enabled_options(), 0);
+
+    // A tiny PNG whose header claims 40000x40000 pixels
+    std::string png = make_png(1, 1, 3, gradient);
+    std::string header;
+    put_be32(header, 40000);
+    put_be32(header, 40000);
+    png.replace(16, 8, header);
+    std::string crc;
+    put_be32(crc, crc32(std::string_view(png).substr(12, 17)));
+    png.replace(29, 4, crc);
+    ASSERT_TRUE(processor.needs_processing(png));
+    EXPECT_THROW((void)processor.process(png), std::runtime_error);
+
+    // Likewise a JPEG whose frame header claims 60000x60000
+    auto jpeg = processor.process(make_png(2000, 100, 3, gradient));
+    ASSERT_TRUE(jpeg);
+    std::string bomb = jpeg->data;
+    size_t sof = 2;
+    while (sof + 9 < bomb.size() && !(uint8_t(bomb[sof]) == 0xFF && (uint8_t(bomb[sof + 1]) & 0xFC) == 0xC0)) {
+        ++sof;
+    }
+    ASSERT_LT(sof + 9, bomb.size());
+    bomb.replace(sof + 5, 4, std::string("\xEA\x60\xEA\x60", 4));
+    EXPECT_THROW((void)processor.process(bomb), std::runtime_error);
+
+    // The limit is configurable
+    auto options = enabled_options();
+    options.max_pixels = 100 * 100;
+    image_processor strict(options, 0, {"image/jpeg"});
+    EXPECT_THROW((void)strict.process(make_png(200, 100, 3, gradient)), std::runtime_error);
+    EXPECT_TRUE(strict.process(make_png(100, 100, 3, gradient)));
+}
+
+TEST_F(ImageProcessorTest, UnacceptedFormatIsTranscoded) {
+    image_processor processor(enabled_options(), 0, {"image/jpeg"});
+    const auto png = make_png(64, 64, 3, gradient);
+    auto out = processor.process(png);
+    ASSERT_TRUE(out);
+    EXPECT_EQ(out->media_type, "image/jpeg");
+    EXPECT_EQ(out->width, 64u);
+
+    // An opaque PNG stays a PNG for a provider that takes no JPEG
+    image_processor png_only(enabled_options(), 0, {"image/png"});
+    auto kept = png_only.process(make_png(2000, 100, 3, gradient));
+    ASSERT_TRUE(kept);
+    EXPECT_EQ(kept->media_type, "image/png");
+    EXPECT_EQ(kept->width, 1568u);
+}
+
+TEST_F(ImageProcessorTest, ProcessAsyncMatchesProcess) {
+    image_processor processor(enabled_options(), 0);
+    const auto png = make_png(2400, 1600, 3, gradient);
+    auto pending = processor.process_async(png);
+    auto direct = processor.process(png);
+    auto async = pending.get();
+    ASSERT_TRUE(direct && async);
+    EXPECT_EQ(direct->data, async->data);
+}
+
+TEST_F(ImageProcessorTest, ContextAttachesDownscaledImage) {
+    std::ifstream file("../schemas/claude.json");
+    if (!file.is_open()) GTEST_SKIP() << "Claude schema file not found";
+    json schema;
+    file >> schema;
+
+    const auto dir = std::filesystem::temp_directory_path() /
+                     ("hyni_image_processor_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir);
+    const auto path = (dir / "photo.png").string();
+    std::ofstream(path, std::ios::binary) << make_png(2000, 1200, 3, noise);
+
+    context_config config;
+    config.image_preprocessing.enabled = true;
+    general_context context(schema, config);
+    context.add_user_message("describe", "image/png", path);
+    context.add_assistant_message("ok");
+    context.add_user_message("again", "image/png", path);
+
+    const auto& messages = context.get_messages();
+    const auto& source = messages[0]["content"][1]["source"];
+    EXPECT_EQ(source["media_type"], "image/jpeg");
+    const auto data = source["data"].get<std::string>();
+    EXPECT_LE(data.size(), schema["multimodal"]["max_image_size"].get<size_t>());
+
+    auto decoded = base64::decode(data);
+    ASSERT_TRUE(decoded);
+    auto info = image_processor::probe(*decoded);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->width, 1568u);
+
+    // The repeat is served from the cache under the processed identity
+    EXPECT_EQ(messages[2]["content"][1]["source"]["data"], data);
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,385 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// Minimal HTTP/1.1 server on the loopback interface for tests that need a real
+// transport without network access. Each connection is served on its own
+// thread and kept alive across requests, so connection reuse is observable.
+// Also a fake OpenAI chat completions endpoint built on it, with a fixture.
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hyni::testing {
+
+struct local_http_request {
+    std::string method;
+    std::string target;
+    std::unordered_map<std::string, std::string> headers; ///< Names in lower case
+    std::string body;
+};
+
+struct local_http_response {
+    int status = 200;
+    std::string content_type = "application/json";
+    std::vector<std::pair<std::string, std::string>> headers; ///< Extra response headers
+    std::string body;                     ///< Sent with Content-Length when chunks is empty
+    std::vector<std::string> chunks;      ///< Sent with chunked encoding, one write each
+    std::chrono::milliseconds chunk_delay{0};
+};
+
+class local_http_server {
+public:
+    using handler = std::function<local_http_response(const local_http_request& request)>;
+
+    explicit local_http_server(handler on_request) : m_handler(std::move(on_request)) {
+        m_listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listen_fd < 0) throw std::runtime_error("socket() failed");
+        const int yes = 1;
+        ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        if (::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(m_listen_fd, 128) != 0) {
+            ::close(m_listen_fd);
+            throw std::runtime_error("bind() or listen() failed");
+        }
+        socklen_t length = sizeof(address);
+        ::getsockname(m_listen_fd, reinterpret_cast<sockaddr*>(&address), &length);
+        m_port = ntohs(address.sin_port);
+
+        m_acceptor = std::thread([this] { accept_loop(); });
+    }
+
+    ~local_http_server() {
+        m_stopping = true;
+        ::shutdown(m_listen_fd, SHUT_RDWR);
+        m_acceptor.join();
+        ::close(m_listen_fd);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (int fd : m_connection_fds) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for (auto& thread : m_connection_threads) {
+            thread.join();
+        }
+    }
+
+    local_http_server(const local_http_server&) = delete;
+    local_http_server& operator=(const local_http_server&) = delete;
+
+    [[nodiscard]] std::string url(const std::string& path = "/") const {
+        return "http://127.0.0.1:" + std::to_string(m_port) + path;
+    }
+
+    [[nodiscard]] size_t requests() const noexcept { return m_requests.load(); }
+    [[nodiscard]] size_t connections() const noexcept { return m_connections.load(); }
+
+private:
+    void accept_loop() {
+        while (!m_stopping) {
+            const int fd = ::accept(m_listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                if (m_stopping) return;
+                continue;
+            }
+            m_connections.fetch_add(1);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_connection_fds.push_back(fd);
+            m_connection_threads.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        for (;;) {
+            local_http_request request;
+            if (!read_request(fd, buffer, request)) break;
+            m_requests.fetch_add(1);
+            const local_http_response response = m_handler(request);
+            if (!write_response(fd, response)) break;
+        }
+        ::shutdown(fd, SHUT_RDWR);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ::close(fd);
+        std::erase(m_connection_fds, fd);
+    }
+
+    static bool read_more(int fd, std::string& buffer) {
+        char data[16384];
+        const ssize_t count = ::recv(fd, data, sizeof(data), 0);
+        if (count <= 0) return false;
+        buffer.append(data, static_cast<size_t>(count));
+        return true;
+    }
+
+    static bool read_request(int fd, std::string& buffer, local_http_request& request) {
+        size_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!read_more(fd, buffer)) return false;
+        }
+
+        const std::string head = buffer.substr(0, header_end);
+        size_t line_end = head.find("\r\n");
+        const std::string request_line = head.substr(0, line_end);
+        const size_t first_space = request_line.find(' ');
+        const size_t second_space = request_line.find(' ', first_space + 1);
+        request.method = request_line.substr(0, first_space);
+        request.target = request_line.substr(first_space + 1, second_space - first_space - 1);
+
+        while (line_end != std::string::npos && line_end < head.size()) {
+            const size_t start = line_end + 2;
+            line_end = head.find("\r\n", start);
+            const std::string line = head.substr(start, line_end == std::string::npos
+                                                              ? std::string::npos
+                                                              : line_end - start);
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            request.headers[name] = value;
+        }
+
+        size_t content_length = 0;
+        if (auto it = request.headers.find("content-length"); it != request.headers.end()) {
+            content_length = std::stoul(it->second);
+        }
+        const size_t body_start = header_end + 4;
+        while (buffer.size() < body_start + content_length) {
+            if (!read_more(fd, buffer)) return false;
+        }
+        request.body = buffer.substr(body_start, content_length);
+        buffer.erase(0, body_start + content_length);
+        return true;
+    }
+
+    static bool send_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t count = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) return false;
+            sent += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    static bool write_response(int fd, const local_http_response& response) {
+        std::string head = "HTTP/1.1 " + std::to_string(response.status) + " X\r\n"
+                           "Content-Type: " + response.content_type + "\r\n";
+        for (const auto& [name, value] : response.headers) {
+            head += name + ": " + value + "\r\n";
+        }
+        if (response.chunks.empty()) {
+            head += "Content-Length: " + std::to_string(response.body.size()) + "\r\n\r\n";
+            return send_all(fd, head + response.body);
+        }
+
+        head += "Transfer-Encoding: chunked\r\n\r\n";
+        if (!send_all(fd, head)) return false;
+        for (const auto& chunk : response.chunks) {
+            if (response.chunk_delay.count() > 0) {
+                std::this_thread::sleep_for(response.chunk_delay);
+            }
+            char size[32];
+            std::snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+            if (!send_all(fd, size + chunk + "\r\n")) return false;
+        }
+        return send_all(fd, "0\r\n\r\n");
+    }
+
+    handler m_handler;
+    int m_listen_fd = -1;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<size_t> m_requests{0};
+    std::atomic<size_t> m_connections{0};
+    std::thread m_acceptor;
+    std::mutex m_mutex;
+    std::vector<int> m_connection_fds;
+    std::vector<std::thread> m_connection_threads;
+};
+
+// Text of the last message of a chat completions request; content may be a string or parts
+inline std::string last_prompt(const nlohmann::json& body) {
+    const nlohmann::json& content = body.at("messages").back().at("content");
+    return content.is_string() ? content.get<std::string>() : content.at(0).at("text").get<std::string>();
+}
+
+inline std::string last_prompt(const local_http_request& request) {
+    return last_prompt(nlohmann::json::parse(request.body));
+}
+
+// A chat completion answering text
+inline local_http_response openai_reply(const std::string& text, const nlohmann::json& usage = nullptr) {
+    nlohmann::json body = {{"choices", {{{"message", {{"role", "assistant"}, {"content", text}}}}}}};
+    if (!usage.is_null()) {
+        body["usage"] = usage;
+    }
+    local_http_response response;
+    response.body = body.dump();
+    return response;
+}
+
+// A streamed chat completion: one event per delta, then usage if given
+inline local_http_response openai_stream(const std::vector<std::string>& deltas,
+                                         const nlohmann::json& usage = nullptr,
+                                         std::chrono::milliseconds chunk_delay = std::chrono::milliseconds(1)) {
+    local_http_response response;
+    response.content_type = "text/event-stream";
+    for (const auto& delta : deltas) {
+        nlohmann::json chunk = {{"choices", {{{"index", 0}, {"delta", {{"content", delta}}}}}}};
+        response.chunks.push_back(std::string("data: ").append(chunk.dump()).append("\n\n"));
+    }
+    if (!usage.is_null()) {
+        nlohmann::json chunk = {{"choices", nlohmann::json::array()}, {"usage", usage}};
+        response.chunks.push_back(std::string("data: ").append(chunk.dump()).append("\n\n"));
+    }
+    response.chunks.push_back("data: [DONE]\n\n");
+    response.chunk_delay = chunk_delay;
+    return response;
+}
+
+// Answers "re: <last prompt>", or streams "Hello" and " there". The prompt
+// "unauthorized" fails with 401, and "slow" streams 200 ms apart. delay is
+// spent before answering, so requests sent together overlap.
+inline local_http_server::handler openai_echo(std::chrono::milliseconds delay = {},
+                                              std::chrono::milliseconds chunk_delay = std::chrono::milliseconds(1)) {
+    return [delay, chunk_delay](const local_http_request& request) {
+        const nlohmann::json body = nlohmann::json::parse(request.body);
+        const std::string prompt = last_prompt(body);
+        if (prompt == "unauthorized") {
+            local_http_response response;
+            response.status = 401;
+            response.body = R"({"error":{"message":"Invalid API key","type":"auth"}})";
+            return response;
+        }
+        if (body.value("stream", false)) {
+            return openai_stream({"Hello", " there"}, nullptr,
+                                 prompt == "slow" ? std::chrono::milliseconds(200) : chunk_delay);
+        }
+        std::this_thread::sleep_for(delay);
+        return openai_reply("re: " + prompt);
+    };
+}
+
+// How a fake provider answers, for tests that route between OpenAI and
+// Claude; set between requests only
+struct provider_behaviour {
+    std::atomic<int> delay_ms{0};        ///< Before answering
+    std::atomic<int> chunk_delay_ms{0};  ///< Before each stream chunk, on top of delay_ms
+    std::atomic<int> status{200};
+    std::vector<std::pair<std::string, std::string>> headers; ///< Extra response headers
+};
+
+inline std::string sse(const nlohmann::json& payload) {
+    return std::string("data: ").append(payload.dump()).append("\n\n");
+}
+
+// Answers "from openai", or streams "openai" and " says hi"
+inline local_http_response openai_answer(const local_http_request& request, const provider_behaviour& how) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(how.delay_ms.load()));
+    const nlohmann::json body = nlohmann::json::parse(request.body);
+    local_http_response response;
+    response.status = how.status;
+    response.headers = how.headers;
+    if (response.status != 200) {
+        response.body = R"({"error":{"message":"overloaded","type":"server_error"}})";
+    } else if (body.value("stream", false)) {
+        response.content_type = "text/event-stream";
+        response.chunk_delay = std::chrono::milliseconds(how.chunk_delay_ms.load());
+        for (const char* word : {"openai", " says hi"}) {
+            response.chunks.push_back(sse({{"choices", {{{"index", 0}, {"delta", {{"content", word}}}}}}}));
+        }
+        response.chunks.push_back("data: [DONE]\n\n");
+    } else {
+        response.body = nlohmann::json{{"choices", {{{"message", {{"role", "assistant"},
+                                                                  {"content", "from openai"}}}}}}}.dump();
+    }
+    return response;
+}
+
+// Answers "from claude", or streams "claude" and " says hi"
+inline local_http_response claude_answer(const local_http_request& request, const provider_behaviour& how) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(how.delay_ms.load()));
+    const nlohmann::json body = nlohmann::json::parse(request.body);
+    local_http_response response;
+    response.status = how.status;
+    response.headers = how.headers;
+    if (response.status != 200) {
+        response.body = R"({"type":"error","error":{"type":"overloaded_error","message":"overloaded"}})";
+    } else if (body.value("stream", false)) {
+        response.content_type = "text/event-stream";
+        response.chunk_delay = std::chrono::milliseconds(how.chunk_delay_ms.load());
+        response.chunks.push_back("event: message_start\n" +
+            sse({{"type", "message_start"}, {"message", {{"usage", {{"input_tokens", 5}}}}}}));
+        for (const char* word : {"claude", " says hi"}) {
+            response.chunks.push_back("event: content_block_delta\n" +
+                sse({{"type", "content_block_delta"}, {"index", 0},
+                     {"delta", {{"type", "text_delta"}, {"text", word}}}}));
+        }
+        response.chunks.push_back("event: message_stop\n" + sse({{"type", "message_stop"}}));
+    } else {
+        response.body = nlohmann::json{{"type", "message"}, {"role", "assistant"},
+                                       {"content", {{{"type", "text"}, {"text", "from claude"}}}}}.dump();
+    }
+    return response;
+}
+
+// Serves the OpenAI schema from a local_http_server; m_schema points at it
+class openai_server_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        serve(openai_echo());
+    }
+
+    // Replaces the server; the handler runs on one thread per connection
+    void serve(local_http_server::handler handler) {
+        m_server = std::make_unique<local_http_server>(std::move(handler));
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+    }
+
+    nlohmann::json m_schema;
+    std::unique_ptr<local_http_server> m_server;
+};
+
+} // hyni::testing
@@ -0,0 +1,194 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/media_cache.h"
+#include "../src/base64.h"
+#include "../src/hash.h"
+#include "../src/general_context.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+class MediaCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() /
+                ("hyni_media_cache_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::string write_file(const std::string& name, const std::string& content) {
+        auto path = m_dir / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path.string();
+    }
+
+    std::filesystem::path m_dir;
+};
+
+TEST_F(MediaCacheTest, RepeatedFileIsServedByIdentity) {
+    media_cache cache;
+    const std::string content(3000, '\x7f');
+    const auto path = write_file("a.png", content);
+
+    const auto key = media_cache::file_key::of(path);
+    EXPECT_EQ(cache.find(key), nullptr);
+
+    auto first = cache.insert(key, content);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(*first, base64::encode(content));
+
+    auto second = cache.find(media_cache::file_key::of(path));
+    EXPECT_EQ(second, first); // Same buffer, not a copy
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, first->size());
+    EXPECT_EQ(stats.hit_count, 1u);
+    EXPECT_EQ(stats.miss_count, 1u);
+}
+
+TEST_F(MediaCacheTest, ModifiedFileIsNotServedStale) {
+    media_cache cache;
+    const auto path = write_file("a.png", "version one");
+    (void)cache.insert(media_cache::file_key::of(path), "version one");
+
+    write_file("a.png", "version two, longer");
+    const auto key = media_cache::file_key::of(path);
+    EXPECT_EQ(cache.find(key), nullptr);
+
+    auto updated = cache.insert(key, "version two, longer");
+    EXPECT_EQ(*updated, base64::encode("version two, longer"));
+    EXPECT_EQ(cache.find(key), updated);
+}
+
+TEST_F(MediaCacheTest, NonRegularFilesBypassTheIdentityLookup) {
+    media_cache cache;
+    const auto path = (m_dir / "fifo").string();
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    // A pipe keeps its size and mtime while its contents change
+    const auto key = media_cache::file_key::of(path);
+    EXPECT_FALSE(key.regular);
+    auto first = cache.insert(key, "first read");
+    EXPECT_EQ(*first, base64::encode("first read"));
+    EXPECT_EQ(cache.find(key), nullptr);
+    EXPECT_EQ(cache.find(media_cache::file_key::of(path)), nullptr);
+}
+
+TEST_F(MediaCacheTest, SameContentIsStoredOnce) {
+    media_cache cache;
+    const std::string content(5000, 'z');
+    const auto a = write_file("a.png", content);
+    const auto b = write_file("b.png", content);
+
+    auto first = cache.insert(media_cache::file_key::of(a), content);
+    auto second = cache.insert(media_cache::file_key::of(b), content);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(cache.find(media_cache::file_key::of(b)), first);
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.content_hit_count, 1u);
+    EXPECT_EQ(stats.miss_count, 1u);
+}
+
+TEST_F(MediaCacheTest, EvictsLeastRecentlyUsedWithinBudget) {
+    media_cache cache(4000); // Room for two 1600-byte payloads
+    const std::string a(1200, 'a'), b(1200, 'b'), c(1200, 'c');
+    const auto path_a = write_file("a.png", a);
+
+    auto payload_a = cache.insert(media_cache::file_key::of(path_a), a);
+    (void)cache.insert(b);
+    (void)cache.find(media_cache::file_key::of(path_a)); // a is now most recent
+    (void)cache.insert(c);                                // evicts b
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 2u);
+    EXPECT_LE(stats.bytes, 4000u);
+    EXPECT_EQ(stats.eviction_count, 1u);
+    EXPECT_EQ(cache.find(media_cache::file_key::of(path_a)), payload_a);
+
+    // Evicted payloads stay valid for their holders
+    cache.set_max_bytes(0);
+    EXPECT_EQ(cache.get_cache_stats().entries, 0u);
+    EXPECT_EQ(cache.find(media_cache::file_key::of(path_a)), nullptr);
+    EXPECT_EQ(*payload_a, base64::encode(a));
+}
+
+TEST_F(MediaCacheTest, ConcurrentInsertsAgree) {
+    media_cache cache;
+    const std::string content(1 << 16, 'q');
+    std::vector<media_cache::payload> results(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i] { results[i] = cache.insert(content); });
+    }
+    for (auto& t : threads) t.join();
+
+    for (const auto& result : results) {
+        EXPECT_EQ(*result, *results[0]);
+    }
+    EXPECT_EQ(cache.get_cache_stats().entries, 1u);
+}
+
+TEST_F(MediaCacheTest, ContentHashDistinguishesInputs) {
+    EXPECT_EQ(content_hash("abc"), content_hash("abc"));
+    EXPECT_NE(content_hash("abc"), content_hash("abd"));
+    const std::string big(1000, 'x');
+    std::string changed = big;
+    changed[517] = 'y';
+    EXPECT_NE(content_hash(big), content_hash(changed));
+    EXPECT_NE(content_hash(""), content_hash(std::string(1, '\0')));
+}
+
+TEST_F(MediaCacheTest, ContextReusesEncodedImage) {
+    std::ifstream file("../schemas/claude.json");
+    if (!file.is_open()) GTEST_SKIP() << "Claude schema file not found";
+    json schema;
+    file >> schema;
+
+    const auto image = write_file("shot.png", std::string(20000, '\x42'));
+    general_context context(schema);
+    const auto before = media_cache::instance().get_cache_stats();
+
+    context.add_user_message("first", "image/png", image);
+    context.add_assistant_message("ok");
+    context.add_user_message("second", "image/png", image);
+
+    const auto after = media_cache::instance().get_cache_stats();
+    EXPECT_EQ(after.miss_count, before.miss_count + 1);
+    EXPECT_EQ(after.hit_count, before.hit_count + 1);
+
+    const auto& messages = context.get_messages();
+    EXPECT_EQ(messages[0]["content"][1]["source"]["data"],
+              messages[2]["content"][1]["source"]["data"]);
+
+    // Disabled per context
+    context_config config;
+    config.enable_media_cache = false;
+    general_context uncached(schema, config);
+    uncached.add_user_message("third", "image/png", image);
+    EXPECT_EQ(media_cache::instance().get_cache_stats().hit_count, after.hit_count);
+    EXPECT_EQ(uncached.get_messages()[0]["content"][1]["source"]["data"],
+              messages[0]["content"][1]["source"]["data"]);
+}
@@ -0,0 +1,94 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/media_file.h"
+#include "../src/base64.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace hyni;
+
+class MediaFileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() /
+                ("hyni_media_file_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::string write_file(const std::string& name, const std::string& content) {
+        auto path = m_dir / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path.string();
+    }
+
+    std::filesystem::path m_dir;
+};
+
+TEST_F(MediaFileTest, RegularFileIsMapped) {
+    std::string content(300000, '\0');
+    for (size_t i = 0; i < content.size(); ++i) content[i] = static_cast<char>(i * 31);
+    const auto path = write_file("image.bin", content);
+
+    auto file = media_file::open(path, 1 << 20);
+    EXPECT_EQ(file.key().size, content.size());
+    EXPECT_EQ(file.key().path, media_cache::file_key::of(path).path);
+    EXPECT_EQ(file.key().mtime, media_cache::file_key::of(path).mtime);
+    EXPECT_TRUE(file.key().regular);
+
+    EXPECT_EQ(file.contents(), content);
+    EXPECT_TRUE(file.is_mapped());
+    EXPECT_EQ(file.encode_base64(), base64::encode(content));
+
+    // Moving keeps the mapping alive
+    media_file moved = std::move(file);
+    EXPECT_EQ(moved.contents(), content);
+}
+
+TEST_F(MediaFileTest, EmptyFileHasNoContents) {
+    const auto path = write_file("empty.bin", "");
+    auto file = media_file::open(path, 1024);
+    EXPECT_TRUE(file.contents().empty());
+    EXPECT_EQ(file.encode_base64(), "");
+}
+
+TEST_F(MediaFileTest, PipeIsReadInChunks) {
+    const auto path = (m_dir / "fifo").string();
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    const std::string content(700000, 'p');
+    std::thread writer([&] { std::ofstream(path, std::ios::binary) << content; });
+    auto file = media_file::open(path, 1 << 20);
+    const auto data = file.contents();
+    writer.join();
+
+    EXPECT_FALSE(file.is_mapped());
+    EXPECT_FALSE(file.key().regular); // Never served from media_cache by identity
+    EXPECT_EQ(data.size(), content.size());
+    EXPECT_EQ(data, content);
+}
+
+TEST_F(MediaFileTest, RejectsMissingLargeAndDirectories) {
+    EXPECT_THROW(media_file::open((m_dir / "missing.png").string(), 1024), std::runtime_error);
+    EXPECT_THROW(media_file::open(m_dir.string(), 1024), std::runtime_error);
+
+    const auto path = write_file("large.bin", std::string(2048, 'x'));
+    EXPECT_THROW(media_file::open(path, 1024), std::runtime_error);
+    EXPECT_NO_THROW(media_file::open(path, 2048));
+}
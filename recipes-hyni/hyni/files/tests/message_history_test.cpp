@@ -0,0 +1,263 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/message_history.h"
+#include "../src/general_context.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+namespace {
+json make_message(const std::string& role, int n) {
+    return json{{"role", role}, {"content", "message " + std::to_string(n)}};
+}
+} // anonymous namespace
+
+TEST(MessageHistoryTest, PushBackAndAccess) {
+    message_history history;
+    EXPECT_TRUE(history.empty());
+
+    for (int i = 0; i < 10; ++i) {
+        history.push_back(make_message("user", i));
+    }
+
+    ASSERT_EQ(history.size(), 10u);
+    EXPECT_EQ(history.front()["content"], "message 0");
+    EXPECT_EQ(history.back()["content"], "message 9");
+    EXPECT_EQ(history[4]["content"], "message 4");
+    EXPECT_THROW((void)history.at(10), std::out_of_range);
+
+    int expected = 0;
+    for (const auto& msg : history) {
+        EXPECT_EQ(msg["content"], "message " + std::to_string(expected++));
+    }
+    EXPECT_EQ(expected, 10);
+}
+
+TEST(MessageHistoryTest, ForkSharesAndDiverges) {
+    message_history trunk;
+    for (int i = 0; i < 100; ++i) {
+        trunk.push_back(make_message(i % 2 ? "assistant" : "user", i));
+    }
+
+    auto branch_a = trunk.fork();
+    auto branch_b = trunk.fork();
+
+    EXPECT_TRUE(branch_a.shares_storage_with(trunk));
+    EXPECT_TRUE(branch_b.shares_storage_with(branch_a));
+    EXPECT_EQ(&branch_a[50], &trunk[50]); // Same message object, not a copy
+
+    branch_a.push_back(make_message("user", 1000));
+    branch_b.push_back(make_message("user", 2000));
+    branch_b.push_back(make_message("assistant", 2001));
+
+    EXPECT_EQ(trunk.size(), 100u);
+    EXPECT_EQ(branch_a.size(), 101u);
+    EXPECT_EQ(branch_b.size(), 102u);
+    EXPECT_EQ(branch_a.back()["content"], "message 1000");
+    EXPECT_EQ(branch_b[100]["content"], "message 2000");
+    EXPECT_EQ(trunk.back()["content"], "message 99");
+
+    branch_a.clear();
+    EXPECT_TRUE(branch_a.empty());
+    EXPECT_EQ(branch_b[99]["content"], "message 99");
+}
+
+TEST(MessageHistoryTest, RepeatedForksKeepOrder) {
+    message_history history;
+    std::vector<message_history> checkpoints;
+
+    for (int i = 0; i < 500; ++i) {
+        history.push_back(make_message("user", i));
+        checkpoints.push_back(history.fork());
+    }
+
+    ASSERT_EQ(history.size(), 500u);
+    for (size_t i = 0; i < history.size(); ++i) {
+        ASSERT_EQ(history[i]["content"], "message " + std::to_string(i));
+    }
+
+    ASSERT_EQ(checkpoints[41].size(), 42u);
+    EXPECT_EQ(checkpoints[41].back()["content"], "message 41");
+    EXPECT_EQ(std::distance(checkpoints[41].begin(), checkpoints[41].end()), 42);
+}
+
+class ContextForkTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/claude.json");
+        if (!file.is_open()) {
+            GTEST_SKIP() << "Claude schema file not found";
+        }
+        file >> m_schema;
+        m_context = std::make_unique<general_context>(m_schema);
+        m_context->set_api_key("test-key");
+        m_context->set_system_message("You are a test assistant");
+        for (int i = 0; i < 50; ++i) {
+            m_context->add_user_message("question " + std::to_string(i));
+            m_context->add_assistant_message("answer " + std::to_string(i));
+        }
+    }
+
+    json m_schema;
+    std::unique_ptr<general_context> m_context;
+};
+
+TEST_F(ContextForkTest, ForkContinuesIndependently) {
+    auto branch = m_context->fork();
+
+    EXPECT_TRUE(branch->get_messages().shares_storage_with(m_context->get_messages()));
+    EXPECT_TRUE(branch->has_api_key());
+    EXPECT_EQ(branch->get_headers(), m_context->get_headers());
+
+    branch->add_user_message("branch question");
+    m_context->add_user_message("trunk question");
+
+    auto branch_request = branch->build_request();
+    auto trunk_request = m_context->build_request();
+
+    ASSERT_EQ(branch_request["messages"].size(), 101u);
+    ASSERT_EQ(trunk_request["messages"].size(), 101u);
+    EXPECT_EQ(branch_request["messages"][100]["content"][0]["text"], "branch question");
+    EXPECT_EQ(trunk_request["messages"][100]["content"][0]["text"], "trunk question");
+    EXPECT_EQ(branch_request["messages"][99], trunk_request["messages"][99]);
+    EXPECT_EQ(branch_request["system"], "You are a test assistant");
+}
+
+TEST_F(ContextForkTest, SnapshotAndRestore) {
+    m_context->set_parameter("temperature", 0.2);
+    auto snap = m_context->snapshot();
+
+    m_context->add_user_message("follow-up");
+    m_context->set_parameter("temperature", 0.9);
+    m_context->set_system_message("Changed");
+    ASSERT_EQ(m_context->get_messages().size(), 101u);
+
+    m_context->restore(snap);
+
+    EXPECT_EQ(m_context->get_messages().size(), 100u);
+    EXPECT_EQ(m_context->get_parameter_as<double>("temperature"), 0.2);
+    EXPECT_EQ(m_context->build_request()["system"], "You are a test assistant");
+
+    // Restoring the same snapshot twice yields the same state
+    m_context->add_user_message("another follow-up");
+    m_context->restore(snap);
+    EXPECT_EQ(m_context->get_messages().back()["content"][0]["text"], "answer 49");
+}
+
+TEST(MessageHistoryTest, WeightsSurviveForks) {
+    message_history history;
+    for (int i = 0; i < 20; ++i) {
+        history.push_back(make_message("user", i), 10);
+    }
+    auto branch = history.fork();
+    branch.push_back(make_message("user", 20), 5);
+
+    EXPECT_EQ(history.total_weight(), 200u);
+    EXPECT_EQ(branch.total_weight(), 205u);
+    EXPECT_EQ(branch.weight_before(0), 0u);
+    EXPECT_EQ(branch.weight_before(7), 70u);
+    EXPECT_EQ(branch.weight_before(21), 205u);
+}
+
+class HistoryWindowTest : public ::testing::Test {
+protected:
+    std::unique_ptr<general_context> create_context(size_t max_context_tokens,
+                                                    size_t min_recent = 2) {
+        std::ifstream file("../schemas/claude.json");
+        if (!file.is_open()) {
+            return nullptr;
+        }
+        json schema;
+        file >> schema;
+
+        context_config config;
+        config.enable_history_window = true;
+        config.max_context_tokens = max_context_tokens;
+        config.history_window_min_recent = min_recent;
+        config.default_max_tokens = 100;
+        return std::make_unique<general_context>(schema, config);
+    }
+
+    static void add_turns(general_context& context, int turns) {
+        std::string padding; // About 100 tokens per message
+        for (int i = 0; i < 100; ++i) {
+            padding += " the";
+        }
+        for (int i = 0; i < turns; ++i) {
+            context.add_user_message("question " + std::to_string(i) + padding);
+            context.add_assistant_message("answer " + std::to_string(i) + padding);
+        }
+    }
+};
+
+TEST_F(HistoryWindowTest, ShortHistoryIsSentUnchanged) {
+    auto context = create_context(200000);
+    if (!context) GTEST_SKIP() << "Claude schema file not found";
+
+    add_turns(*context, 10);
+    context->add_user_message("latest");
+
+    EXPECT_EQ(context->get_history_window_start(), 0u);
+    EXPECT_EQ(context->build_request()["messages"].size(), 21u);
+}
+
+TEST_F(HistoryWindowTest, LongHistoryIsTrimmedToBudget) {
+    auto context = create_context(2000);
+    if (!context) GTEST_SKIP() << "Claude schema file not found";
+
+    context->set_system_message("Pinned system prompt");
+    add_turns(*context, 100);
+    context->add_user_message("latest question");
+
+    const size_t start = context->get_history_window_start();
+    EXPECT_GT(start, 0u);
+    EXPECT_LT(start, context->get_messages().size());
+    EXPECT_EQ(context->get_messages()[start]["role"], "user");
+
+    auto request = context->build_request();
+    const auto& messages = request["messages"];
+    EXPECT_EQ(messages.size(), context->get_messages().size() - start);
+    EXPECT_LT(messages.size(), 20u);
+    EXPECT_EQ(messages.back()["content"][0]["text"], "latest question");
+    EXPECT_EQ(request["system"], "Pinned system prompt");
+    EXPECT_LT(request.dump().size(), 2000u * 4);
+}
+
+TEST_F(HistoryWindowTest, RecentMessagesAreAlwaysKept) {
+    auto context = create_context(10, 3);
+    if (!context) GTEST_SKIP() << "Claude schema file not found";
+
+    add_turns(*context, 5);
+    context->add_user_message("latest question");
+
+    EXPECT_EQ(context->get_history_window_start(), context->get_messages().size() - 3);
+    EXPECT_EQ(context->build_request()["messages"].size(), 3u);
+}
+
+TEST_F(HistoryWindowTest, DisabledByDefault) {
+    std::ifstream file("../schemas/claude.json");
+    if (!file.is_open()) GTEST_SKIP() << "Claude schema file not found";
+    json schema;
+    file >> schema;
+
+    context_config config;
+    config.max_context_tokens = 10;
+    general_context context(schema, config);
+    add_turns(context, 5);
+    context.add_user_message("latest question");
+
+    EXPECT_EQ(context.get_history_window_start(), 0u);
+    EXPECT_EQ(context.build_request()["messages"].size(), 11u);
+}
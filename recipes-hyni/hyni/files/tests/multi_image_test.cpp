@@ -0,0 +1,125 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/general_context.h"
+#include "../src/base64.h"
+#include "../src/thread_pool.h"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+class MultiImageTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/claude.json");
+        if (!file.is_open()) GTEST_SKIP() << "Claude schema file not found";
+        file >> m_schema;
+
+        m_dir = std::filesystem::temp_directory_path() /
+                ("hyni_multi_image_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(m_dir);
+    }
+
+    std::string write_file(const std::string& name, const std::string& content) {
+        auto path = m_dir / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path.string();
+    }
+
+    json m_schema;
+    std::filesystem::path m_dir;
+};
+
+TEST_F(MultiImageTest, ContentKeepsAttachmentOrder) {
+    context_config config;
+    config.enable_media_cache = false;
+    general_context context(m_schema, config);
+
+    std::vector<media_attachment> media;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 8; ++i) {
+        // Varying sizes so that encodes finish out of order
+        const std::string content((8 - i) * 40000 + i, static_cast<char>('a' + i));
+        if (i == 3) {
+            media.push_back({"image/png", base64::encode(content)}); // Inline data mixes in
+        } else {
+            media.push_back({"image/png", write_file("img" + std::to_string(i) + ".png", content)});
+        }
+        expected.push_back(base64::encode(content));
+    }
+
+    context.add_user_message("compare these", media);
+
+    const auto& content = context.get_messages()[0]["content"];
+    ASSERT_EQ(content.size(), media.size() + 1);
+    EXPECT_EQ(content[0]["text"], "compare these");
+    for (size_t i = 0; i < media.size(); ++i) {
+        EXPECT_EQ(content[i + 1]["source"]["data"], expected[i]) << "attachment " << i;
+        EXPECT_EQ(content[i + 1]["source"]["media_type"], "image/png");
+    }
+}
+
+TEST_F(MultiImageTest, MatchesSingleAttachmentMessage) {
+    general_context context(m_schema);
+    const auto path = write_file("one.png", std::string(3000, '\x11'));
+    context.add_user_message("single", "image/png", path);
+    context.add_assistant_message("ok");
+    context.add_user_message("single", std::vector<media_attachment>{{"image/png", path}});
+
+    const auto& messages = context.get_messages();
+    EXPECT_EQ(messages[0], messages[2]);
+}
+
+TEST_F(MultiImageTest, EnforcesSchemaLimit) {
+    general_context context(m_schema);
+    const auto path = write_file("a.png", "tiny");
+    const auto limit = m_schema["multimodal"]["max_images_per_message"].get<size_t>();
+
+    std::vector<media_attachment> media(limit + 1, media_attachment{"image/png", path});
+    EXPECT_THROW(context.add_user_message("too many", media), validation_exception);
+    EXPECT_EQ(context.get_messages().size(), 0u);
+
+    media.pop_back();
+    EXPECT_NO_THROW(context.add_user_message("at the limit", media));
+}
+
+TEST_F(MultiImageTest, MissingFileFailsWholeMessage) {
+    general_context context(m_schema);
+    std::vector<media_attachment> media = {
+        {"image/png", write_file("a.png", "first")},
+        {"image/png", (m_dir / "missing.png").string()},
+        {"image/png", write_file("c.png", "third")},
+    };
+    EXPECT_THROW(context.add_user_message("broken", media), std::runtime_error);
+    EXPECT_EQ(context.get_messages().size(), 0u);
+}
+
+TEST_F(MultiImageTest, WorksFromPoolWorker) {
+    // Nested use from the shared pool runs inline rather than waiting on itself
+    const auto a = write_file("a.png", std::string(5000, 'a'));
+    const auto b = write_file("b.png", std::string(5000, 'b'));
+    auto result = thread_pool::shared().submit([&] {
+        general_context context(m_schema);
+        context.add_user_message("nested", {{"image/png", a}, {"image/png", b}});
+        return context.get_messages()[0]["content"].size();
+    });
+    ASSERT_EQ(result.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+    EXPECT_EQ(result.get(), 3u);
+}
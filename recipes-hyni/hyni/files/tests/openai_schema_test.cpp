@@ -480,6 +480,19 @@ TEST_F(OpenAISchemaTest, LimitsConfiguration) {
     }
 }
 
+// Test that automatic prompt caching adds no markers
+TEST_F(OpenAISchemaTest, PromptCachingIsAutomatic) {
+    ASSERT_TRUE(m_schema.contains("prompt_caching"));
+    EXPECT_TRUE(m_schema["prompt_caching"]["automatic"].get<bool>());
+    EXPECT_TRUE(m_context->supports_prompt_caching());
+
+    const std::string preamble(20000, 'a');
+    m_context->set_system_message(preamble);
+    m_context->add_user_message("Question");
+    auto request = m_context->build_request();
+    EXPECT_EQ(request.dump().find("cache_control"), std::string::npos);
+}
+
 TEST_F(OpenAISchemaTest, SchemaFreshnessCheck) {
     ASSERT_TRUE(m_schema["provider"].contains("last_validated"));
 
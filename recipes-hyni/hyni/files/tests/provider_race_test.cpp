@@ -0,0 +1,191 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/provider_race.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+#include <thread>
+#include <unistd.h>
+
+using namespace hyni;
+using hyni::testing::claude_answer;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_server;
+using hyni::testing::openai_answer;
+using hyni::testing::provider_behaviour;
+using json = nlohmann::json;
+using std::chrono::milliseconds;
+
+class ProviderRaceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_openai = std::make_unique<local_http_server>([this](const local_http_request& request) {
+            m_openai_body = request.body;
+            return openai_answer(request, m_openai_behaviour);
+        });
+        m_claude = std::make_unique<local_http_server>([this](const local_http_request& request) {
+            m_claude_body = request.body;
+            return claude_answer(request, m_claude_behaviour);
+        });
+
+        // The real schemas, pointed at the local servers
+        auto builder = schema_registry::create();
+        for (const auto& [name, server] : {std::pair{"openai", m_openai.get()}, std::pair{"claude", m_claude.get()}}) {
+            std::ifstream file(std::string("../schemas/") + name + ".json");
+            if (!file.is_open()) GTEST_SKIP() << "Schema file not found";
+            json schema;
+            file >> schema;
+            schema["api"]["endpoint"] = server->url("/v1");
+            const auto path = std::filesystem::temp_directory_path() /
+                              ("hyni_race_" + std::to_string(::getpid()) + "_" + name + ".json");
+            std::ofstream(path) << schema.dump();
+            m_schema_files.push_back(path);
+            builder.register_schema(name, path.string());
+        }
+        m_factory = std::make_shared<context_factory>(builder.build());
+    }
+
+    void TearDown() override {
+        for (const auto& path : m_schema_files) {
+            std::filesystem::remove(path);
+        }
+    }
+
+    provider_race make_race() {
+        provider_race race(m_factory, {{"openai", "openai-key", {}, {}}, {"claude", "claude-key", {}, {}}});
+        race.set_transport(m_transport);
+        return race;
+    }
+
+    void wait_for_idle() {
+        const auto deadline = std::chrono::steady_clock::now() + milliseconds(2000);
+        while (m_transport.in_flight() > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(milliseconds(1));
+        }
+    }
+
+    provider_behaviour m_openai_behaviour;
+    provider_behaviour m_claude_behaviour;
+    std::string m_openai_body;
+    std::string m_claude_body;
+    std::unique_ptr<local_http_server> m_openai;
+    std::unique_ptr<local_http_server> m_claude;
+    std::vector<std::filesystem::path> m_schema_files;
+    std::shared_ptr<context_factory> m_factory;
+    async_transport m_transport;
+};
+
+TEST_F(ProviderRaceTest, TranslatesConversationForEachProvider) {
+    conversation chat;
+    chat.set_system_message("Be brief.")
+        .add_user_message("Hello")
+        .add_assistant_message("Hi!")
+        .add_user_message("How are you?")
+        .set_parameter("top_k", 5); // Known to claude only
+
+    // Both fail, so neither request is cancelled before it arrives
+    m_openai_behaviour.status = 500;
+    m_claude_behaviour.status = 500;
+    auto race = make_race();
+    EXPECT_THROW((void)race.send(chat), std::runtime_error);
+
+    const json openai = json::parse(m_openai_body);
+    EXPECT_EQ(openai["messages"][0]["role"], "system");
+    EXPECT_EQ(openai["messages"].size(), 4u);
+    EXPECT_FALSE(openai.contains("top_k"));
+
+    const json claude = json::parse(m_claude_body);
+    EXPECT_EQ(claude["messages"].size(), 3u);
+    EXPECT_EQ(claude["messages"][0]["role"], "user");
+    EXPECT_NE(claude.dump().find("Be brief."), std::string::npos);
+    EXPECT_EQ(claude["top_k"], 5);
+}
+
+TEST_F(ProviderRaceTest, FirstCompleteResponseWinsAndLosersAreCancelled) {
+    m_claude_behaviour.delay_ms = 400;
+    auto race = make_race();
+    conversation chat;
+    chat.add_user_message("Hello");
+
+    const auto start = std::chrono::steady_clock::now();
+    auto result = race.send(chat);
+    EXPECT_EQ(result.provider, "openai");
+    EXPECT_EQ(result.text, "from openai");
+    EXPECT_TRUE(result.response.success);
+    EXPECT_LT(result.latency, milliseconds(300));
+
+    // The slow transfer is aborted instead of running to the end
+    wait_for_idle();
+    EXPECT_EQ(m_transport.in_flight(), 0u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, milliseconds(350));
+}
+
+TEST_F(ProviderRaceTest, FailedEntrantsDropOut) {
+    m_openai_behaviour.status = 503;
+    m_claude_behaviour.delay_ms = 50;
+    auto race = make_race();
+    conversation chat;
+    chat.add_user_message("Hello");
+    EXPECT_EQ(race.send(chat).provider, "claude");
+
+    m_claude_behaviour.status = 500;
+    try {
+        (void)race.send(chat);
+        FAIL() << "Expected every provider to fail";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("openai: HTTP 503"), std::string::npos);
+        EXPECT_NE(std::string(e.what()).find("claude: HTTP 500"), std::string::npos);
+    }
+}
+
+TEST_F(ProviderRaceTest, StreamThatStartsFirstWins) {
+    m_openai_behaviour.delay_ms = 400;
+    auto race = make_race();
+    conversation chat;
+    chat.add_user_message("Hello");
+
+    std::vector<std::string> deltas;
+    auto result = race.send_stream(chat, [&](const stream_event& event) {
+        if (event.type == stream_event_type::text_delta) {
+            deltas.emplace_back(event.text);
+        }
+        return true;
+    });
+    EXPECT_EQ(result.provider, "claude");
+    EXPECT_EQ(result.text, "claude says hi");
+    EXPECT_EQ(deltas, (std::vector<std::string>{"claude", " says hi"}));
+    EXPECT_LT(result.latency, milliseconds(300));
+
+    wait_for_idle();
+    EXPECT_EQ(m_transport.in_flight(), 0u);
+}
+
+TEST_F(ProviderRaceTest, RefusesToWaitOnTheEventLoop) {
+    auto race = make_race();
+    conversation chat;
+    chat.add_user_message("Hello");
+
+    transport_request request;
+    request.url = m_openai->url("/v1");
+    request.body = std::make_shared<const std::string>("{}");
+    std::promise<bool> refused;
+    m_transport.submit(std::move(request), [&](http_response) {
+        try {
+            (void)race.send(chat);
+            refused.set_value(false);
+        } catch (const std::logic_error&) {
+            refused.set_value(true);
+        }
+    });
+    EXPECT_TRUE(refused.get_future().get());
+}
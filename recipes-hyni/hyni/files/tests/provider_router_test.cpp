@@ -0,0 +1,287 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/provider_router.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+#include <thread>
+#include <unistd.h>
+
+using namespace hyni;
+using hyni::testing::claude_answer;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_server;
+using hyni::testing::openai_answer;
+using hyni::testing::provider_behaviour;
+using json = nlohmann::json;
+using std::chrono::milliseconds;
+
+class ProviderRouterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_openai = std::make_unique<local_http_server>([this](const local_http_request& request) {
+            return openai_answer(request, m_openai_behaviour);
+        });
+        m_claude = std::make_unique<local_http_server>([this](const local_http_request& request) {
+            return claude_answer(request, m_claude_behaviour);
+        });
+
+        // The real schemas, pointed at the local servers
+        auto builder = schema_registry::create();
+        for (const auto& [name, server] : {std::pair{"openai", m_openai.get()}, std::pair{"claude", m_claude.get()}}) {
+            std::ifstream file(std::string("../schemas/") + name + ".json");
+            if (!file.is_open()) GTEST_SKIP() << "Schema file not found";
+            json schema;
+            file >> schema;
+            schema["api"]["endpoint"] = server->url("/v1");
+            const auto path = std::filesystem::temp_directory_path() /
+                              ("hyni_router_" + std::to_string(::getpid()) + "_" + name + ".json");
+            std::ofstream(path) << schema.dump();
+            m_schema_files.push_back(path);
+            builder.register_schema(name, path.string());
+        }
+        m_factory = std::make_shared<context_factory>(builder.build());
+        m_chat.add_user_message("Hello");
+    }
+
+    void TearDown() override {
+        for (const auto& path : m_schema_files) {
+            std::filesystem::remove(path);
+        }
+    }
+
+    // openai is the expensive candidate, claude the cheap one
+    std::unique_ptr<provider_router> make_router(router_options options = {}) {
+        route_candidate openai{"openai", "openai-key", {}, {}, 10.0, 30.0};
+        route_candidate claude{"claude", "claude-key", std::string("claude-3-5-haiku-20241022"), {}, 1.0, 5.0};
+        auto router = std::make_unique<provider_router>(m_factory, std::vector{openai, claude}, options);
+        router->set_transport(m_transport);
+        return router;
+    }
+
+    provider_behaviour m_openai_behaviour;
+    provider_behaviour m_claude_behaviour;
+    std::unique_ptr<local_http_server> m_openai;
+    std::unique_ptr<local_http_server> m_claude;
+    std::vector<std::filesystem::path> m_schema_files;
+    std::shared_ptr<context_factory> m_factory;
+    async_transport m_transport;
+    conversation m_chat;
+};
+
+TEST_F(ProviderRouterTest, FallsOverToTheNextCandidate) {
+    m_openai_behaviour.status = 503;
+    auto router = make_router();
+
+    auto result = router->send(m_chat);
+    EXPECT_EQ(result.provider, "claude");
+    EXPECT_EQ(result.model, "claude-3-5-haiku-20241022");
+    EXPECT_EQ(result.text, "from claude");
+    EXPECT_EQ(result.attempts, 2u);
+
+    const auto failed = router->get_stats(0);
+    EXPECT_EQ(failed.failures, 1u);
+    EXPECT_GT(failed.error_rate, 0.0);
+    EXPECT_FALSE(failed.latency_ms);
+    EXPECT_TRUE(router->get_stats(1).latency_ms);
+
+    // The failing candidate now ranks behind the working one
+    EXPECT_EQ(router->rank(m_chat), (std::vector<size_t>{1, 0}));
+
+    m_claude_behaviour.status = 500;
+    try {
+        (void)router->send(m_chat);
+        FAIL() << "Expected every provider to fail";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("openai: HTTP 503"), std::string::npos);
+        EXPECT_NE(std::string(e.what()).find("claude: HTTP 500"), std::string::npos);
+    }
+}
+
+TEST_F(ProviderRouterTest, FailingCandidateGetsAnotherChance) {
+    router_options options;
+    options.error_half_life = milliseconds(20);
+    m_openai_behaviour.status = 503;
+    auto router = make_router(options);
+    EXPECT_EQ(router->send(m_chat).provider, "claude");
+    EXPECT_EQ(router->rank(m_chat).front(), 1u);
+
+    // Once the error rate has decayed, the faster candidate is tried again
+    std::this_thread::sleep_for(milliseconds(100));
+    EXPECT_LT(router->get_stats(0).error_rate, options.max_error_rate);
+    m_openai_behaviour.status = 200;
+    EXPECT_EQ(router->rank(m_chat).front(), 0u);
+    EXPECT_EQ(router->send(m_chat).provider, "openai");
+}
+
+TEST_F(ProviderRouterTest, PrefersTheFasterCandidate) {
+    m_openai_behaviour.delay_ms = 150;
+    auto router = make_router();
+
+    // Unmeasured candidates go first, so each is tried once
+    EXPECT_EQ(router->send(m_chat).provider, "openai");
+    EXPECT_EQ(router->send(m_chat).provider, "claude");
+    EXPECT_EQ(router->send(m_chat).provider, "claude");
+    EXPECT_GT(*router->get_stats(0).latency_ms, *router->get_stats(1).latency_ms);
+}
+
+TEST_F(ProviderRouterTest, RanksStreamsByTimeToFirstToken) {
+    // openai is slow to answer; claude answers at once but is slow to start a stream
+    m_openai_behaviour.delay_ms = 100;
+    m_claude_behaviour.chunk_delay_ms = 200;
+    auto router = make_router();
+    (void)router->send(m_chat);
+    (void)router->send(m_chat);
+    (void)router->send_stream(m_chat, nullptr);
+    (void)router->send_stream(m_chat, nullptr);
+
+    const auto claude = router->get_stats(1);
+    ASSERT_TRUE(claude.latency_ms);
+    ASSERT_TRUE(claude.ttft_ms);
+    EXPECT_GT(*claude.ttft_ms, *claude.latency_ms);
+
+    // The streams' first tokens don't skew the complete-response ranking
+    EXPECT_EQ(router->rank(m_chat), (std::vector<size_t>{1, 0}));
+    EXPECT_EQ(router->rank(m_chat, {}, true), (std::vector<size_t>{0, 1}));
+    EXPECT_EQ(router->send(m_chat).provider, "claude");
+    EXPECT_EQ(router->send_stream(m_chat, nullptr).provider, "openai");
+}
+
+TEST_F(ProviderRouterTest, MeetsALatencyTargetAsCheaplyAsPossible) {
+    m_claude_behaviour.delay_ms = 150;
+    auto router = make_router();
+    (void)router->send(m_chat);
+    (void)router->send(m_chat);
+    ASSERT_TRUE(router->get_stats(0).latency_ms);
+    ASSERT_TRUE(router->get_stats(1).latency_ms);
+
+    // Only the expensive candidate is fast enough
+    route_target tight;
+    tight.max_latency = milliseconds(100);
+    EXPECT_EQ(router->send(m_chat, tight).provider, "openai");
+
+    // Both are, so the cheap one wins
+    route_target relaxed;
+    relaxed.max_latency = milliseconds(2000);
+    EXPECT_EQ(router->send(m_chat, relaxed).provider, "claude");
+
+    // A cost ceiling only the cheap one meets beats raw speed
+    route_target budget;
+    budget.max_cost = 0.005;
+    EXPECT_EQ(router->rank(m_chat, budget), (std::vector<size_t>{1, 0}));
+}
+
+TEST_F(ProviderRouterTest, AvoidsCandidatesOutOfRateLimitHeadroom) {
+    auto router = make_router();
+
+    // Low headroom: 5 of 100 requests left
+    m_openai_behaviour.headers = {{"x-ratelimit-limit-requests", "100"},
+                                  {"x-ratelimit-remaining-requests", "5"},
+                                  {"x-ratelimit-reset-requests", "30s"}};
+    EXPECT_EQ(router->send(m_chat).provider, "openai");
+    auto stats = router->get_stats(0);
+    ASSERT_TRUE(stats.headroom);
+    EXPECT_DOUBLE_EQ(*stats.headroom, 0.05);
+    EXPECT_GT(stats.limits_expire, std::chrono::steady_clock::now() + std::chrono::seconds(20));
+    EXPECT_EQ(router->rank(m_chat).front(), 1u);
+
+    // Throttled: a 429 with Retry-After ranks behind even a low-headroom candidate
+    m_claude_behaviour.status = 429;
+    m_claude_behaviour.headers = {{"retry-after", "20"}};
+    EXPECT_EQ(router->send(m_chat).provider, "openai");
+    stats = router->get_stats(1);
+    EXPECT_GT(stats.throttled_until, std::chrono::steady_clock::now() + std::chrono::seconds(10));
+    EXPECT_EQ(router->rank(m_chat), (std::vector<size_t>{0, 1}));
+
+    // An exhausted limit throttles too
+    m_openai_behaviour.headers = {{"anthropic-ratelimit-requests-limit", "50"},
+                                  {"anthropic-ratelimit-requests-remaining", "0"}};
+    (void)router->send(m_chat);
+    EXPECT_GT(router->get_stats(0).throttled_until, std::chrono::steady_clock::now());
+}
+
+TEST_F(ProviderRouterTest, StreamSkipsCandidatesThatCannotStream) {
+    // The same schemas, with streaming turned off for openai or for both
+    const auto without_streaming = [this](std::initializer_list<size_t> which) {
+        auto builder = schema_registry::create();
+        for (size_t i = 0; i < 2; ++i) {
+            json schema = json::parse(std::ifstream(m_schema_files[i]));
+            if (std::find(which.begin(), which.end(), i) != which.end()) {
+                schema["features"]["streaming"] = false;
+            }
+            auto path = m_schema_files[i];
+            path += ".nostream" + std::to_string(m_schema_files.size());
+            std::ofstream(path) << schema.dump();
+            m_schema_files.push_back(path);
+            builder.register_schema(i == 0 ? "openai" : "claude", path.string());
+        }
+        m_factory = std::make_shared<context_factory>(builder.build());
+        return make_router();
+    };
+
+    auto router = without_streaming({0});
+    auto result = router->send_stream(m_chat, nullptr);
+    EXPECT_EQ(result.provider, "claude");
+    EXPECT_EQ(result.attempts, 1u);
+    EXPECT_EQ(router->get_stats(0).requests, 0u);
+
+    m_claude_behaviour.status = 500;
+    try {
+        (void)router->send_stream(m_chat, nullptr);
+        FAIL() << "Expected the stream to fail";
+    } catch (const streaming_not_supported_error&) {
+        FAIL() << "claude can stream";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("openai: streaming not supported"), std::string::npos);
+    }
+
+    router = without_streaming({0, 1});
+    EXPECT_THROW((void)router->send_stream(m_chat, nullptr), streaming_not_supported_error);
+}
+
+TEST_F(ProviderRouterTest, StreamFallsOverBeforeItsFirstToken) {
+    m_openai_behaviour.status = 500;
+    auto router = make_router();
+
+    std::vector<std::string> deltas;
+    auto result = router->send_stream(m_chat, [&](const stream_event& event) {
+        if (event.type == stream_event_type::text_delta) {
+            deltas.emplace_back(event.text);
+        }
+        return true;
+    });
+    EXPECT_EQ(result.provider, "claude");
+    EXPECT_EQ(result.text, "claude says hi");
+    EXPECT_EQ(deltas, (std::vector<std::string>{"claude", " says hi"}));
+    EXPECT_EQ(result.attempts, 2u);
+    EXPECT_EQ(router->get_stats(0).failures, 1u);
+}
+
+TEST_F(ProviderRouterTest, RefusesToWaitOnTheEventLoop) {
+    auto router = make_router();
+
+    transport_request request;
+    request.url = m_openai->url("/v1");
+    request.body = std::make_shared<const std::string>("{}");
+    std::promise<bool> refused;
+    m_transport.submit(std::move(request), [&](http_response) {
+        try {
+            (void)router->send_stream(m_chat, nullptr);
+            refused.set_value(false);
+        } catch (const std::logic_error&) {
+            refused.set_value(true);
+        }
+    });
+    EXPECT_TRUE(refused.get_future().get());
+}
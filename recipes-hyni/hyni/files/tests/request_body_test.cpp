@@ -0,0 +1,120 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/general_context.h"
+#include "../src/http_client.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+class RequestBodyTest : public ::testing::TestWithParam<const char*> {
+protected:
+    void SetUp() override {
+        std::ifstream file(std::string("../schemas/") + GetParam() + ".json");
+        if (!file.is_open()) GTEST_SKIP() << GetParam() << " schema file not found";
+        file >> m_schema;
+    }
+
+    json m_schema;
+};
+
+// Prompt caching remembers what was sent, so the two builds run on twin
+// contexts driven through the same steps rather than on one context twice
+struct twin_contexts {
+    general_context body;
+    general_context object;
+
+    twin_contexts(const json& schema, const context_config& config = {})
+        : body(schema, config), object(schema, config) {}
+
+    template <typename F>
+    void apply(F&& step) {
+        step(body);
+        step(object);
+    }
+
+    void expect_same(bool streaming = false) {
+        const std::string serialized = body.build_request_body(streaming);
+        EXPECT_EQ(serialized, object.build_request(streaming).dump());
+        EXPECT_TRUE(json::accept(serialized));
+    }
+};
+
+TEST_P(RequestBodyTest, MatchesBuildRequest) {
+    twin_contexts contexts(m_schema);
+    contexts.expect_same();
+
+    contexts.apply([](general_context& c) { c.add_user_message("Hello \"world\"\né"); });
+    contexts.expect_same();
+    contexts.expect_same(true);
+
+    contexts.apply([](general_context& c) {
+        c.set_system_message("Be brief.");
+        c.set_parameter("temperature", 0.25);
+        c.add_assistant_message("Hi!");
+        c.add_user_message("Describe", "image/png", "iVBORw0KGgoAAAANSUhEUgAAAAE=");
+    });
+    contexts.expect_same();
+    contexts.expect_same(true);
+}
+
+TEST_P(RequestBodyTest, MatchesBuildRequestWithLongHistory) {
+    context_config config;
+    config.enable_history_window = true;
+    config.max_context_tokens = 6000;
+    twin_contexts contexts(m_schema, config);
+    contexts.apply([](general_context& c) { c.set_system_message(std::string(8000, 's')); });
+
+    // Enough turns for the window to drop some and for cache breakpoints to move
+    for (int i = 0; i < 40; ++i) {
+        contexts.apply([i](general_context& c) {
+            c.add_user_message("question " + std::to_string(i) + std::string(2000, 'q'));
+            c.add_assistant_message("answer " + std::to_string(i));
+        });
+        contexts.expect_same();
+    }
+    EXPECT_GT(contexts.body.get_history_window_start(), 0u);
+}
+
+TEST_P(RequestBodyTest, MessagesParameterOverridesHistory) {
+    twin_contexts contexts(m_schema);
+    contexts.apply([](general_context& c) {
+        c.add_user_message("from history");
+        c.set_parameter("messages", json::array({{{"role", "user"}, {"content", "explicit"}}}));
+    });
+    contexts.expect_same();
+    EXPECT_EQ(json::parse(contexts.body.build_request_body())["messages"][0]["content"], "explicit");
+}
+
+INSTANTIATE_TEST_SUITE_P(Providers, RequestBodyTest,
+                         ::testing::Values("claude", "openai", "deepseek", "mistral"));
+
+TEST(RequestBodyMoveTest, MovedPromptKeepsItsBuffer) {
+    std::ifstream file("../schemas/claude.json");
+    if (!file.is_open()) GTEST_SKIP() << "Claude schema file not found";
+    general_context context(json::parse(file));
+
+    std::string prompt(200000, 'x');
+    const char* buffer = prompt.data();
+    context.add_user_message(std::move(prompt));
+
+    const auto& text = context.get_messages()[0]["content"][0]["text"];
+    EXPECT_EQ(text.get_ref<const std::string&>().data(), buffer);
+}
+
+TEST(RequestBodyMoveTest, NullBodyIsRejected) {
+    http_client client;
+    auto response = client.post("http://localhost:1", request_body{});
+    EXPECT_FALSE(response.success);
+}
@@ -0,0 +1,219 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/hash.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <thread>
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::local_http_server;
+using json = nlohmann::json;
+
+namespace {
+
+// Keys that land in the same shard, so they compete for one share of the budget
+std::vector<std::string> keys_in_one_shard(size_t count) {
+    std::vector<std::string> keys;
+    for (size_t i = 0; keys.size() < count; ++i) {
+        std::string key = "key-" + std::to_string(i);
+        if (content_hash(key) % response_cache::SHARD_COUNT == 0) {
+            keys.push_back(std::move(key));
+        }
+    }
+    return keys;
+}
+
+} // anonymous namespace
+
+TEST(ResponseCacheTest, StoresAndFindsByExactKey) {
+    response_cache cache;
+    const auto key = response_cache::make_key("https://api.example.com", R"({"a":1})");
+    EXPECT_EQ(cache.find(key), nullptr);
+
+    cache.insert(key, "response");
+    auto hit = cache.find(key);
+    ASSERT_NE(hit, nullptr);
+    EXPECT_EQ(*hit, "response");
+    EXPECT_EQ(cache.find(response_cache::make_key("https://other.example.com", R"({"a":1})")), nullptr);
+
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, key.size() + 8);
+    EXPECT_EQ(stats.hit_count, 1u);
+    EXPECT_EQ(stats.miss_count, 2u);
+    EXPECT_DOUBLE_EQ(stats.hit_rate(), 1.0 / 3.0);
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsedWithinBudget) {
+    // Each shard may hold 100 bytes: two 40 byte entries
+    response_cache cache(100 * response_cache::SHARD_COUNT);
+    const auto keys = keys_in_one_shard(3);
+    const std::string response(40 - keys[0].size(), 'r');
+
+    cache.insert(keys[0], response);
+    cache.insert(keys[1], response);
+    EXPECT_NE(cache.find(keys[0]), nullptr); // Now more recent than keys[1]
+    cache.insert(keys[2], response);
+
+    EXPECT_NE(cache.find(keys[0]), nullptr);
+    EXPECT_EQ(cache.find(keys[1]), nullptr);
+    EXPECT_NE(cache.find(keys[2]), nullptr);
+    EXPECT_EQ(cache.get_cache_stats().eviction_count, 1u);
+
+    // Larger than a shard's budget: not stored at all
+    cache.insert("big", std::string(200, 'x'));
+    EXPECT_EQ(cache.find("big"), nullptr);
+
+    cache.set_max_bytes(0);
+    EXPECT_EQ(cache.get_cache_stats().entries, 0u);
+    cache.clear();
+    EXPECT_EQ(cache.get_cache_stats().miss_count, 0u);
+}
+
+TEST(ResponseCacheTest, ConcurrentAccessStaysConsistent) {
+    response_cache cache;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 2000; ++i) {
+                std::string key = "k";
+                key += std::to_string(i % 100);
+                if (auto hit = cache.find(key)) {
+                    EXPECT_EQ(*hit, "v" + key);
+                } else {
+                    cache.insert(key, "v" + key);
+                }
+            }
+            (void)t;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto stats = cache.get_cache_stats();
+    EXPECT_EQ(stats.entries, 100u);
+    EXPECT_EQ(stats.hit_count + stats.miss_count, 8000u);
+}
+
+class ResponseCachingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        m_server = std::make_unique<local_http_server>([this](const local_http_request& request) {
+            const json body = json::parse(request.body);
+            const std::string prompt = body["messages"].back()["content"][0]["text"];
+            local_http_response response;
+            if (m_truncate_next.exchange(false)) {
+                response.body = R"({"choices":[{"message":)";
+                return response;
+            }
+            response.body = json{{"choices", {{{"message", {{"role", "assistant"},
+                {"content", "answer " + std::to_string(++m_answers) + " to " + prompt}}}}}}}.dump();
+            return response;
+        });
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+    }
+
+    std::unique_ptr<chat_api> make_api(const context_config& config = {},
+                                       std::optional<double> temperature = 0.0) {
+        auto context = std::make_unique<general_context>(m_schema, config);
+        context->set_api_key("test-key");
+        if (temperature) {
+            context->set_parameter("temperature", *temperature);
+        }
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_response_cache(m_cache);
+        api->set_transport(m_transport);
+        return api;
+    }
+
+    json m_schema;
+    std::atomic<int> m_answers{0};
+    std::atomic<bool> m_truncate_next{false};
+    std::unique_ptr<local_http_server> m_server;
+    response_cache m_cache;
+    async_transport m_transport;
+};
+
+TEST_F(ResponseCachingTest, DeterministicRequestsAreAnsweredFromCache) {
+    auto api = make_api();
+    EXPECT_EQ(api->send_message("hi"), "answer 1 to hi");
+    EXPECT_EQ(api->send_message("hi"), "answer 1 to hi");
+
+    // Another chat_api sharing the cache, through the coroutine API
+    auto other = make_api();
+    EXPECT_EQ(sync_wait(other->co_send_message("hi")), "answer 1 to hi");
+    EXPECT_EQ(sync_wait(other->co_send_message("bye")), "answer 2 to bye");
+
+    EXPECT_EQ(m_server->requests(), 2u);
+    auto stats = m_cache.get_cache_stats();
+    EXPECT_EQ(stats.hit_count, 2u);
+    EXPECT_EQ(stats.miss_count, 2u);
+    EXPECT_EQ(stats.entries, 2u);
+}
+
+TEST_F(ResponseCachingTest, UnparsableAnswersAreNotCached) {
+    auto api = make_api();
+    m_truncate_next = true;
+    EXPECT_THROW((void)api->send_message("hi"), std::runtime_error);
+    EXPECT_EQ(m_cache.get_cache_stats().entries, 0u);
+
+    // The next identical request goes upstream instead of replaying the truncated body
+    EXPECT_EQ(api->send_message("hi"), "answer 1 to hi");
+    EXPECT_EQ(api->send_message("hi"), "answer 1 to hi");
+    EXPECT_EQ(m_server->requests(), 2u);
+}
+
+TEST_F(ResponseCachingTest, SampledRequestsBypassCacheUnlessForced) {
+    auto sampled = make_api({}, 0.7);
+    EXPECT_FALSE(sampled->get_context().allows_response_caching());
+    EXPECT_EQ(sampled->send_message("hi"), "answer 1 to hi");
+    EXPECT_EQ(sampled->send_message("hi"), "answer 2 to hi");
+
+    // The schema's default temperature is not 0 either
+    auto schema_default = make_api({}, std::nullopt);
+    EXPECT_FALSE(schema_default->get_context().allows_response_caching());
+
+    context_config forced;
+    forced.force_response_caching = true;
+    auto forced_api = make_api(forced, 0.7);
+    EXPECT_EQ(forced_api->send_message("hi"), "answer 3 to hi");
+    EXPECT_EQ(forced_api->send_message("hi"), "answer 3 to hi");
+
+    context_config disabled;
+    disabled.enable_caching = false;
+    disabled.force_response_caching = true;
+    auto disabled_api = make_api(disabled);
+    EXPECT_FALSE(disabled_api->get_context().allows_response_caching());
+    EXPECT_EQ(disabled_api->send_message("hi"), "answer 4 to hi");
+    EXPECT_EQ(m_server->requests(), 4u);
+}
+
+TEST_F(ResponseCachingTest, BatchServesCachedPromptsWithoutSending) {
+    auto api = make_api();
+    const std::vector<std::string> prompts = {"a", "b"};
+    auto first = api->send_batch(prompts);
+    auto second = api->send_batch(prompts);
+
+    EXPECT_EQ(m_server->requests(), 2u);
+    for (size_t i = 0; i < prompts.size(); ++i) {
+        EXPECT_TRUE(second[i].success);
+        EXPECT_EQ(second[i].text, first[i].text);
+        EXPECT_EQ(second[i].attempts, 0u);
+    }
+}
@@ -0,0 +1,186 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "local_http_server.h"
+
+using namespace hyni;
+using namespace std::chrono_literals;
+
+namespace {
+
+transport_request raw_request(const std::string& url, const std::string& body) {
+    transport_request request;
+    request.url = url;
+    request.body = std::make_shared<const std::string>(body);
+    request.headers["Content-Type"] = "application/json";
+    request.single_flight = true;
+    return request;
+}
+
+void wait_idle(const async_transport& transport) {
+    while (transport.in_flight() > 0) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+} // anonymous namespace
+
+class SingleFlightTest : public hyni::testing::openai_server_test {
+protected:
+    void SetUp() override {
+        openai_server_test::SetUp();
+        if (IsSkipped()) return;
+        // Slow enough that requests sent together overlap upstream
+        serve(hyni::testing::openai_echo(100ms, 50ms));
+    }
+
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_transport(m_transport);
+        api->set_single_flight(true);
+        return api;
+    }
+
+    async_transport m_transport;
+};
+
+TEST_F(SingleFlightTest, IdenticalRequestsShareOneTransfer) {
+    const std::string body = R"({"messages":[{"role":"user","content":[{"type":"text","text":"same"}]}]})";
+    // Same JSON with other key order and spacing
+    const std::string reordered = R"({ "messages": [ { "content": [ { "text": "same", "type": "text" } ], "role": "user" } ] })";
+
+    std::atomic<int> succeeded{0};
+    auto on_complete = [&](http_response response) {
+        if (response.success && response.body.find("re: same") != std::string::npos) ++succeeded;
+    };
+    for (int i = 0; i < 8; ++i) {
+        m_transport.submit(raw_request(m_server->url(), i % 2 ? body : reordered), on_complete);
+    }
+    wait_idle(m_transport);
+
+    EXPECT_EQ(succeeded.load(), 8);
+    EXPECT_EQ(m_server->requests(), 1u);
+    EXPECT_EQ(m_transport.coalesced(), 7u);
+}
+
+TEST_F(SingleFlightTest, DifferentRequestsAreNotShared) {
+    auto body = [](const std::string& text) {
+        return R"({"messages":[{"role":"user","content":[{"type":"text","text":")" + text + R"("}]}]})";
+    };
+    m_transport.submit(raw_request(m_server->url(), body("a")), nullptr);
+    m_transport.submit(raw_request(m_server->url(), body("b")), nullptr);
+    auto other_key = raw_request(m_server->url(), body("a"));
+    other_key.headers["Authorization"] = "Bearer other";
+    m_transport.submit(std::move(other_key), nullptr);
+    auto opted_out = raw_request(m_server->url(), body("a"));
+    opted_out.single_flight = false;
+    m_transport.submit(std::move(opted_out), nullptr);
+    wait_idle(m_transport);
+
+    EXPECT_EQ(m_server->requests(), 4u);
+    EXPECT_EQ(m_transport.coalesced(), 0u);
+}
+
+TEST_F(SingleFlightTest, StreamIsFannedOutToEveryWaiter) {
+    auto first = make_api();
+    auto second = make_api();
+    auto read_all = [](chat_api& api) -> task<std::string> {
+        auto stream = api.co_send_message_stream("story");
+        std::string text;
+        while (auto delta = co_await stream.next()) {
+            text += *delta;
+        }
+        co_return text;
+    };
+
+    auto leader = std::async(std::launch::async, [&] { return sync_wait(read_all(*first)); });
+    // Joins after the first chunk has arrived and is replayed to it
+    std::this_thread::sleep_for(80ms);
+    EXPECT_EQ(sync_wait(read_all(*second)), "Hello there");
+    EXPECT_EQ(leader.get(), "Hello there");
+    EXPECT_EQ(m_server->requests(), 1u);
+    EXPECT_EQ(m_transport.coalesced(), 1u);
+}
+
+TEST_F(SingleFlightTest, CancellingOneWaiterKeepsTheOthers) {
+    const std::string body = R"({"messages":[{"role":"user","content":[{"type":"text","text":"x"}]}]})";
+    std::string cancelled_error;
+    bool other_succeeded = false;
+    const auto id = m_transport.submit(raw_request(m_server->url(), body), [&](http_response response) {
+        cancelled_error = response.error_message;
+    });
+    m_transport.submit(raw_request(m_server->url(), body), [&](http_response response) {
+        other_succeeded = response.success;
+    });
+    std::this_thread::sleep_for(20ms);
+    m_transport.cancel(id);
+    wait_idle(m_transport);
+
+    EXPECT_EQ(cancelled_error, "Request cancelled");
+    EXPECT_TRUE(other_succeeded);
+    EXPECT_EQ(m_server->requests(), 1u);
+}
+
+TEST_F(SingleFlightTest, CancellingEveryWaiterAbortsTheTransfer) {
+    const std::string body = R"({"messages":[{"role":"user","content":[{"type":"text","text":"y"}]}]})";
+    std::atomic<int> cancelled{0};
+    auto on_complete = [&](http_response response) {
+        if (response.error_message == "Request cancelled") ++cancelled;
+    };
+    const auto first = m_transport.submit(raw_request(m_server->url(), body), on_complete);
+    const auto second = m_transport.submit(raw_request(m_server->url(), body), on_complete);
+
+    // The server takes 100 ms to answer
+    const auto start = std::chrono::steady_clock::now();
+    m_transport.cancel(first);
+    m_transport.cancel(second);
+    wait_idle(m_transport);
+
+    EXPECT_EQ(cancelled.load(), 2);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 90ms);
+}
+
+TEST_F(SingleFlightTest, BlockingSendsFromManyThreadsShareOneTransfer) {
+    std::vector<std::unique_ptr<chat_api>> apis;
+    for (int i = 0; i < 4; ++i) {
+        apis.push_back(make_api());
+    }
+    std::vector<std::future<std::string>> answers;
+    for (auto& api : apis) {
+        answers.push_back(std::async(std::launch::async, [&api] { return api->send_message("hi"); }));
+    }
+    for (auto& answer : answers) {
+        EXPECT_EQ(answer.get(), "re: hi");
+    }
+    EXPECT_LT(m_server->requests(), 4u);
+    EXPECT_EQ(m_server->requests() + m_transport.coalesced(), 4u);
+}
+
+TEST_F(SingleFlightTest, BlockingSendOnTheEventLoopDoesNotDeadlock) {
+    auto api = make_api();
+    std::promise<std::string> answer;
+    const std::string body = R"({"messages":[{"role":"user","content":[{"type":"text","text":"outer"}]}]})";
+    m_transport.submit(raw_request(m_server->url(), body), [&](http_response) {
+        // Runs on the transport thread, which could not answer its own wait
+        try {
+            answer.set_value(api->send_message("inner"));
+        } catch (...) {
+            answer.set_exception(std::current_exception());
+        }
+    });
+    auto result = answer.get_future();
+    ASSERT_EQ(result.wait_for(10s), std::future_status::ready);
+    EXPECT_EQ(result.get(), "re: inner");
+}
@@ -0,0 +1,155 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/sse_decoder.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+struct owned_event {
+    std::string type;
+    std::string data;
+    std::string id;
+
+    bool operator==(const owned_event&) const = default;
+};
+
+std::ostream& operator<<(std::ostream& os, const owned_event& e) {
+    return os << "{type=" << e.type << " data=" << e.data << " id=" << e.id << "}";
+}
+
+// Feeds the stream split at the given offsets and collects the events
+std::vector<owned_event> decode(std::string_view stream, const std::vector<size_t>& splits = {}) {
+    std::vector<owned_event> events;
+    sse_decoder decoder;
+    const sse_decoder::event_callback collect = [&](const sse_event& e) {
+        events.push_back({std::string(e.type), std::string(e.data), std::string(e.id)});
+    };
+    size_t pos = 0;
+    for (size_t split : splits) {
+        decoder.feed(stream.substr(pos, split - pos), collect);
+        pos = split;
+    }
+    decoder.feed(stream.substr(pos), collect);
+    decoder.finish(collect);
+    return events;
+}
+
+} // anonymous namespace
+
+TEST(SseDecoderTest, DecodesDataEvents) {
+    const auto events = decode("data: {\"a\":1}\n\ndata: {\"b\":2}\n\ndata: [DONE]\n\n");
+    ASSERT_EQ(events.size(), 3u);
+    EXPECT_EQ(events[0].data, "{\"a\":1}");
+    EXPECT_EQ(events[1].data, "{\"b\":2}");
+    EXPECT_EQ(events[2].data, "[DONE]");
+    EXPECT_TRUE(events[0].type.empty());
+}
+
+TEST(SseDecoderTest, DecodesEventTypesAndMultiLineData) {
+    const auto events = decode(
+        "event: message_start\n"
+        "data: {\"type\":\"message_start\"}\n"
+        "\n"
+        ": keep-alive comment\n"
+        "event: content_block_delta\n"
+        "data: first\n"
+        "data:second\n"
+        "data\n"
+        "\n");
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, "message_start");
+    EXPECT_EQ(events[1].type, "content_block_delta");
+    EXPECT_EQ(events[1].data, "first\nsecond\n");
+}
+
+TEST(SseDecoderTest, HandlesCrLfIdRetryAndBom) {
+    sse_decoder decoder;
+    std::vector<owned_event> events;
+    const sse_decoder::event_callback collect = [&](const sse_event& e) {
+        events.push_back({std::string(e.type), std::string(e.data), std::string(e.id)});
+    };
+    decoder.feed("\xEF\xBB\xBF" "id: 7\r\nretry: 1500\r\ndata: x\r\n\r\nevent: ping\r\n\r\ndata: y\r\n\r\n",
+                 collect);
+    ASSERT_EQ(events.size(), 2u); // The ping without data is not dispatched
+    EXPECT_EQ(events[0], (owned_event{"", "x", "7"}));
+    EXPECT_EQ(events[1], (owned_event{"", "y", "7"})); // The last ID carries over
+    EXPECT_EQ(decoder.retry_ms(), 1500u);
+}
+
+TEST(SseDecoderTest, KeepsPartialLinesAcrossChunks) {
+    sse_decoder decoder;
+    std::vector<std::string> data;
+    const sse_decoder::event_callback collect = [&](const sse_event& e) {
+        data.emplace_back(e.data);
+    };
+    decoder.feed("data: {\"text\":\"Hel", collect);
+    EXPECT_TRUE(data.empty());
+    EXPECT_GT(decoder.pending_bytes(), 0u);
+    decoder.feed("lo\"}\n", collect);
+    EXPECT_TRUE(data.empty()); // Not yet terminated by a blank line
+    decoder.feed("\ndata: {\"text\":\" world\"}\n\n", collect);
+    ASSERT_EQ(data.size(), 2u);
+    EXPECT_EQ(data[0], "{\"text\":\"Hello\"}");
+    EXPECT_EQ(data[1], "{\"text\":\" world\"}");
+}
+
+TEST(SseDecoderTest, FinishReportsUnterminatedEvent) {
+    const auto events = decode("data: a\n\ndata: tail");
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[1].data, "tail");
+}
+
+TEST(SseDecoderTest, SingleLineEventsAreNotCopied) {
+    const std::string chunk = "data: {\"delta\":\"abc\"}\n\n";
+    sse_decoder decoder;
+    const char* seen = nullptr;
+    decoder.feed(chunk, [&](const sse_event& e) { seen = e.data.data(); });
+    EXPECT_EQ(seen, chunk.data() + 6);
+}
+
+// Fuzz harness: any split of a stream into chunks must decode exactly like the
+// whole stream fed at once. Streams mix every line form the decoder knows.
+TEST(SseDecoderTest, ArbitraryChunkSplitsDecodeIdentically) {
+    std::mt19937 rng(20240611);
+    const std::vector<std::string> pieces = {
+        "data: {\"choices\":[{\"delta\":{\"content\":\"token\"}}]}\n",
+        "data: second line\n", "data:\n", "data\n", "event: content_block_delta\n",
+        "event: ping\n", ": comment\n", "id: 42\n", "retry: 10\n", "unknown: x\n",
+        "\n", "\r\n", "data: crlf\r\n", "data: unicode \xC3\xA9\xE2\x82\xAC\n",
+        "data: [DONE]\n"};
+
+    for (int round = 0; round < 300; ++round) {
+        std::string stream = round % 7 == 0 ? "\xEF\xBB\xBF" : "";
+        const int lines = 1 + static_cast<int>(rng() % 40);
+        for (int i = 0; i < lines; ++i) {
+            stream += pieces[rng() % pieces.size()];
+        }
+        if (rng() % 3 == 0) {
+            stream += "data: unterminated";
+        }
+
+        const auto expected = decode(stream);
+
+        // Random cut points, including single-byte chunks
+        std::vector<size_t> splits;
+        for (size_t pos = 0; pos < stream.size();) {
+            pos += 1 + rng() % (round % 4 == 0 ? 2 : 24);
+            if (pos < stream.size()) splits.push_back(pos);
+        }
+        ASSERT_EQ(decode(stream, splits), expected) << "round " << round << " stream: " << stream;
+    }
+}
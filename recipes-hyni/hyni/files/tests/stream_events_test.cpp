@@ -0,0 +1,198 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/general_context.h"
+#include "../src/stream_events.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+namespace {
+
+struct recorded {
+    std::vector<stream_event_type> types;
+    std::string text;
+    std::string finish_reason;
+    std::string error;
+    std::vector<json> usage;
+};
+
+json load_schema(const std::string& provider) {
+    std::ifstream file("../schemas/" + provider + ".json");
+    if (!file.is_open()) return nullptr;
+    return json::parse(file);
+}
+
+// Decodes a raw stream and records every typed event
+recorded replay(const stream_event_parser& parser, std::string_view stream) {
+    recorded out;
+    const stream_event_callback record = [&](const stream_event& e) {
+        out.types.push_back(e.type);
+        switch (e.type) {
+        case stream_event_type::text_delta: out.text += e.text; break;
+        case stream_event_type::finish: out.finish_reason = e.text; break;
+        case stream_event_type::error: out.error = e.text; break;
+        case stream_event_type::usage: out.usage.push_back(*e.usage); break;
+        default: break;
+        }
+        return true;
+    };
+    sse_decoder decoder;
+    const sse_decoder::event_callback on_sse = [&](const sse_event& e) { parser.parse(e, record); };
+    decoder.feed(stream, on_sse);
+    decoder.finish(on_sse);
+    return out;
+}
+
+size_t count(const recorded& r, stream_event_type type) {
+    return static_cast<size_t>(std::count(r.types.begin(), r.types.end(), type));
+}
+
+const std::string OPENAI_STREAM =
+    "data: {\"id\":\"c\",\"choices\":[{\"index\":0,\"delta\":{\"role\":\"assistant\",\"content\":\"\"},\"finish_reason\":null}]}\n\n"
+    "data: {\"id\":\"c\",\"choices\":[{\"index\":0,\"delta\":{\"content\":\"Hello\"},\"finish_reason\":null}]}\n\n"
+    "data: {\"id\":\"c\",\"choices\":[{\"index\":0,\"delta\":{\"content\":\" there\"},\"finish_reason\":null}]}\n\n"
+    "data: {\"id\":\"c\",\"choices\":[{\"index\":0,\"delta\":{},\"finish_reason\":\"stop\"}]}\n\n"
+    "data: {\"id\":\"c\",\"choices\":[],\"usage\":{\"prompt_tokens\":9,\"completion_tokens\":2,\"total_tokens\":11}}\n\n"
+    "data: [DONE]\n\n";
+
+} // anonymous namespace
+
+TEST(StreamEventsTest, ClaudeStream) {
+    const json schema = load_schema("claude");
+    if (schema.is_null()) GTEST_SKIP() << "Claude schema file not found";
+    general_context context(schema);
+
+    const auto r = replay(context.get_stream_parser(),
+        "event: message_start\n"
+        "data: {\"type\":\"message_start\",\"message\":{\"id\":\"m\",\"usage\":{\"input_tokens\":25,\"output_tokens\":1}}}\n\n"
+        "event: content_block_start\n"
+        "data: {\"type\":\"content_block_start\",\"index\":0,\"content_block\":{\"type\":\"text\",\"text\":\"\"}}\n\n"
+        "event: ping\n"
+        "data: {\"type\": \"ping\"}\n\n"
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"Hello\"}}\n\n"
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"!\"}}\n\n"
+        "event: content_block_stop\n"
+        "data: {\"type\":\"content_block_stop\",\"index\":0}\n\n"
+        "event: message_delta\n"
+        "data: {\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"end_turn\",\"stop_sequence\":null},\"usage\":{\"output_tokens\":15}}\n\n"
+        "event: message_stop\n"
+        "data: {\"type\":\"message_stop\"}\n\n");
+
+    EXPECT_EQ(r.text, "Hello!");
+    EXPECT_EQ(r.finish_reason, "end_turn");
+    EXPECT_EQ(count(r, stream_event_type::ping), 1u);
+    EXPECT_EQ(count(r, stream_event_type::other), 2u); // Content block start and stop
+    ASSERT_EQ(r.usage.size(), 2u);
+    EXPECT_EQ(r.usage[0]["input_tokens"], 25);
+    EXPECT_EQ(r.usage[1]["output_tokens"], 15);
+    ASSERT_FALSE(r.types.empty());
+    EXPECT_EQ(r.types.back(), stream_event_type::done);
+
+    // Usage is reported before the finish reason of the same event
+    const auto usage_at = std::find(r.types.rbegin(), r.types.rend(), stream_event_type::usage);
+    const auto finish_at = std::find(r.types.rbegin(), r.types.rend(), stream_event_type::finish);
+    EXPECT_LT(finish_at, usage_at);
+}
+
+TEST(StreamEventsTest, OpenAiCompatibleStreams) {
+    for (const std::string provider : {"openai", "deepseek", "mistral"}) {
+        SCOPED_TRACE(provider);
+        const json schema = load_schema(provider);
+        if (schema.is_null()) GTEST_SKIP() << provider << " schema file not found";
+        general_context context(schema);
+        const auto& parser = context.get_stream_parser();
+        EXPECT_TRUE(parser.supports(stream_event_type::text_delta));
+        EXPECT_TRUE(parser.supports(stream_event_type::usage));
+        EXPECT_TRUE(parser.supports(stream_event_type::finish));
+
+        const auto r = replay(parser, OPENAI_STREAM);
+        EXPECT_EQ(r.text, "Hello there");
+        EXPECT_EQ(count(r, stream_event_type::text_delta), 2u); // The empty first delta is skipped
+        EXPECT_EQ(r.finish_reason, "stop");
+        ASSERT_EQ(r.usage.size(), 1u);
+        EXPECT_EQ(r.usage[0]["total_tokens"], 11);
+        EXPECT_EQ(r.types.back(), stream_event_type::done);
+    }
+}
+
+TEST(StreamEventsTest, ReportsErrorsInStream) {
+    const json claude = load_schema("claude");
+    const json openai = load_schema("openai");
+    if (claude.is_null() || openai.is_null()) GTEST_SKIP() << "Schema files not found";
+
+    auto r = replay(stream_event_parser(claude),
+        "event: error\n"
+        "data: {\"type\":\"error\",\"error\":{\"type\":\"overloaded_error\",\"message\":\"Overloaded\"}}\n\n");
+    EXPECT_EQ(r.types, std::vector<stream_event_type>{stream_event_type::error});
+    EXPECT_EQ(r.error, "Overloaded");
+
+    r = replay(stream_event_parser(openai),
+               "data: {\"error\":{\"message\":\"Rate limit reached\",\"type\":\"requests\"}}\n\n"
+               "data: not json\n\n");
+    ASSERT_EQ(r.types.size(), 2u);
+    EXPECT_EQ(r.types[0], stream_event_type::error);
+    EXPECT_EQ(r.types[1], stream_event_type::error);
+    EXPECT_EQ(r.error, "Malformed stream event: not json");
+}
+
+TEST(StreamEventsTest, ConsumerCanStopEarly) {
+    const json schema = load_schema("openai");
+    if (schema.is_null()) GTEST_SKIP() << "OpenAI schema file not found";
+    const stream_event_parser parser(schema);
+
+    // A consumer that wants only the first text delta
+    std::string text;
+    bool stopped = false;
+    size_t calls = 0;
+    sse_decoder decoder;
+    decoder.feed(OPENAI_STREAM, [&](const sse_event& e) {
+        if (stopped) return;
+        stopped = !parser.parse(e, [&](const stream_event& event) {
+            ++calls;
+            if (event.type != stream_event_type::text_delta) return true;
+            text += event.text;
+            return false;
+        });
+    });
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ(text, "Hello");
+    EXPECT_EQ(calls, 2u); // The role-only chunk, then the first delta
+
+    // When one event yields several typed events, stopping skips the rest
+    const json claude = load_schema("claude");
+    if (claude.is_null()) return;
+    std::vector<stream_event_type> seen;
+    const std::string data =
+        "{\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"max_tokens\"},\"usage\":{\"output_tokens\":3}}";
+    EXPECT_FALSE(stream_event_parser(claude).parse(sse_event{"message_delta", data, {}},
+        [&](const stream_event& event) {
+            seen.push_back(event.type);
+            return false;
+        }));
+    EXPECT_EQ(seen, std::vector<stream_event_type>{stream_event_type::usage});
+}
+
+TEST(StreamEventsTest, DefaultParserRecognizesOnlyProtocolEvents) {
+    const stream_event_parser parser;
+    EXPECT_FALSE(parser.supports(stream_event_type::text_delta));
+    const auto r = replay(parser, OPENAI_STREAM);
+    EXPECT_TRUE(r.text.empty());
+    EXPECT_EQ(count(r, stream_event_type::other), 5u);
+    EXPECT_EQ(r.types.back(), stream_event_type::done);
+}
@@ -0,0 +1,188 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/stream_metrics.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::local_http_server;
+using json = nlohmann::json;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+TEST(LatencyHistogramTest, BucketsByPowerOfTwo) {
+    latency_histogram histogram;
+    histogram.add(microseconds(0));
+    histogram.add(microseconds(1));
+    histogram.add(microseconds(3));
+    histogram.add(microseconds(1000));
+    EXPECT_EQ(histogram.count(), 4u);
+    EXPECT_EQ(histogram.bucket(0), 1u);
+    EXPECT_EQ(histogram.bucket(1), 1u);
+    EXPECT_EQ(histogram.bucket(2), 1u);
+    EXPECT_EQ(histogram.bucket(10), 1u); // [512, 1024)
+    EXPECT_EQ(histogram.max(), microseconds(1000));
+    EXPECT_EQ(histogram.mean(), microseconds(251));
+}
+
+TEST(LatencyHistogramTest, PercentilesAreBucketUpperBounds) {
+    latency_histogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), microseconds(0));
+    for (int i = 0; i < 99; ++i) {
+        histogram.add(microseconds(100));
+    }
+    histogram.add(milliseconds(50));
+    EXPECT_EQ(histogram.percentile(0.5), microseconds(127));
+    EXPECT_EQ(histogram.percentile(0.99), microseconds(127));
+    EXPECT_EQ(histogram.percentile(1.0), microseconds(50000)); // Capped at the maximum
+
+    latency_histogram other;
+    other.add(microseconds(10));
+    histogram += other;
+    EXPECT_EQ(histogram.count(), 101u);
+    EXPECT_EQ(histogram.percentile(0.0), microseconds(15));
+}
+
+TEST(StreamTimingTest, RecordsFirstTokenAndGaps) {
+    stream_timing timing;
+    timing.start = stream_timing::clock::now();
+    EXPECT_FALSE(timing.time_to_first_token());
+    EXPECT_FALSE(timing.time_to_headers());
+
+    timing.add_delta(timing.start + milliseconds(100));
+    timing.add_delta(timing.start + milliseconds(120));
+    timing.add_delta(timing.start + milliseconds(150));
+    timing.end = timing.start + milliseconds(160);
+    EXPECT_EQ(*timing.time_to_first_token(), milliseconds(100));
+    EXPECT_EQ(timing.deltas, 3u);
+    EXPECT_EQ(timing.gaps.count(), 2u);
+    EXPECT_EQ(timing.gaps.max(), milliseconds(30));
+    EXPECT_EQ(timing.duration(), milliseconds(160));
+}
+
+TEST(StreamMetricsTest, AggregatesPerProviderAndModel) {
+    stream_metrics metrics;
+    stream_timing timing;
+    timing.start = stream_timing::clock::now();
+    timing.headers_received = timing.start + milliseconds(5);
+    timing.add_delta(timing.start + milliseconds(10));
+    timing.add_delta(timing.start + milliseconds(20));
+    timing.bytes = 64;
+    timing.end = timing.start + milliseconds(25);
+
+    metrics.record("openai", "gpt-4o", timing, true);
+    metrics.record("openai", "gpt-4o", timing, false);
+    metrics.record("claude", "claude-sonnet", timing, true);
+
+    auto summary = metrics.get("openai", "gpt-4o");
+    ASSERT_TRUE(summary);
+    EXPECT_EQ(summary->streams, 2u);
+    EXPECT_EQ(summary->failures, 1u);
+    EXPECT_EQ(summary->deltas, 4u);
+    EXPECT_EQ(summary->bytes, 128u);
+    EXPECT_EQ(summary->time_to_headers.count(), 2u);
+    EXPECT_EQ(summary->time_to_first_token.max(), milliseconds(10));
+    EXPECT_EQ(summary->inter_token.count(), 2u);
+    EXPECT_EQ(metrics.snapshot().size(), 2u);
+    EXPECT_FALSE(metrics.get("openai", "gpt-3.5"));
+
+    metrics.reset();
+    EXPECT_TRUE(metrics.snapshot().empty());
+}
+
+class StreamTimingApiTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        m_server = std::make_unique<local_http_server>([](const local_http_request&) {
+            local_http_response response;
+            response.content_type = "text/event-stream";
+            response.chunk_delay = milliseconds(30);
+            for (const char* word : {"Hello", " there", "!"}) {
+                json chunk = {{"choices", {{{"index", 0}, {"delta", {{"content", word}}}}}}};
+                response.chunks.push_back("data: " + chunk.dump() + "\n\n");
+            }
+            response.chunks.push_back("data: [DONE]\n\n");
+            return response;
+        });
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+    }
+
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_transport(m_transport);
+        return api;
+    }
+
+    [[nodiscard]] uint64_t recorded_streams(const chat_api& api) const {
+        auto summary = stream_metrics::instance().get("openai", api.get_context().get_model());
+        return summary ? summary->streams : 0;
+    }
+
+    json m_schema;
+    std::unique_ptr<local_http_server> m_server;
+    async_transport m_transport;
+};
+
+TEST_F(StreamTimingApiTest, CompletionCallbackReceivesTiming) {
+    auto api = make_api();
+    const uint64_t before = recorded_streams(*api);
+
+    std::promise<http_response> done;
+    api->send_message_stream("hi", [](std::string) {},
+                             [&](const http_response& response) { done.set_value(response); });
+    const http_response response = done.get_future().get();
+    ASSERT_TRUE(response.success);
+    ASSERT_TRUE(response.timing);
+
+    const stream_timing& timing = *response.timing;
+    EXPECT_EQ(timing.deltas, 3u);
+    EXPECT_GT(timing.bytes, 0u);
+    ASSERT_TRUE(timing.time_to_headers());
+    ASSERT_TRUE(timing.time_to_first_token());
+    EXPECT_LE(*timing.time_to_headers(), *timing.time_to_first_token());
+    EXPECT_EQ(timing.gaps.count(), 2u);
+    EXPECT_GE(timing.gaps.max(), milliseconds(20));
+    EXPECT_GE(timing.duration(), *timing.time_to_first_token());
+
+    EXPECT_EQ(recorded_streams(*api), before + 1);
+}
+
+TEST_F(StreamTimingApiTest, CoroutineStreamsAreRecorded) {
+    auto api = make_api();
+    const uint64_t before = recorded_streams(*api);
+
+    auto read_all = [&]() -> task<std::string> {
+        auto stream = api->co_send_message_stream("hi");
+        std::string text;
+        while (auto delta = co_await stream.next()) {
+            text += *delta;
+        }
+        co_return text;
+    };
+    EXPECT_EQ(sync_wait(read_all()), "Hello there!");
+
+    // Recorded on the transport thread before the stream ends
+    EXPECT_EQ(recorded_streams(*api), before + 1);
+    auto summary = stream_metrics::instance().get("openai", api->get_context().get_model());
+    ASSERT_TRUE(summary);
+    EXPECT_GE(summary->inter_token.count(), 2u);
+}
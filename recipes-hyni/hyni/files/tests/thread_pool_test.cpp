@@ -0,0 +1,106 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+using namespace hyni;
+
+TEST(ThreadPoolTest, RunsTasksAndReturnsResults) {
+    thread_pool pool(3);
+    EXPECT_EQ(pool.size(), 3u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 50; ++i) {
+        results.push_back(pool.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+}
+
+TEST(ThreadPoolTest, PropagatesExceptions) {
+    thread_pool pool(1);
+    auto failing = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+    EXPECT_THROW(failing.get(), std::runtime_error);
+
+    // The worker survives a throwing task
+    EXPECT_EQ(pool.submit([] { return 7; }).get(), 7);
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueuedTasks) {
+    std::atomic<int> done{0};
+    {
+        thread_pool pool(2);
+        for (int i = 0; i < 100; ++i) {
+            (void)pool.submit([&done] { done.fetch_add(1); });
+        }
+    }
+    EXPECT_EQ(done.load(), 100);
+}
+
+TEST(ThreadPoolTest, SharedPoolIsSingleton) {
+    EXPECT_EQ(&thread_pool::shared(), &thread_pool::shared());
+    EXPECT_GE(thread_pool::shared().size(), 1u);
+    EXPECT_EQ(thread_pool::shared().submit([] { return 1; }).get(), 1);
+}
+
+TEST(ThreadPoolTest, IdleWorkersStealFromBusyWorker) {
+    thread_pool pool(4);
+
+    // Tasks submitted by a worker go to its own queue; while that worker is
+    // blocked, the others have to steal them
+    auto outer = pool.submit([&pool] {
+        EXPECT_TRUE(pool.in_worker());
+        std::vector<std::future<int>> inner;
+        for (int i = 0; i < 32; ++i) {
+            inner.push_back(pool.submit([i] { return i; }));
+        }
+        int sum = 0;
+        for (auto& f : inner) {
+            sum += f.get();
+        }
+        return sum;
+    });
+    EXPECT_EQ(outer.get(), 31 * 32 / 2);
+    EXPECT_GE(pool.steals(), 32u); // The outer task may have been stolen as well
+    EXPECT_EQ(pool.pending(), 0u);
+    EXPECT_FALSE(pool.in_worker());
+}
+
+TEST(ThreadPoolTest, SharedIoPoolIsBoundedAndSeparate) {
+    auto& io = thread_pool::shared_io();
+    EXPECT_NE(&io, &thread_pool::shared());
+    EXPECT_GE(io.size(), 8u);
+    EXPECT_LE(io.size(), 64u);
+
+    // More blocking tasks than workers queue up instead of adding threads
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 0; i < io.size() * 2; ++i) {
+        tasks.push_back(io.submit([&] {
+            const int now = running.fetch_add(1) + 1;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            running.fetch_sub(1);
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+    EXPECT_LE(static_cast<size_t>(peak.load()), io.size());
+}
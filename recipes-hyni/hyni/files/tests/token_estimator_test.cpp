@@ -0,0 +1,122 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/token_estimator.h"
+#include "../src/general_context.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+using namespace hyni;
+using json = nlohmann::json;
+
+TEST(TokenEstimatorTest, EmptyTextHasNoTokens) {
+    token_estimator estimator;
+    EXPECT_EQ(estimator.count(""), 0u);
+}
+
+TEST(TokenEstimatorTest, EnglishProseIsInPlausibleRange) {
+    // 10 tokens with the OpenAI tokenizers
+    const std::string text = "The quick brown fox jumps over the lazy dog.";
+    for (const char* provider : {"openai", "claude", "deepseek", "mistral"}) {
+        auto estimator = token_estimator::for_provider(provider);
+        const size_t tokens = estimator.count(text);
+        EXPECT_GE(tokens, 8u) << provider;
+        EXPECT_LE(tokens, 15u) << provider;
+    }
+}
+
+TEST(TokenEstimatorTest, CountGrowsWithText) {
+    auto estimator = token_estimator::for_provider("claude");
+    const std::string sentence = "Hello world, this is a sentence. ";
+    std::string text;
+    size_t previous = 0;
+    for (int i = 0; i < 20; ++i) {
+        text += sentence;
+        const size_t tokens = estimator.count(text);
+        EXPECT_GT(tokens, previous);
+        previous = tokens;
+    }
+}
+
+TEST(TokenEstimatorTest, ProvidersUseDifferentModels) {
+    const std::string digits = "1234567890 0987654321 1122334455";
+    auto openai = token_estimator::for_provider("openai");
+    auto mistral = token_estimator::for_provider("mistral");
+    auto unknown = token_estimator::for_provider("unknown");
+
+    EXPECT_GT(mistral.count(digits), openai.count(digits));
+    EXPECT_EQ(unknown.count(digits), token_estimator().count(digits));
+}
+
+TEST(TokenEstimatorTest, IncrementalCountMatchesWholeText) {
+    auto estimator = token_estimator::for_provider("openai");
+    const std::string text =
+        "Streaming deltas split words like inter|nationalization, numbers like 12|345 "
+        "and  spaced   runs\n\n across chunk boundaries. 東京 café!";
+
+    std::string whole;
+    token_estimator::counter counter(estimator);
+    size_t start = 0;
+    for (size_t pos = text.find('|'); pos != std::string::npos; pos = text.find('|', start)) {
+        counter.append(std::string_view(text).substr(start, pos - start));
+        whole += text.substr(start, pos - start);
+        start = pos + 1;
+    }
+    counter.append(std::string_view(text).substr(start));
+    whole += text.substr(start);
+
+    EXPECT_EQ(counter.tokens(), estimator.count(whole));
+
+    // Byte-by-byte appends give the same statistics
+    token_estimator::counter bytewise(estimator);
+    for (char c : whole) {
+        bytewise.append(std::string_view(&c, 1));
+    }
+    EXPECT_EQ(bytewise.tokens(), counter.tokens());
+    EXPECT_EQ(bytewise.stats().word_runs, counter.stats().word_runs);
+}
+
+TEST(TokenEstimatorTest, MessageCountChargesImagesFlat) {
+    auto estimator = token_estimator::for_provider("claude");
+    const std::string payload(1 << 20, 'A');
+
+    json text_message = {{"role", "user"},
+                         {"content", json::array({{{"type", "text"}, {"text", "Describe this"}}})}};
+    json image_message = text_message;
+    image_message["content"].push_back({{"type", "image"},
+                                        {"source", {{"type", "base64"},
+                                                    {"media_type", "image/png"},
+                                                    {"data", payload}}}});
+
+    const size_t text_tokens = estimator.count_message(text_message);
+    EXPECT_EQ(estimator.count_message(image_message),
+              text_tokens + estimator.model().per_image);
+}
+
+TEST(TokenEstimatorTest, ContextRecordsHistoryEstimate) {
+    std::ifstream file("../schemas/openai.json");
+    if (!file.is_open()) {
+        GTEST_SKIP() << "OpenAI schema file not found";
+    }
+    json schema;
+    file >> schema;
+
+    general_context context(schema);
+    EXPECT_EQ(context.get_estimated_history_tokens(), 0u);
+
+    context.add_user_message("The quick brown fox jumps over the lazy dog.");
+    const size_t first = context.get_estimated_history_tokens();
+    EXPECT_EQ(first, context.get_token_estimator().count_message(context.get_messages()[0]));
+
+    context.add_assistant_message("And then it rested.");
+    EXPECT_GT(context.get_estimated_history_tokens(), first);
+}
@@ -0,0 +1,202 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/traffic_recording.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+#include <unistd.h>
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::local_http_server;
+using json = nlohmann::json;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// A stream of three chunks, 100 ms apart
+recorded_exchange timed_stream() {
+    recorded_exchange exchange;
+    exchange.url = "http://recorded/v1";
+    exchange.request_body = R"({"stream":true})";
+    exchange.streamed = true;
+    exchange.status_code = 200;
+    for (int i = 0; i < 3; ++i) {
+        exchange.chunks.push_back({std::chrono::microseconds(i * 100000), "chunk " + std::to_string(i)});
+    }
+    exchange.duration = std::chrono::microseconds(200000);
+    return exchange;
+}
+
+milliseconds stream_time(traffic_replay& replay, std::vector<std::string>* chunks = nullptr) {
+    const auto start = clock_type::now();
+    auto response = replay.stream("http://recorded/v1", R"({"stream":true})", [&](std::string_view chunk) {
+        if (chunks) chunks->emplace_back(chunk);
+    });
+    EXPECT_TRUE(response.success);
+    return std::chrono::duration_cast<milliseconds>(clock_type::now() - start);
+}
+
+} // anonymous namespace
+
+TEST(TrafficReplayTest, ReplaysChunksAtRecordedOrScaledSpeed) {
+    std::vector<std::string> chunks;
+    traffic_replay recorded_speed({timed_stream()});
+    EXPECT_GE(stream_time(recorded_speed, &chunks), milliseconds(200));
+    EXPECT_EQ(chunks, (std::vector<std::string>{"chunk 0", "chunk 1", "chunk 2"}));
+
+    replay_options fast;
+    fast.speed = 4;
+    traffic_replay accelerated({timed_stream()}, fast);
+    const auto scaled = stream_time(accelerated);
+    EXPECT_GE(scaled, milliseconds(50));
+    EXPECT_LT(scaled, milliseconds(150));
+
+    replay_options instant;
+    instant.speed = 0;
+    traffic_replay immediate({timed_stream()}, instant);
+    EXPECT_LT(stream_time(immediate), milliseconds(20));
+}
+
+TEST(TrafficReplayTest, MatchesRequestsOrServesInOrder) {
+    recorded_exchange first;
+    first.url = "http://recorded/v1";
+    first.request_body = "a";
+    first.status_code = 200;
+    first.body = "answer a";
+    recorded_exchange second = first;
+    second.request_body = "b";
+    second.status_code = 429;
+    second.body = "slow down";
+
+    traffic_replay matched({first, second});
+    EXPECT_EQ(matched.respond("http://recorded/v1", "b").status_code, 429);
+    auto response = matched.respond("http://recorded/v1", "a");
+    EXPECT_TRUE(response.success);
+    EXPECT_EQ(response.body, "answer a");
+    auto unknown = matched.respond("http://recorded/v1", "c");
+    EXPECT_FALSE(unknown.success);
+    EXPECT_FALSE(unknown.error_message.empty());
+
+    replay_options in_order;
+    in_order.match_requests = false;
+    traffic_replay ordered({first, second}, in_order);
+    EXPECT_EQ(ordered.respond("http://other", "x").body, "answer a");
+    EXPECT_EQ(ordered.respond("http://other", "y").body, "slow down");
+    EXPECT_EQ(ordered.respond("http://other", "z").body, "answer a");
+}
+
+TEST(TrafficReplayTest, CancelCheckStopsPlayback) {
+    traffic_replay replay({timed_stream()});
+    std::vector<std::string> chunks;
+    const auto start = clock_type::now();
+    auto response = replay.stream("http://recorded/v1", R"({"stream":true})",
+                                  [&](std::string_view chunk) { chunks.emplace_back(chunk); },
+                                  [&] { return !chunks.empty(); });
+    EXPECT_FALSE(response.success);
+    EXPECT_EQ(chunks.size(), 1u);
+    EXPECT_LT(clock_type::now() - start, milliseconds(80));
+}
+
+class TrafficRecordingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        m_server = std::make_unique<local_http_server>([](const local_http_request& request) {
+            const json body = json::parse(request.body);
+            local_http_response response;
+            response.headers.push_back({"x-request-id", "req-1"});
+            if (body.value("stream", false)) {
+                response.content_type = "text/event-stream";
+                for (const char* word : {"Hello", " there"}) {
+                    json chunk = {{"choices", {{{"index", 0}, {"delta", {{"content", word}}}}}}};
+                    response.chunks.push_back("data: " + chunk.dump() + "\n\n");
+                }
+                response.chunks.push_back("data: [DONE]\n\n");
+                response.chunk_delay = milliseconds(30);
+                return response;
+            }
+            response.body = json{{"choices", {{{"message", {{"role", "assistant"},
+                                                            {"content", "answer"}}}}}}}.dump();
+            return response;
+        });
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+        m_trace = std::filesystem::temp_directory_path() /
+                  ("hyni_trace_" + std::to_string(::getpid()) + ".bin");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(m_trace);
+    }
+
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("test-key");
+        return std::make_unique<chat_api>(std::move(context));
+    }
+
+    static std::string stream_text(chat_api& api) {
+        std::string text;
+        std::promise<bool> done;
+        api.send_message_stream("story", [&](std::string chunk) { text += chunk; },
+                                [&](const http_response& response) { done.set_value(response.success); });
+        EXPECT_TRUE(done.get_future().get());
+        return text;
+    }
+
+    json m_schema;
+    std::unique_ptr<local_http_server> m_server;
+    std::filesystem::path m_trace;
+};
+
+TEST_F(TrafficRecordingTest, ReplaysRecordedTrafficWithoutNetwork) {
+    {
+        auto recorder = std::make_shared<traffic_recorder>(m_trace);
+        auto api = make_api();
+        api->set_traffic_recorder(recorder);
+        EXPECT_EQ(api->send_message("hi"), "answer");
+        EXPECT_EQ(stream_text(*api), "Hello there");
+        EXPECT_EQ(recorder->size(), 2u);
+    }
+    m_server.reset();
+
+    const auto exchanges = traffic_replay::load(m_trace);
+    ASSERT_EQ(exchanges.size(), 2u);
+    EXPECT_FALSE(exchanges[0].streamed);
+    EXPECT_EQ(exchanges[0].headers.at("x-request-id"), "req-1");
+    EXPECT_TRUE(exchanges[1].streamed);
+    EXPECT_FALSE(exchanges[1].chunks.empty());
+    EXPECT_GE(exchanges[1].duration, std::chrono::microseconds(60000));
+    for (const auto& exchange : exchanges) {
+        EXPECT_EQ(exchange.request_body.find("test-key"), std::string::npos);
+    }
+
+    replay_options options;
+    options.speed = 0;
+    auto api = make_api();
+    api->set_traffic_replay(std::make_shared<traffic_replay>(m_trace, options));
+    EXPECT_EQ(api->send_message("hi"), "answer");
+    EXPECT_EQ(stream_text(*api), "Hello there");
+    EXPECT_THROW(api->send_message("never recorded"), std::runtime_error);
+}
+
+TEST_F(TrafficRecordingTest, RejectsFilesThatAreNotTraces) {
+    std::ofstream(m_trace) << "not a trace";
+    EXPECT_THROW(traffic_replay::load(m_trace), std::runtime_error);
+}
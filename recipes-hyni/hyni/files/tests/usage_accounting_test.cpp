@@ -0,0 +1,246 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include "../src/chat_api.h"
+#include "../src/usage_accounting.h"
+#include "local_http_server.h"
+#include <fstream>
+#include <future>
+#include <thread>
+
+using namespace hyni;
+using hyni::testing::local_http_request;
+using hyni::testing::local_http_response;
+using hyni::testing::local_http_server;
+using json = nlohmann::json;
+
+TEST(TokenUsageTest, ReadsEveryProviderFormat) {
+    // Anthropic: cache reads and writes are counted apart from input_tokens
+    auto claude = token_usage::from_json(json{{"input_tokens", 10}, {"output_tokens", 20},
+                                              {"cache_read_input_tokens", 100},
+                                              {"cache_creation_input_tokens", 5}});
+    EXPECT_EQ(claude.input_tokens, 115u);
+    EXPECT_EQ(claude.output_tokens, 20u);
+    EXPECT_EQ(claude.cached_tokens, 100u);
+
+    auto openai = token_usage::from_json(json{{"prompt_tokens", 50}, {"completion_tokens", 7},
+                                              {"total_tokens", 57},
+                                              {"prompt_tokens_details", {{"cached_tokens", 32}}}});
+    EXPECT_EQ(openai.input_tokens, 50u);
+    EXPECT_EQ(openai.output_tokens, 7u);
+    EXPECT_EQ(openai.cached_tokens, 32u);
+    EXPECT_EQ(openai.total_tokens(), 57u);
+
+    auto deepseek = token_usage::from_json(json{{"prompt_tokens", 40}, {"completion_tokens", 3},
+                                                {"prompt_cache_hit_tokens", 24}});
+    EXPECT_EQ(deepseek.cached_tokens, 24u);
+
+    EXPECT_TRUE(token_usage::from_json(json("nonsense")).empty());
+}
+
+TEST(TokenUsageTest, StreamReportsKeepTheLargestCounts) {
+    token_usage usage;
+    usage.update(token_usage::from_json(json{{"input_tokens", 25}, {"output_tokens", 1}}));
+    usage.update(token_usage::from_json(json{{"output_tokens", 15}}));
+    EXPECT_EQ(usage.input_tokens, 25u);
+    EXPECT_EQ(usage.output_tokens, 15u);
+}
+
+TEST(UsageLedgerTest, AggregatesPerProviderModelKeyAndTag) {
+    usage_ledger ledger;
+    ledger.record("openai", "gpt-4o", "sk-secret-1234", "search", {100, 10, 50});
+    ledger.record("openai", "gpt-4o", "sk-secret-1234", "search", {200, 20, 0});
+    ledger.record("openai", "gpt-4o", "sk-secret-1234", "chat", {1, 1, 0});
+    ledger.record("claude", "claude-sonnet", "sk-ant-abcd", "search", {5, 5, 0});
+
+    const auto snapshot = ledger.snapshot();
+    EXPECT_EQ(snapshot.entries.size(), 3u);
+    for (const auto& entry : snapshot.entries) {
+        EXPECT_EQ(entry.api_key.find("secret"), std::string::npos); // Keys are redacted
+    }
+
+    usage_filter search;
+    search.tag = "search";
+    const auto searched = ledger.total(search);
+    EXPECT_EQ(searched.requests, 3u);
+    EXPECT_EQ(searched.usage.input_tokens, 305u);
+    EXPECT_EQ(searched.usage.cached_tokens, 50u);
+
+    usage_filter key;
+    key.api_key = usage_ledger::api_key_id("sk-secret-1234");
+    EXPECT_EQ(ledger.total(key).usage.total_tokens(), 332u);
+    EXPECT_EQ(ledger.total().requests, 4u);
+
+    ledger.reset();
+    EXPECT_TRUE(ledger.snapshot().entries.empty());
+}
+
+TEST(UsageLedgerTest, KeysSharingTheirTailStayApart) {
+    usage_ledger ledger;
+    ledger.record("openai", "gpt-4o", "sk-team-a-1234", "", {10, 1, 0});
+    ledger.record("openai", "gpt-4o", "sk-team-b-1234", "", {20, 2, 0});
+    EXPECT_EQ(ledger.snapshot().entries.size(), 2u);
+    EXPECT_NE(usage_ledger::api_key_id("sk-team-a-1234"), usage_ledger::api_key_id("sk-team-b-1234"));
+
+    usage_filter key;
+    key.api_key = usage_ledger::api_key_id("sk-team-b-1234");
+    EXPECT_EQ(ledger.total(key).usage.input_tokens, 20u);
+}
+
+TEST(UsageLedgerTest, OverflowKeepsTotalsRight) {
+    usage_ledger ledger(2);
+    for (int i = 0; i < 5; ++i) {
+        ledger.record("openai", "model-" + std::to_string(i), "", "", {10, 1, 0});
+    }
+    const auto totals = ledger.total();
+    EXPECT_EQ(totals.requests, 5u);
+    EXPECT_EQ(totals.usage.input_tokens, 50u);
+
+    usage_filter overflow;
+    overflow.provider = "*";
+    EXPECT_EQ(ledger.total(overflow).requests, 3u);
+}
+
+TEST(UsageLedgerTest, ConcurrentRecordsAreExact) {
+    usage_ledger ledger;
+    constexpr int THREADS = 4;
+    constexpr int RECORDS = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&ledger, t] {
+            for (int i = 0; i < RECORDS; ++i) {
+                // A shared key and one key per thread, claimed concurrently
+                ledger.record("openai", "gpt-4o", "", "shared", {1, 2, 0});
+                ledger.record("openai", "gpt-4o", "", "thread-" + std::to_string(t), {1, 0, 0});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    usage_filter shared;
+    shared.tag = "shared";
+    EXPECT_EQ(ledger.total(shared).requests, static_cast<uint64_t>(THREADS * RECORDS));
+    EXPECT_EQ(ledger.total(shared).usage.output_tokens, static_cast<uint64_t>(2 * THREADS * RECORDS));
+    EXPECT_EQ(ledger.total().usage.input_tokens, static_cast<uint64_t>(2 * THREADS * RECORDS));
+    EXPECT_EQ(ledger.snapshot().entries.size(), static_cast<size_t>(THREADS + 1));
+}
+
+class UsageAccountingApiTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::ifstream file("../schemas/openai.json");
+        if (!file.is_open()) GTEST_SKIP() << "OpenAI schema file not found";
+        file >> m_schema;
+        m_server = std::make_unique<local_http_server>([](const local_http_request& request) {
+            const json body = json::parse(request.body);
+            local_http_response response;
+            const json usage = {{"prompt_tokens", 12}, {"completion_tokens", 3},
+                                {"prompt_tokens_details", {{"cached_tokens", 8}}}};
+            if (body.value("stream", false)) {
+                response.content_type = "text/event-stream";
+                json delta = {{"choices", {{{"index", 0}, {"delta", {{"content", "Hi"}}}}}}};
+                response.chunks.push_back("data: " + delta.dump() + "\n\n");
+                // Like OpenAI, usage is only streamed when asked for
+                if (body.contains("stream_options") && body["stream_options"].value("include_usage", false)) {
+                    response.chunks.push_back("data: " + json{{"choices", json::array()}, {"usage", usage}}.dump() + "\n\n");
+                }
+                response.chunks.push_back("data: [DONE]\n\n");
+                return response;
+            }
+            if (body.contains("stream_options")) {
+                // OpenAI rejects stream_options on requests that do not stream
+                response.status = 400;
+                response.body = R"({"error":{"message":"stream_options requires stream","type":"invalid_request_error"}})";
+                return response;
+            }
+            response.body = json{{"choices", {{{"message", {{"role", "assistant"}, {"content", "Hi"}}}}}},
+                                 {"usage", usage}}.dump();
+            return response;
+        });
+        m_schema["api"]["endpoint"] = m_server->url("/v1/chat/completions");
+    }
+
+    std::unique_ptr<chat_api> make_api() {
+        auto context = std::make_unique<general_context>(m_schema);
+        context->set_api_key("sk-test-key-9876");
+        context->set_parameter("temperature", 0.0);
+        auto api = std::make_unique<chat_api>(std::move(context));
+        api->set_transport(m_transport);
+        api->set_response_cache(m_cache);
+        api->set_usage_ledger(m_ledger);
+        api->set_usage_tag("tenant-a");
+        return api;
+    }
+
+    json m_schema;
+    std::unique_ptr<local_http_server> m_server;
+    async_transport m_transport;
+    response_cache m_cache;
+    usage_ledger m_ledger;
+};
+
+TEST_F(UsageAccountingApiTest, AccountsResponsesButNotCacheHits) {
+    auto api = make_api();
+    EXPECT_EQ(api->send_message("hello"), "Hi");
+    EXPECT_EQ(api->send_message("hello"), "Hi"); // From the response cache
+    EXPECT_EQ(sync_wait(api->co_send_message("again")), "Hi");
+
+    const auto snapshot = m_ledger.snapshot();
+    ASSERT_EQ(snapshot.entries.size(), 1u);
+    const usage_entry& entry = snapshot.entries.front();
+    EXPECT_EQ(entry.provider, "openai");
+    EXPECT_EQ(entry.model, api->get_context().get_model());
+    EXPECT_EQ(entry.api_key, usage_ledger::api_key_id("sk-test-key-9876"));
+    EXPECT_EQ(entry.api_key.substr(entry.api_key.size() - 7), "...9876");
+    EXPECT_EQ(entry.tag, "tenant-a");
+    EXPECT_EQ(entry.totals.requests, 2u);
+    EXPECT_EQ(entry.totals.usage.input_tokens, 24u);
+    EXPECT_EQ(entry.totals.usage.output_tokens, 6u);
+    EXPECT_EQ(entry.totals.usage.cached_tokens, 16u);
+}
+
+TEST_F(UsageAccountingApiTest, AccountsStreams) {
+    auto api = make_api();
+    std::promise<void> done;
+    api->send_message_stream("hello", [](std::string) {},
+                             [&](const http_response&) { done.set_value(); });
+    done.get_future().get();
+
+    auto read_all = [&]() -> task<std::string> {
+        auto stream = api->co_send_message_stream("again");
+        std::string text;
+        while (auto delta = co_await stream.next()) {
+            text += *delta;
+        }
+        co_return text;
+    };
+    EXPECT_EQ(sync_wait(read_all()), "Hi");
+
+    const auto snapshot = m_ledger.snapshot();
+    ASSERT_EQ(snapshot.entries.size(), 1u);
+    EXPECT_EQ(snapshot.entries.front().provider, "openai");
+    const auto totals = m_ledger.total();
+    EXPECT_EQ(totals.requests, 2u);
+    EXPECT_EQ(totals.usage.input_tokens, 24u);
+    EXPECT_EQ(totals.usage.output_tokens, 6u);
+}
+
+TEST_F(UsageAccountingApiTest, AccountsBatches) {
+    auto api = make_api();
+    const std::vector<std::string> prompts = {"one", "two", "three"};
+    auto results = api->send_batch(prompts);
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_EQ(m_ledger.total().requests, 3u);
+    EXPECT_EQ(m_ledger.total().usage.output_tokens, 9u);
+}